@@ -1,5 +1,6 @@
 use criterion::{black_box, criterion_group, criterion_main, Criterion};
-use sixcy::codec::{Codec, ZstdCodec, Lz4Codec};
+use sixcy::block::{content_hash, encode_block, encode_block_into, BlockType};
+use sixcy::codec::{Codec, CodecId, ZstdCodec, Lz4Codec};
 
 fn bench_compression(c: &mut Criterion) {
     let data = vec![0u8; 1024 * 1024]; // 1MB of zeros
@@ -10,5 +11,40 @@ fn bench_compression(c: &mut Criterion) {
     c.bench_function("lz4_compress_1mb", |b| b.iter(|| lz4.compress(black_box(&data), 0)));
 }
 
-criterion_group!(benches, bench_compression);
+/// Fresh output buffer per block vs one buffer reused across blocks.  The
+/// gap between each pair is the allocator's share of encoding a block.
+fn bench_buffer_reuse(c: &mut Criterion) {
+    // 4 MiB (the default chunk size) of mildly compressible bytes.
+    let data: Vec<u8> = (0..4u32 << 20).map(|i| (i.wrapping_mul(2_654_435_761) >> 27) as u8).collect();
+
+    for (name, codec) in [("lz4", CodecId::Lz4), ("zstd", CodecId::Zstd)] {
+        c.bench_function(&format!("encode_block_{name}_4mb_fresh"), |b| b.iter(|| {
+            encode_block(BlockType::Data, 0, 0, black_box(&data), codec, 1, None).unwrap()
+        }));
+
+        let mut payload = Vec::new();
+        c.bench_function(&format!("encode_block_{name}_4mb_reused"), |b| b.iter(|| {
+            let hash = content_hash(&data);
+            encode_block_into(BlockType::Data, 0, 0, black_box(&data), hash, codec, 1, 1, None, None,
+                              &mut payload).unwrap()
+        }));
+    }
+}
+
+/// Same block with and without AES-256-GCM; the gap is the cost of sealing.
+fn bench_encryption(c: &mut Criterion) {
+    let data: Vec<u8> = (0..4u32 << 20).map(|i| (i.wrapping_mul(2_654_435_761) >> 27) as u8).collect();
+    let key = [0x42u8; 32];
+
+    for (name, key) in [("plain", None), ("aes256gcm", Some(&key))] {
+        let mut payload = Vec::new();
+        c.bench_function(&format!("encode_block_lz4_4mb_{name}"), |b| b.iter(|| {
+            let hash = content_hash(&data);
+            encode_block_into(BlockType::Data, 0, 0, black_box(&data), hash, CodecId::Lz4, 1, 1, key, None,
+                              &mut payload).unwrap()
+        }));
+    }
+}
+
+criterion_group!(benches, bench_compression, bench_buffer_reuse, bench_encryption);
 criterion_main!(benches);
@@ -0,0 +1,657 @@
+//! Benchmarks for the paths an archive actually goes through: codecs, block
+//! encode/decode (also with an intra-block thread budget), verified decode,
+//! `SixCyWriter` packing, `SixCyReader` extraction and `read_at`,
+//! write-behind and read-ahead file I/O, the CAS table, recovery scanning
+//! and plugin dispatch.
+//!
+//! Every group but `dedup` (lookups per second) reports throughput in
+//! uncompressed bytes per second.  The
+//! corpora are generated from fixed seeds, so every machine measures the
+//! same input:
+//!
+//! | corpus   | stands in for                                    |
+//! |----------|--------------------------------------------------|
+//! | `text`   | source code, logs, prose                         |
+//! | `binary` | executables and structured records               |
+//! | `media`  | already-compressed images, video and archives    |
+//! | `small`  | many small files (2,000 text files of 1–8 KiB)   |
+//! | `sparse` | a VM disk image, three quarters zero pages       |
+//!
+//! Run everything with `cargo bench --bench pipeline_bench`, one group with
+//! e.g. `cargo bench --bench pipeline_bench -- pack/`, and the Rayon groups
+//! with `--features parallel`.  See BENCHMARK.md §11.
+
+use std::fs::File;
+use std::collections::HashMap;
+use std::io::{Cursor, Seek, Write};
+use std::time::{Duration, Instant};
+
+use criterion::{black_box, criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput};
+use sixcy::block::{content_hash, decode_block_into, encode_block, encode_block_into, BlockType};
+use sixcy::codec::{get_codec, registry, CodecId};
+use sixcy::io_stream::{default_threads, DedupTable, SixCyReader, SixCyWriter, WriteBehind,
+                       DEFAULT_DEDUP_MEMORY, DEFAULT_SOLID_BLOCK_SIZE, DEFAULT_WRITE_DEPTH};
+use sixcy::plugin::{rc, SixcyCodecPlugin};
+use sixcy::recovery;
+
+const KIB: usize = 1024;
+const MIB: usize = 1024 * KIB;
+const KEY: [u8; 32] = [0x42; 32];
+
+// ── Corpora ──────────────────────────────────────────────────────────────────
+
+struct Rng(u64);
+
+impl Rng {
+    fn new(seed: u64) -> Self { Self(seed | 1) }
+
+    fn next(&mut self) -> u64 {
+        self.0 ^= self.0 << 13;
+        self.0 ^= self.0 >> 7;
+        self.0 ^= self.0 << 17;
+        self.0
+    }
+}
+
+/// Words drawn with a bias toward the front of the list, like real text.
+fn text(len: usize, seed: u64) -> Vec<u8> {
+    const WORDS: &[&str] = &[
+        "the", "of", "and", "block", "to", "a", "in", "archive", "is", "chunk", "for", "index",
+        "let", "fn", "return", "self", "codec", "offset", "error", "data", "file", "size",
+        "=>", "{", "}", "match", "Some(x)", "None", "0x1f", "compressed", "header", "payload",
+    ];
+    let mut rng = Rng::new(seed);
+    let mut out = Vec::with_capacity(len + 16);
+    while out.len() < len {
+        let r = rng.next();
+        let i = ((r % WORDS.len() as u64) as usize).min(((r >> 32) % WORDS.len() as u64) as usize);
+        out.extend_from_slice(WORDS[i].as_bytes());
+        out.push(if r >> 60 == 0 { b'\n' } else { b' ' });
+    }
+    out.truncate(len);
+    out
+}
+
+/// Fixed-layout records: counters, timestamps, small integers, padding and
+/// a little noise — roughly what executables and databases look like.
+fn binary(len: usize, seed: u64) -> Vec<u8> {
+    let mut rng = Rng::new(seed);
+    let mut out = Vec::with_capacity(len + 64);
+    let (mut id, mut time) = (0u32, 1_700_000_000_000u64);
+    while out.len() < len {
+        id   += 1;
+        time += rng.next() % 1000;
+        out.extend_from_slice(&id.to_le_bytes());
+        out.extend_from_slice(&time.to_le_bytes());
+        out.extend_from_slice(&((rng.next() % 10_000) as u32).to_le_bytes());
+        out.extend_from_slice(&[0u8; 12]);
+        out.extend_from_slice(&rng.next().to_le_bytes());
+        out.extend_from_slice(b"\x48\x8b\x45\xf8\x48\x89\xc7\xe8");
+        out.extend_from_slice(&[(id % 7) as u8; 16]);
+    }
+    out.truncate(len);
+    out
+}
+
+/// Incompressible bytes.
+fn media(len: usize, seed: u64) -> Vec<u8> {
+    let mut rng = Rng::new(seed);
+    let mut out = Vec::with_capacity(len + 8);
+    while out.len() < len {
+        out.extend_from_slice(&rng.next().to_le_bytes());
+    }
+    out.truncate(len);
+    out
+}
+
+fn small_files() -> Vec<(String, Vec<u8>)> {
+    let mut rng = Rng::new(99);
+    (0..2000)
+        .map(|i| {
+            let len = KIB + (rng.next() % (7 * KIB as u64)) as usize;
+            (format!("src/file_{i:04}.rs"), text(len, i as u64 + 1))
+        })
+        .collect()
+}
+
+/// A 16 MiB mix of the three large corpora, as three files.
+fn mixed() -> Vec<(String, Vec<u8>)> {
+    vec![
+        ("text.log".into(),   text(8 * MIB, 1)),
+        ("binary.bin".into(), binary(4 * MIB, 2)),
+        ("media.jpg".into(),  media(4 * MIB, 3)),
+    ]
+}
+
+/// A 64 MiB disk image: every fourth MiB holds `binary` records, the rest
+/// is zeros.
+fn sparse() -> Vec<(String, Vec<u8>)> {
+    let image = (0..64u64)
+        .flat_map(|i| if i % 4 == 0 { binary(MIB, i + 1) } else { vec![0u8; MIB] })
+        .collect();
+    vec![("disk.img".into(), image)]
+}
+
+fn total(files: &[(String, Vec<u8>)]) -> u64 {
+    files.iter().map(|(_, d)| d.len() as u64).sum()
+}
+
+struct Pack {
+    chunk:   usize,
+    codec:   CodecId,
+    level:   i32,
+    key:     Option<[u8; 32]>,
+    threads: usize,
+    solid:   bool,
+    /// Decoded bytes per SOLID block.
+    solid_block: usize,
+}
+
+impl Default for Pack {
+    fn default() -> Self {
+        Self {
+            chunk: MIB, codec: CodecId::Zstd, level: 3, key: None, threads: 1, solid: false,
+            solid_block: DEFAULT_SOLID_BLOCK_SIZE,
+        }
+    }
+}
+
+fn pack(files: &[(String, Vec<u8>)], p: &Pack) -> Vec<u8> {
+    let mut out = Cursor::new(Vec::new());
+    pack_to(&mut out, files, p);
+    out.into_inner()
+}
+
+fn pack_to<W: Write + Seek>(out: W, files: &[(String, Vec<u8>)], p: &Pack) {
+    let mut w = SixCyWriter::with_options(out, p.chunk, p.level, p.key).unwrap();
+    w.threads = p.threads;
+    w.solid_block_size = p.solid_block;
+    if p.solid {
+        w.start_solid_session(p.codec).unwrap();
+    }
+    for (name, data) in files {
+        w.add_file(name.clone(), data, p.codec).unwrap();
+    }
+    w.finalize().unwrap();
+}
+
+/// 1, 2, 4, … up to the core count.
+fn thread_counts() -> Vec<usize> {
+    let max = default_threads();
+    let mut v: Vec<usize> = std::iter::successors(Some(1), |n| Some(n * 2)).take_while(|&n| n < max).collect();
+    v.push(max);
+    v
+}
+
+// ── Codecs ───────────────────────────────────────────────────────────────────
+
+fn bench_codecs(c: &mut Criterion) {
+    let corpora = [("text", text(MIB, 1)), ("binary", binary(MIB, 2)), ("media", media(MIB, 3))];
+    let settings = [
+        (CodecId::None, 0), (CodecId::Lz4, 0),
+        (CodecId::Zstd, 1), (CodecId::Zstd, 3), (CodecId::Zstd, 9), (CodecId::Zstd, 19),
+        (CodecId::Brotli, 1), (CodecId::Brotli, 6), (CodecId::Brotli, 11),
+        (CodecId::Lzma, 0),
+    ];
+
+    let mut g = c.benchmark_group("codec");
+    g.sample_size(10);
+    for (corpus, data) in &corpora {
+        g.throughput(Throughput::Bytes(data.len() as u64));
+        for &(id, level) in &settings {
+            let codec = get_codec(id).unwrap();
+            let name  = format!("{}-{level}", id.name());
+
+            let mut buf = Vec::new();
+            g.bench_with_input(BenchmarkId::new(format!("compress/{name}"), corpus), data, |b, data| {
+                b.iter(|| { buf.clear(); codec.compress_into(black_box(data), level, &mut buf).unwrap() })
+            });
+
+            let compressed = codec.compress(data, level).unwrap();
+            let mut out = vec![0u8; data.len()];
+            g.bench_with_input(BenchmarkId::new(format!("decompress/{name}"), corpus), &compressed, |b, src| {
+                b.iter(|| codec.decompress_into(black_box(src), &mut out).unwrap())
+            });
+        }
+    }
+    g.finish();
+}
+
+// ── Blocks ───────────────────────────────────────────────────────────────────
+
+/// Hash + compress + seal, and open + decompress + verify, on one 4 MiB
+/// chunk — the per-block work of the writer and reader.
+fn bench_blocks(c: &mut Criterion) {
+    let data = text(4 * MIB, 7);
+    let mut g = c.benchmark_group("block");
+    g.throughput(Throughput::Bytes(data.len() as u64));
+
+    for id in [CodecId::Lz4, CodecId::Zstd] {
+        for (mode, key) in [("plain", None), ("aes256gcm", Some(&KEY))] {
+            let name = format!("{}/{mode}", id.name());
+            let mut payload = Vec::new();
+            g.bench_function(BenchmarkId::new("encode", &name), |b| b.iter(|| {
+                let hash = content_hash(black_box(&data));
+                encode_block_into(BlockType::Data, 0, 0, &data, hash, id, 3, 1, key, None, &mut payload).unwrap()
+            }));
+
+            let (header, on_disk) = encode_block(BlockType::Data, 0, 0, &data, id, 3, key).unwrap();
+            let mut out = vec![0u8; data.len()];
+            g.bench_function(BenchmarkId::new("decode", &name), |b| b.iter(|| {
+                decode_block_into(&header, black_box(&on_disk), key, None, 1, &mut out).unwrap()
+            }));
+        }
+    }
+    g.finish();
+}
+
+/// One 32 MiB block with the codec allowed 1, 4 or every core, as a large
+/// SOLID block is written with `block_threads` set and read by a single
+/// reader.  Zstd decodes one frame serially; `lzma-mt` also decodes in
+/// parallel.
+fn bench_block_threads(c: &mut Criterion) {
+    let data = text(32 * MIB, 8);
+    let mut g = c.benchmark_group("block_threads");
+    g.sample_size(10);
+    g.throughput(Throughput::Bytes(data.len() as u64));
+
+    let hash = content_hash(&data);
+    for (id, level) in [(CodecId::Zstd, 3), (CodecId::Zstd, 19), (CodecId::LzmaMt, 0)] {
+        let name = format!("{}-{level}", id.name());
+        for threads in [1, 4, default_threads()] {
+            let mut payload = Vec::new();
+            g.bench_function(BenchmarkId::new(format!("encode/{name}"), threads), |b| b.iter(|| {
+                encode_block_into(BlockType::Data, 0, 0, black_box(&data), hash, id, level, threads, None, None,
+                                  &mut payload).unwrap()
+            }));
+        }
+        let (header, on_disk) = encode_block(BlockType::Data, 0, 0, &data, id, level, None).unwrap();
+        let mut out = vec![0u8; data.len()];
+        for threads in [1, 4, default_threads()] {
+            g.bench_function(BenchmarkId::new(format!("decode/{name}"), threads), |b| b.iter(|| {
+                decode_block_into(&header, black_box(&on_disk), None, None, threads, &mut out).unwrap()
+            }));
+        }
+    }
+    g.finish();
+}
+
+/// Verified Zstd decode, as `decode_block_into` does it: a bulk decode into
+/// the output followed by one BLAKE3 pass (`bulk`), against a streaming
+/// decode through 128 KiB output windows hashed as each is written
+/// (`windowed`).  `decode` is the bulk decode alone, the floor for both.
+fn bench_verify(c: &mut Criterion) {
+    const WINDOW: usize = 128 * KIB;
+    let zstd = get_codec(CodecId::Zstd).unwrap();
+    let mut g = c.benchmark_group("verify");
+    for size in [256 * KIB, 4 * MIB, 32 * MIB] {
+        let data = text(size, 9);
+        let payload = zstd.compress(&data, 3).unwrap();
+        let mut out = vec![0u8; size];
+        let label = format!("{} KiB", size / KIB);
+        g.throughput(Throughput::Bytes(size as u64));
+        g.bench_function(BenchmarkId::new("decode", &label), |b| b.iter(|| {
+            zstd.decompress_into(black_box(&payload), &mut out).unwrap()
+        }));
+        g.bench_function(BenchmarkId::new("bulk", &label), |b| b.iter(|| {
+            zstd.decompress_into_hashed(black_box(&payload), &mut out).unwrap()
+        }));
+        let mut decoder = zstd::stream::raw::Decoder::new().unwrap();
+        g.bench_function(BenchmarkId::new("windowed", &label), |b| b.iter(|| {
+            use zstd::stream::raw::Operation;
+            decoder.reinit().unwrap();
+            let mut hasher = blake3::Hasher::new();
+            let (mut read, mut written) = (0, 0);
+            while read < payload.len() || written < out.len() {
+                let end = out.len().min(written + WINDOW);
+                let st = decoder.run_on_buffers(&payload[read..], &mut out[written..end]).unwrap();
+                hasher.update(&out[written..written + st.bytes_written]);
+                read    += st.bytes_read;
+                written += st.bytes_written;
+                if st.remaining == 0 && read == payload.len() { break; }
+            }
+            hasher.finalize()
+        }));
+    }
+    g.finish();
+}
+
+// ── Pack ─────────────────────────────────────────────────────────────────────
+
+fn bench_pack(c: &mut Criterion) {
+    let files = mixed();
+    let mut g = c.benchmark_group("pack");
+    g.sample_size(10);
+    g.throughput(Throughput::Bytes(total(&files)));
+
+    for chunk in [64 * KIB, 256 * KIB, MIB, 4 * MIB] {
+        let p = Pack { chunk, threads: default_threads(), ..Pack::default() };
+        g.bench_function(BenchmarkId::new("chunk", format!("{}KiB", chunk / KIB)), |b| {
+            b.iter(|| pack(black_box(&files), &p))
+        });
+    }
+    for threads in thread_counts() {
+        let p = Pack { threads, ..Pack::default() };
+        g.bench_function(BenchmarkId::new("threads", threads), |b| b.iter(|| pack(black_box(&files), &p)));
+    }
+    for (mode, key) in [("plain", None), ("aes256gcm", Some(KEY))] {
+        let p = Pack { key, threads: default_threads(), ..Pack::default() };
+        g.bench_function(BenchmarkId::new("encryption", mode), |b| b.iter(|| pack(black_box(&files), &p)));
+    }
+
+    // The same bytes twice: the second copy is all CAS hits.
+    let twice: Vec<_> = files.iter().cloned().chain(files.iter().map(|(n, d)| (format!("copy/{n}"), d.clone())))
+        .collect();
+    g.throughput(Throughput::Bytes(total(&twice)));
+    let p = Pack { threads: default_threads(), ..Pack::default() };
+    g.bench_function("dedup/2x", |b| b.iter(|| pack(black_box(&twice), &p)));
+
+    let small = small_files();
+    g.throughput(Throughput::Bytes(total(&small)));
+    for (mode, solid) in [("separate", false), ("solid", true)] {
+        let p = Pack { solid, ..Pack::default() };
+        g.bench_function(BenchmarkId::new("small_files", mode), |b| b.iter(|| pack(black_box(&small), &p)));
+    }
+
+    // Zero chunks become fill blocks: detected, hashed once, never compressed.
+    let image = sparse();
+    g.throughput(Throughput::Bytes(total(&image)));
+    let p = Pack { threads: default_threads(), ..Pack::default() };
+    g.bench_function("sparse", |b| b.iter(|| pack(black_box(&image), &p)));
+    g.finish();
+}
+
+// ── Unpack ───────────────────────────────────────────────────────────────────
+
+fn bench_unpack(c: &mut Criterion) {
+    let files = mixed();
+    let mut g = c.benchmark_group("unpack");
+    g.sample_size(10);
+    g.throughput(Throughput::Bytes(total(&files)));
+
+    for (mode, key) in [("plain", None), ("aes256gcm", Some(KEY))] {
+        let archive = pack(&files, &Pack { key, threads: default_threads(), ..Pack::default() });
+        let mut r = SixCyReader::with_key(Cursor::new(archive), key).unwrap();
+        r.set_cache_budget(0);
+        g.bench_function(BenchmarkId::new("serial", mode), |b| b.iter(|| {
+            for id in 0..files.len() as u32 {
+                black_box(r.unpack_file(id).unwrap());
+            }
+        }));
+        for threads in thread_counts() {
+            r.threads = threads;
+            g.bench_function(BenchmarkId::new(format!("parallel/{mode}"), threads), |b| b.iter(|| {
+                for id in 0..files.len() as u32 {
+                    black_box(r.unpack_file_parallel(id).unwrap());
+                }
+            }));
+        }
+    }
+
+    let small   = small_files();
+    let archive = pack(&small, &Pack { solid: true, ..Pack::default() });
+    let mut r   = SixCyReader::new(Cursor::new(archive)).unwrap();
+    g.throughput(Throughput::Bytes(total(&small)));
+    g.bench_function("small_files/solid", |b| b.iter(|| {
+        for id in 0..small.len() as u32 {
+            black_box(r.unpack_file(id).unwrap());
+        }
+    }));
+
+    let image   = sparse();
+    let archive = pack(&image, &Pack { threads: default_threads(), ..Pack::default() });
+    let mut r   = SixCyReader::new(Cursor::new(archive)).unwrap();
+    r.set_cache_budget(0);
+    g.throughput(Throughput::Bytes(total(&image)));
+    g.bench_function("sparse", |b| b.iter(|| black_box(r.unpack_file_parallel(0).unwrap())));
+    g.finish();
+}
+
+// ── read_at ──────────────────────────────────────────────────────────────────
+
+/// 4 KiB random reads from a 16 MiB file in 1 MiB blocks.  Cold reads clear
+/// the block cache first, so each one decodes a block; warm reads find it
+/// cached.
+fn bench_read_at(c: &mut Criterion) {
+    const READ: usize = 4 * KIB;
+    let data    = text(16 * MIB, 5);
+    let archive = pack(&[("f".into(), data.clone())], &Pack::default());
+    let mut r   = SixCyReader::new(Cursor::new(archive)).unwrap();
+    let mut rng = Rng::new(11);
+    let mut buf = vec![0u8; READ];
+
+    let mut g = c.benchmark_group("read_at");
+    g.throughput(Throughput::Bytes(READ as u64));
+
+    g.bench_function("cold", |b| b.iter_custom(|iters| {
+        let mut spent = Duration::ZERO;
+        for _ in 0..iters {
+            let offset = rng.next() % (data.len() - READ) as u64;
+            r.cache().clear();
+            let start = Instant::now();
+            black_box(r.read_at(0, offset, &mut buf).unwrap());
+            spent += start.elapsed();
+        }
+        spent
+    }));
+
+    let offset = 5 * MIB as u64 + 123;
+    r.read_at(0, offset, &mut buf).unwrap();
+    g.bench_function("warm", |b| b.iter(|| r.read_at(0, black_box(offset), &mut buf).unwrap()));
+
+    g.bench_function("shared/warm", |b| b.iter(|| r.read_at_shared(0, black_box(offset), &mut buf).unwrap()));
+    g.finish();
+
+    // One small member out of a solid session: only the SOLID block(s) it
+    // spans are decoded, so the cost follows the block size.
+    let files = small_files();
+    let mut g = c.benchmark_group("solid_member");
+    for (name, solid_block) in [("256KiB", 256 * KIB), ("1MiB", MIB), ("16MiB", 16 * MIB)] {
+        let archive = pack(&files, &Pack { solid: true, solid_block, ..Pack::default() });
+        let mut r   = SixCyReader::new(Cursor::new(archive)).unwrap();
+        g.bench_function(BenchmarkId::new("cold", name), |b| b.iter_custom(|iters| {
+            let mut spent = Duration::ZERO;
+            for _ in 0..iters {
+                let id = (rng.next() % files.len() as u64) as u32;
+                r.cache().clear();
+                let start = Instant::now();
+                black_box(r.unpack_file(id).unwrap());
+                spent += start.elapsed();
+            }
+            spent
+        }));
+    }
+    g.finish();
+}
+
+// ── File I/O ─────────────────────────────────────────────────────────────────
+
+/// Packing into a real file, written directly vs through `WriteBehind`, and
+/// extraction from an unmapped file by read-ahead depth.  LZ4 at 64 KiB
+/// chunks keeps the codec cheap, so the I/O pattern shows.
+fn bench_io(c: &mut Criterion) {
+    let files = mixed();
+    let path  = std::env::temp_dir().join(format!("sixcy-bench-{}.6cy", std::process::id()));
+    let p     = Pack { chunk: 64 * KIB, codec: CodecId::Lz4, threads: default_threads(), ..Pack::default() };
+
+    let mut g = c.benchmark_group("io");
+    g.sample_size(10);
+    g.throughput(Throughput::Bytes(total(&files)));
+    g.bench_function("write/direct", |b| b.iter(|| pack_to(File::create(&path).unwrap(), &files, &p)));
+    g.bench_function("write/behind", |b| b.iter(|| {
+        let out = WriteBehind::new(File::create(&path).unwrap(), DEFAULT_WRITE_DEPTH).unwrap();
+        pack_to(out, &files, &p)
+    }));
+
+    let mut r = SixCyReader::new(File::open(&path).unwrap()).unwrap();
+    r.set_cache_budget(0);
+    for io_depth in [0, 4, 16] {
+        r.io_depth = io_depth;
+        g.bench_function(BenchmarkId::new("read_ahead", io_depth), |b| b.iter(|| {
+            for id in 0..files.len() as u32 {
+                black_box(r.unpack_file_parallel(id).unwrap());
+            }
+        }));
+    }
+    g.finish();
+    drop(r);
+    let _ = std::fs::remove_file(&path);
+}
+
+// ── CAS table ────────────────────────────────────────────────────────────────
+
+/// Building a CAS table of 1M chunk hashes, then 1M lookups of which half
+/// hit: `HashMap` vs `DedupTable` in memory vs `DedupTable` with every full
+/// hash spilled.
+fn bench_dedup(c: &mut Criterion) {
+    const N: u64 = 1 << 20;
+    let hash = |i: u64| content_hash(&i.to_le_bytes());
+    let stored: Vec<[u8; 32]> = (0..N).map(hash).collect();
+    let probes: Vec<[u8; 32]> = (0..N).map(|i| hash(if i % 2 == 0 { i } else { N + i })).collect();
+
+    let mut g = c.benchmark_group("dedup");
+    g.sample_size(10);
+    g.throughput(Throughput::Elements(N));
+    g.bench_function("insert/hashmap", |b| b.iter(|| {
+        let mut m = HashMap::new();
+        for (i, h) in stored.iter().enumerate() {
+            m.entry(*h).or_insert((256 + i as u64, 1u64));
+        }
+        m
+    }));
+    for (name, budget) in [("table", DEFAULT_DEDUP_MEMORY), ("spilled", 0)] {
+        g.bench_function(BenchmarkId::new("insert", name), |b| b.iter(|| {
+            let mut t = DedupTable::new(budget);
+            for (i, h) in stored.iter().enumerate() {
+                t.insert(*h, (256 + i as u64, 1)).unwrap();
+            }
+            t
+        }));
+    }
+
+    let map: HashMap<[u8; 32], (u64, u64)> = stored.iter().enumerate().map(|(i, h)| (*h, (256 + i as u64, 1))).collect();
+    g.bench_function("lookup/hashmap", |b| b.iter(|| probes.iter().filter(|h| map.contains_key(*h)).count()));
+    for (name, budget) in [("table", DEFAULT_DEDUP_MEMORY), ("spilled", 0)] {
+        let mut t = DedupTable::new(budget);
+        for (i, h) in stored.iter().enumerate() {
+            t.insert(*h, (256 + i as u64, 1)).unwrap();
+        }
+        t.set_budget(budget).unwrap();
+        g.bench_function(BenchmarkId::new("lookup", name), |b| b.iter(|| {
+            probes.iter().filter(|h| t.contains(h).unwrap()).count()
+        }));
+    }
+    g.finish();
+}
+
+// ── Recovery ─────────────────────────────────────────────────────────────────
+
+fn bench_recovery(c: &mut Criterion) {
+    let clean = pack(&mixed(), &Pack { chunk: 256 * KIB, ..Pack::default() });
+    // 1 MiB of garbage in the middle, forcing a resync.
+    let mut damaged = clean.clone();
+    let mid = damaged.len() / 2;
+    damaged[mid..mid + MIB].copy_from_slice(&media(MIB, 13));
+
+    let mut g = c.benchmark_group("recovery");
+    g.sample_size(20);
+    g.throughput(Throughput::Bytes(clean.len() as u64));
+    for (name, bytes) in [("clean", &clean), ("damaged", &damaged)] {
+        let src = Cursor::new(bytes.as_slice());
+        g.bench_function(BenchmarkId::new("scan_at", name), |b| b.iter(|| {
+            recovery::scan_at::<_, fn(u64, u64)>(&src, bytes.len() as u64, None).unwrap()
+        }));
+        g.bench_function(BenchmarkId::new("scan", name), |b| b.iter_batched(
+            || Cursor::new(bytes.as_slice()),
+            |mut cur| recovery::scan::<_, fn(u64, u64)>(&mut cur, 0, None).unwrap(),
+            BatchSize::SmallInput,
+        ));
+    }
+    g.finish();
+}
+
+// ── Plugins ──────────────────────────────────────────────────────────────────
+
+unsafe extern "C" fn copy(i: *const u8, n: u32, o: *mut u8, on: *mut u32) -> i32 {
+    if *on < n { return rc::OVERFLOW; }
+    std::ptr::copy_nonoverlapping(i, o, n as usize);
+    *on = n;
+    rc::OK
+}
+unsafe extern "C" fn copy_c(i: *const u8, n: u32, o: *mut u8, on: *mut u32, _: i32) -> i32 {
+    copy(i, n, o, on)
+}
+unsafe extern "C" fn bound(n: u32) -> u32 { n }
+
+static COPY_PLUGIN: SixcyCodecPlugin = SixcyCodecPlugin {
+    uuid:            [0xBE, 0x4C, 0, 0, 0, 0, 0, 0x40, 0x80, 0, 0, 0, 0, 0, 0, 0x01],
+    short_id:        78,
+    abi_version:     1,
+    compress:        Some(copy_c),
+    decompress:      Some(copy),
+    compress_bound:  Some(bound),
+    ctx_create:      None,
+    ctx_destroy:     None,
+    compress_ctx:    None,
+    decompress_ctx:  None,
+    dict_compress:   None,
+    dict_decompress: None,
+};
+
+/// A pass-through plugin against the built-in None codec: the difference is
+/// the cost of going through the plugin ABI.
+fn bench_plugin(c: &mut Criterion) {
+    let uuid = registry::register_plugin(&COPY_PLUGIN).unwrap();
+    let data = binary(4 * MIB, 17);
+
+    let mut g = c.benchmark_group("plugin");
+    g.throughput(Throughput::Bytes(data.len() as u64));
+    for (name, id) in [("none", CodecId::None), ("passthrough", CodecId::Plugin(uuid))] {
+        let mut payload = Vec::new();
+        g.bench_function(BenchmarkId::new("encode", name), |b| b.iter(|| {
+            let hash = content_hash(black_box(&data));
+            encode_block_into(BlockType::Data, 0, 0, &data, hash, id, 0, 1, None, None, &mut payload).unwrap()
+        }));
+        let (header, on_disk) = encode_block(BlockType::Data, 0, 0, &data, id, 0, None).unwrap();
+        let mut out = vec![0u8; data.len()];
+        g.bench_function(BenchmarkId::new("decode", name), |b| b.iter(|| {
+            decode_block_into(&header, black_box(&on_disk), None, None, 1, &mut out).unwrap()
+        }));
+    }
+    g.finish();
+}
+
+// ── Rayon (`parallel` feature) ───────────────────────────────────────────────
+
+/// Thread scaling of `compress_chunks_parallel` and of hashing one large
+/// chunk, each on a pool of the given size.
+fn bench_rayon(c: &mut Criterion) {
+    #[cfg(feature = "parallel")]
+    {
+        let data   = text(16 * MIB, 21);
+        let chunks: Vec<&[u8]> = data.chunks(MIB).collect();
+        let mut g  = c.benchmark_group("rayon");
+        g.sample_size(10);
+        g.throughput(Throughput::Bytes(data.len() as u64));
+        for threads in thread_counts() {
+            let pool = rayon::ThreadPoolBuilder::new().num_threads(threads).build().unwrap();
+            g.bench_function(BenchmarkId::new("compress_chunks/zstd-3", threads), |b| b.iter(|| {
+                pool.install(|| sixcy::perf::compress_chunks_parallel(black_box(&chunks), CodecId::Zstd, 3).unwrap())
+            }));
+            g.bench_function(BenchmarkId::new("content_hash", threads), |b| b.iter(|| {
+                pool.install(|| content_hash(black_box(&data)))
+            }));
+        }
+        g.finish();
+    }
+    let _ = c;
+}
+
+criterion_group!(
+    benches,
+    bench_codecs, bench_blocks, bench_block_threads, bench_verify, bench_pack, bench_unpack, bench_read_at, bench_io, bench_dedup,
+    bench_recovery,
+    bench_plugin,
+    bench_rayon,
+);
+criterion_main!(benches);
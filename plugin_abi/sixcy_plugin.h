@@ -1,12 +1,14 @@
 /*
  * sixcy_plugin.h — Frozen C ABI for .6cy codec plugins
  *
- * ABI version: 1
+ * ABI version: 3
  * Format:      .6cy v3+
  *
  * ── Stability contract ─────────────────────────────────────────────────────
  *
- *  This header is FROZEN at ABI version 1.
+ *  The ABI version 1 fields of this header are FROZEN.  ABI version 2
+ *  appends the per-thread codec context entry points, ABI version 3 the
+ *  dictionary entry points (see below).
  *
  *  The following NEVER change:
  *    - struct field offsets and types
@@ -40,6 +42,20 @@
  *  All memory is owned by the caller and passed as explicit length-tagged
  *  pointers.  The plugin manages any internal scratch space privately.
  *
+ * ── Codec contexts (ABI v2+) ───────────────────────────────────────────────
+ *
+ *  A plugin with expensive per-call setup (match-finder tables, entropy
+ *  workspaces) may expose an opaque SixcyCodecCtx.  The host creates at most
+ *  one context per plugin per worker thread with fn_ctx_create(), passes it
+ *  to every fn_compress_ctx / fn_decompress_ctx call made on that thread,
+ *  and destroys it with fn_ctx_destroy() when the thread exits.
+ *
+ *  A context is never shared between threads and never used by two calls
+ *  at once, so the *_ctx functions need not lock it.  The stateless
+ *  fn_compress / fn_decompress entry points remain mandatory; the host
+ *  falls back to them when the context fields are NULL or when
+ *  fn_ctx_create() returns NULL.
+ *
  * ── Memory model ───────────────────────────────────────────────────────────
  *
  *  No allocator is shared between host and plugin.
@@ -77,7 +93,7 @@ extern "C" {
 
 /** ABI version implemented by this header.
  *  Written into SixcyCodecPlugin::abi_version by every plugin. */
-#define SIXCY_PLUGIN_ABI_VERSION  UINT32_C(1)
+#define SIXCY_PLUGIN_ABI_VERSION  UINT32_C(3)
 
 /** Byte length of a codec UUID in little-endian field order. */
 #define SIXCY_CODEC_UUID_LEN      16
@@ -97,6 +113,12 @@ extern "C" {
 /** Codec-internal error (OOM, invalid level, etc.). */
 #define SIXCY_RC_INTERNAL        (-3)
 
+/* ── Codec context ────────────────────────────────────────────────────────── */
+
+/** Opaque per-thread codec state owned by the plugin (ABI v2+).
+ *  The host never dereferences it; see "Codec contexts" above. */
+typedef struct SixcyCodecCtx SixcyCodecCtx;
+
 /* ── Plugin descriptor ────────────────────────────────────────────────────── */
 
 /**
@@ -203,18 +225,98 @@ typedef struct SixcyCodecPlugin {
      */
     uint32_t (*fn_compress_bound)(uint32_t in_len);
 
-    /*
-     * ── ABI v2+ fields appended here ────────────────────────────────────────
+    /* ── ABI v2 fields ───────────────────────────────────────────────────────
+     *
+     * Read by the host only when abi_version >= 2.  Each field may be NULL;
+     * the context path is used only when all four are non-NULL.
+     */
+
+    /**
+     * Allocate a codec context for use by one host thread.
+     *
+     * Called lazily, at most once per plugin per host thread.  The context
+     * may cache any encoder/decoder state across calls.
+     *
+     * @return  A new context, or NULL if one cannot be created.  On NULL the
+     *          host uses fn_compress / fn_decompress on that thread.
+     */
+    SixcyCodecCtx *(*fn_ctx_create)(void);
+
+    /**
+     * Release a context returned by fn_ctx_create.
      *
-     * Example (not present in v1):
+     * Called exactly once per context, on the thread that created it, after
+     * the last *_ctx call.  Never called with NULL.
+     */
+    void (*fn_ctx_destroy)(SixcyCodecCtx *ctx);
+
+    /**
+     * Same contract as fn_compress, reusing the state held in ctx.
      *
-     *   uint32_t (*fn_dict_compress)(
-     *       const uint8_t *dict, uint32_t dict_len,
-     *       const uint8_t *in,   uint32_t in_len,
-     *             uint8_t *out,  uint32_t *out_len,
-     *       int32_t level
-     *   );
+     * Thread safety: ctx is confined to the calling thread.  Calls with
+     *   distinct contexts MUST be safe to run concurrently.
+     *
+     * @param ctx  Non-null.  Obtained from fn_ctx_create on this thread.
      */
+    int32_t (*fn_compress_ctx)(
+        SixcyCodecCtx *ctx,
+        const uint8_t *in_buf,  uint32_t  in_len,
+              uint8_t *out_buf, uint32_t *out_len,
+        int32_t level
+    );
+
+    /**
+     * Same contract as fn_decompress, reusing the state held in ctx.
+     *
+     * Thread safety: same guarantee as fn_compress_ctx.
+     *
+     * @param ctx  Non-null.  Obtained from fn_ctx_create on this thread.
+     */
+    int32_t (*fn_decompress_ctx)(
+        SixcyCodecCtx *ctx,
+        const uint8_t *in_buf,  uint32_t  in_len,
+              uint8_t *out_buf, uint32_t *out_len
+    );
+
+    /* ── ABI v3 fields ───────────────────────────────────────────────────────
+     *
+     * Read by the host only when abi_version >= 3.  Both may be NULL, in
+     * which case the host never compresses this codec's blocks against the
+     * archive dictionary.
+     */
+
+    /**
+     * Compress in_len bytes against a shared dictionary.
+     *
+     * The dictionary is the plaintext of the archive's DICT block.  It is
+     * identical for every call within one archive; plugins may cache state
+     * derived from it, keyed on its contents.
+     *
+     * Buffer contract and return codes are those of fn_compress.
+     *
+     * @param dict      Non-null.  dict[0..dict_len) is readable.
+     * @param dict_len  Byte count of the dictionary.
+     */
+    int32_t (*fn_dict_compress)(
+        const uint8_t *dict,    uint32_t  dict_len,
+        const uint8_t *in_buf,  uint32_t  in_len,
+              uint8_t *out_buf, uint32_t *out_len,
+        int32_t level
+    );
+
+    /**
+     * Decompress a payload produced by fn_dict_compress with the same
+     * dictionary.
+     *
+     * Buffer contract and return codes are those of fn_decompress.
+     */
+    int32_t (*fn_dict_decompress)(
+        const uint8_t *dict,    uint32_t  dict_len,
+        const uint8_t *in_buf,  uint32_t  in_len,
+              uint8_t *out_buf, uint32_t *out_len
+    );
+
+    /* ── ABI v4+ fields appended here ─────────────────────────────────────── */
 
 } SixcyCodecPlugin;
 #pragma pack(pop)
@@ -16,15 +16,19 @@
 //! # Ok::<(), Box<dyn std::error::Error>>(())
 //! ```
 
-use std::fs::File;
-use std::io::{self, Write};
+use std::fs::{File, OpenOptions};
+use std::io;
 use std::path::{Path, PathBuf};
 
-use crate::codec::CodecId;
-use crate::crypto::derive_key;
-use crate::index::FileIndexRecord;
-use crate::io_stream::{SixCyReader, SixCyWriter, DEFAULT_CHUNK_SIZE, DEFAULT_COMPRESSION_LEVEL};
-use crate::superblock::Superblock;
+use crate::block::BlockHeader;
+use crate::codec::{CodecId, Dictionary};
+use crate::crypto::{derive_key, CryptoError, KeyCache};
+use crate::index::{BlockTableView, FileIndexRecord, RecordView};
+use crate::io_stream::{map_file, CacheStats, Chunking, CopyStats, MmapSource, SixCyReader, SixCyWriter,
+                       WriteBehind, DEFAULT_CHUNK_SIZE, DEFAULT_COMPRESSION_LEVEL, DEFAULT_SOLID_BLOCK_SIZE,
+                       DEFAULT_DEDUP_MEMORY, DEFAULT_WRITE_DEPTH};
+use crate::stats::StatsReport;
+use crate::superblock::{Superblock, SB_FLAG_ENCRYPTED};
 
 // ── PackOptions ───────────────────────────────────────────────────────────────
 
@@ -34,9 +38,39 @@ pub struct PackOptions {
     pub default_codec: CodecId,
     pub level:         i32,
     pub chunk_size:    usize,
+    /// Fixed `chunk_size` chunks, or content-defined boundaries whose
+    /// sizes come from the [`CdcParams`](crate::io_stream::CdcParams).
+    pub chunking:      Chunking,
+    /// Decoded size of each SOLID block between `begin_solid` and
+    /// `end_solid`; smaller blocks make member reads cheaper.  At least
+    /// `chunk_size`, or `begin_solid` fails.
+    pub solid_block_size: usize,
     /// When set, every block is AES-256-GCM encrypted.
     /// Key = Argon2id(password, salt=archive_uuid).
     pub password:      Option<String>,
+    /// Shared dictionary written once as a DICT block; Zstd blocks are then
+    /// compressed against it.  Train one with [`Dictionary::train`].
+    pub dictionary:    Option<Dictionary>,
+    /// Compressor worker threads for the pipelined writer; `1` (the
+    /// default) disables it.
+    /// [`default_threads`](crate::io_stream::default_threads) gives one
+    /// per core.
+    pub threads:       usize,
+    /// Threads one block may use inside its codec: Zstd worker threads, or
+    /// parallel streams for [`CodecId::LzmaMt`].  `1` (the default) keeps
+    /// each block on one thread; raise it for solid sessions and large
+    /// files, which otherwise compress on a single core.
+    pub block_threads: usize,
+    /// Store chunks that sample as incompressible (media, archives) with
+    /// `CodecId::None`; see [`codec::adaptive`](crate::codec::adaptive).
+    pub adaptive:      bool,
+    /// Full 1 MiB write buffers queued behind the writer; the archive is
+    /// written by a background thread (see
+    /// [`WriteBehind`](crate::io_stream::WriteBehind)).
+    pub io_depth:      usize,
+    /// Memory budget of the CAS table, past which full chunk hashes spill to
+    /// a temporary file (see [`DedupTable`](crate::io_stream::DedupTable)).
+    pub dedup_memory:  usize,
 }
 
 impl Default for PackOptions {
@@ -45,11 +79,22 @@ impl Default for PackOptions {
             default_codec: CodecId::Zstd,
             level:         DEFAULT_COMPRESSION_LEVEL,
             chunk_size:    DEFAULT_CHUNK_SIZE,
+            chunking:      Chunking::Fixed,
+            solid_block_size: DEFAULT_SOLID_BLOCK_SIZE,
             password:      None,
+            dictionary:    None,
+            threads:       1,
+            block_threads: 1,
+            adaptive:      false,
+            io_depth:      DEFAULT_WRITE_DEPTH,
+            dedup_memory:  DEFAULT_DEDUP_MEMORY,
         }
     }
 }
 
+/// Output files held open at once by [`Archive::extract_all`].
+pub const EXTRACT_BATCH_FILES: usize = 256;
+
 // ── FileInfo ──────────────────────────────────────────────────────────────────
 
 /// Lightweight descriptor returned by [`Archive::list`].
@@ -63,6 +108,19 @@ pub struct FileInfo {
     pub first_block_hash: Option<[u8; 32]>,
 }
 
+impl From<RecordView<'_>> for FileInfo {
+    fn from(r: RecordView<'_>) -> Self {
+        FileInfo {
+            id:               r.id(),
+            name:             r.name().to_owned(),
+            original_size:    r.original_size(),
+            compressed_size:  r.compressed_size(),
+            block_count:      r.block_count(),
+            first_block_hash: (r.block_count() > 0).then(|| r.block_ref(0).content_hash),
+        }
+    }
+}
+
 impl From<&FileIndexRecord> for FileInfo {
     fn from(r: &FileIndexRecord) -> Self {
         FileInfo {
@@ -79,17 +137,28 @@ impl From<&FileIndexRecord> for FileInfo {
 // ── ArchiveMode ───────────────────────────────────────────────────────────────
 
 enum ArchiveMode {
-    Read(SixCyReader<File>),
-    Write(SixCyWriter<File>, CodecId),
+    /// Archives are opened memory-mapped; see [`map_file`].
+    Read(SixCyReader<MmapSource>),
+    /// Written through a [`WriteBehind`] I/O thread.
+    Write(SixCyWriter<WriteBehind<File>>, CodecId),
 }
 
 // ── Archive ───────────────────────────────────────────────────────────────────
 
+/// An archive open for reading is `Sync`: every read method takes `&self`,
+/// so one `Archive` can serve concurrent reads from many threads.
 pub struct Archive {
     path: PathBuf,
     mode: ArchiveMode,
+    /// A second handle to the file being written, synced by `finalize`.
+    sync: Option<File>,
 }
 
+const _: () = {
+    fn assert_sync<T: Sync>() {}
+    let _ = assert_sync::<Archive>;
+};
+
 impl Archive {
     // ── Constructors ─────────────────────────────────────────────────────────
 
@@ -101,40 +170,110 @@ impl Archive {
         Self::open_with_password(path, Some(password.to_owned()))
     }
 
-    fn open_with_password<P: AsRef<Path>>(path: P, password: Option<String>) -> io::Result<Self> {
-        let path = path.as_ref().to_owned();
+    /// [`open_encrypted`](Self::open_encrypted), taking the key from `cache`
+    /// when this archive was opened with this password before, so only the
+    /// first open pays for Argon2id.  [`KeyCache::global`] is the
+    /// process-wide cache.
+    pub fn open_encrypted_cached<P: AsRef<Path>>(path: P, password: &str, cache: &KeyCache) -> io::Result<Self> {
+        Self::open_keyed(path, Some(|sb: &Superblock| cache.key(password, &sb.archive_uuid)))
+    }
 
-        let key = if let Some(ref pwd) = password {
-            let mut f = File::open(&path)?;
-            let sb = Superblock::read(&mut f)
-                .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
-            Some(derive_key(pwd, sb.archive_uuid.as_bytes())
-                .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?)
-        } else {
-            None
-        };
+    fn open_with_password<P: AsRef<Path>>(path: P, password: Option<String>) -> io::Result<Self> {
+        Self::open_keyed(path, password.map(|pwd| move |sb: &Superblock| derive_key(&pwd, sb.archive_uuid.as_bytes())))
+    }
 
-        let reader = SixCyReader::with_key(File::open(&path)?, key)?;
-        Ok(Self { path, mode: ArchiveMode::Read(reader) })
+    /// Map the archive and open it, deriving its key with `derive` when the
+    /// superblock marks it encrypted.  The superblock, and with it the salt,
+    /// is read from the mapping the reader keeps, so the file is opened
+    /// once and a malformed archive fails before any key is derived.
+    fn open_keyed<P, F>(path: P, derive: Option<F>) -> io::Result<Self>
+    where
+        P: AsRef<Path>,
+        F: FnOnce(&Superblock) -> Result<[u8; 32], CryptoError>,
+    {
+        let path = path.as_ref().to_owned();
+        let reader = SixCyReader::with_key_from(map_file(&File::open(&path)?)?, |sb| match derive {
+            Some(derive) if sb.flags & SB_FLAG_ENCRYPTED != 0 => derive(sb).map(Some)
+                .map_err(|e| io::Error::new(io::ErrorKind::Other, e)),
+            _ => Ok(None),
+        })?;
+        Ok(Self { path, mode: ArchiveMode::Read(reader), sync: None })
     }
 
     pub fn create<P: AsRef<Path>>(path: P, opts: PackOptions) -> io::Result<Self> {
+        selectable(opts.default_codec)?;
         let path = path.as_ref().to_owned();
+        let file = File::create(&path)?;
+        let sync = file.try_clone()?;
         let mut writer = SixCyWriter::with_options(
-            File::create(&path)?,
+            WriteBehind::new(file, opts.io_depth)?,
             opts.chunk_size,
             opts.level,
             None,
         )?;
-
         if let Some(ref pwd) = opts.password {
             let key = derive_key(pwd, writer.superblock.archive_uuid.as_bytes())
                 .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
             writer.encryption_key = Some(key);
         }
+        Self::writing(path, writer, sync, opts)
+    }
+
+    /// Open an existing archive to add files to it; see
+    /// [`SixCyWriter::append`].
+    ///
+    /// Chunks already stored in the archive are referenced, not written
+    /// again, so adding a new version of a mostly unchanged file costs
+    /// little more than its index record.  Files keep their names.  A name
+    /// added again is read back as its newest version.  `opts.password`
+    /// must be given exactly when the archive is encrypted.  `opts.dictionary`
+    /// is only accepted for an archive that has none yet.  The archive must
+    /// not be open for reading (which maps it) while it is appended to.
+    pub fn append<P: AsRef<Path>>(path: P, opts: PackOptions) -> io::Result<Self> {
+        selectable(opts.default_codec)?;
+        let path = path.as_ref().to_owned();
+        let mut existing = File::open(&path)?;
+        let key = match opts.password {
+            Some(ref pwd) => {
+                let sb = Superblock::read(&mut existing)
+                    .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+                Some(derive_key(pwd, sb.archive_uuid.as_bytes())
+                    .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?)
+            }
+            None => None,
+        };
+        let file = OpenOptions::new().write(true).open(&path)?;
+        let sync = file.try_clone()?;
+        let writer = SixCyWriter::append(
+            existing,
+            WriteBehind::new(file, opts.io_depth)?,
+            opts.chunk_size,
+            opts.level,
+            key,
+            opts.dedup_memory,
+        )?;
+        Self::writing(path, writer, sync, opts)
+    }
+
+    /// Apply the rest of `opts` to a new or reopened writer.
+    fn writing(
+        path:       PathBuf,
+        mut writer: SixCyWriter<WriteBehind<File>>,
+        sync:       File,
+        opts:       PackOptions,
+    ) -> io::Result<Self> {
+        writer.threads  = opts.threads.max(1);
+        writer.chunking = opts.chunking;
+        writer.solid_block_size = opts.solid_block_size;
+        writer.block_threads    = opts.block_threads.max(1);
+        writer.adaptive         = opts.adaptive;
+        writer.set_dedup_memory(opts.dedup_memory)?;
+        if let Some(dict) = opts.dictionary {
+            writer.set_dictionary(dict)?;
+        }
 
         let default_codec = opts.default_codec;
-        Ok(Self { path, mode: ArchiveMode::Write(writer, default_codec) })
+        Ok(Self { path, mode: ArchiveMode::Write(writer, default_codec), sync: Some(sync) })
     }
 
     // ── Write ─────────────────────────────────────────────────────────────────
@@ -149,14 +288,73 @@ impl Archive {
 
     pub fn add_file_with_codec(&mut self, name: &str, data: &[u8], codec: CodecId) -> io::Result<()> {
         match &mut self.mode {
-            ArchiveMode::Write(w, _) => w.add_file(name.to_owned(), data, codec),
+            ArchiveMode::Write(w, _) => w.add_file(name.to_owned(), data, selectable(codec)?),
             ArchiveMode::Read(_)     => Err(read_only()),
         }
     }
 
+    /// Add a file streamed from `reader` with the default codec, holding
+    /// only a few chunks in memory; see [`SixCyWriter::add_reader`].
+    pub fn add_reader<R: io::Read>(&mut self, name: &str, reader: R) -> io::Result<()> {
+        match &mut self.mode {
+            ArchiveMode::Write(w, c) => {
+                let codec = *c;
+                w.add_reader(name.to_owned(), reader, codec)
+            }
+            ArchiveMode::Read(_) => Err(read_only()),
+        }
+    }
+
+    /// Add several `(name, data)` pairs with the default codec.  With
+    /// `threads > 1` their chunks are compressed concurrently.
+    pub fn add_files(&mut self, files: &[(&str, &[u8])]) -> io::Result<()> {
+        match &mut self.mode {
+            ArchiveMode::Write(w, c) => {
+                let codec = *c;
+                let files: Vec<(String, &[u8])> =
+                    files.iter().map(|&(n, d)| (n.to_owned(), d)).collect();
+                w.add_files(&files, codec)
+            }
+            ArchiveMode::Read(_) => Err(read_only()),
+        }
+    }
+
+    /// Append every file of `src`, named `rename(name)`, copying the blocks
+    /// `keep` accepts without decoding them; files with any other block are
+    /// re-encoded with the default codec.  See
+    /// [`SixCyWriter::copy_files_from`].
+    pub fn copy_from(
+        &mut self,
+        src:    &Archive,
+        rename: impl Fn(&str) -> String,
+        keep:   impl Fn(&BlockHeader) -> bool,
+    ) -> io::Result<CopyStats> {
+        let reader = match &src.mode {
+            ArchiveMode::Read(r)     => r,
+            ArchiveMode::Write(_, _) => return Err(write_only()),
+        };
+        let files: Vec<(u32, String)> = reader.index.iter()
+            .map(|r| (r.id(), rename(r.name())))
+            .collect();
+        match &mut self.mode {
+            ArchiveMode::Write(w, c) => {
+                let codec = *c;
+                w.copy_files_from(reader, &files, codec, keep)
+            }
+            ArchiveMode::Read(_) => Err(read_only()),
+        }
+    }
+
+    /// Start a solid session; see [`SixCyWriter::start_solid_session`].
+    /// `solid_block_size` must be at least one chunk (`chunk_size`).
     pub fn begin_solid(&mut self, codec: CodecId) -> io::Result<()> {
         match &mut self.mode {
-            ArchiveMode::Write(w, _) => w.start_solid_session(codec),
+            ArchiveMode::Write(w, _) if w.solid_block_size < w.chunk_size => {
+                Err(io::Error::new(io::ErrorKind::InvalidInput, format!(
+                    "solid block size {} B is smaller than the {} B chunk size",
+                    w.solid_block_size, w.chunk_size)))
+            }
+            ArchiveMode::Write(w, _) => w.start_solid_session(selectable(codec)?),
             ArchiveMode::Read(_)     => Err(read_only()),
         }
     }
@@ -169,9 +367,14 @@ impl Archive {
     }
 
     /// Flush the INDEX block and patch the superblock.  Must be called once.
+    ///
+    /// The file is synced (`sync_data`) before the superblock is patched and
+    /// again after, so a crash cannot leave a superblock naming footers that
+    /// never reached the disk; see [`SixCyWriter::finalize_with`].
     pub fn finalize(&mut self) -> io::Result<()> {
+        let sync = self.sync.as_ref();
         match &mut self.mode {
-            ArchiveMode::Write(w, _) => w.finalize(),
+            ArchiveMode::Write(w, _) => w.finalize_with(|_| sync.map_or(Ok(()), File::sync_data)),
             ArchiveMode::Read(_)     => Err(read_only()),
         }
     }
@@ -180,53 +383,135 @@ impl Archive {
 
     pub fn list(&self) -> Vec<FileInfo> {
         match &self.mode {
-            ArchiveMode::Read(r)     => r.index.records.iter().map(FileInfo::from).collect(),
+            ArchiveMode::Read(r)     => r.index.iter().map(FileInfo::from).collect(),
             ArchiveMode::Write(w, _) => w.index.records.iter().map(FileInfo::from).collect(),
         }
     }
 
+    /// Look up one file: the last record named `name`, so the newest
+    /// version of a file added more than once.  Reading, this is a binary
+    /// search of the index's name table; no other record is decoded.
     pub fn stat(&self, name: &str) -> Option<FileInfo> {
-        self.list().into_iter().find(|f| f.name == name)
+        match &self.mode {
+            ArchiveMode::Read(r)     => r.index.find_name_last(name).map(FileInfo::from),
+            ArchiveMode::Write(w, _) => w.index.records.iter().rev().find(|r| r.name == name).map(FileInfo::from),
+        }
     }
 
-    pub fn read_file(&mut self, name: &str) -> io::Result<Vec<u8>> {
-        let id = self.stat(name)
-            .ok_or_else(|| io::Error::new(io::ErrorKind::NotFound,
-                format!("File not found: {name}")))?
-            .id;
-        self.read_file_by_id(id)
+    pub fn read_file(&self, name: &str) -> io::Result<Vec<u8>> {
+        self.read_file_by_id(self.id_of(name)?)
     }
 
-    pub fn read_file_by_id(&mut self, id: u32) -> io::Result<Vec<u8>> {
-        match &mut self.mode {
-            ArchiveMode::Read(r) => r.unpack_file(id),
+    /// Record ID for `name`, without building a [`FileInfo`].
+    fn id_of(&self, name: &str) -> io::Result<u32> {
+        let id = match &self.mode {
+            ArchiveMode::Read(r)     => r.index.find_name_last(name).map(|r| r.id()),
+            ArchiveMode::Write(_, _) => return Err(write_only()),
+        };
+        id.ok_or_else(|| io::Error::new(io::ErrorKind::NotFound, format!("File not found: {name}")))
+    }
+
+    pub fn read_file_by_id(&self, id: u32) -> io::Result<Vec<u8>> {
+        match &self.mode {
+            ArchiveMode::Read(r) => r.unpack_file_parallel(id),
             ArchiveMode::Write(_, _) => Err(write_only()),
         }
     }
 
-    pub fn read_at(&mut self, name: &str, offset: u64, buf: &mut [u8]) -> io::Result<usize> {
-        let id = self.stat(name)
-            .ok_or_else(|| io::Error::new(io::ErrorKind::NotFound,
-                format!("File not found: {name}")))?
-            .id;
-        match &mut self.mode {
-            ArchiveMode::Read(r) => r.read_at(id, offset, buf),
+    pub fn read_at(&self, name: &str, offset: u64, buf: &mut [u8]) -> io::Result<usize> {
+        let id = self.id_of(name)?;
+        match &self.mode {
+            ArchiveMode::Read(r) => r.read_at_shared(id, offset, buf),
             ArchiveMode::Write(_, _) => Err(write_only()),
         }
     }
 
     /// Extract all files into `dest`, creating it if necessary.
-    pub fn extract_all<P: AsRef<Path>>(&mut self, dest: P) -> io::Result<()> {
+    ///
+    /// Files are extracted in batches of [`EXTRACT_BATCH_FILES`]; within a
+    /// batch, blocks from every file are decoded concurrently and written
+    /// in place into the pre-sized output files.
+    pub fn extract_all<P: AsRef<Path>>(&self, dest: P) -> io::Result<()> {
         let dest = dest.as_ref();
         if !dest.exists() { std::fs::create_dir_all(dest)?; }
-        let ids: Vec<(u32, String)> = self.list().into_iter().map(|f| (f.id, f.name)).collect();
-        for (id, name) in ids {
-            let data = self.read_file_by_id(id)?;
-            File::create(dest.join(&name))?.write_all(&data)?;
+        let reader = match &self.mode {
+            ArchiveMode::Read(r)     => r,
+            ArchiveMode::Write(_, _) => return Err(write_only()),
+        };
+        // A repeated name is extracted once, from its last record, as it
+        // would be if the files were written one after another.
+        let last: std::collections::HashMap<&str, u32> = reader.index.iter()
+            .map(|r| (r.name(), r.id()))
+            .collect();
+        let files: Vec<(u32, String, u64)> = reader.index.iter()
+            .filter(|r| last[r.name()] == r.id())
+            .map(|r| (r.id(), r.name().to_owned(), r.original_size()))
+            .collect();
+        for batch in files.chunks(EXTRACT_BATCH_FILES) {
+            let mut targets = Vec::with_capacity(batch.len());
+            for (id, name, size) in batch {
+                let f = File::create(dest.join(name))?;
+                f.set_len(*size)?;
+                targets.push((*id, f));
+            }
+            reader.unpack_files_to(&targets)?;
         }
         Ok(())
     }
 
+    /// Read block payloads ahead of the decode workers on `depth` I/O
+    /// threads; `0` (the default) turns read-ahead off.  See
+    /// [`SixCyReader::io_depth`].
+    pub fn set_io_depth(&mut self, depth: usize) -> io::Result<()> {
+        match &mut self.mode {
+            ArchiveMode::Read(r)     => { r.io_depth = depth; Ok(()) }
+            ArchiveMode::Write(_, _) => Err(write_only()),
+        }
+    }
+
+    /// Resize the decoded-block cache (emptying it); `0` disables caching.
+    pub fn set_cache_budget(&mut self, bytes: usize) -> io::Result<()> {
+        match &mut self.mode {
+            ArchiveMode::Read(r)     => { r.set_cache_budget(bytes); Ok(()) }
+            ArchiveMode::Write(_, _) => Err(write_only()),
+        }
+    }
+
+    /// Decoded-block cache counters; `None` for an archive being written.
+    pub fn cache_stats(&self) -> Option<CacheStats> {
+        match &self.mode {
+            ArchiveMode::Read(r)     => Some(r.cache().stats()),
+            ArchiveMode::Write(_, _) => None,
+        }
+    }
+
+    /// Count calls, bytes and time per pipeline stage from now on; see
+    /// [`crate::stats`].
+    pub fn enable_stats(&mut self) {
+        match &mut self.mode {
+            ArchiveMode::Read(r)     => r.enable_stats(),
+            ArchiveMode::Write(w, _) => w.enable_stats(),
+        }
+    }
+
+    /// Stage, codec and dedup counters so far (and, when reading, the block
+    /// cache's); `None` until [`enable_stats`](Self::enable_stats).
+    pub fn stats(&self) -> Option<StatsReport> {
+        match &self.mode {
+            ArchiveMode::Read(r)     => r.stats(),
+            ArchiveMode::Write(w, _) => w.stats(),
+        }
+    }
+
+    /// Every block's location, read in place from the BLOCK TABLE footer.
+    /// `None` while writing, and for archives without a valid table.
+    pub fn block_table(&self) -> Option<BlockTableView<'_>> {
+        match &self.mode {
+            ArchiveMode::Read(r)     => r.block_table_in_place(),
+            ArchiveMode::Write(_, _) => None,
+        }
+    }
+
     // ── Metadata ─────────────────────────────────────────────────────────────
 
     pub fn path(&self) -> &Path { &self.path }
@@ -238,6 +523,15 @@ impl Archive {
         }
     }
 
+    /// The level every block was compressed at, when the archive records
+    /// one; see [`Superblock::pack_level`].
+    pub fn pack_level(&self) -> Option<i32> {
+        match &self.mode {
+            ArchiveMode::Read(r)     => r.superblock.pack_level,
+            ArchiveMode::Write(_, _) => None,
+        }
+    }
+
     pub fn root_hash_hex(&self) -> String {
         match &self.mode {
             ArchiveMode::Read(r)     => hex::encode(r.index.root_hash),
@@ -246,5 +540,15 @@ impl Archive {
     }
 }
 
+/// `codec`, unless it is [`CodecId::Fill`]: the writer stores uniform
+/// chunks as fill blocks on its own, and the codec refuses anything else.
+fn selectable(codec: CodecId) -> io::Result<CodecId> {
+    if codec == CodecId::Fill {
+        return Err(io::Error::new(io::ErrorKind::InvalidInput,
+            "the fill codec is chosen automatically for uniform chunks and cannot be selected"));
+    }
+    Ok(codec)
+}
+
 fn read_only()  -> io::Error { io::Error::new(io::ErrorKind::PermissionDenied, "archive is read-only") }
 fn write_only() -> io::Error { io::Error::new(io::ErrorKind::PermissionDenied, "archive is write-only") }
@@ -7,8 +7,8 @@
 //!    0      4   magic        = 0x424C434B  ("BLCK", LE u32)
 //!    4      2   header_version = 1         (LE u16, bumped on layout change)
 //!    6      2   header_size  = 84          (LE u16, skip unknown extensions)
-//!    8      2   block_type   0=Data 1=Index 2=Solid  (LE u16)
-//!   10      2   flags        0x0001=Encrypted        (LE u16)
+//!    8      2   block_type   0=Data 1=Index 2=Solid 3=Dict (LE u16)
+//!   10      2   flags        0x0001=Encrypted 0x0002=Dict (LE u16)
 //!   12     16   codec_uuid   frozen 16-byte UUID     (LE field order)
 //!   28      4   file_id      0xFFFF_FFFF = solid/idx (LE u32)
 //!   32      8   file_offset  in decompressed file    (LE u64)
@@ -34,9 +34,16 @@
 //! `content_hash`.  A scanner can rebuild the full block list by reading
 //! headers sequentially without decompressing payloads.  Solid blocks and the
 //! Index block must still be parsed for file-name recovery; see `io_stream`.
+//!
+//! # Dictionaries
+//! An archive may hold one DICT block whose plaintext is a trained codec
+//! dictionary.  DATA and SOLID blocks compressed against it set `FLAG_DICT`;
+//! decoding such a block without the dictionary is a hard error.
 
+use std::cell::RefCell;
 use std::io::{self, Read, Write};
-use crate::codec::{CodecId, get_codec_by_uuid, CodecError, uuid_to_string};
+use crate::codec::{Codec, CodecId, Dictionary, get_codec, get_codec_by_uuid, CodecError, uuid_to_string};
+use crate::stats::{self, Stage};
 use crc32fast::Hasher;
 
 // ── Constants ────────────────────────────────────────────────────────────────
@@ -65,6 +72,8 @@ pub enum BlockType {
     Index = 1,
     /// Solid block — payload contains multiple concatenated files.
     Solid = 2,
+    /// Dictionary block — payload is the archive's shared codec dictionary.
+    Dict  = 3,
 }
 
 impl BlockType {
@@ -73,6 +82,7 @@ impl BlockType {
             0 => Some(BlockType::Data),
             1 => Some(BlockType::Index),
             2 => Some(BlockType::Solid),
+            3 => Some(BlockType::Dict),
             _ => None,
         }
     }
@@ -82,6 +92,8 @@ impl BlockType {
 
 /// Payload is AES-256-GCM encrypted (nonce prepended).
 pub const FLAG_ENCRYPTED: u16 = 0x0001;
+/// Payload was compressed against the archive's DICT block.
+pub const FLAG_DICT:      u16 = 0x0002;
 
 // ── Block header ─────────────────────────────────────────────────────────────
 
@@ -225,10 +237,99 @@ impl BlockHeader {
     }
 
     #[inline] pub fn is_encrypted(&self) -> bool { self.flags & FLAG_ENCRYPTED != 0 }
+    #[inline] pub fn uses_dict(&self)    -> bool { self.flags & FLAG_DICT != 0 }
     #[inline] pub fn codec_id(&self)     -> Option<CodecId> { CodecId::from_uuid(&self.codec_uuid) }
     #[inline] pub fn codec_uuid_str(&self) -> String { uuid_to_string(&self.codec_uuid) }
 }
 
+// ── Content hash ──────────────────────────────────────────────────────────────
+
+/// Inputs at least this long are hashed across the Rayon pool when the
+/// `parallel` feature is on.  Below it, splitting the work costs more than
+/// it saves.
+pub const PARALLEL_HASH_MIN: usize = 1024 * 1024;
+
+/// Inputs at least this long are checked for a single repeated byte before
+/// hashing, whose hash is then looked up rather than computed: 64 KiB.
+pub const FILL_HASH_MIN: usize = 64 * 1024;
+
+/// Uniform runs whose hash each thread remembers.
+const FILL_MEMO: usize = 8;
+
+/// Bytes OR-folded per step of [`uniform_byte`]: one page.
+const UNIFORM_STEP: usize = 4096;
+
+thread_local! {
+    /// (byte, length, BLAKE3) of recently hashed uniform runs.
+    static FILL_HASHES: RefCell<Vec<(u8, usize, [u8; 32])>> = const { RefCell::new(Vec::new()) };
+}
+
+/// BLAKE3 of `data`, as stored in `content_hash` and used as the CAS key.
+///
+/// Large inputs are hashed with `Hasher::update_rayon` under the `parallel`
+/// feature; the result is the same either way.  Inputs of one repeated
+/// byte (zero pages of a disk image) from [`FILL_HASH_MIN`] on take their
+/// hash from [`fill_hash`].
+pub fn content_hash(data: &[u8]) -> [u8; 32] {
+    stats::timed(Stage::Hash, data.len(), || hash_content(data))
+}
+
+fn hash_content(data: &[u8]) -> [u8; 32] {
+    if data.len() >= FILL_HASH_MIN {
+        if let Some(byte) = uniform_byte(data) {
+            return fill_hash(byte, data.len());
+        }
+    }
+    #[cfg(feature = "parallel")]
+    {
+        if data.len() >= PARALLEL_HASH_MIN {
+            return blake3::Hasher::new().update_rayon(data).finalize().into();
+        }
+    }
+    blake3::hash(data).into()
+}
+
+/// The byte every byte of `data` equals, or `None` (also for empty input).
+///
+/// Each page is OR-folded against the first byte with no early exit inside
+/// it, which the compiler turns into full-width vector compares; the scan
+/// stops at the first page that differs.  The last byte is checked first,
+/// so most non-uniform input is rejected without a scan.
+pub fn uniform_byte(data: &[u8]) -> Option<u8> {
+    let (&byte, &last) = (data.first()?, data.last()?);
+    if last != byte {
+        return None;
+    }
+    data.chunks(UNIFORM_STEP)
+        .all(|page| page.iter().fold(0, |acc, &b| acc | (b ^ byte)) == 0)
+        .then_some(byte)
+}
+
+/// BLAKE3 of `len` copies of `byte`, memoized per thread for the last
+/// [`FILL_MEMO`] runs, so a disk image's zero chunks are hashed only once.
+pub(crate) fn fill_hash(byte: u8, len: usize) -> [u8; 32] {
+    FILL_HASHES.with(|cell| {
+        let mut memo = cell.borrow_mut();
+        if let Some(&(_, _, hash)) = memo.iter().find(|&&(b, n, _)| b == byte && n == len) {
+            return hash;
+        }
+        let page = [byte; UNIFORM_STEP];
+        let mut hasher = blake3::Hasher::new();
+        let mut left = len;
+        while left > 0 {
+            let n = left.min(page.len());
+            hasher.update(&page[..n]);
+            left -= n;
+        }
+        let hash: [u8; 32] = hasher.finalize().into();
+        if memo.len() == FILL_MEMO {
+            memo.remove(0);
+        }
+        memo.push((byte, len, hash));
+        hash
+    })
+}
+
 // ── encode_block ──────────────────────────────────────────────────────────────
 
 /// Compress (and optionally encrypt) a chunk of data, returning a fully
@@ -246,22 +347,90 @@ pub fn encode_block(
     level:          i32,
     encryption_key: Option<&[u8; 32]>,
 ) -> Result<(BlockHeader, Vec<u8>), CodecError> {
-    // BLAKE3 of original plaintext — CAS identity, stored in header.
-    let content_hash: [u8; 32] = blake3::hash(data).into();
+    encode_block_with_dict(block_type, file_id, file_offset, data,
+                           codec_id, level, encryption_key, None)
+}
+
+/// [`encode_block`] with an optional shared dictionary.
+///
+/// When `dict` is set and the codec supports dictionaries the payload is
+/// compressed against it and `FLAG_DICT` is set; other codecs ignore `dict`.
+pub fn encode_block_with_dict(
+    block_type:     BlockType,
+    file_id:        u32,
+    file_offset:    u64,
+    data:           &[u8],
+    codec_id:       CodecId,
+    level:          i32,
+    encryption_key: Option<&[u8; 32]>,
+    dict:           Option<&Dictionary>,
+) -> Result<(BlockHeader, Vec<u8>), CodecError> {
+    let mut payload = Vec::new();
+    let header = encode_block_into(block_type, file_id, file_offset, data, content_hash(data),
+                                   codec_id, level, 1, encryption_key, dict, &mut payload)?;
+    Ok((header, payload))
+}
+
+/// [`encode_block_with_dict`] into a caller-supplied payload buffer, for a
+/// chunk whose hash the caller has already computed.
+///
+/// `content_hash` must be [`content_hash`]`(data)`: the writer hashes each
+/// chunk once for its dedup lookup and passes the result on, rather than
+/// reading the chunk a second time here.  `payload` is cleared, then holds
+/// the on-disk bytes.  Passing the same buffer for every block lets it
+/// settle at the largest compressed size, so steady-state encoding
+/// allocates nothing for the output.
+///
+/// A block of one repeated byte is stored with [`CodecId::Fill`] instead of
+/// `codec_id`: no codec runs, and the payload is 5 bytes before any
+/// encryption.
+///
+/// `threads` is the thread budget for this one block (see
+/// [`Codec::compress_into_threaded`](crate::codec::Codec::compress_into_threaded));
+/// `1` compresses on the caller's thread.  Dictionary compression is always
+/// single-threaded.
+pub fn encode_block_into(
+    block_type:     BlockType,
+    file_id:        u32,
+    file_offset:    u64,
+    data:           &[u8],
+    content_hash:   [u8; 32],
+    codec_id:       CodecId,
+    level:          i32,
+    threads:        usize,
+    encryption_key: Option<&[u8; 32]>,
+    dict:           Option<&Dictionary>,
+    payload:        &mut Vec<u8>,
+) -> Result<BlockHeader, CodecError> {
+    debug_assert!(blake3::hash(data) == content_hash, "content_hash is not BLAKE3 of data");
+
+    let codec_id = if uniform_byte(data).is_some() { CodecId::Fill } else { codec_id };
 
     // Compress.
-    let codec   = get_codec_by_uuid(&codec_id.uuid())?;
-    let mut payload = codec.compress(data, level)?;
+    let codec   = get_codec(codec_id)?;
+    let mut flags = 0u16;
+    payload.clear();
+    if encryption_key.is_some() {
+        // Nonce slot: the compressed bytes land after it and are sealed in place.
+        payload.resize(crate::crypto::NONCE_LEN, 0);
+    }
+    stats::timed_codec(codec_id, false, data.len(), || match dict {
+        Some(d) if codec.supports_dict() => {
+            flags |= FLAG_DICT;
+            codec.compress_with_dict_into(data, level, d, payload)
+        }
+        _ if threads > 1 => codec.compress_into_threaded(data, level, threads, payload),
+        _ => codec.compress_into(data, level, payload),
+    })?;
 
     // Optionally encrypt the compressed payload.
-    let mut flags = 0u16;
     if let Some(key) = encryption_key {
-        payload = crate::crypto::encrypt(key, &payload)
+        stats::timed(Stage::Encrypt, payload.len(), || crate::crypto::seal_in_place(key, payload))
             .map_err(|e| CodecError::Encryption(e.to_string()))?;
         flags |= FLAG_ENCRYPTED;
     }
 
-    let header = BlockHeader {
+    Ok(BlockHeader {
         header_version: BLOCK_HEADER_VERSION,
         block_type,
         flags,
@@ -271,13 +440,19 @@ pub fn encode_block(
         orig_size:    data.len() as u32,
         comp_size:    payload.len() as u32,
         content_hash,
-    };
-
-    Ok((header, payload))
+    })
 }
 
 // ── decode_block ──────────────────────────────────────────────────────────────
 
+/// Decoded bytes per payload byte up to which [`decode_block_owned`]
+/// takes a header's `orig_size` on trust and allocates it before decoding.
+pub const MAX_PREALLOC_RATIO: usize = 1024;
+
+/// `orig_size` that [`decode_block_owned`] always allocates up front,
+/// however small the payload.
+pub const PREALLOC_MIN: usize = 1024 * 1024;
+
 /// Verify, decrypt (if needed), and decompress a block payload.
 ///
 /// Verification order (no opt-outs):
@@ -292,25 +467,212 @@ pub fn decode_block(
     payload:        &[u8],
     decryption_key: Option<&[u8; 32]>,
 ) -> Result<Vec<u8>, CodecError> {
-    // 1. Decrypt if flagged — GCM tag covers the ciphertext.
-    let compressed = if header.is_encrypted() {
-        let key = decryption_key.ok_or_else(|| {
-            CodecError::Encryption("Block is encrypted but no decryption key was provided".into())
-        })?;
-        crate::crypto::decrypt(key, payload)
-            .map_err(|e| CodecError::Encryption(e.to_string()))?
+    decode_block_with_dict(header, payload, decryption_key, None)
+}
+
+/// [`decode_block`] for archives that carry a DICT block.
+///
+/// `dict` is only consulted for blocks with `FLAG_DICT`; such a block fails
+/// hard when `dict` is `None`.
+pub fn decode_block_with_dict(
+    header:         &BlockHeader,
+    payload:        &[u8],
+    decryption_key: Option<&[u8; 32]>,
+    dict:           Option<&Dictionary>,
+) -> Result<Vec<u8>, CodecError> {
+    decode_block_owned(header, payload, decryption_key, dict, 0)
+}
+
+/// [`decode_block_with_dict`] with a thread budget, as for
+/// [`decode_block_into`].
+///
+/// The output is allocated up front from `orig_size` only when that is at
+/// most [`MAX_PREALLOC_RATIO`] times the payload (or [`PREALLOC_MIN`]), or
+/// the block is a Fill run whose payload states the same length.
+/// Otherwise the header is not trusted for the allocation: the codec grows
+/// the output as it decodes and fails once it passes `orig_size`
+/// (see [`Codec::decompress_bounded`](crate::codec::Codec::decompress_bounded)),
+/// so a hostile header costs no more memory than the block it claims to be.
+pub fn decode_block_owned(
+    header:         &BlockHeader,
+    payload:        &[u8],
+    decryption_key: Option<&[u8; 32]>,
+    dict:           Option<&Dictionary>,
+    threads:        usize,
+) -> Result<Vec<u8>, CodecError> {
+    if !header.is_encrypted() {
+        return decompress_owned(header, payload, dict, threads);
+    }
+    crate::buffer::with_scratch(payload.len(), |buf| {
+        buf.copy_from_slice(payload);
+        decode_block_in_place_owned(header, buf, decryption_key, dict, threads)
+    })
+}
+
+/// [`decode_block_owned`] for a payload the caller may overwrite: an
+/// encrypted payload is decrypted in place, with no copy.
+pub fn decode_block_in_place_owned(
+    header:         &BlockHeader,
+    payload:        &mut [u8],
+    decryption_key: Option<&[u8; 32]>,
+    dict:           Option<&Dictionary>,
+    threads:        usize,
+) -> Result<Vec<u8>, CodecError> {
+    let compressed = open_payload(header, payload, decryption_key)?;
+    decompress_owned(header, compressed, dict, threads)
+}
+
+/// [`decode_block_with_dict`] into a caller-supplied buffer.
+///
+/// `dst` must be exactly `header.orig_size` bytes.  Unencrypted payloads are
+/// decompressed straight from `payload` into `dst` with no intermediate
+/// buffer; encrypted payloads are copied into the thread's scratch buffer
+/// and opened there.  Callers that own a mutable payload should use
+/// [`decode_block_in_place`] and skip the copy.
+///
+/// `threads` caps the threads the codec may use for this one block (`0` =
+/// one per core), as `threads` does for [`encode_block_into`].  Readers
+/// that already decode on a worker pool pass 1.
+pub fn decode_block_into(
+    header:         &BlockHeader,
+    payload:        &[u8],
+    decryption_key: Option<&[u8; 32]>,
+    dict:           Option<&Dictionary>,
+    threads:        usize,
+    dst:            &mut [u8],
+) -> Result<(), CodecError> {
+    check_dst(header, dst)?;
+    if !header.is_encrypted() {
+        return decompress_verified(header, payload, dict, threads, dst);
+    }
+    crate::buffer::with_scratch(payload.len(), |buf| {
+        buf.copy_from_slice(payload);
+        decode_block_in_place(header, buf, decryption_key, dict, threads, dst)
+    })
+}
+
+/// [`decode_block_into`] for a payload the caller may overwrite: an
+/// encrypted payload is decrypted in place, with no copy.
+pub fn decode_block_in_place(
+    header:         &BlockHeader,
+    payload:        &mut [u8],
+    decryption_key: Option<&[u8; 32]>,
+    dict:           Option<&Dictionary>,
+    threads:        usize,
+    dst:            &mut [u8],
+) -> Result<(), CodecError> {
+    check_dst(header, dst)?;
+    let compressed = open_payload(header, payload, decryption_key)?;
+    decompress_verified(header, compressed, dict, threads, dst)
+}
+
+fn check_dst(header: &BlockHeader, dst: &[u8]) -> Result<(), CodecError> {
+    if dst.len() != header.orig_size as usize {
+        return Err(CodecError::Decompression(format!(
+            "destination is {} B but the block decodes to {} B", dst.len(), header.orig_size)));
+    }
+    Ok(())
+}
+
+/// Step 1 of decoding: the plaintext payload, decrypted in place if the
+/// block is flagged.  The GCM tag covers the ciphertext.
+fn open_payload<'p>(
+    header:         &BlockHeader,
+    payload:        &'p mut [u8],
+    decryption_key: Option<&[u8; 32]>,
+) -> Result<&'p [u8], CodecError> {
+    if !header.is_encrypted() {
+        return Ok(payload);
+    }
+    let key = decryption_key.ok_or_else(|| {
+        CodecError::Encryption("Block is encrypted but no decryption key was provided".into())
+    })?;
+    let len = payload.len();
+    let plain = stats::timed(Stage::Decrypt, len, move || crate::crypto::open_in_place(key, payload))
+        .map_err(|e| CodecError::Encryption(e.to_string()))?;
+    Ok(plain)
+}
+
+/// Steps 2 and 3 of decoding into a new buffer, sized as
+/// [`decode_block_owned`] describes.
+fn decompress_owned(
+    header:     &BlockHeader,
+    compressed: &[u8],
+    dict:       Option<&Dictionary>,
+    threads:    usize,
+) -> Result<Vec<u8>, CodecError> {
+    let orig = header.orig_size as usize;
+    let trusted = if header.codec_uuid == CodecId::Fill.uuid() {
+        let (_, n) = crate::codec::fill_payload(compressed)?;
+        if n != orig {
+            return Err(CodecError::Decompression(format!(
+                "fill payload decodes to {n} B, header declares {orig} B")));
+        }
+        true
     } else {
-        payload.to_vec()
+        orig <= compressed.len().saturating_mul(MAX_PREALLOC_RATIO).max(PREALLOC_MIN)
+    };
+    if trusted {
+        let mut out = vec![0u8; orig];
+        decompress_verified(header, compressed, dict, threads, &mut out)?;
+        return Ok(out);
+    }
+
+    let (codec, codec_id) = block_codec(header)?;
+    let out = match block_dict(header, dict)? {
+        Some(d) => stats::timed_codec(codec_id, true, orig, || codec.decompress_with_dict_bounded(compressed, d, orig))?,
+        None    => stats::timed_codec(codec_id, true, orig, || codec.decompress_bounded(compressed, orig))?,
     };
+    check_decoded(header, out.len(), &content_hash(&out))?;
+    Ok(out)
+}
+
+/// Steps 2 and 3 of decoding: decompress the plaintext payload into `dst`
+/// and check the content hash, which the codec returns with its output
+/// (see [`Codec::decompress_into_hashed`](crate::codec::Codec::decompress_into_hashed)).
+fn decompress_verified(
+    header:     &BlockHeader,
+    compressed: &[u8],
+    dict:       Option<&Dictionary>,
+    threads:    usize,
+    dst:        &mut [u8],
+) -> Result<(), CodecError> {
+    let (codec, codec_id) = block_codec(header)?;
+    let (n, actual_hash) = match block_dict(header, dict)? {
+        Some(d) => stats::timed_codec(codec_id, true, dst.len(), || codec.decompress_with_dict_into_hashed(compressed, d, dst))?,
+        None    => stats::timed_codec(codec_id, true, dst.len(), || codec.decompress_into_hashed_threaded(compressed, threads, dst))?,
+    };
+    check_decoded(header, n, &actual_hash)
+}
 
-    // 2. Decompress using the UUID embedded in the header.
-    //    Fails hard if the UUID is not available in this build.
-    let codec        = get_codec_by_uuid(&header.codec_uuid)?;
-    let decompressed = codec.decompress(&compressed)?;
+/// 2. The codec named by the UUID embedded in the header.
+///    Fails hard if the UUID is not available in this build.
+fn block_codec(header: &BlockHeader) -> Result<(&'static dyn Codec, CodecId), CodecError> {
+    let codec = get_codec_by_uuid(&header.codec_uuid)?;
+    let codec_id = CodecId::builtin_from_uuid(&header.codec_uuid).unwrap_or(CodecId::Plugin(header.codec_uuid));
+    Ok((codec, codec_id))
+}
+
+/// The dictionary a `FLAG_DICT` block needs, or `None` for other blocks.
+fn block_dict<'d>(header: &BlockHeader, dict: Option<&'d Dictionary>)
+    -> Result<Option<&'d Dictionary>, CodecError>
+{
+    if !header.uses_dict() {
+        return Ok(None);
+    }
+    dict.map(Some).ok_or_else(|| CodecError::Decompression(
+        "Block was compressed with the archive dictionary but none was loaded".into()))
+}
+
+/// Check `n` decoded bytes hashing to `actual_hash` against the header.
+fn check_decoded(header: &BlockHeader, n: usize, actual_hash: &[u8; 32]) -> Result<(), CodecError> {
+    if n != header.orig_size as usize {
+        return Err(CodecError::Decompression(format!(
+            "block decoded to {n} B, header declares {} B", header.orig_size)));
+    }
 
     // 3. BLAKE3 content hash — mandatory final check.
-    let actual_hash: [u8; 32] = blake3::hash(&decompressed).into();
-    if actual_hash != header.content_hash {
+    if *actual_hash != header.content_hash {
         return Err(CodecError::Decompression(format!(
             "BLAKE3 content hash mismatch (got {}, expected {})",
             hex::encode(actual_hash),
@@ -318,5 +680,5 @@ pub fn decode_block(
         )));
     }
 
-    Ok(decompressed)
+    Ok(())
 }
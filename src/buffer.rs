@@ -0,0 +1,98 @@
+//! Reusable byte buffers for the block encode and decode paths.
+//!
+//! Encoding a block needs an output buffer of up to `compress_bound(len)`
+//! bytes, and decoding one read from a plain file needs a buffer for its
+//! payload.  Allocating those per block puts the allocator on the hot path
+//! (and, for multi-MiB chunks, a page-faulting `mmap` per block), so they
+//! are reused instead:
+//!
+//! - [`BufferPool`] hands out buffers that travel between threads, such as
+//!   compressed payloads that a pipeline worker fills and the write stage
+//!   drains.  Buffers come back cleared but keep their capacity.
+//! - [`with_scratch`] lends the calling thread's scratch buffer for work
+//!   that starts and ends on one thread, such as reading a payload and
+//!   decoding it.
+//!
+//! Both only ever grow, to the largest block seen; the memory is released
+//! with the pool or the thread.
+
+use std::cell::RefCell;
+use std::sync::Mutex;
+
+/// A stack of spare buffers shared between threads.
+#[derive(Debug, Default)]
+pub struct BufferPool {
+    free: Mutex<Vec<Vec<u8>>>,
+}
+
+impl BufferPool {
+    pub fn new() -> Self { Self::default() }
+
+    /// An empty buffer, reusing the capacity of one given back earlier.
+    pub fn take(&self) -> Vec<u8> {
+        self.free.lock().unwrap().pop().unwrap_or_default()
+    }
+
+    /// Return `buf` for a later [`take`](Self::take).
+    pub fn give(&self, mut buf: Vec<u8>) {
+        buf.clear();
+        self.free.lock().unwrap().push(buf);
+    }
+
+    /// Number of buffers waiting to be reused.
+    pub fn spare(&self) -> usize { self.free.lock().unwrap().len() }
+}
+
+thread_local! {
+    static SCRATCH: RefCell<Vec<u8>> = RefCell::new(Vec::new());
+}
+
+/// Run `f` on `len` bytes of this thread's scratch buffer.
+///
+/// The contents are whatever the previous user left (zeroes where the buffer
+/// had to grow), so `f` must overwrite what it reads.  A nested call, made
+/// while the scratch buffer is already lent out, gets a temporary instead.
+pub fn with_scratch<T>(len: usize, f: impl FnOnce(&mut [u8]) -> T) -> T {
+    SCRATCH.with(|cell| match cell.try_borrow_mut() {
+        Ok(mut buf) => {
+            if buf.len() < len {
+                buf.resize(len, 0);
+            }
+            f(&mut buf[..len])
+        }
+        Err(_) => f(&mut vec![0u8; len]),
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn pool_reuses_capacity() {
+        let pool = BufferPool::new();
+        let mut a = pool.take();
+        a.extend_from_slice(&[7u8; 4096]);
+        let ptr = a.as_ptr();
+        pool.give(a);
+        assert_eq!(pool.spare(), 1);
+
+        let b = pool.take();
+        assert!(b.is_empty());
+        assert!(b.capacity() >= 4096);
+        assert_eq!(b.as_ptr(), ptr);
+        assert_eq!(pool.spare(), 0);
+    }
+
+    #[test]
+    fn scratch_is_reused_and_nests() {
+        let first = with_scratch(1024, |buf| { buf.fill(1); buf.as_ptr() as usize });
+        let again = with_scratch(512, |buf| {
+            assert_eq!(buf.len(), 512);
+            let inner = with_scratch(16, |inner| inner.as_ptr() as usize);
+            assert_ne!(inner, buf.as_ptr() as usize);
+            buf.as_ptr() as usize
+        });
+        assert_eq!(first, again);
+    }
+}
@@ -0,0 +1,122 @@
+//! Adaptive codec selection: store chunks that will not shrink.
+//!
+//! Already-compressed media (JPEG, MP4, zip) costs the full price of Zstd
+//! or LZMA and saves nothing.  [`select`] looks at a sample of each chunk,
+//! [`SAMPLE_WINDOWS`] windows of [`SAMPLE_WINDOW`] bytes spread evenly over
+//! it, and decides between the configured codec and [`CodecId::None`]:
+//!
+//! - order-0 byte entropy at or above [`STORE_ENTROPY`] bits per byte:
+//!   stored;
+//! - below [`COMPRESS_ENTROPY`]: compressed;
+//! - in between: a trial LZ4 pass over the sample, which must save at
+//!   least [`MIN_TRIAL_SAVING`] of it.
+//!
+//! The choice is recorded in the block header's `codec_uuid` like any
+//! other, so readers need nothing new.  It depends only on the chunk, so a
+//! pipelined pack still matches a sequential one byte for byte.
+
+use super::CodecId;
+use crate::buffer::with_scratch;
+
+/// Bytes per sample window: one page.
+pub const SAMPLE_WINDOW: usize = 4 * 1024;
+
+/// Windows sampled per chunk, so at most 64 KiB is examined.
+pub const SAMPLE_WINDOWS: usize = 16;
+
+/// Sample entropy (bits per byte) from which a chunk is stored.
+pub const STORE_ENTROPY: f64 = 7.9;
+
+/// Sample entropy below which a chunk is compressed without a trial.
+pub const COMPRESS_ENTROPY: f64 = 7.0;
+
+/// Fraction of the sample a trial LZ4 pass has to save.
+pub const MIN_TRIAL_SAVING: f64 = 0.03;
+
+/// The codec to store `data` with: `codec`, or `CodecId::None` when the
+/// sample says compressing will not pay.
+///
+/// Chunks shorter than one window, and `CodecId::None` itself, are passed
+/// through.
+pub fn select(data: &[u8], codec: CodecId) -> CodecId {
+    if codec == CodecId::None || data.len() < SAMPLE_WINDOW {
+        return codec;
+    }
+    let windows = SAMPLE_WINDOWS.min(data.len() / SAMPLE_WINDOW);
+    let stride  = data.len() / windows;
+    let len     = windows * SAMPLE_WINDOW;
+
+    let compressible = with_scratch(len, |sample| {
+        for (i, window) in sample.chunks_exact_mut(SAMPLE_WINDOW).enumerate() {
+            let at = i * stride;
+            window.copy_from_slice(&data[at..at + SAMPLE_WINDOW]);
+        }
+        let bits = entropy(sample);
+        if bits >= STORE_ENTROPY {
+            false
+        } else if bits < COMPRESS_ENTROPY {
+            true
+        } else {
+            let trial = lz4_flex::block::compress(sample).len();
+            (trial as f64) <= len as f64 * (1.0 - MIN_TRIAL_SAVING)
+        }
+    });
+    if compressible { codec } else { CodecId::None }
+}
+
+/// Shannon entropy of `data`'s byte histogram, in bits per byte (0–8).
+pub fn entropy(data: &[u8]) -> f64 {
+    if data.is_empty() {
+        return 0.0;
+    }
+    let mut counts = [0u32; 256];
+    for &b in data {
+        counts[b as usize] += 1;
+    }
+    let n = data.len() as f64;
+    counts.iter()
+        .filter(|&&c| c != 0)
+        .map(|&c| {
+            let p = c as f64 / n;
+            -p * p.log2()
+        })
+        .sum()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// xorshift bytes: close to 8 bits of entropy.
+    fn noise(len: usize) -> Vec<u8> {
+        let mut x = 0x9e37_79b9_7f4a_7c15u64;
+        (0..len).map(|_| { x ^= x << 13; x ^= x >> 7; x ^= x << 17; (x >> 32) as u8 }).collect()
+    }
+
+    #[test]
+    fn entropy_bounds() {
+        assert_eq!(entropy(&[]), 0.0);
+        assert_eq!(entropy(&[7; 1000]), 0.0);
+        let all: Vec<u8> = (0..=255).collect();
+        assert!((entropy(&all) - 8.0).abs() < 1e-9);
+    }
+
+    #[test]
+    fn noise_is_stored_text_is_compressed() {
+        assert_eq!(select(&noise(1 << 20), CodecId::Zstd), CodecId::None);
+        let text = b"the archive index names every block of the file ".repeat(20_000);
+        assert_eq!(select(&text, CodecId::Lzma), CodecId::Lzma);
+        // Too short to sample: left to the codec.
+        assert_eq!(select(&noise(100), CodecId::Zstd), CodecId::Zstd);
+    }
+
+    #[test]
+    fn trial_pass_catches_repeated_noise() {
+        // High order-0 entropy, but every window repeats itself: LZ4 wins.
+        let unit = noise(512);
+        let data: Vec<u8> = unit.iter().copied().cycle().take(1 << 20).collect();
+        let bits = entropy(&data[..SAMPLE_WINDOW]);
+        assert!(bits > COMPRESS_ENTROPY && bits < STORE_ENTROPY, "{bits}");
+        assert_eq!(select(&data, CodecId::Zstd), CodecId::Zstd);
+    }
+}
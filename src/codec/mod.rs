@@ -1,4 +1,4 @@
-//! Codec registry: frozen UUID identities + optional short-ID fast path.
+//! Codec identities: frozen UUIDs + optional short-ID fast path.
 //!
 //! # Identity rules
 //! Every codec is identified by a 16-byte UUID.  That UUID is:
@@ -13,8 +13,19 @@
 //! # Endianness
 //! All codec IDs on disk are the raw 16 bytes of the UUID in little-endian
 //! field order (RFC 4122 §4.1.2 wire format).  This is non-negotiable.
+//!
+//! # Dispatch
+//! Implementations are resolved through [`registry`], which holds the
+//! built-ins and any codecs contributed by plugins.  [`adaptive`] picks,
+//! per chunk, whether the configured codec is worth running at all.
+
+pub mod adaptive;
+pub mod registry;
 
+use std::cell::RefCell;
 use std::io::{self, Read, Write};
+use std::sync::Mutex;
+use std::thread;
 use thiserror::Error;
 
 // ── Frozen codec UUIDs ──────────────────────────────────────────────────────
@@ -52,6 +63,20 @@ pub const UUID_LZMA:   [u8; 16] = [
     0x1c,0x2e,0x8f,0x4a, 0x3d,0x9b, 0x7a,0x4f,
     0xc2,0xe8, 0x6d,0x5b,0x1a,0x0f,0x3c,0x9e,
 ];
+/// LZMA, multi-stream — independent LZMA streams that encode and decode in
+/// parallel.  Payload layout in `LzmaMtCodec`.
+/// UUID: 6e2b9f41-8c3a-4d5e-9a7b-1f0c4e8d2b6a  (LE bytes)
+pub const UUID_LZMA_MT: [u8; 16] = [
+    0x41,0x9f,0x2b,0x6e, 0x3a,0x8c, 0x5e,0x4d,
+    0x9a,0x7b, 0x1f,0x0c,0x4e,0x8d,0x2b,0x6a,
+];
+/// Fill — a block of one repeated byte, stored as that byte and a length.
+/// Chosen by the block encoder, never by the caller.
+/// UUID: 7d3c5a92-4e1b-4c6f-8a2d-9b0e3f5c1a74  (LE bytes)
+pub const UUID_FILL:   [u8; 16] = [
+    0x92,0x5a,0x3c,0x7d, 0x1b,0x4e, 0x6f,0x4c,
+    0x8a,0x2d, 0x9b,0x0e,0x3f,0x5c,0x1a,0x74,
+];
 
 // ── Short IDs (in-process only, never written to disk) ───────────────────────
 
@@ -65,6 +90,8 @@ pub const SHORT_ZSTD:   ShortId = ShortId(1);
 pub const SHORT_LZ4:    ShortId = ShortId(2);
 pub const SHORT_BROTLI: ShortId = ShortId(3);
 pub const SHORT_LZMA:   ShortId = ShortId(4);
+pub const SHORT_LZMA_MT: ShortId = ShortId(5);
+pub const SHORT_FILL:   ShortId = ShortId(6);
 
 // ── CodecId enum ─────────────────────────────────────────────────────────────
 
@@ -77,6 +104,11 @@ pub enum CodecId {
     Lz4,
     Brotli,
     Lzma,
+    LzmaMt,
+    /// Uniform block; see [`FillCodec`].  Not selectable by name.
+    Fill,
+    /// A codec supplied by a plugin, identified by its UUID.
+    Plugin([u8; 16]),
 }
 
 impl CodecId {
@@ -90,6 +122,9 @@ impl CodecId {
             CodecId::Lz4    => UUID_LZ4,
             CodecId::Brotli => UUID_BROTLI,
             CodecId::Lzma   => UUID_LZMA,
+            CodecId::LzmaMt => UUID_LZMA_MT,
+            CodecId::Fill   => UUID_FILL,
+            CodecId::Plugin(uuid) => uuid,
         }
     }
 
@@ -102,18 +137,29 @@ impl CodecId {
             CodecId::Lz4    => SHORT_LZ4,
             CodecId::Brotli => SHORT_BROTLI,
             CodecId::Lzma   => SHORT_LZMA,
+            CodecId::LzmaMt => SHORT_LZMA_MT,
+            CodecId::Fill   => SHORT_FILL,
+            CodecId::Plugin(uuid) => registry::short_id(&uuid),
         }
     }
 
     /// Resolve a UUID to a CodecId.
-    /// Returns `None` if the UUID is not recognised by this build.
+    /// Returns `None` if neither this build nor a loaded plugin provides it.
     pub fn from_uuid(uuid: &[u8; 16]) -> Option<Self> {
+        Self::builtin_from_uuid(uuid)
+            .or_else(|| registry::contains(uuid).then_some(CodecId::Plugin(*uuid)))
+    }
+
+    /// Resolve a UUID to a built-in CodecId without consulting the registry.
+    pub fn builtin_from_uuid(uuid: &[u8; 16]) -> Option<Self> {
         match uuid {
             u if u == &UUID_NONE   => Some(CodecId::None),
             u if u == &UUID_ZSTD   => Some(CodecId::Zstd),
             u if u == &UUID_LZ4    => Some(CodecId::Lz4),
             u if u == &UUID_BROTLI => Some(CodecId::Brotli),
             u if u == &UUID_LZMA   => Some(CodecId::Lzma),
+            u if u == &UUID_LZMA_MT => Some(CodecId::LzmaMt),
+            u if u == &UUID_FILL   => Some(CodecId::Fill),
             _                      => None,
         }
     }
@@ -126,10 +172,15 @@ impl CodecId {
             CodecId::Lz4    => "lz4",
             CodecId::Brotli => "brotli",
             CodecId::Lzma   => "lzma",
+            CodecId::LzmaMt => "lzma-mt",
+            CodecId::Fill   => "fill",
+            CodecId::Plugin(_) => "plugin",
         }
     }
 
-    /// Parse from a CLI string.
+    /// Parse from a CLI string: a built-in name, or the hyphenated UUID of a
+    /// registered plugin codec.  [`CodecId::Fill`] is never returned, by
+    /// name or by UUID; the writer picks it on its own.
     pub fn from_name(s: &str) -> Option<Self> {
         match s.to_lowercase().as_str() {
             "none"   => Some(CodecId::None),
@@ -137,7 +188,9 @@ impl CodecId {
             "lz4"    => Some(CodecId::Lz4),
             "brotli" => Some(CodecId::Brotli),
             "lzma"   => Some(CodecId::Lzma),
-            _        => None,
+            "lzma-mt" => Some(CodecId::LzmaMt),
+            other    => uuid_from_str(other).and_then(|u| Self::from_uuid(&u))
+                .filter(|c| *c != CodecId::Fill),
         }
     }
 
@@ -161,6 +214,26 @@ pub fn uuid_to_string(bytes: &[u8; 16]) -> String {
     )
 }
 
+/// Parse `xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx` into raw LE-field-order bytes.
+/// Inverse of [`uuid_to_string`].
+pub fn uuid_from_str(s: &str) -> Option<[u8; 16]> {
+    let groups: Vec<&str> = s.split('-').collect();
+    let lens = [8, 4, 4, 4, 12];
+    if groups.len() != 5 || groups.iter().zip(lens).any(|(g, n)| g.len() != n) {
+        return None;
+    }
+    let hex: String = groups.concat();
+    let mut b = [0u8; 16];
+    for (i, byte) in b.iter_mut().enumerate() {
+        *byte = u8::from_str_radix(hex.get(2 * i..2 * i + 2)?, 16).ok()?;
+    }
+    // Canonical display order → LE field order.
+    b[0..4].reverse();
+    b[4..6].reverse();
+    b[6..8].reverse();
+    Some(b)
+}
+
 // ── Error type ───────────────────────────────────────────────────────────────
 
 #[derive(Error, Debug)]
@@ -175,16 +248,216 @@ pub enum CodecError {
     /// The UUID is formatted for display; decoding MUST NOT continue.
     #[error("Required codec not available (UUID {uuid}) — cannot decode without it")]
     UnavailableCodec { uuid: String },
+    #[error("Plugin error: {0}")]
+    Plugin(String),
     #[error("IO error: {0}")]
     Io(#[from] io::Error),
 }
 
+// ── Dictionary ───────────────────────────────────────────────────────────────
+
+/// A trained compression dictionary, stored once per archive in a DICT block.
+///
+/// Blocks compressed against it carry `FLAG_DICT`; see `block.rs`.  The
+/// BLAKE3 of the dictionary bytes is computed once here and used as a cache
+/// key for prepared codec state.
+#[derive(Debug, Clone)]
+pub struct Dictionary {
+    bytes: Vec<u8>,
+    hash:  [u8; 32],
+}
+
+impl Dictionary {
+    pub fn new(bytes: Vec<u8>) -> Self {
+        let hash = blake3::hash(&bytes).into();
+        Self { bytes, hash }
+    }
+
+    /// Train a Zstd dictionary of at most `max_size` bytes from `samples`.
+    ///
+    /// Training needs many small, representative samples (roughly 100× the
+    /// dictionary size in total); too little input is reported as an error.
+    pub fn train<S: AsRef<[u8]>>(samples: &[S], max_size: usize) -> Result<Self, CodecError> {
+        let bytes = zstd::dict::from_samples(samples, max_size)
+            .map_err(|e| CodecError::Compression(format!("dictionary training failed: {e}")))?;
+        Ok(Self::new(bytes))
+    }
+
+    #[inline] pub fn as_bytes(&self) -> &[u8]     { &self.bytes }
+    #[inline] pub fn hash(&self)     -> &[u8; 32] { &self.hash }
+}
+
 // ── Codec trait ──────────────────────────────────────────────────────────────
 
 pub trait Codec: Send + Sync {
     fn codec_id(&self) -> CodecId;
     fn compress(&self, data: &[u8], level: i32) -> Result<Vec<u8>, CodecError>;
     fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, CodecError>;
+
+    /// Compress `data`, appending the output to `dst`.
+    ///
+    /// Lets the block encoder reuse one buffer across blocks.  The default
+    /// appends the result of `compress`; the built-in codecs and plugins
+    /// write straight into `dst`'s spare capacity.
+    fn compress_into(&self, data: &[u8], level: i32, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+        dst.extend_from_slice(&self.compress(data, level)?);
+        Ok(())
+    }
+
+    /// [`compress_into`](Codec::compress_into) with up to `threads` threads
+    /// for this one input, for blocks large enough to keep several cores
+    /// busy.  The output decodes like any other payload of the codec.  The
+    /// default ignores `threads`.
+    fn compress_into_threaded(&self, data: &[u8], level: i32, _threads: usize, dst: &mut Vec<u8>)
+        -> Result<(), CodecError>
+    {
+        self.compress_into(data, level, dst)
+    }
+
+    /// Decompress when the exact output size is known (`orig_size` from the
+    /// block header).  Codecs that need a caller-sized output buffer, such as
+    /// plugins, override this; the rest ignore the hint.
+    fn decompress_sized(&self, data: &[u8], _orig_size: usize) -> Result<Vec<u8>, CodecError> {
+        self.decompress(data)
+    }
+
+    /// Decompress into a new buffer that grows with the output, failing as
+    /// soon as it would pass `limit` bytes.
+    ///
+    /// For block headers too large to allocate from up front: the output can
+    /// never cost more than `limit`, however the payload is crafted.  The
+    /// default relies on `decompress_sized` allocating at most `limit`, as
+    /// plugins do; every built-in codec bounds its own output.
+    fn decompress_bounded(&self, data: &[u8], limit: usize) -> Result<Vec<u8>, CodecError> {
+        let out = self.decompress_sized(data, limit)?;
+        within(out, limit)
+    }
+
+    /// Decompress straight into `dst`, returning the number of bytes written.
+    ///
+    /// `dst` is normally exactly `orig_size` bytes; output that does not fit
+    /// is an error.  The default decodes to a temporary and copies it; the
+    /// built-in codecs and plugins write in place.
+    fn decompress_into(&self, src: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+        let out = self.decompress_sized(src, dst.len())?;
+        copy_out(&out, dst)
+    }
+
+    /// [`decompress_into`](Codec::decompress_into), also returning BLAKE3 of
+    /// the bytes written, for block verification.  The default hashes `dst`
+    /// in one pass after decoding; codecs that know their output's hash
+    /// without reading it back (Fill) override it.
+    fn decompress_into_hashed(&self, src: &[u8], dst: &mut [u8])
+        -> Result<(usize, [u8; 32]), CodecError>
+    {
+        let n = self.decompress_into(src, dst)?;
+        Ok((n, crate::block::content_hash(&dst[..n])))
+    }
+
+    /// [`decompress_into_hashed`](Codec::decompress_into_hashed) with up to
+    /// `threads` threads for this one payload (`0` = one per core).  The
+    /// default ignores `threads`.
+    fn decompress_into_hashed_threaded(&self, src: &[u8], _threads: usize, dst: &mut [u8])
+        -> Result<(usize, [u8; 32]), CodecError>
+    {
+        self.decompress_into_hashed(src, dst)
+    }
+
+    /// True if `compress_with_dict` / `decompress_with_dict` are implemented.
+    fn supports_dict(&self) -> bool { false }
+
+    /// Compress against a shared dictionary.
+    fn compress_with_dict(&self, _data: &[u8], _level: i32, _dict: &Dictionary)
+        -> Result<Vec<u8>, CodecError>
+    {
+        Err(CodecError::Compression(format!(
+            "codec {} does not support dictionaries", self.codec_id().name())))
+    }
+
+    /// [`compress_with_dict`](Codec::compress_with_dict), appending to `dst`.
+    fn compress_with_dict_into(&self, data: &[u8], level: i32, dict: &Dictionary, dst: &mut Vec<u8>)
+        -> Result<(), CodecError>
+    {
+        dst.extend_from_slice(&self.compress_with_dict(data, level, dict)?);
+        Ok(())
+    }
+
+    /// Decompress a payload produced by `compress_with_dict`.
+    /// `orig_size` is the exact decompressed size from the block header.
+    fn decompress_with_dict(&self, _data: &[u8], _dict: &Dictionary, _orig_size: usize)
+        -> Result<Vec<u8>, CodecError>
+    {
+        Err(CodecError::Decompression(format!(
+            "codec {} does not support dictionaries", self.codec_id().name())))
+    }
+
+    /// [`decompress_with_dict`](Codec::decompress_with_dict) into `dst`.
+    fn decompress_with_dict_into(&self, src: &[u8], dict: &Dictionary, dst: &mut [u8])
+        -> Result<usize, CodecError>
+    {
+        let out = self.decompress_with_dict(src, dict, dst.len())?;
+        copy_out(&out, dst)
+    }
+
+    /// [`decompress_bounded`](Codec::decompress_bounded) against a
+    /// dictionary.
+    fn decompress_with_dict_bounded(&self, src: &[u8], dict: &Dictionary, limit: usize)
+        -> Result<Vec<u8>, CodecError>
+    {
+        let out = self.decompress_with_dict(src, dict, limit)?;
+        within(out, limit)
+    }
+
+    /// [`decompress_into_hashed`](Codec::decompress_into_hashed) against a
+    /// dictionary.
+    fn decompress_with_dict_into_hashed(&self, src: &[u8], dict: &Dictionary, dst: &mut [u8])
+        -> Result<(usize, [u8; 32]), CodecError>
+    {
+        let n = self.decompress_with_dict_into(src, dict, dst)?;
+        Ok((n, crate::block::content_hash(&dst[..n])))
+    }
+}
+
+/// Copy a decoded temporary into the caller's buffer for the default
+/// `*_into` implementations.
+fn copy_out(out: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+    let cap = dst.len();
+    dst.get_mut(..out.len())
+        .ok_or_else(|| overflow(out.len(), cap))?
+        .copy_from_slice(out);
+    Ok(out.len())
+}
+
+fn overflow(need: usize, cap: usize) -> CodecError {
+    CodecError::Decompression(format!(
+        "decompressed output ({need} B) exceeds destination buffer ({cap} B)"))
+}
+
+/// `out`, unless it is longer than `limit`.
+fn within(out: Vec<u8>, limit: usize) -> Result<Vec<u8>, CodecError> {
+    match out.len() {
+        n if n > limit => Err(past_limit(limit)),
+        _ => Ok(out),
+    }
+}
+
+fn past_limit(limit: usize) -> CodecError {
+    CodecError::Decompression(format!("decompressed output exceeds its {limit} B limit"))
+}
+
+/// Read a streaming decoder to its end, stopping one byte past `limit`.
+fn read_bounded(r: impl Read, limit: usize) -> Result<Vec<u8>, CodecError> {
+    let mut out = Vec::new();
+    r.take(limit as u64 + 1).read_to_end(&mut out).map_err(dec_err)?;
+    within(out, limit)
+}
+
+fn dec_err<E: std::fmt::Display>(e: E) -> CodecError {
+    CodecError::Decompression(e.to_string())
+}
+
+fn comp_err<E: std::fmt::Display>(e: E) -> CodecError {
+    CodecError::Compression(e.to_string())
 }
 
 // ── Built-in codec implementations ──────────────────────────────────────────
@@ -194,17 +467,164 @@ impl Codec for NoneCodec {
     fn codec_id(&self) -> CodecId { CodecId::None }
     fn compress(&self, data: &[u8], _: i32) -> Result<Vec<u8>, CodecError> { Ok(data.to_vec()) }
     fn decompress(&self, data: &[u8])        -> Result<Vec<u8>, CodecError> { Ok(data.to_vec()) }
+    fn compress_into(&self, data: &[u8], _: i32, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+        dst.extend_from_slice(data);
+        Ok(())
+    }
+    fn decompress_bounded(&self, data: &[u8], limit: usize) -> Result<Vec<u8>, CodecError> {
+        match data.len() {
+            n if n > limit => Err(past_limit(limit)),
+            _ => Ok(data.to_vec()),
+        }
+    }
+    fn decompress_into(&self, src: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+        copy_out(src, dst)
+    }
+}
+
+// Loading a dictionary into a Zstd context costs far more than compressing a
+// small file, so each thread keeps its last dictionary-bound context, and
+// one plain context each way for `compress_into` / `decompress_into`.
+thread_local! {
+    static ZSTD_CCTX: RefCell<Option<(i32, zstd::bulk::Compressor<'static>)>> = RefCell::new(None);
+    /// Context with `NbWorkers` set, keyed by (level, workers).
+    static ZSTD_MT_CCTX: RefCell<Option<(i32, u32, zstd::bulk::Compressor<'static>)>> =
+        RefCell::new(None);
+    static ZSTD_DICT_CCTX: RefCell<Option<([u8; 32], i32, zstd::bulk::Compressor<'static>)>> =
+        RefCell::new(None);
+    static ZSTD_DICT_DCTX: RefCell<Option<([u8; 32], zstd::bulk::Decompressor<'static>)>> =
+        RefCell::new(None);
+    static ZSTD_DCTX: RefCell<Option<zstd::bulk::Decompressor<'static>>> = RefCell::new(None);
+}
+
+/// Run `f` with this thread's decompression context bound to `dict`.
+fn with_zstd_dict_dctx<T>(
+    dict: &Dictionary,
+    f: impl FnOnce(&mut zstd::bulk::Decompressor<'static>) -> std::io::Result<T>,
+) -> Result<T, CodecError> {
+    ZSTD_DICT_DCTX.with(|cell| {
+        let mut slot = cell.borrow_mut();
+        let fresh = !matches!(&*slot, Some((h, _)) if h == dict.hash());
+        if fresh {
+            let d = zstd::bulk::Decompressor::with_dictionary(dict.as_bytes()).map_err(dec_err)?;
+            *slot = Some((*dict.hash(), d));
+        }
+        let (_, d) = slot.as_mut().unwrap();
+        f(d).map_err(dec_err)
+    })
+}
+
+/// Compress one frame into `dst`'s spare capacity, after what it holds.
+fn zstd_append(c: &mut zstd::bulk::Compressor<'static>, data: &[u8], dst: &mut Vec<u8>)
+    -> io::Result<()>
+{
+    let start = dst.len();
+    dst.reserve(zstd::zstd_safe::compress_bound(data.len()));
+    // A cursor past the end of the Vec writes into its spare capacity.
+    let mut out = io::Cursor::new(dst);
+    out.set_position(start as u64);
+    c.compress_to_buffer(data, &mut out)?;
+    Ok(())
 }
 
 pub struct ZstdCodec;
 impl Codec for ZstdCodec {
     fn codec_id(&self) -> CodecId { CodecId::Zstd }
     fn compress(&self, data: &[u8], level: i32) -> Result<Vec<u8>, CodecError> {
-        zstd::encode_all(data, level).map_err(|e| CodecError::Compression(e.to_string()))
+        let mut out = Vec::new();
+        self.compress_into(data, level, &mut out)?;
+        Ok(out)
+    }
+    fn compress_into(&self, data: &[u8], level: i32, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+        ZSTD_CCTX.with(|cell| {
+            let mut slot = cell.borrow_mut();
+            if !matches!(&*slot, Some((l, _)) if *l == level) {
+                *slot = Some((level, zstd::bulk::Compressor::new(level).map_err(comp_err)?));
+            }
+            let (_, c) = slot.as_mut().unwrap();
+            zstd_append(c, data, dst).map_err(comp_err)
+        })
+    }
+    /// One frame compressed by zstd's own worker threads, in jobs of a few
+    /// windows each.  The frame is identical for any `threads > 1`, and it
+    /// decodes serially like every other frame.
+    fn compress_into_threaded(&self, data: &[u8], level: i32, threads: usize, dst: &mut Vec<u8>)
+        -> Result<(), CodecError>
+    {
+        if threads <= 1 {
+            return self.compress_into(data, level, dst);
+        }
+        let workers = u32::try_from(threads).unwrap_or(u32::MAX);
+        ZSTD_MT_CCTX.with(|cell| {
+            let mut slot = cell.borrow_mut();
+            if !matches!(&*slot, Some((l, n, _)) if *l == level && *n == workers) {
+                let mut c = zstd::bulk::Compressor::new(level).map_err(comp_err)?;
+                c.set_parameter(zstd::stream::raw::CParameter::NbWorkers(workers)).map_err(comp_err)?;
+                *slot = Some((level, workers, c));
+            }
+            let (_, _, c) = slot.as_mut().unwrap();
+            zstd_append(c, data, dst).map_err(comp_err)
+        })
     }
     fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, CodecError> {
         zstd::decode_all(data).map_err(|e| CodecError::Decompression(e.to_string()))
     }
+    fn decompress_bounded(&self, data: &[u8], limit: usize) -> Result<Vec<u8>, CodecError> {
+        read_bounded(zstd::stream::read::Decoder::with_buffer(data).map_err(dec_err)?, limit)
+    }
+    fn decompress_into(&self, src: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+        ZSTD_DCTX.with(|cell| {
+            let mut slot = cell.borrow_mut();
+            if slot.is_none() {
+                *slot = Some(zstd::bulk::Decompressor::new().map_err(dec_err)?);
+            }
+            slot.as_mut().unwrap().decompress_to_buffer(src, dst).map_err(dec_err)
+        })
+    }
+    fn supports_dict(&self) -> bool { true }
+
+    fn compress_with_dict(&self, data: &[u8], level: i32, dict: &Dictionary)
+        -> Result<Vec<u8>, CodecError>
+    {
+        let mut out = Vec::new();
+        self.compress_with_dict_into(data, level, dict, &mut out)?;
+        Ok(out)
+    }
+
+    fn compress_with_dict_into(&self, data: &[u8], level: i32, dict: &Dictionary, dst: &mut Vec<u8>)
+        -> Result<(), CodecError>
+    {
+        ZSTD_DICT_CCTX.with(|cell| {
+            let mut slot = cell.borrow_mut();
+            let fresh = !matches!(&*slot, Some((h, l, _)) if h == dict.hash() && *l == level);
+            if fresh {
+                let c = zstd::bulk::Compressor::with_dictionary(level, dict.as_bytes())
+                    .map_err(|e| CodecError::Compression(e.to_string()))?;
+                *slot = Some((*dict.hash(), level, c));
+            }
+            let (_, _, c) = slot.as_mut().unwrap();
+            zstd_append(c, data, dst).map_err(comp_err)
+        })
+    }
+
+    fn decompress_with_dict(&self, data: &[u8], dict: &Dictionary, orig_size: usize)
+        -> Result<Vec<u8>, CodecError>
+    {
+        with_zstd_dict_dctx(dict, |d| d.decompress(data, orig_size))
+    }
+
+    fn decompress_with_dict_bounded(&self, src: &[u8], dict: &Dictionary, limit: usize)
+        -> Result<Vec<u8>, CodecError>
+    {
+        let d = zstd::stream::read::Decoder::with_dictionary(src, dict.as_bytes()).map_err(dec_err)?;
+        read_bounded(d, limit)
+    }
+
+    fn decompress_with_dict_into(&self, src: &[u8], dict: &Dictionary, dst: &mut [u8])
+        -> Result<usize, CodecError>
+    {
+        with_zstd_dict_dctx(dict, |d| d.decompress_to_buffer(src, dst))
+    }
 }
 
 pub struct Lz4Codec;
@@ -213,24 +633,66 @@ impl Codec for Lz4Codec {
     fn compress(&self, data: &[u8], _: i32) -> Result<Vec<u8>, CodecError> {
         Ok(lz4_flex::compress_prepend_size(data))
     }
+    fn compress_into(&self, data: &[u8], _: i32, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+        // Same framing as `compress_prepend_size`.  lz4_flex only writes to
+        // initialised slices, and `dst` arrives cleared, so the block goes
+        // into this thread's scratch buffer instead: that stays initialised
+        // between calls and is zeroed only where it grows.  Only the
+        // compressed bytes are copied out.
+        let bound = lz4_flex::block::get_maximum_output_size(data.len());
+        crate::buffer::with_scratch(bound, |out| {
+            let n = lz4_flex::block::compress_into(data, out).map_err(comp_err)?;
+            dst.reserve(4 + n);
+            dst.extend_from_slice(&(data.len() as u32).to_le_bytes());
+            dst.extend_from_slice(&out[..n]);
+            Ok(())
+        })
+    }
     fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, CodecError> {
         lz4_flex::decompress_size_prepended(data)
             .map_err(|e| CodecError::Decompression(e.to_string()))
     }
+    fn decompress_bounded(&self, data: &[u8], limit: usize) -> Result<Vec<u8>, CodecError> {
+        let n = lz4_size(data)?;
+        if n > limit {
+            return Err(past_limit(limit));
+        }
+        let mut out = vec![0u8; n];
+        let n = self.decompress_into(data, &mut out)?;
+        out.truncate(n);
+        Ok(out)
+    }
+    fn decompress_into(&self, src: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+        let n = lz4_size(src)?;
+        let cap = dst.len();
+        let out = dst.get_mut(..n).ok_or_else(|| overflow(n, cap))?;
+        lz4_flex::block::decompress_into(&src[4..], out).map_err(dec_err)
+    }
+}
+
+/// Decoded size from the `compress_prepend_size` framing: u32 LE size, then
+/// the raw block.
+fn lz4_size(src: &[u8]) -> Result<usize, CodecError> {
+    match src.get(..4) {
+        Some(prefix) => Ok(u32::from_le_bytes(prefix.try_into().unwrap()) as usize),
+        None => Err(CodecError::Decompression("LZ4 payload shorter than its size prefix".into())),
+    }
 }
 
 pub struct BrotliCodec;
 impl Codec for BrotliCodec {
     fn codec_id(&self) -> CodecId { CodecId::Brotli }
     fn compress(&self, data: &[u8], level: i32) -> Result<Vec<u8>, CodecError> {
-        let quality = level.clamp(0, 11) as u32;
         let mut out = Vec::new();
-        {
-            let mut w = brotli::CompressorWriter::new(&mut out, 4096, quality, 22);
-            w.write_all(data).map_err(|e| CodecError::Compression(e.to_string()))?;
-        }
+        self.compress_into(data, level, &mut out)?;
         Ok(out)
     }
+    fn compress_into(&self, data: &[u8], level: i32, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+        let quality = level.clamp(0, 11) as u32;
+        // Dropping the writer finishes the stream.
+        let mut w = brotli::CompressorWriter::new(dst, 4096, quality, 22);
+        w.write_all(data).map_err(comp_err)
+    }
     fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, CodecError> {
         let mut out = Vec::new();
         brotli::Decompressor::new(data, 4096)
@@ -238,47 +700,332 @@ impl Codec for BrotliCodec {
             .map_err(|e| CodecError::Decompression(e.to_string()))?;
         Ok(out)
     }
+    fn decompress_bounded(&self, data: &[u8], limit: usize) -> Result<Vec<u8>, CodecError> {
+        read_bounded(brotli::Decompressor::new(data, 4096), limit)
+    }
+    fn decompress_into(&self, src: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+        let mut r = brotli::Decompressor::new(src, 4096);
+        let mut n = 0;
+        while n < dst.len() {
+            match r.read(&mut dst[n..]).map_err(dec_err)? {
+                0 => return Ok(n),
+                k => n += k,
+            }
+        }
+        // `dst` is full; anything left over means it was too small.
+        if r.read(&mut [0u8; 1]).map_err(dec_err)? != 0 {
+            return Err(overflow(n + 1, dst.len()));
+        }
+        Ok(n)
+    }
 }
 
 pub struct LzmaCodec;
 impl Codec for LzmaCodec {
     fn codec_id(&self) -> CodecId { CodecId::Lzma }
-    fn compress(&self, data: &[u8], _: i32) -> Result<Vec<u8>, CodecError> {
+    fn compress(&self, data: &[u8], level: i32) -> Result<Vec<u8>, CodecError> {
         let mut out = Vec::new();
-        lzma_rs::lzma_compress(&mut std::io::Cursor::new(data), &mut out)
-            .map_err(|e| CodecError::Compression(e.to_string()))?;
+        self.compress_into(data, level, &mut out)?;
         Ok(out)
     }
+    fn compress_into(&self, data: &[u8], _: i32, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+        lzma_rs::lzma_compress(&mut std::io::Cursor::new(data), dst).map_err(comp_err)
+    }
     fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, CodecError> {
         let mut out = Vec::new();
         lzma_rs::lzma_decompress(&mut std::io::Cursor::new(data), &mut out)
             .map_err(|e| CodecError::Decompression(e.to_string()))?;
         Ok(out)
     }
+    fn decompress_bounded(&self, data: &[u8], limit: usize) -> Result<Vec<u8>, CodecError> {
+        let mut out = BoundedWriter { out: Vec::new(), limit };
+        lzma_rs::lzma_decompress(&mut std::io::Cursor::new(data), &mut out).map_err(dec_err)?;
+        Ok(out.out)
+    }
+    fn decompress_into(&self, src: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+        // Writing past the end of `dst` fails with `WriteZero`.
+        let mut out = std::io::Cursor::new(dst);
+        lzma_rs::lzma_decompress(&mut std::io::Cursor::new(src), &mut out).map_err(dec_err)?;
+        Ok(out.position() as usize)
+    }
+}
+
+/// A growing `Vec` writer that fails rather than hold more than `limit`
+/// bytes, for decoders that only write.
+struct BoundedWriter {
+    out:   Vec<u8>,
+    limit: usize,
+}
+
+impl Write for BoundedWriter {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        if buf.len() > self.limit - self.out.len() {
+            return Err(io::Error::new(io::ErrorKind::WriteZero, past_limit(self.limit).to_string()));
+        }
+        self.out.extend_from_slice(buf);
+        Ok(buf.len())
+    }
+    fn flush(&mut self) -> io::Result<()> { Ok(()) }
+}
+
+/// Decoded bytes per stream of an `lzma-mt` payload: 4 MiB.  Fixed, so a
+/// payload does not depend on how many threads wrote it.
+pub const LZMA_MT_STREAM_SIZE: usize = 4 * 1024 * 1024;
+
+/// LZMA split into independent streams of [`LZMA_MT_STREAM_SIZE`] decoded
+/// bytes, each compressed and decompressed on its own thread.
+///
+/// Payload layout (all integers LE):
+///
+/// ```text
+/// u32                    stream count n
+/// n × (u32, u32)         decoded length, compressed length of each stream
+/// n × LZMA stream        `lzma_compress` output, back to back
+/// ```
+///
+/// Each stream starts with an empty dictionary, so the ratio is a little
+/// below one LZMA stream over the whole block.  Like [`LzmaCodec`] it
+/// ignores `level`: lzma-rs has a single preset.
+pub struct LzmaMtCodec;
+impl Codec for LzmaMtCodec {
+    fn codec_id(&self) -> CodecId { CodecId::LzmaMt }
+    fn compress(&self, data: &[u8], level: i32) -> Result<Vec<u8>, CodecError> {
+        let mut out = Vec::new();
+        self.compress_into(data, level, &mut out)?;
+        Ok(out)
+    }
+    fn compress_into(&self, data: &[u8], _: i32, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+        lzma_mt_compress(data, 1, dst)
+    }
+    fn compress_into_threaded(&self, data: &[u8], _: i32, threads: usize, dst: &mut Vec<u8>)
+        -> Result<(), CodecError>
+    {
+        lzma_mt_compress(data, threads, dst)
+    }
+    fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, CodecError> {
+        let total = lzma_mt_streams(data)?.iter().map(|&(n, _)| n).sum::<usize>();
+        let mut out = vec![0u8; total];
+        self.decompress_into(data, &mut out)?;
+        Ok(out)
+    }
+    fn decompress_bounded(&self, data: &[u8], limit: usize) -> Result<Vec<u8>, CodecError> {
+        // The stream table is checked against `limit` before it sizes anything.
+        let total = lzma_mt_streams(data)?.iter().map(|&(n, _)| n).sum::<usize>();
+        if total > limit {
+            return Err(past_limit(limit));
+        }
+        let mut out = vec![0u8; total];
+        self.decompress_into(data, &mut out)?;
+        Ok(out)
+    }
+    fn decompress_into(&self, src: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+        lzma_mt_decompress(src, 0, dst)
+    }
+    fn decompress_into_hashed_threaded(&self, src: &[u8], threads: usize, dst: &mut [u8])
+        -> Result<(usize, [u8; 32]), CodecError>
+    {
+        let n = lzma_mt_decompress(src, threads, dst)?;
+        Ok((n, crate::block::content_hash(&dst[..n])))
+    }
+}
+
+/// Compress `data` as an `lzma-mt` payload on up to `threads` threads.
+fn lzma_mt_compress(data: &[u8], threads: usize, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+    let pieces: Vec<&[u8]> = data.chunks(LZMA_MT_STREAM_SIZE).collect();
+    let streams = run_parallel(pieces.clone(), threads, |piece| {
+        let mut out = Vec::new();
+        lzma_rs::lzma_compress(&mut io::Cursor::new(piece), &mut out).map(|()| out)
+    })
+    .into_iter()
+    .collect::<io::Result<Vec<_>>>()
+    .map_err(comp_err)?;
+
+    dst.reserve(4 + 8 * streams.len() + streams.iter().map(Vec::len).sum::<usize>());
+    dst.extend_from_slice(&(streams.len() as u32).to_le_bytes());
+    for (piece, stream) in pieces.iter().zip(&streams) {
+        dst.extend_from_slice(&(piece.len() as u32).to_le_bytes());
+        dst.extend_from_slice(&(stream.len() as u32).to_le_bytes());
+    }
+    for stream in &streams {
+        dst.extend_from_slice(stream);
+    }
+    Ok(())
+}
+
+/// Decode an `lzma-mt` payload into `dst` on up to `threads` threads (`0` =
+/// one per core; 1 decodes the streams in turn on this thread).
+fn lzma_mt_decompress(src: &[u8], threads: usize, dst: &mut [u8]) -> Result<usize, CodecError> {
+    let streams = lzma_mt_streams(src)?;
+    let total: usize = streams.iter().map(|&(n, _)| n).sum();
+    let cap = dst.len();
+    // One disjoint output range per stream.
+    let mut rest = dst.get_mut(..total).ok_or_else(|| overflow(total, cap))?;
+    let mut jobs = Vec::with_capacity(streams.len());
+    for (n, stream) in streams {
+        let (out, tail) = std::mem::take(&mut rest).split_at_mut(n);
+        jobs.push((stream, out));
+        rest = tail;
+    }
+    let threads = match threads {
+        0 => thread::available_parallelism().map_or(1, |n| n.get()),
+        n => n,
+    };
+    for res in run_parallel(jobs, threads, |(stream, out)| lzma_mt_decode(stream, out)) {
+        res?;
+    }
+    Ok(total)
+}
+
+/// Split an `lzma-mt` payload into (decoded length, stream) pairs.
+fn lzma_mt_streams(src: &[u8]) -> Result<Vec<(usize, &[u8])>, CodecError> {
+    let truncated = || CodecError::Decompression("lzma-mt payload is truncated".into());
+    let n = u32::from_le_bytes(src.get(..4).ok_or_else(truncated)?.try_into().unwrap()) as usize;
+    let table_end = n.checked_mul(8).and_then(|t| t.checked_add(4)).ok_or_else(truncated)?;
+    let table = src.get(4..table_end).ok_or_else(truncated)?;
+
+    let mut pos = table_end;
+    let mut streams = Vec::with_capacity(n);
+    for entry in table.chunks_exact(8) {
+        let orig = u32::from_le_bytes(entry[..4].try_into().unwrap()) as usize;
+        let comp = u32::from_le_bytes(entry[4..].try_into().unwrap()) as usize;
+        streams.push((orig, src.get(pos..pos + comp).ok_or_else(truncated)?));
+        pos += comp;
+    }
+    if pos != src.len() {
+        return Err(CodecError::Decompression(format!(
+            "lzma-mt payload has {} bytes after its last stream", src.len() - pos)));
+    }
+    Ok(streams)
+}
+
+/// Decode one `lzma-mt` stream, which must fill `out` exactly.
+fn lzma_mt_decode(stream: &[u8], out: &mut [u8]) -> Result<(), CodecError> {
+    let want = out.len();
+    let mut w = io::Cursor::new(out);
+    lzma_rs::lzma_decompress(&mut io::Cursor::new(stream), &mut w).map_err(dec_err)?;
+    if w.position() as usize != want {
+        return Err(CodecError::Decompression(format!(
+            "lzma-mt stream decoded to {} B, table says {want} B", w.position())));
+    }
+    Ok(())
+}
+
+/// `items.map(f)` on up to `threads` scoped threads, results in input order.
+fn run_parallel<I: Send, T: Send>(items: Vec<I>, threads: usize, f: impl Fn(I) -> T + Sync) -> Vec<T> {
+    let n = items.len();
+    if threads <= 1 || n <= 1 {
+        return items.into_iter().map(f).collect();
+    }
+    let queue = Mutex::new(items.into_iter().enumerate());
+    let f = &f;
+    let mut out: Vec<Option<T>> = (0..n).map(|_| None).collect();
+    thread::scope(|s| {
+        let workers: Vec<_> = (0..threads.min(n)).map(|_| s.spawn(|| {
+            let mut done = Vec::new();
+            loop {
+                // The lock is released before `f` runs.
+                let next = queue.lock().unwrap().next();
+                match next {
+                    Some((i, item)) => done.push((i, f(item))),
+                    None            => return done,
+                }
+            }
+        })).collect();
+        for w in workers {
+            for (i, t) in w.join().unwrap() {
+                out[i] = Some(t);
+            }
+        }
+    });
+    out.into_iter().map(Option::unwrap).collect()
+}
+
+/// A run of one byte value: the payload is that byte, then the run length
+/// as u32 LE — 5 bytes for a whole zero chunk.  Decoding is a `fill` of the
+/// output.
+///
+/// `encode_block_into` switches to this codec on its own when every byte of
+/// a block is the same, whatever codec was asked for; the codec refuses any
+/// other input.
+pub struct FillCodec;
+impl Codec for FillCodec {
+    fn codec_id(&self) -> CodecId { CodecId::Fill }
+    fn compress(&self, data: &[u8], level: i32) -> Result<Vec<u8>, CodecError> {
+        let mut out = Vec::with_capacity(5);
+        self.compress_into(data, level, &mut out)?;
+        Ok(out)
+    }
+    fn compress_into(&self, data: &[u8], _: i32, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+        let byte = match crate::block::uniform_byte(data) {
+            Some(b)                  => b,
+            None if data.is_empty()  => 0,
+            None => return Err(CodecError::Compression("fill input is not one repeated byte".into())),
+        };
+        let len = u32::try_from(data.len()).map_err(comp_err)?;
+        dst.push(byte);
+        dst.extend_from_slice(&len.to_le_bytes());
+        Ok(())
+    }
+    fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, CodecError> {
+        let (byte, n) = fill_payload(data)?;
+        Ok(vec![byte; n])
+    }
+    fn decompress_bounded(&self, data: &[u8], limit: usize) -> Result<Vec<u8>, CodecError> {
+        match fill_payload(data)? {
+            (_, n) if n > limit => Err(past_limit(limit)),
+            (byte, n) => Ok(vec![byte; n]),
+        }
+    }
+    fn decompress_into(&self, src: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+        let (byte, n) = fill_payload(src)?;
+        let cap = dst.len();
+        dst.get_mut(..n).ok_or_else(|| overflow(n, cap))?.fill(byte);
+        Ok(n)
+    }
+    fn decompress_into_hashed(&self, src: &[u8], dst: &mut [u8])
+        -> Result<(usize, [u8; 32]), CodecError>
+    {
+        // The hash of a run is known without reading the run back.
+        let n = self.decompress_into(src, dst)?;
+        Ok((n, crate::block::fill_hash(src[0], n)))
+    }
+}
+
+/// (byte, length) of a fill payload.
+pub(crate) fn fill_payload(src: &[u8]) -> Result<(u8, usize), CodecError> {
+    match src {
+        &[byte, a, b, c, d] => Ok((byte, u32::from_le_bytes([a, b, c, d]) as usize)),
+        _ => Err(CodecError::Decompression(format!(
+            "fill payload is {} bytes, expected 5", src.len()))),
+    }
 }
 
 // ── Factory ──────────────────────────────────────────────────────────────────
 
-/// Resolve a UUID to a built-in codec.
+//
+// Both functions hand out `&'static` handles owned by the registry: nothing
+// is allocated per call, so they are cheap enough to call once per block.
+
+/// Resolve a UUID to a registered codec (built-in or plugin).
 ///
 /// Returns `Err(CodecError::UnavailableCodec)` if the UUID is not recognised.
 /// The caller MUST NOT fall back to any other codec — fail hard.
-pub fn get_codec_by_uuid(uuid: &[u8; 16]) -> Result<Box<dyn Codec>, CodecError> {
-    match CodecId::from_uuid(uuid) {
-        Some(id) => get_codec(id),
-        None => Err(CodecError::UnavailableCodec {
-            uuid: uuid_to_string(uuid),
-        }),
-    }
+pub fn get_codec_by_uuid(uuid: &[u8; 16]) -> Result<&'static dyn Codec, CodecError> {
+    registry::lookup(uuid).ok_or_else(|| CodecError::UnavailableCodec {
+        uuid: uuid_to_string(uuid),
+    })
 }
 
-/// Resolve a CodecId to a built-in codec.
-pub fn get_codec(id: CodecId) -> Result<Box<dyn Codec>, CodecError> {
+/// Resolve a CodecId to a registered codec.
+///
+/// Built-ins go straight to the short-ID table (one atomic load); only
+/// `CodecId::Plugin` needs the UUID map.
+#[inline]
+pub fn get_codec(id: CodecId) -> Result<&'static dyn Codec, CodecError> {
     match id {
-        CodecId::None   => Ok(Box::new(NoneCodec)),
-        CodecId::Zstd   => Ok(Box::new(ZstdCodec)),
-        CodecId::Lz4    => Ok(Box::new(Lz4Codec)),
-        CodecId::Brotli => Ok(Box::new(BrotliCodec)),
-        CodecId::Lzma   => Ok(Box::new(LzmaCodec)),
+        CodecId::Plugin(uuid) => get_codec_by_uuid(&uuid),
+        builtin => registry::lookup_short(builtin.short_id()).ok_or_else(|| {
+            CodecError::UnavailableCodec { uuid: builtin.uuid_str() }
+        }),
     }
 }
@@ -0,0 +1,281 @@
+//! Process-wide codec registry: built-in codecs plus loaded plugins.
+//!
+//! # Lookup
+//! Entries are keyed by the frozen 16-byte codec UUID.  Every codec that owns
+//! a short ID below [`MAX_SHORT_ID`] also occupies a slot in a lock-free
+//! table, so dispatch by [`ShortId`] (and therefore by built-in [`CodecId`])
+//! is one atomic load.  UUIDs without a slot fall back to a read-locked map.
+//!
+//! # Plugins
+//! On first use the registry loads every plugin named by the
+//! `SIXCY_PLUGIN_PATH` environment variable — a platform path list whose
+//! entries are shared libraries or directories containing them.  More can be
+//! added at any time with [`load_plugin`] or, for statically linked plugins,
+//! [`register_plugin`].  Each library is opened once per process and never
+//! closed; its descriptor is `'static` for the life of the process.
+//!
+//! A plugin whose UUID equals a built-in UUID replaces the built-in codec for
+//! that UUID (and its short ID).  The on-disk identity is unchanged, so
+//! archives stay readable by builds without the plugin.
+//!
+//! # Short IDs
+//! Built-ins keep their fixed short IDs.  A plugin gets its advisory
+//! `short_id` only if it is below [`MAX_SHORT_ID`] and not already taken;
+//! otherwise it is reachable by UUID alone.  Short IDs are never persisted.
+
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
+use std::ptr;
+use std::sync::atomic::{AtomicPtr, Ordering};
+use std::sync::{Mutex, OnceLock, RwLock};
+
+use super::{
+    BrotliCodec, Codec, CodecError, CodecId, FillCodec, Lz4Codec, LzmaCodec, LzmaMtCodec, NoneCodec, ShortId,
+    ZstdCodec, uuid_to_string,
+};
+use crate::plugin::{PluginCodec, SixcyCodecPlugin, SixcyCodecRegisterFn};
+
+/// Environment variable holding the plugin search path.
+pub const PLUGIN_PATH_ENV: &str = "SIXCY_PLUGIN_PATH";
+
+/// Exported symbol every plugin library must provide.
+pub const PLUGIN_ENTRY_SYMBOL: &[u8] = b"sixcy_codec_register\0";
+
+/// Size of the short-ID fast-path table.
+pub const MAX_SHORT_ID: usize = 256;
+
+static NONE:   NoneCodec   = NoneCodec;
+static ZSTD:   ZstdCodec   = ZstdCodec;
+static LZ4:    Lz4Codec    = Lz4Codec;
+static BROTLI: BrotliCodec = BrotliCodec;
+static LZMA:   LzmaCodec   = LzmaCodec;
+static LZMA_MT: LzmaMtCodec = LzmaMtCodec;
+static FILL:   FillCodec   = FillCodec;
+
+const BUILTINS: [&'static dyn Codec; 7] = [&NONE, &ZSTD, &LZ4, &BROTLI, &LZMA, &LZMA_MT, &FILL];
+
+/// Short-ID fast path.  Each non-null slot points at a leaked `&dyn Codec`;
+/// replaced slots are leaked rather than freed since readers hold no lock.
+static FAST: [AtomicPtr<&'static dyn Codec>; MAX_SHORT_ID] =
+    [const { AtomicPtr::new(ptr::null_mut()) }; MAX_SHORT_ID];
+
+// ── Public types ─────────────────────────────────────────────────────────────
+
+/// Where a registered codec implementation came from.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum CodecSource {
+    /// Compiled into this build.
+    BuiltIn,
+    /// Loaded from a shared library at this path.
+    Library(PathBuf),
+    /// Registered from a statically linked descriptor.
+    Static,
+}
+
+/// Diagnostic description of one registry entry.
+#[derive(Debug, Clone)]
+pub struct CodecInfo {
+    pub uuid:     [u8; 16],
+    /// Fast-path slot actually assigned; `ShortId(0)` for plugins without one.
+    pub short_id: ShortId,
+    pub source:   CodecSource,
+}
+
+// ── Registry ─────────────────────────────────────────────────────────────────
+
+struct Entry {
+    codec: &'static dyn Codec,
+    info:  CodecInfo,
+}
+
+struct Registry {
+    by_uuid:   RwLock<HashMap<[u8; 16], Entry>>,
+    /// Opened libraries — kept alive for the life of the process.
+    libraries: Mutex<Vec<(PathBuf, [u8; 16], libloading::Library)>>,
+    /// Failures from loading `SIXCY_PLUGIN_PATH` at start-up.
+    errors:    Mutex<Vec<(PathBuf, String)>>,
+}
+
+fn registry() -> &'static Registry {
+    static REGISTRY: OnceLock<Registry> = OnceLock::new();
+    REGISTRY.get_or_init(|| {
+        let r = Registry {
+            by_uuid:   RwLock::new(HashMap::new()),
+            libraries: Mutex::new(Vec::new()),
+            errors:    Mutex::new(Vec::new()),
+        };
+        for codec in BUILTINS {
+            r.insert(codec, codec.codec_id().uuid(), codec.codec_id().short_id(), CodecSource::BuiltIn);
+        }
+        if let Some(paths) = std::env::var_os(PLUGIN_PATH_ENV) {
+            for p in std::env::split_paths(&paths) {
+                r.load_search_entry(&p);
+            }
+        }
+        r
+    })
+}
+
+impl Registry {
+    /// Add or replace the codec for `uuid`, claiming a fast-path slot.
+    fn insert(&self, codec: &'static dyn Codec, uuid: [u8; 16], wanted: ShortId, source: CodecSource) {
+        let mut map = self.by_uuid.write().unwrap();
+
+        // Built-in UUIDs always use the built-in slot; others get their
+        // advisory short ID if it is free.
+        let slot = match CodecId::builtin_from_uuid(&uuid) {
+            Some(id) => Some(id.short_id().0 as usize),
+            None => {
+                let s = wanted.0 as usize;
+                let free = s != 0 && s < MAX_SHORT_ID
+                    && FAST[s].load(Ordering::Acquire).is_null();
+                free.then_some(s)
+            }
+        };
+        if let Some(s) = slot {
+            FAST[s].store(Box::into_raw(Box::new(codec)), Ordering::Release);
+        }
+        let short_id = ShortId(slot.unwrap_or(0) as u16);
+        map.insert(uuid, Entry { codec, info: CodecInfo { uuid, short_id, source } });
+    }
+
+    fn register_desc(&self, desc: &'static SixcyCodecPlugin, source: CodecSource)
+        -> Result<[u8; 16], CodecError>
+    {
+        let codec = PluginCodec::new(desc).map_err(CodecError::Plugin)?;
+        let uuid  = *codec.uuid();
+        let codec: &'static PluginCodec = Box::leak(Box::new(codec));
+        let wanted = ShortId(u16::try_from(desc.short_id).unwrap_or(0));
+        self.insert(codec, uuid, wanted, source);
+        Ok(uuid)
+    }
+
+    fn load_library(&self, path: &Path) -> Result<[u8; 16], CodecError> {
+        let path = path.canonicalize()
+            .map_err(|e| CodecError::Plugin(format!("{}: {e}", path.display())))?;
+        let mut libs = self.libraries.lock().unwrap();
+        if let Some((_, uuid, _)) = libs.iter().find(|(p, _, _)| *p == path) {
+            return Ok(*uuid);
+        }
+
+        let plugin_err = |e: String| CodecError::Plugin(format!("{}: {e}", path.display()));
+        // Safety: loading a library runs its initialisers; plugins are
+        // trusted code by definition of being on the search path.
+        // dlopen errors already name the library.
+        let lib = unsafe { libloading::Library::new(&path) }
+            .map_err(|e| CodecError::Plugin(e.to_string()))?;
+        let desc = unsafe {
+            let entry = lib.get::<SixcyCodecRegisterFn>(PLUGIN_ENTRY_SYMBOL)
+                .map_err(|e| plugin_err(e.to_string()))?;
+            (*entry)()
+        };
+        if desc.is_null() {
+            return Err(plugin_err("sixcy_codec_register returned NULL".into()));
+        }
+        // Safety: the ABI requires a static descriptor, and the library is
+        // never unloaded once registered.  On error `lib` is dropped here,
+        // which dlcloses a plugin the host rejected.
+        let desc: &'static SixcyCodecPlugin = unsafe { &*desc };
+        let uuid = self.register_desc(desc, CodecSource::Library(path.clone()))
+            .map_err(|e| plugin_err(e.to_string()))?;
+        libs.push((path, uuid, lib));
+        Ok(uuid)
+    }
+
+    /// Load one search-path entry: a library, or every library in a directory.
+    fn load_search_entry(&self, entry: &Path) {
+        let record = |path: &Path, r: Result<[u8; 16], CodecError>| {
+            if let Err(e) = r {
+                self.errors.lock().unwrap().push((path.to_owned(), e.to_string()));
+            }
+        };
+        if entry.is_dir() {
+            let mut libs: Vec<PathBuf> = match std::fs::read_dir(entry) {
+                Ok(rd) => rd.filter_map(|e| e.ok().map(|e| e.path()))
+                    .filter(|p| p.extension().map_or(false, |x| x == std::env::consts::DLL_EXTENSION))
+                    .collect(),
+                Err(e) => return record(entry, Err(e.into())),
+            };
+            libs.sort();
+            for lib in libs {
+                let r = self.load_library(&lib);
+                record(&lib, r);
+            }
+        } else if !entry.as_os_str().is_empty() {
+            let r = self.load_library(entry);
+            record(entry, r);
+        }
+    }
+}
+
+// ── Public API ───────────────────────────────────────────────────────────────
+
+/// Resolve a short ID through the fast-path table.
+#[inline]
+pub fn lookup_short(id: ShortId) -> Option<&'static dyn Codec> {
+    registry();
+    let p = FAST.get(id.0 as usize)?.load(Ordering::Acquire);
+    // Safety: non-null slots point at leaked, never-freed `&'static dyn Codec`s.
+    if p.is_null() { None } else { Some(unsafe { *p }) }
+}
+
+/// Resolve a codec UUID.  Returns `None` if no built-in or plugin provides it.
+pub fn lookup(uuid: &[u8; 16]) -> Option<&'static dyn Codec> {
+    if let Some(id) = CodecId::builtin_from_uuid(uuid) {
+        return lookup_short(id.short_id());
+    }
+    registry().by_uuid.read().unwrap().get(uuid).map(|e| e.codec)
+}
+
+/// True if a codec for `uuid` is available in this process.
+pub fn contains(uuid: &[u8; 16]) -> bool {
+    lookup(uuid).is_some()
+}
+
+/// Fast-path slot assigned to `uuid`, or `ShortId(0)` if none.
+pub fn short_id(uuid: &[u8; 16]) -> ShortId {
+    registry().by_uuid.read().unwrap()
+        .get(uuid)
+        .map_or(ShortId(0), |e| e.info.short_id)
+}
+
+/// Load a plugin shared library and register its codec.
+///
+/// Loading the same path twice is a no-op that returns the same UUID.
+///
+/// # Errors
+/// `CodecError::Plugin` if the library cannot be opened, lacks the
+/// `sixcy_codec_register` symbol, or declares an unsupported ABI version.
+pub fn load_plugin<P: AsRef<Path>>(path: P) -> Result<[u8; 16], CodecError> {
+    registry().load_library(path.as_ref())
+}
+
+/// Register a statically linked plugin descriptor.
+pub fn register_plugin(desc: &'static SixcyCodecPlugin) -> Result<[u8; 16], CodecError> {
+    registry().register_desc(desc, CodecSource::Static)
+}
+
+/// Every registered codec, ordered by short ID then UUID.
+pub fn codecs() -> Vec<CodecInfo> {
+    let mut v: Vec<CodecInfo> = registry().by_uuid.read().unwrap()
+        .values()
+        .map(|e| e.info.clone())
+        .collect();
+    v.sort_by_key(|i| (i.short_id.0 == 0 && i.source != CodecSource::BuiltIn, i.short_id.0, i.uuid));
+    v
+}
+
+/// Plugins from `SIXCY_PLUGIN_PATH` that failed to load, with the reason.
+pub fn load_errors() -> Vec<(PathBuf, String)> {
+    registry().errors.lock().unwrap().clone()
+}
+
+/// Display form of a registry entry (diagnostics only).
+pub fn describe(info: &CodecInfo) -> String {
+    let name = CodecId::builtin_from_uuid(&info.uuid).map_or("plugin", |c| c.name());
+    match &info.source {
+        CodecSource::BuiltIn    => format!("{} ({name}, built-in)", uuid_to_string(&info.uuid)),
+        CodecSource::Static     => format!("{} ({name}, static plugin)", uuid_to_string(&info.uuid)),
+        CodecSource::Library(p) => format!("{} ({name}, {})", uuid_to_string(&info.uuid), p.display()),
+    }
+}
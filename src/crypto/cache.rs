@@ -0,0 +1,161 @@
+//! Per-process cache of derived archive keys.
+//!
+//! Argon2id costs each encrypted open 64 MiB and a few hundred milliseconds
+//! before the first block can be read.  A service that opens the same
+//! archives over and over pays that every time, for the same key.
+//! [`KeyCache`] derives each archive's key once.
+//!
+//! Entries are keyed by archive UUID and a fingerprint of the password:
+//! BLAKE3 keyed with a random per-cache secret.  A different password for the
+//! same archive gets its own derivation, never the cached key, and the cache
+//! does not hold the password.  Without the secret, the fingerprint cannot be
+//! checked against guesses any faster than Argon2id allows.  Keys are
+//! zeroized when evicted, forgotten, or dropped with the cache.  Once
+//! `capacity` keys are held, the least recently used one is evicted.
+
+use std::collections::VecDeque;
+use std::sync::{Mutex, OnceLock};
+
+use aes_gcm::aead::rand_core::RngCore;
+use aes_gcm::aead::OsRng;
+use uuid::Uuid;
+use zeroize::Zeroizing;
+
+use super::{derive_key, CryptoError};
+
+/// Keys held by [`KeyCache::global`].
+pub const DEFAULT_KEY_CACHE_ENTRIES: usize = 64;
+
+struct Entry {
+    archive:     Uuid,
+    fingerprint: [u8; 32],
+    key:         Zeroizing<[u8; 32]>,
+}
+
+pub struct KeyCache {
+    secret:   Zeroizing<[u8; 32]>,
+    capacity: usize,
+    /// Least recently used first.
+    entries:  Mutex<VecDeque<Entry>>,
+}
+
+impl KeyCache {
+    /// An empty cache holding at most `capacity` keys; `0` caches nothing.
+    pub fn new(capacity: usize) -> Self {
+        let mut secret = Zeroizing::new([0u8; 32]);
+        OsRng.fill_bytes(&mut secret[..]);
+        Self { secret, capacity, entries: Mutex::new(VecDeque::new()) }
+    }
+
+    /// The process-wide cache, holding [`DEFAULT_KEY_CACHE_ENTRIES`] keys.
+    pub fn global() -> &'static KeyCache {
+        static GLOBAL: OnceLock<KeyCache> = OnceLock::new();
+        GLOBAL.get_or_init(|| KeyCache::new(DEFAULT_KEY_CACHE_ENTRIES))
+    }
+
+    /// The key for `password` on the archive `archive_uuid`, as
+    /// [`derive_key`] gives it: from the cache, or derived and cached.
+    ///
+    /// The lock is not held while deriving, so a cold open does not hold up
+    /// warm ones.  Two threads that miss on the same key both derive it.
+    pub fn key(&self, password: &str, archive_uuid: &Uuid) -> Result<[u8; 32], CryptoError> {
+        let fingerprint = *blake3::keyed_hash(&self.secret, password.as_bytes()).as_bytes();
+        if let Some(key) = self.lookup(archive_uuid, &fingerprint) {
+            return Ok(key);
+        }
+        let key = Zeroizing::new(derive_key(password, archive_uuid.as_bytes())?);
+        let out = *key;
+        self.insert(Entry { archive: *archive_uuid, fingerprint, key });
+        Ok(out)
+    }
+
+    /// Drop (and zeroize) every key held for `archive_uuid`.
+    pub fn forget(&self, archive_uuid: &Uuid) {
+        self.entries.lock().unwrap().retain(|e| e.archive != *archive_uuid);
+    }
+
+    /// Drop (and zeroize) every key.
+    pub fn clear(&self) {
+        self.entries.lock().unwrap().clear();
+    }
+
+    pub fn len(&self) -> usize {
+        self.entries.lock().unwrap().len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    fn lookup(&self, archive: &Uuid, fingerprint: &[u8; 32]) -> Option<[u8; 32]> {
+        let mut entries = self.entries.lock().unwrap();
+        let at = entries.iter().position(|e| e.archive == *archive && e.fingerprint == *fingerprint)?;
+        let entry = entries.remove(at)?;
+        let key = *entry.key;
+        entries.push_back(entry);
+        Some(key)
+    }
+
+    fn insert(&self, entry: Entry) {
+        if self.capacity == 0 {
+            return;
+        }
+        let mut entries = self.entries.lock().unwrap();
+        if entries.iter().any(|e| e.archive == entry.archive && e.fingerprint == entry.fingerprint) {
+            return;
+        }
+        while entries.len() >= self.capacity {
+            entries.pop_front();
+        }
+        entries.push_back(entry);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn cached(cache: &KeyCache, archive: &Uuid, fingerprint: [u8; 32]) -> bool {
+        cache.lookup(archive, &fingerprint).is_some()
+    }
+
+    #[test]
+    fn derives_once_per_archive_and_password() {
+        let cache = KeyCache::new(4);
+        let archive = Uuid::new_v4();
+        let key = cache.key("pw", &archive).unwrap();
+        assert_eq!(key, derive_key("pw", archive.as_bytes()).unwrap());
+        assert_eq!(cache.len(), 1);
+        assert_eq!(cache.key("pw", &archive).unwrap(), key);
+        assert_eq!(cache.len(), 1, "a hit adds nothing");
+
+        // Another password is never answered with the cached key.
+        assert_ne!(cache.key("other", &archive).unwrap(), key);
+        assert_eq!(cache.len(), 2);
+        cache.forget(&archive);
+        assert!(cache.is_empty());
+    }
+
+    #[test]
+    fn evicts_least_recently_used() {
+        let cache = KeyCache::new(2);
+        let (a, b, c) = (Uuid::new_v4(), Uuid::new_v4(), Uuid::new_v4());
+        for archive in [a, b] {
+            cache.insert(Entry { archive, fingerprint: [1; 32], key: Zeroizing::new([2; 32]) });
+        }
+        assert!(cached(&cache, &a, [1; 32]));
+        cache.insert(Entry { archive: c, fingerprint: [1; 32], key: Zeroizing::new([3; 32]) });
+        assert_eq!(cache.len(), 2);
+        assert!(!cached(&cache, &b, [1; 32]), "b was least recently used");
+        assert!(cached(&cache, &a, [1; 32]) && cached(&cache, &c, [1; 32]));
+        assert!(!cached(&cache, &a, [9; 32]), "fingerprints must match");
+
+        let none = KeyCache::new(0);
+        none.insert(Entry { archive: a, fingerprint: [1; 32], key: Zeroizing::new([2; 32]) });
+        assert!(none.is_empty());
+    }
+}
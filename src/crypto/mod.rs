@@ -4,15 +4,39 @@
 //! Encryption:     AES-256-GCM, nonce prepended to ciphertext
 //!
 //! Encrypted payload layout: [ nonce (12 B) | ciphertext | GCM tag (16 B) ]
+//!
+//! # Hot path
+//! Blocks are sealed and opened in place ([`seal_in_place`],
+//! [`open_in_place`]): the compressor writes after a reserved nonce slot and
+//! the ciphertext overwrites the plaintext, so encryption adds no buffer and
+//! no copy.  Each thread keeps the expanded key schedule of the last key it
+//! used, the same way `codec` keeps its last dictionary-bound context, so a
+//! writer or reader expands its key once per thread rather than per block.
+//! The cached key is zeroized when it is replaced, and [`forget_key`] clears
+//! it; writers and readers call that when they drop.
+//! The `aes` and `polyval` backends pick AES-NI and CLMUL (PCLMULQDQ, or
+//! PMULL on AArch64) at runtime; building with `-C target-cpu=native` lets
+//! them skip the detection.
+//!
+//! [`KeyCache`] keeps derived keys per archive, so opening an archive again
+//! with the same password skips Argon2id.
+
+mod cache;
+pub use cache::{KeyCache, DEFAULT_KEY_CACHE_ENTRIES};
 
+use std::cell::RefCell;
 use argon2::{Argon2, Algorithm, Version, Params};
-use aes_gcm::aead::{Aead, AeadCore, KeyInit, OsRng as AeadOsRng};
-use aes_gcm::Aes256Gcm;
+use aes_gcm::aead::{AeadCore, AeadInPlace, KeyInit, OsRng as AeadOsRng};
+use aes_gcm::{Aes256Gcm, Key, Nonce, Tag};
 use thiserror::Error;
+use zeroize::Zeroizing;
 
 /// Byte length of the AES-GCM nonce prepended to every encrypted payload.
 pub const NONCE_LEN: usize = 12;
 
+/// Byte length of the GCM tag appended to every encrypted payload.
+pub const TAG_LEN: usize = 16;
+
 #[derive(Error, Debug)]
 pub enum CryptoError {
     #[error("Encryption failed")]
@@ -21,7 +45,7 @@ pub enum CryptoError {
     DecryptionFailed,
     #[error("Key derivation failed: {0}")]
     KeyDerivation(String),
-    #[error("Encrypted payload too short (minimum {NONCE_LEN} bytes)")]
+    #[error("Encrypted payload too short (minimum {} bytes)", NONCE_LEN + TAG_LEN)]
     TooShort,
     #[error("Block is encrypted but no decryption key was provided")]
     MissingKey,
@@ -43,20 +67,82 @@ pub fn derive_key(password: &str, salt: &[u8]) -> Result<[u8; 32], CryptoError>
     Ok(key)
 }
 
-/// Encrypt `plaintext` with AES-256-GCM using a random nonce.
+// Expanding the key is the costly part of building a cipher, so each thread
+// keeps the one it used last.  Both halves are zeroized when dropped: the key
+// by `Zeroizing`, the key schedule by the `aes` crate's `zeroize` feature.
+thread_local! {
+    static CIPHER: RefCell<Option<(Zeroizing<[u8; 32]>, Aes256Gcm)>> = RefCell::new(None);
+}
+
+/// Run `f` with this thread's cipher for `key`.
+fn with_cipher<T>(key: &[u8; 32], f: impl FnOnce(&Aes256Gcm) -> T) -> T {
+    CIPHER.with(|cell| {
+        let mut slot = cell.borrow_mut();
+        if !matches!(&*slot, Some((k, _)) if **k == *key) {
+            *slot = Some((Zeroizing::new(*key), Aes256Gcm::new(Key::<Aes256Gcm>::from_slice(key))));
+        }
+        f(&slot.as_ref().unwrap().1)
+    })
+}
+
+/// Drop this thread's cached cipher if it was built for `key`.
 ///
-/// Returns `nonce (12 B) || ciphertext || GCM-tag (16 B)`.
-pub fn encrypt(key: &[u8; 32], plaintext: &[u8]) -> Result<Vec<u8>, CryptoError> {
-    let cipher = Aes256Gcm::new_from_slice(key)
-        .map_err(|_| CryptoError::EncryptionFailed)?;
+/// Only the calling thread's cache is cleared.  Worker threads that sealed or
+/// opened blocks are scoped to the call that spawned them, so their caches
+/// are dropped when they exit.
+pub fn forget_key(key: &[u8; 32]) {
+    // `try_with`: this runs from `Drop`, possibly while the thread exits.
+    let _ = CIPHER.try_with(|cell| {
+        if let Ok(mut slot) = cell.try_borrow_mut() {
+            if matches!(&*slot, Some((k, _)) if **k == *key) {
+                *slot = None;
+            }
+        }
+    });
+}
+
+/// Seal `buf` in place with a random nonce.
+///
+/// `buf` must hold `NONCE_LEN` reserved bytes followed by the plaintext.
+/// On return it holds `nonce || ciphertext || GCM-tag`, the layout
+/// [`encrypt`] produces; only the tag may grow the buffer.
+pub fn seal_in_place(key: &[u8; 32], buf: &mut Vec<u8>) -> Result<(), CryptoError> {
+    if buf.len() < NONCE_LEN {
+        return Err(CryptoError::EncryptionFailed);
+    }
     let nonce = Aes256Gcm::generate_nonce(&mut AeadOsRng);
-    let ciphertext = cipher
-        .encrypt(&nonce, plaintext)
+    let (slot, plaintext) = buf.split_at_mut(NONCE_LEN);
+    slot.copy_from_slice(&nonce);
+    let tag = with_cipher(key, |c| c.encrypt_in_place_detached(&nonce, b"", plaintext))
         .map_err(|_| CryptoError::EncryptionFailed)?;
+    buf.extend_from_slice(&tag);
+    Ok(())
+}
 
-    let mut out = Vec::with_capacity(NONCE_LEN + ciphertext.len());
-    out.extend_from_slice(nonce.as_slice());
-    out.extend_from_slice(&ciphertext);
+/// Open a payload produced by [`seal_in_place`] or [`encrypt`] in place,
+/// returning the plaintext as a subslice of `buf`.
+///
+/// On failure the contents of `buf` are unspecified.
+pub fn open_in_place<'a>(key: &[u8; 32], buf: &'a mut [u8]) -> Result<&'a mut [u8], CryptoError> {
+    if buf.len() < NONCE_LEN + TAG_LEN {
+        return Err(CryptoError::TooShort);
+    }
+    let (nonce, rest) = buf.split_at_mut(NONCE_LEN);
+    let (body, tag)   = rest.split_at_mut(rest.len() - TAG_LEN);
+    with_cipher(key, |c| c.decrypt_in_place_detached(
+        Nonce::from_slice(nonce), b"", body, Tag::from_slice(tag)))
+        .map_err(|_| CryptoError::DecryptionFailed)?;
+    Ok(body)
+}
+
+/// Encrypt `plaintext` with AES-256-GCM using a random nonce.
+///
+/// Returns `nonce (12 B) || ciphertext || GCM-tag (16 B)`.
+pub fn encrypt(key: &[u8; 32], plaintext: &[u8]) -> Result<Vec<u8>, CryptoError> {
+    let mut out = Vec::with_capacity(NONCE_LEN + plaintext.len() + TAG_LEN);
+    out.resize(NONCE_LEN, 0);
+    out.extend_from_slice(plaintext);
+    seal_in_place(key, &mut out)?;
     Ok(out)
 }
 
@@ -64,13 +150,50 @@ pub fn encrypt(key: &[u8; 32], plaintext: &[u8]) -> Result<Vec<u8>, CryptoError>
 ///
 /// Input must start with the 12-byte nonce followed by ciphertext + GCM tag.
 pub fn decrypt(key: &[u8; 32], data: &[u8]) -> Result<Vec<u8>, CryptoError> {
-    if data.len() < NONCE_LEN {
-        return Err(CryptoError::TooShort);
+    let mut buf = data.to_vec();
+    let len = open_in_place(key, &mut buf)?.len();
+    buf.copy_within(NONCE_LEN..NONCE_LEN + len, 0);
+    buf.truncate(len);
+    Ok(buf)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn sealed_in_place_matches_layout() {
+        let key = [3u8; 32];
+        let mut buf = vec![0u8; NONCE_LEN];
+        buf.extend_from_slice(b"block payload");
+        seal_in_place(&key, &mut buf).unwrap();
+        assert_eq!(buf.len(), NONCE_LEN + 13 + TAG_LEN);
+        assert_eq!(decrypt(&key, &buf).unwrap(), b"block payload");
+
+        let sealed = encrypt(&key, b"block payload").unwrap();
+        let mut copy = sealed.clone();
+        assert_eq!(open_in_place(&key, &mut copy).unwrap(), b"block payload");
+    }
+
+    #[test]
+    fn open_rejects_tampering_and_wrong_key() {
+        let key = [3u8; 32];
+        let mut sealed = encrypt(&key, b"secret").unwrap();
+        assert!(matches!(decrypt(&[4u8; 32], &sealed), Err(CryptoError::DecryptionFailed)));
+        sealed[NONCE_LEN] ^= 1;
+        assert!(matches!(decrypt(&key, &sealed), Err(CryptoError::DecryptionFailed)));
+        assert!(matches!(decrypt(&key, &[0u8; NONCE_LEN + TAG_LEN - 1]), Err(CryptoError::TooShort)));
+    }
+
+    #[test]
+    fn forget_key_clears_only_that_key() {
+        let cached = |key: &[u8; 32]| CIPHER.with(|c| matches!(&*c.borrow(), Some((k, _)) if **k == *key));
+        let key = [5u8; 32];
+        encrypt(&key, b"x").unwrap();
+        assert!(cached(&key));
+        forget_key(&[6u8; 32]);
+        assert!(cached(&key), "another key leaves the cache alone");
+        forget_key(&key);
+        assert!(CIPHER.with(|c| c.borrow().is_none()));
     }
-    let cipher = Aes256Gcm::new_from_slice(key)
-        .map_err(|_| CryptoError::DecryptionFailed)?;
-    let nonce = aes_gcm::Nonce::from_slice(&data[..NONCE_LEN]);
-    cipher
-        .decrypt(nonce, &data[NONCE_LEN..])
-        .map_err(|_| CryptoError::DecryptionFailed)
 }
@@ -0,0 +1,526 @@
+//! Binary FILE INDEX (index format v1) and its zero-parse reader.
+//!
+//! # Layout (all integers little-endian)
+//!
+//! ```text
+//! Header (72 B)
+//!    0      4   magic            = "6CYI"
+//!    4      2   index_version    = 1
+//!    6      2   flags            0x0001 = dict_offset present
+//!    8      8   record_count     N
+//!   16      8   block_ref_count  M
+//!   24      8   pool_size        string-pool bytes
+//!   32      8   dict_offset      valid only when flag 0x0001 is set
+//!   40     32   root_hash
+//! Record table   N × 64 B   in index order
+//! BlockRef array M × 64 B   every record's refs, concatenated
+//! Name table     N × 4 B    record positions sorted by name bytes
+//! String pool    pool_size  names and metadata
+//! ```
+//!
+//! A record (64 B):
+//!
+//! ```text
+//!    0   4  id                  4   4  parent_id
+//!    8   8  name_offset        16   4  name_len
+//!   20   4  meta_len           24   8  meta_offset
+//!   32   8  first_block_ref    40   8  block_ref_count
+//!   48   8  original_size      56   8  compressed_size
+//! ```
+//!
+//! A BlockRef (64 B): `content_hash` (32), then `archive_offset`,
+//! `intra_offset`, `intra_length`, `file_offset` (8 each).
+//!
+//! Metadata is a run of `(u32 key_len, key, u32 value_len, value)` entries in
+//! the string pool, sorted by key so the encoding is deterministic.
+//!
+//! # Lazy access
+//! [`IndexView`] keeps the serialized bytes and decodes fields on demand, so
+//! opening an archive validates the table once and allocates nothing per
+//! file.  [`IndexView::find_name`] and [`IndexView::find_name_last`]
+//! binary-search the name table and [`IndexView::find_id`] is a direct
+//! lookup (see [`IndexView::parse`]); [`RecordView::to_record`]
+//! materializes a single record.
+
+use std::collections::HashMap;
+use std::ops::Range;
+
+use super::{BlockRef, FileIndex, FileIndexRecord, IndexError};
+
+pub const INDEX_MAGIC:   &[u8; 4] = b"6CYI";
+pub const INDEX_VERSION: u16      = 1;
+
+pub const INDEX_HEADER_SIZE: usize = 72;
+pub const RECORD_SIZE:       usize = 64;
+pub const BLOCK_REF_SIZE:    usize = 64;
+const NAME_ENTRY_SIZE:       usize = 4;
+
+const FLAG_DICT_OFFSET: u16 = 0x0001;
+
+#[inline]
+fn u32_at(b: &[u8], at: usize) -> u32 { u32::from_le_bytes(b[at..at + 4].try_into().unwrap()) }
+#[inline]
+fn u64_at(b: &[u8], at: usize) -> u64 { u64::from_le_bytes(b[at..at + 8].try_into().unwrap()) }
+
+// ── Encoding ─────────────────────────────────────────────────────────────────
+
+/// Serialize `index` in index format v1.
+pub fn encode(index: &FileIndex) -> Result<Vec<u8>, IndexError> {
+    let n = index.records.len();
+    if u32::try_from(n).is_err() {
+        return Err(IndexError::Corrupt(format!("{n} records exceed the u32 name table")));
+    }
+    let m: usize = index.records.iter().map(|r| r.block_refs.len()).sum();
+
+    let mut table = Vec::with_capacity(n * RECORD_SIZE);
+    let mut refs  = Vec::with_capacity(m * BLOCK_REF_SIZE);
+    let mut pool  = Vec::new();
+    let mut first_ref = 0u64;
+
+    for rec in &index.records {
+        let name_offset = pool.len() as u64;
+        pool.extend_from_slice(rec.name.as_bytes());
+        let name_len = u32::try_from(rec.name.len())
+            .map_err(|_| IndexError::Corrupt(format!("record {} name too long", rec.id)))?;
+
+        let meta_offset = pool.len() as u64;
+        let mut meta: Vec<(&String, &String)> = rec.metadata.iter().collect();
+        meta.sort();
+        for (k, v) in meta {
+            for s in [k, v] {
+                let len = u32::try_from(s.len())
+                    .map_err(|_| IndexError::Corrupt(format!("record {} metadata too long", rec.id)))?;
+                pool.extend_from_slice(&len.to_le_bytes());
+                pool.extend_from_slice(s.as_bytes());
+            }
+        }
+        let meta_len = u32::try_from(pool.len() as u64 - meta_offset)
+            .map_err(|_| IndexError::Corrupt(format!("record {} metadata too long", rec.id)))?;
+
+        table.extend_from_slice(&rec.id.to_le_bytes());
+        table.extend_from_slice(&rec.parent_id.to_le_bytes());
+        table.extend_from_slice(&name_offset.to_le_bytes());
+        table.extend_from_slice(&name_len.to_le_bytes());
+        table.extend_from_slice(&meta_len.to_le_bytes());
+        table.extend_from_slice(&meta_offset.to_le_bytes());
+        table.extend_from_slice(&first_ref.to_le_bytes());
+        table.extend_from_slice(&(rec.block_refs.len() as u64).to_le_bytes());
+        table.extend_from_slice(&rec.original_size.to_le_bytes());
+        table.extend_from_slice(&rec.compressed_size.to_le_bytes());
+
+        for br in &rec.block_refs {
+            refs.extend_from_slice(&br.content_hash);
+            refs.extend_from_slice(&br.archive_offset.to_le_bytes());
+            refs.extend_from_slice(&br.intra_offset.to_le_bytes());
+            refs.extend_from_slice(&br.intra_length.to_le_bytes());
+            refs.extend_from_slice(&br.file_offset.to_le_bytes());
+        }
+        first_ref += rec.block_refs.len() as u64;
+    }
+
+    // Stable: equal names keep index order, so a lookup finds the first.
+    let mut names: Vec<u32> = (0..n as u32).collect();
+    names.sort_by(|&a, &b| index.records[a as usize].name.cmp(&index.records[b as usize].name));
+
+    let flags = if index.dict_offset.is_some() { FLAG_DICT_OFFSET } else { 0 };
+    let mut out = Vec::with_capacity(
+        INDEX_HEADER_SIZE + table.len() + refs.len() + n * NAME_ENTRY_SIZE + pool.len());
+    out.extend_from_slice(INDEX_MAGIC);
+    out.extend_from_slice(&INDEX_VERSION.to_le_bytes());
+    out.extend_from_slice(&flags.to_le_bytes());
+    out.extend_from_slice(&(n as u64).to_le_bytes());
+    out.extend_from_slice(&(m as u64).to_le_bytes());
+    out.extend_from_slice(&(pool.len() as u64).to_le_bytes());
+    out.extend_from_slice(&index.dict_offset.unwrap_or(0).to_le_bytes());
+    out.extend_from_slice(&index.root_hash);
+    out.extend_from_slice(&table);
+    out.extend_from_slice(&refs);
+    for pos in names {
+        out.extend_from_slice(&pos.to_le_bytes());
+    }
+    out.extend_from_slice(&pool);
+    Ok(out)
+}
+
+// ── IndexView ────────────────────────────────────────────────────────────────
+
+/// A validated binary index, read in place.
+pub struct IndexView {
+    bytes:  Vec<u8>,
+    count:  usize,
+    refs:   Range<usize>,
+    names:  Range<usize>,
+    pool:   Range<usize>,
+    /// ID → position, built only when IDs are not simply positions.
+    by_id:  Option<HashMap<u32, usize>>,
+    pub root_hash:   [u8; 32],
+    pub dict_offset: Option<u64>,
+}
+
+impl IndexView {
+    /// Validate `bytes` (index format v1) and wrap them.
+    ///
+    /// Every record's name, metadata and BlockRef range is bounds- and
+    /// UTF-8-checked here, once, so accessors never fail afterwards.
+    ///
+    /// Record IDs equal to their positions (as every writer in this crate
+    /// produces) need no ID map; otherwise one is built here, keeping the
+    /// first record for a repeated ID.
+    pub fn parse(bytes: Vec<u8>) -> Result<Self, IndexError> {
+        if bytes.len() < INDEX_HEADER_SIZE || &bytes[0..4] != INDEX_MAGIC {
+            return Err(IndexError::InvalidMagic);
+        }
+        let version = u16::from_le_bytes(bytes[4..6].try_into().unwrap());
+        if version != INDEX_VERSION {
+            return Err(IndexError::UnsupportedVersion(version));
+        }
+        let flags     = u16::from_le_bytes(bytes[6..8].try_into().unwrap());
+        let count     = u64_at(&bytes, 8);
+        let ref_count = u64_at(&bytes, 16);
+        let pool_size = u64_at(&bytes, 24);
+
+        let truncated = || IndexError::Corrupt("section sizes exceed the index".into());
+        let section = |start: usize, n: u64, width: usize| -> Result<Range<usize>, IndexError> {
+            let len = usize::try_from(n).ok().and_then(|n| n.checked_mul(width)).ok_or_else(truncated)?;
+            let end = start.checked_add(len).ok_or_else(truncated)?;
+            Ok(start..end)
+        };
+        let table = section(INDEX_HEADER_SIZE, count, RECORD_SIZE)?;
+        let refs  = section(table.end, ref_count, BLOCK_REF_SIZE)?;
+        let names = section(refs.end, count, NAME_ENTRY_SIZE)?;
+        let pool  = section(names.end, pool_size, 1)?;
+        if pool.end != bytes.len() {
+            return Err(IndexError::Corrupt(format!(
+                "index is {} B, sections describe {} B", bytes.len(), pool.end)));
+        }
+
+        let mut view = Self {
+            root_hash:   bytes[40..72].try_into().unwrap(),
+            dict_offset: (flags & FLAG_DICT_OFFSET != 0).then(|| u64_at(&bytes, 32)),
+            count: count as usize,
+            by_id: None,
+            bytes, refs, names, pool,
+        };
+        view.validate()?;
+        if view.iter().any(|r| r.id() as usize != r.position()) {
+            let mut by_id = HashMap::with_capacity(view.count);
+            for r in view.iter() {
+                by_id.entry(r.id()).or_insert(r.position());
+            }
+            view.by_id = Some(by_id);
+        }
+        Ok(view)
+    }
+
+    /// Encode `index` and view it; used to serve indexes from older formats.
+    pub fn from_index(index: &FileIndex) -> Result<Self, IndexError> {
+        Self::parse(encode(index)?)
+    }
+
+    fn validate(&self) -> Result<(), IndexError> {
+        let pool     = &self.bytes[self.pool.clone()];
+        let ref_cnt  = (self.refs.len() / BLOCK_REF_SIZE) as u64;
+        let in_pool  = |off: u64, len: u32| -> Option<&[u8]> {
+            let off = usize::try_from(off).ok()?;
+            pool.get(off..off.checked_add(len as usize)?)
+        };
+        for pos in 0..self.count {
+            let r   = self.raw(pos);
+            let bad = |what: &str| IndexError::Corrupt(format!("record {pos}: {what}"));
+
+            let name = in_pool(u64_at(r, 8), u32_at(r, 16)).ok_or_else(|| bad("name out of range"))?;
+            std::str::from_utf8(name).map_err(|_| bad("name is not UTF-8"))?;
+
+            let mut meta = in_pool(u64_at(r, 24), u32_at(r, 20)).ok_or_else(|| bad("metadata out of range"))?;
+            while !meta.is_empty() {
+                for _ in 0..2 {
+                    let len = meta.get(..4).map(|l| u32::from_le_bytes(l.try_into().unwrap()) as usize)
+                        .ok_or_else(|| bad("metadata truncated"))?;
+                    let s = meta.get(4..4 + len).ok_or_else(|| bad("metadata truncated"))?;
+                    std::str::from_utf8(s).map_err(|_| bad("metadata is not UTF-8"))?;
+                    meta = &meta[4 + len..];
+                }
+            }
+
+            let (first, n) = (u64_at(r, 32), u64_at(r, 40));
+            if first.checked_add(n).map_or(true, |end| end > ref_cnt) {
+                return Err(bad("block refs out of range"));
+            }
+        }
+        for i in 0..self.count {
+            if u32_at(&self.bytes, self.names.start + i * NAME_ENTRY_SIZE) as usize >= self.count {
+                return Err(IndexError::Corrupt(format!("name table entry {i} out of range")));
+            }
+        }
+        Ok(())
+    }
+
+    #[inline]
+    fn raw(&self, pos: usize) -> &[u8] {
+        let at = INDEX_HEADER_SIZE + pos * RECORD_SIZE;
+        &self.bytes[at..at + RECORD_SIZE]
+    }
+
+    #[inline]
+    fn pool_str(&self, off: u64, len: usize) -> &str {
+        let at = self.pool.start + off as usize;
+        std::str::from_utf8(&self.bytes[at..at + len]).expect("validated in parse")
+    }
+
+    /// The serialized index.
+    pub fn as_bytes(&self) -> &[u8] { &self.bytes }
+
+    pub fn len(&self) -> usize { self.count }
+
+    pub fn is_empty(&self) -> bool { self.count == 0 }
+
+    /// The record at index position `pos`.
+    pub fn get(&self, pos: usize) -> Option<RecordView<'_>> {
+        (pos < self.count).then(|| RecordView { view: self, pos })
+    }
+
+    /// Every record, in index order.
+    pub fn iter(&self) -> impl ExactSizeIterator<Item = RecordView<'_>> + '_ {
+        (0..self.count).map(move |pos| RecordView { view: self, pos })
+    }
+
+    /// First record (in index order) named `name`, by binary search.
+    pub fn find_name(&self, name: &str) -> Option<RecordView<'_>> {
+        let entry = |i: usize| u32_at(&self.bytes, self.names.start + i * NAME_ENTRY_SIZE) as usize;
+        let (mut lo, mut hi) = (0, self.count);
+        while lo < hi {
+            let mid = lo + (hi - lo) / 2;
+            if self.get(entry(mid))?.name() < name { lo = mid + 1 } else { hi = mid }
+        }
+        (lo < self.count).then(|| self.get(entry(lo))).flatten().filter(|r| r.name() == name)
+    }
+
+    /// Last record (in index order) named `name`: the newest version of a
+    /// file added to the archive more than once.
+    pub fn find_name_last(&self, name: &str) -> Option<RecordView<'_>> {
+        let entry = |i: usize| u32_at(&self.bytes, self.names.start + i * NAME_ENTRY_SIZE) as usize;
+        let (mut lo, mut hi) = (0, self.count);
+        while lo < hi {
+            let mid = lo + (hi - lo) / 2;
+            if self.get(entry(mid))?.name() <= name { lo = mid + 1 } else { hi = mid }
+        }
+        (lo > 0).then(|| self.get(entry(lo - 1))).flatten().filter(|r| r.name() == name)
+    }
+
+    /// The record with `id`, in O(1).
+    pub fn find_id(&self, id: u32) -> Option<RecordView<'_>> {
+        match &self.by_id {
+            None        => self.get(id as usize),
+            Some(by_id) => self.get(*by_id.get(&id)?),
+        }
+    }
+
+    /// Materialize the whole index.
+    pub fn to_index(&self) -> FileIndex {
+        FileIndex {
+            records:     self.iter().map(|r| r.to_record()).collect(),
+            root_hash:   self.root_hash,
+            dict_offset: self.dict_offset,
+        }
+    }
+}
+
+impl std::fmt::Debug for IndexView {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("IndexView")
+            .field("records", &self.count)
+            .field("block_refs", &(self.refs.len() / BLOCK_REF_SIZE))
+            .field("dict_offset", &self.dict_offset)
+            .finish()
+    }
+}
+
+// ── RecordView ───────────────────────────────────────────────────────────────
+
+/// One record of an [`IndexView`], decoded field by field.
+#[derive(Clone, Copy)]
+pub struct RecordView<'a> {
+    view: &'a IndexView,
+    pos:  usize,
+}
+
+impl<'a> RecordView<'a> {
+    #[inline]
+    fn raw(&self) -> &'a [u8] { self.view.raw(self.pos) }
+
+    /// Position in the index (not necessarily the ID).
+    pub fn position(&self) -> usize { self.pos }
+
+    pub fn id(&self)              -> u32 { u32_at(self.raw(), 0) }
+    pub fn parent_id(&self)       -> u32 { u32_at(self.raw(), 4) }
+    pub fn original_size(&self)   -> u64 { u64_at(self.raw(), 48) }
+    pub fn compressed_size(&self) -> u64 { u64_at(self.raw(), 56) }
+    pub fn block_count(&self)     -> usize { u64_at(self.raw(), 40) as usize }
+
+    pub fn name(&self) -> &'a str {
+        let r = self.raw();
+        self.view.pool_str(u64_at(r, 8), u32_at(r, 16) as usize)
+    }
+
+    /// The `i`th block ref; panics if `i >= block_count()`.
+    pub fn block_ref(&self, i: usize) -> BlockRef {
+        let b = self.ref_bytes(i);
+        BlockRef {
+            content_hash:   b[0..32].try_into().unwrap(),
+            archive_offset: u64_at(b, 32),
+            intra_offset:   u64_at(b, 40),
+            intra_length:   u64_at(b, 48),
+            file_offset:    u64_at(b, 56),
+        }
+    }
+
+    /// `block_ref(i).file_offset`, without decoding the rest of the ref.
+    fn file_offset(&self, i: usize) -> u64 { u64_at(self.ref_bytes(i), 56) }
+
+    fn ref_bytes(&self, i: usize) -> &'a [u8] {
+        assert!(i < self.block_count(), "block ref {i} out of range");
+        let at = self.view.refs.start + (u64_at(self.raw(), 32) as usize + i) * BLOCK_REF_SIZE;
+        &self.view.bytes[at..at + BLOCK_REF_SIZE]
+    }
+
+    /// [`FileIndexRecord::has_file_offsets`] for this record.
+    pub fn has_file_offsets(&self) -> bool {
+        let n = self.block_count();
+        n < 2 || self.file_offset(n - 1) > 0
+    }
+
+    /// [`FileIndexRecord::locate`] for this record: a binary search over
+    /// the refs in place, reading only their `file_offset`.
+    pub fn locate(&self, offset: u64) -> (usize, u64) {
+        if !self.has_file_offsets() {
+            return (0, 0);
+        }
+        let (mut lo, mut hi) = (0, self.block_count());
+        while lo < hi {
+            let mid = lo + (hi - lo) / 2;
+            if self.file_offset(mid) <= offset { lo = mid + 1 } else { hi = mid }
+        }
+        let i = lo.saturating_sub(1);
+        (i, if i < self.block_count() { self.file_offset(i) } else { 0 })
+    }
+
+    pub fn block_refs(&self) -> impl ExactSizeIterator<Item = BlockRef> + 'a {
+        let rec = *self;
+        (0..rec.block_count()).map(move |i| rec.block_ref(i))
+    }
+
+    pub fn metadata(&self) -> HashMap<String, String> {
+        let r   = self.raw();
+        let end = u64_at(r, 24) + u32_at(r, 20) as u64;
+        let next = |off: &mut u64| {
+            let len = u32_at(&self.view.bytes, self.view.pool.start + *off as usize) as usize;
+            let s   = self.view.pool_str(*off + 4, len).to_owned();
+            *off += 4 + len as u64;
+            s
+        };
+        let mut off  = u64_at(r, 24);
+        let mut meta = HashMap::new();
+        while off < end {
+            let k = next(&mut off);
+            let v = next(&mut off);
+            meta.insert(k, v);
+        }
+        meta
+    }
+
+    /// An owned copy of this record.
+    pub fn to_record(&self) -> FileIndexRecord {
+        FileIndexRecord {
+            id:              self.id(),
+            parent_id:       self.parent_id(),
+            name:            self.name().to_owned(),
+            block_refs:      self.block_refs().collect(),
+            original_size:   self.original_size(),
+            compressed_size: self.compressed_size(),
+            metadata:        self.metadata(),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn sample() -> FileIndex {
+        let rec = |id: u32, name: &str, refs: u64| FileIndexRecord {
+            id,
+            parent_id:       0,
+            name:            name.into(),
+            block_refs:      (0..refs).map(|i| BlockRef {
+                content_hash: [id as u8; 32], archive_offset: 256 + i,
+                intra_offset: 0, intra_length: 0, file_offset: i * 10,
+            }).collect(),
+            original_size:   refs * 10,
+            compressed_size: refs,
+            metadata:        [("mode".to_string(), "0644".to_string())].into(),
+        };
+        let mut idx = FileIndex {
+            records:     vec![rec(0, "zeta", 2), rec(1, "alpha", 0), rec(2, "mid", 3), rec(3, "alpha", 1)],
+            root_hash:   [0; 32],
+            dict_offset: Some(4096),
+        };
+        idx.compute_root_hash();
+        idx
+    }
+
+    #[test]
+    fn roundtrip_and_lookup() {
+        let idx  = sample();
+        let view = IndexView::parse(encode(&idx).unwrap()).unwrap();
+        assert_eq!(view.len(), 4);
+        assert_eq!(view.dict_offset, Some(4096));
+        assert_eq!(view.root_hash, idx.root_hash);
+
+        assert_eq!(view.find_name("alpha").unwrap().id(), 1, "first of equal names");
+        assert_eq!(view.find_name_last("alpha").unwrap().id(), 3, "last of equal names");
+        assert_eq!(view.find_name_last("zeta").unwrap().id(), 0);
+        assert!(view.find_name_last("beta").is_none());
+        assert_eq!(view.find_name("mid").unwrap().block_ref(2).archive_offset, 258);
+        assert!(view.find_name("beta").is_none());
+        assert_eq!(view.find_id(3).unwrap().name(), "alpha");
+
+        let mut sparse = idx.clone();
+        sparse.records.swap(0, 2);
+        let sparse = IndexView::parse(encode(&sparse).unwrap()).unwrap();
+        assert_eq!(sparse.find_id(0).unwrap().name(), "zeta");
+        assert_eq!(sparse.find_id(2).unwrap().position(), 0);
+        assert!(sparse.find_id(9).is_none());
+
+        let back = view.to_index();
+        for (a, b) in idx.records.iter().zip(&back.records) {
+            assert_eq!((a.id, &a.name, a.original_size, &a.metadata), (b.id, &b.name, b.original_size, &b.metadata));
+            assert_eq!(a.block_refs.len(), b.block_refs.len());
+        }
+    }
+
+    #[test]
+    fn locate_matches_owned_record() {
+        let idx  = sample();
+        let view = IndexView::parse(encode(&idx).unwrap()).unwrap();
+        for (rec, owned) in view.iter().zip(&idx.records) {
+            assert_eq!(rec.has_file_offsets(), owned.has_file_offsets());
+            for offset in 0..owned.original_size + 5 {
+                assert_eq!(rec.locate(offset), owned.locate(offset), "{} at {offset}", owned.name);
+            }
+        }
+    }
+
+    #[test]
+    fn rejects_corruption() {
+        let bytes = encode(&sample()).unwrap();
+        assert!(matches!(IndexView::parse(bytes[..bytes.len() - 1].to_vec()), Err(IndexError::Corrupt(_))));
+
+        let mut bad = bytes.clone();
+        bad[INDEX_HEADER_SIZE + 16] = 0xFF;           // record 0 name_len
+        assert!(matches!(IndexView::parse(bad), Err(IndexError::Corrupt(_))));
+
+        let mut bad = bytes;
+        bad[4] = 9;
+        assert!(matches!(IndexView::parse(bad), Err(IndexError::UnsupportedVersion(9))));
+    }
+}
@@ -1,6 +1,32 @@
 //! File index — reconstructible by scanning blocks.
+//!
+//! [`FileIndex`] is the owned form built by the writer and by block scans.
+//! On disk the INDEX block holds it in the binary layout of [`binary`];
+//! readers keep that as an [`IndexView`] rather than materializing every
+//! record.  Archives from writers before index format v1 hold JSON, which
+//! [`FileIndex::from_bytes`] still accepts.  The [`table`] footer lists
+//! every block, so the file list can also be rebuilt without scanning.
 use serde::{Serialize, Deserialize};
 use std::collections::HashMap;
+use thiserror::Error;
+
+pub mod binary;
+pub mod table;
+
+pub use binary::{IndexView, RecordView, INDEX_MAGIC, INDEX_VERSION};
+pub use table::{BlockTable, BlockTableEntry, BlockTableView};
+
+#[derive(Error, Debug)]
+pub enum IndexError {
+    #[error("Invalid index magic — not a binary FILE INDEX")]
+    InvalidMagic,
+    #[error("Unsupported index version {0} (this build reads v{INDEX_VERSION})")]
+    UnsupportedVersion(u16),
+    #[error("Corrupt FILE INDEX: {0}")]
+    Corrupt(String),
+    #[error("Legacy JSON index: {0}")]
+    Json(#[from] serde_json::Error),
+}
 
 #[derive(Debug, Serialize, Deserialize, Clone)]
 pub struct BlockRef {
@@ -10,6 +36,11 @@ pub struct BlockRef {
     pub intra_offset:   u64,
     #[serde(default)]
     pub intra_length:   u64,
+    /// Position of this block's first byte within the file, i.e. the sum of
+    /// the decoded lengths of the refs before it.  Absent (zero) in archives
+    /// from writers that predate it; see [`FileIndexRecord::locate`].
+    #[serde(default)]
+    pub file_offset:    u64,
 }
 
 impl BlockRef {
@@ -41,21 +72,57 @@ impl FileIndexRecord {
             metadata: HashMap::new(),
         }
     }
+
+    /// False for multi-block records whose refs carry no `file_offset`
+    /// (every ref after the first covers at least one byte, so a real
+    /// offset table never ends in zero).
+    pub fn has_file_offsets(&self) -> bool {
+        self.block_refs.len() < 2 || self.block_refs.last().map_or(true, |br| br.file_offset > 0)
+    }
+
+    /// The first block ref a read at `offset` needs, and that block's file
+    /// offset, found by binary search over `file_offset`.
+    ///
+    /// Records without offsets give `(0, 0)`: the caller must walk forward
+    /// from the first block, skipping by decoded length.
+    pub fn locate(&self, offset: u64) -> (usize, u64) {
+        if !self.has_file_offsets() {
+            return (0, 0);
+        }
+        let i = self.block_refs.partition_point(|br| br.file_offset <= offset).saturating_sub(1);
+        (i, self.block_refs.get(i).map_or(0, |br| br.file_offset))
+    }
 }
 
 #[derive(Debug, Serialize, Deserialize, Clone, Default)]
 pub struct FileIndex {
-    pub records:   Vec<FileIndexRecord>,
-    pub root_hash: [u8; 32],
+    pub records:     Vec<FileIndexRecord>,
+    pub root_hash:   [u8; 32],
+    /// Archive offset of the DICT block, if the archive has one.
+    #[serde(default)]
+    pub dict_offset: Option<u64>,
 }
 
 impl FileIndex {
-    pub fn to_bytes(&self) -> Result<Vec<u8>, serde_json::Error> {
-        serde_json::to_vec(self)
+    /// Serialize in index format v1 (see [`binary`]).
+    pub fn to_bytes(&self) -> Result<Vec<u8>, IndexError> {
+        binary::encode(self)
+    }
+
+    /// Parse a decoded INDEX block payload — binary v1 or legacy JSON.
+    pub fn from_bytes(bytes: &[u8]) -> Result<Self, IndexError> {
+        Ok(Self::view_payload(bytes.to_vec())?.to_index())
     }
-    pub fn from_bytes(bytes: &[u8]) -> Result<Self, serde_json::Error> {
-        serde_json::from_slice(bytes)
+
+    /// An INDEX block payload as an [`IndexView`], taking ownership of it.
+    pub fn view_payload(raw: Vec<u8>) -> Result<IndexView, IndexError> {
+        if raw.starts_with(INDEX_MAGIC) {
+            IndexView::parse(raw)
+        } else {
+            IndexView::from_index(&serde_json::from_slice(&raw)?)
+        }
     }
+
     pub fn compute_root_hash(&mut self) {
         let mut h = blake3::Hasher::new();
         for rec in &self.records {
@@ -66,3 +133,39 @@ impl FileIndex {
         self.root_hash = h.finalize().into();
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn record(offsets: &[u64]) -> FileIndexRecord {
+        let refs = offsets.iter().map(|&file_offset| BlockRef {
+            content_hash: [0; 32], archive_offset: 0, intra_offset: 0, intra_length: 0, file_offset,
+        }).collect();
+        FileIndexRecord::from_scan(0, 400, refs)
+    }
+
+    #[test]
+    fn locate_binary_searches_offsets() {
+        let r = record(&[0, 100, 200, 300]);
+        assert_eq!(r.locate(0),   (0, 0));
+        assert_eq!(r.locate(199), (1, 100));
+        assert_eq!(r.locate(200), (2, 200));
+        assert_eq!(r.locate(399), (3, 300));
+    }
+
+    #[test]
+    fn reads_legacy_json_index() {
+        let idx  = FileIndex { records: vec![record(&[0, 100])], root_hash: [7; 32], dict_offset: None };
+        let json = serde_json::to_vec(&idx).unwrap();
+        let back = FileIndex::from_bytes(&json).unwrap();
+        assert_eq!(back.records[0].block_refs[1].file_offset, 100);
+        assert_eq!(back.root_hash, [7; 32]);
+    }
+
+    #[test]
+    fn locate_without_offsets_starts_at_zero() {
+        assert!(!record(&[0, 0, 0]).has_file_offsets());
+        assert_eq!(record(&[0, 0, 0]).locate(250), (0, 0));
+    }
+}
@@ -0,0 +1,325 @@
+//! BLOCK TABLE footer — a fixed-width list of every block in the archive.
+//!
+//! # Layout (all integers little-endian)
+//!
+//! ```text
+//! Header (32 B)
+//!    0      4   magic               = "6CYT"
+//!    4      2   table_version       = 1
+//!    6      2   reserved            = 0
+//!    8      8   entry_count         N
+//!   16      8   recovery_map_offset offset of the RECOVERY MAP length prefix
+//!   24      4   entries_crc32       CRC32 of the entry array
+//!   28      4   header_crc32        CRC32 of header bytes [0, 28)
+//! Entries   N × 64 B   in archive order
+//! ```
+//!
+//! An entry (64 B) repeats the fields of the block's header that locate it:
+//!
+//! ```text
+//!    0   8  archive_offset      8   8  file_offset
+//!   16   4  file_id            20   4  orig_size
+//!   24   4  comp_size          28   2  block_type
+//!   30   2  flags              32  32  content_hash
+//! ```
+//!
+//! The table is written after the RECOVERY MAP and found through the
+//! superblock's `block_table_offset`.  It is stored uncompressed, so a
+//! mapped archive can be read through [`BlockTableView`] in place.  Nothing
+//! requires it: a reader that finds no table, or one that fails its CRCs,
+//! falls back to scanning block headers.
+
+use std::io::{self, Read, Seek, SeekFrom};
+
+use crc32fast::Hasher;
+
+use super::{BlockRef, FileIndex, FileIndexRecord, IndexError};
+use crate::block::{BlockHeader, BlockType};
+
+pub const TABLE_MAGIC:   &[u8; 4] = b"6CYT";
+pub const TABLE_VERSION: u16      = 1;
+
+pub const TABLE_HEADER_SIZE: usize = 32;
+pub const TABLE_ENTRY_SIZE:  usize = 64;
+
+#[inline]
+fn u16_at(b: &[u8], at: usize) -> u16 { u16::from_le_bytes(b[at..at + 2].try_into().unwrap()) }
+#[inline]
+fn u32_at(b: &[u8], at: usize) -> u32 { u32::from_le_bytes(b[at..at + 4].try_into().unwrap()) }
+#[inline]
+fn u64_at(b: &[u8], at: usize) -> u64 { u64::from_le_bytes(b[at..at + 8].try_into().unwrap()) }
+
+fn crc32(bytes: &[u8]) -> u32 {
+    let mut h = Hasher::new();
+    h.update(bytes);
+    h.finalize()
+}
+
+/// Where one block is, and what it holds.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct BlockTableEntry {
+    pub archive_offset: u64,
+    pub file_offset:    u64,
+    pub file_id:        u32,
+    pub orig_size:      u32,
+    pub comp_size:      u32,
+    pub block_type:     BlockType,
+    pub flags:          u16,
+    pub content_hash:   [u8; 32],
+}
+
+impl BlockTableEntry {
+    pub fn new(archive_offset: u64, header: &BlockHeader) -> Self {
+        Self {
+            archive_offset,
+            file_offset:  header.file_offset,
+            file_id:      header.file_id,
+            orig_size:    header.orig_size,
+            comp_size:    header.comp_size,
+            block_type:   header.block_type,
+            flags:        header.flags,
+            content_hash: header.content_hash,
+        }
+    }
+
+    fn encode(&self, out: &mut Vec<u8>) {
+        out.extend_from_slice(&self.archive_offset.to_le_bytes());
+        out.extend_from_slice(&self.file_offset.to_le_bytes());
+        out.extend_from_slice(&self.file_id.to_le_bytes());
+        out.extend_from_slice(&self.orig_size.to_le_bytes());
+        out.extend_from_slice(&self.comp_size.to_le_bytes());
+        out.extend_from_slice(&(self.block_type as u16).to_le_bytes());
+        out.extend_from_slice(&self.flags.to_le_bytes());
+        out.extend_from_slice(&self.content_hash);
+    }
+
+    fn decode(raw: &[u8]) -> Result<Self, IndexError> {
+        let block_type = u16_at(raw, 28);
+        Ok(Self {
+            archive_offset: u64_at(raw, 0),
+            file_offset:    u64_at(raw, 8),
+            file_id:        u32_at(raw, 16),
+            orig_size:      u32_at(raw, 20),
+            comp_size:      u32_at(raw, 24),
+            block_type:     BlockType::from_u16(block_type).ok_or_else(|| {
+                IndexError::Corrupt(format!("block table entry has unknown block_type {block_type}"))
+            })?,
+            flags:          u16_at(raw, 30),
+            content_hash:   raw[32..64].try_into().unwrap(),
+        })
+    }
+}
+
+/// The writer's list of blocks, in the order they were written.
+#[derive(Debug, Clone, Default)]
+pub struct BlockTable {
+    pub entries: Vec<BlockTableEntry>,
+}
+
+impl BlockTable {
+    pub fn push(&mut self, archive_offset: u64, header: &BlockHeader) {
+        self.entries.push(BlockTableEntry::new(archive_offset, header));
+    }
+
+    /// Serialize header and entries.
+    pub fn encode(&self, recovery_map_offset: u64) -> Vec<u8> {
+        let mut out = Vec::with_capacity(TABLE_HEADER_SIZE + self.entries.len() * TABLE_ENTRY_SIZE);
+        out.resize(TABLE_HEADER_SIZE, 0);
+        for e in &self.entries {
+            e.encode(&mut out);
+        }
+        let entries_crc = crc32(&out[TABLE_HEADER_SIZE..]);
+
+        out[0..4].copy_from_slice(TABLE_MAGIC);
+        out[4..6].copy_from_slice(&TABLE_VERSION.to_le_bytes());
+        out[8..16].copy_from_slice(&(self.entries.len() as u64).to_le_bytes());
+        out[16..24].copy_from_slice(&recovery_map_offset.to_le_bytes());
+        out[24..28].copy_from_slice(&entries_crc.to_le_bytes());
+        let header_crc = crc32(&out[..28]);
+        out[28..32].copy_from_slice(&header_crc.to_le_bytes());
+        out
+    }
+}
+
+/// A validated block table, read in place from its serialized bytes.
+#[derive(Debug, Clone, Copy)]
+pub struct BlockTableView<'a> {
+    entries:             &'a [u8],
+    recovery_map_offset: u64,
+}
+
+impl<'a> BlockTableView<'a> {
+    /// Check magic, version, both CRCs and the entry count against `bytes`,
+    /// which must start at the table header.  Bytes after the last entry
+    /// are ignored.
+    pub fn parse(bytes: &'a [u8]) -> Result<Self, IndexError> {
+        let header = bytes.get(..TABLE_HEADER_SIZE)
+            .ok_or_else(|| IndexError::Corrupt("block table header truncated".into()))?;
+        if &header[0..4] != TABLE_MAGIC {
+            return Err(IndexError::InvalidMagic);
+        }
+        if crc32(&header[..28]) != u32_at(header, 28) {
+            return Err(IndexError::Corrupt("block table header CRC32 mismatch".into()));
+        }
+        let version = u16_at(header, 4);
+        if version != TABLE_VERSION {
+            return Err(IndexError::UnsupportedVersion(version));
+        }
+        let entries = usize::try_from(u64_at(header, 8)).ok()
+            .and_then(|n| n.checked_mul(TABLE_ENTRY_SIZE))
+            .and_then(|len| bytes.get(TABLE_HEADER_SIZE..TABLE_HEADER_SIZE.checked_add(len)?))
+            .ok_or_else(|| IndexError::Corrupt("block table entries truncated".into()))?;
+        if crc32(entries) != u32_at(header, 24) {
+            return Err(IndexError::Corrupt("block table entries CRC32 mismatch".into()));
+        }
+        Ok(Self { entries, recovery_map_offset: u64_at(header, 16) })
+    }
+
+    /// Total serialized size of a table whose header is `header`, so a
+    /// reader knows how much to read after the first [`TABLE_HEADER_SIZE`]
+    /// bytes.  `None` if the header is not a table header.
+    pub fn encoded_len(header: &[u8]) -> Option<u64> {
+        if header.len() < TABLE_HEADER_SIZE || &header[0..4] != TABLE_MAGIC
+            || crc32(&header[..28]) != u32_at(header, 28)
+        {
+            return None;
+        }
+        u64_at(header, 8)
+            .checked_mul(TABLE_ENTRY_SIZE as u64)?
+            .checked_add(TABLE_HEADER_SIZE as u64)
+    }
+
+    pub fn len(&self) -> usize { self.entries.len() / TABLE_ENTRY_SIZE }
+
+    pub fn is_empty(&self) -> bool { self.entries.is_empty() }
+
+    pub fn recovery_map_offset(&self) -> u64 { self.recovery_map_offset }
+
+    pub fn get(&self, i: usize) -> Option<Result<BlockTableEntry, IndexError>> {
+        let raw = self.entries.get(i * TABLE_ENTRY_SIZE..(i + 1) * TABLE_ENTRY_SIZE)?;
+        Some(BlockTableEntry::decode(raw))
+    }
+
+    pub fn iter(&self) -> impl ExactSizeIterator<Item = Result<BlockTableEntry, IndexError>> + 'a {
+        self.entries.chunks_exact(TABLE_ENTRY_SIZE).map(BlockTableEntry::decode)
+    }
+
+    /// Rebuild the file list from the DATA entries, as a block scan would:
+    /// names are synthesised and solid members are not recovered.
+    pub fn to_index(&self) -> Result<FileIndex, IndexError> {
+        let mut records: Vec<FileIndexRecord> = Vec::new();
+        let mut dict_offset = None;
+
+        let mut data = Vec::new();
+        for e in self.iter() {
+            let e = e?;
+            match e.block_type {
+                BlockType::Data => data.push(e),
+                BlockType::Dict => dict_offset = Some(e.archive_offset),
+                _ => {}
+            }
+        }
+        data.sort_by_key(|e| (e.file_id, e.file_offset));
+
+        for e in data {
+            let end = e.file_offset + e.orig_size as u64;
+            let block_ref = BlockRef {
+                content_hash:   e.content_hash,
+                archive_offset: e.archive_offset,
+                intra_offset:   0,
+                intra_length:   0,
+                file_offset:    e.file_offset,
+            };
+            match records.last_mut() {
+                Some(r) if r.id == e.file_id => {
+                    r.original_size = r.original_size.max(end);
+                    r.block_refs.push(block_ref);
+                }
+                _ => records.push(FileIndexRecord::from_scan(e.file_id, end, vec![block_ref])),
+            }
+        }
+
+        let mut index = FileIndex { records, root_hash: [0u8; 32], dict_offset };
+        index.compute_root_hash();
+        Ok(index)
+    }
+}
+
+/// Read the serialized block table at `offset`, or `None` if no valid table
+/// header is there.  The entries are not checked; see
+/// [`BlockTableView::parse`].
+pub fn read_table<R: Read + Seek>(mut r: R, offset: u64) -> io::Result<Option<Vec<u8>>> {
+    let end = r.seek(SeekFrom::End(0))?;
+    if offset == 0 || end.saturating_sub(offset) < TABLE_HEADER_SIZE as u64 {
+        return Ok(None);
+    }
+    r.seek(SeekFrom::Start(offset))?;
+    let mut bytes = vec![0u8; TABLE_HEADER_SIZE];
+    r.read_exact(&mut bytes)?;
+    match BlockTableView::encoded_len(&bytes) {
+        Some(len) if len <= end - offset => {
+            bytes.resize(len as usize, 0);
+            r.read_exact(&mut bytes[TABLE_HEADER_SIZE..])?;
+            Ok(Some(bytes))
+        }
+        _ => Ok(None),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn entry(archive_offset: u64, block_type: BlockType, file_id: u32, file_offset: u64) -> BlockTableEntry {
+        BlockTableEntry {
+            archive_offset, file_offset, file_id,
+            orig_size: 100, comp_size: 60, block_type, flags: 0,
+            content_hash: [archive_offset as u8; 32],
+        }
+    }
+
+    #[test]
+    fn roundtrip_and_reconstruct() {
+        let table = BlockTable { entries: vec![
+            entry(256, BlockType::Dict, u32::MAX, 0),
+            entry(400, BlockType::Data, 2, 0),
+            entry(544, BlockType::Data, 1, 0),
+            entry(688, BlockType::Data, 2, 100),
+            entry(832, BlockType::Index, u32::MAX, 0),
+        ]};
+        let bytes = table.encode(999);
+        assert_eq!(bytes.len(), TABLE_HEADER_SIZE + 5 * TABLE_ENTRY_SIZE);
+        assert_eq!(BlockTableView::encoded_len(&bytes), Some(bytes.len() as u64));
+
+        let view = BlockTableView::parse(&bytes).unwrap();
+        assert_eq!(view.len(), 5);
+        assert_eq!(view.recovery_map_offset(), 999);
+        let entries: Vec<_> = view.iter().map(Result::unwrap).collect();
+        assert_eq!(entries, table.entries);
+
+        let index = view.to_index().unwrap();
+        assert_eq!(index.dict_offset, Some(256));
+        assert_eq!(index.records.len(), 2);
+        assert_eq!(index.records[1].id, 2);
+        assert_eq!(index.records[1].original_size, 200);
+        let offsets: Vec<u64> = index.records[1].block_refs.iter().map(|b| b.archive_offset).collect();
+        assert_eq!(offsets, [400, 688]);
+    }
+
+    #[test]
+    fn rejects_damage() {
+        let table = BlockTable { entries: vec![entry(256, BlockType::Data, 0, 0)] };
+        let bytes = table.encode(0);
+
+        let mut bad = bytes.clone();
+        bad[TABLE_HEADER_SIZE + 3] ^= 1;
+        assert!(BlockTableView::parse(&bad).is_err());
+
+        let mut bad = bytes.clone();
+        bad[9] ^= 1;
+        assert!(BlockTableView::parse(&bad).is_err());
+        assert_eq!(BlockTableView::encoded_len(&bad), None);
+
+        assert!(BlockTableView::parse(&bytes[..bytes.len() - 1]).is_err());
+    }
+}
@@ -0,0 +1,178 @@
+//! Appending to a finished archive, for incremental backups.
+//!
+//! [`SixCyWriter::append`] reopens an archive written by
+//! [`finalize`](SixCyWriter::finalize) and continues it.  The writer
+//! starts from the archive's own state rather than an empty one:
+//!
+//! - the CAS table is rebuilt from the BLOCK TABLE's DATA entries (or, for
+//!   archives without a valid table, from the INDEX refs and their block
+//!   headers), so a chunk that is already stored costs only a `BlockRef`;
+//! - the file records, DICT block, recovery checkpoints and required
+//!   codecs are carried over, and new records continue the ID sequence;
+//! - the superblock keeps its `archive_uuid`, so the key derived from a
+//!   password still opens every block, old and new.  The key is checked
+//!   against an existing encrypted block before anything is written.
+//!
+//! New blocks go after the end of the file, past the old INDEX, RECOVERY
+//! MAP and BLOCK TABLE, which are left in place.  `finalize` then
+//! writes a new INDEX (listing old and new files), recovery map and table,
+//! and patches the superblock last.  Until that one 256-byte write, the
+//! superblock still names the old INDEX and table, so an append that fails
+//! partway leaves the previous archive readable.  That holds across a crash
+//! only if the new footers reach the disk before the superblock does:
+//! [`finalize_with`](SixCyWriter::finalize_with) takes a barrier (such as
+//! `File::sync_data`) that runs between the two writes and after the last,
+//! and [`Archive`](crate::Archive) always passes one.  The superseded
+//! footers are dead bytes.  A block scan skips them as it skips any non-block run.
+
+use std::collections::hash_map::Entry;
+use std::collections::HashMap;
+use std::io::{self, Read, Seek, SeekFrom, Write};
+
+use super::{DedupTable, SixCyWriter};
+use crate::block::{decode_block, BlockHeader, BlockType, FLAG_ENCRYPTED};
+use crate::codec::Dictionary;
+use crate::crypto;
+use crate::index::table::read_table;
+use crate::index::{BlockTable, BlockTableEntry, BlockTableView, FileIndex};
+use crate::recovery::RecoveryMap;
+use crate::superblock::{Superblock, SB_FLAG_ENCRYPTED};
+
+impl<W: Write + Seek> SixCyWriter<W> {
+    /// Continue the archive that `existing` reads, writing through `writer`.
+    ///
+    /// The two are separate handles to the same bytes, e.g. the file opened
+    /// once for reading and once for writing; `existing` is only read here,
+    /// before anything is written.  `encryption_key` must be given
+    /// exactly when the archive is encrypted, and must be the archive's
+    /// key.  `compression_level` applies to new blocks.  The superblock
+    /// keeps a `pack_level` only if it matches the archive's.
+    /// `dedup_memory` bounds the CAS table as
+    /// [`set_dedup_memory`](Self::set_dedup_memory) does, from the first
+    /// stored chunk it is rebuilt with.
+    ///
+    /// `finalize` rewrites the superblock in place, so no one else may have
+    /// the archive memory-mapped while it is appended to; see [`map_file`].
+    ///
+    /// [`map_file`]: super::map_file
+    pub fn append<R: Read + Seek>(
+        mut existing:      R,
+        mut writer:        W,
+        chunk_size:        usize,
+        compression_level: i32,
+        encryption_key:    Option<[u8; 32]>,
+        dedup_memory:      usize,
+    ) -> io::Result<Self> {
+        existing.seek(SeekFrom::Start(0))?;
+        let superblock = Superblock::read(&mut existing)
+            .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+        let encrypted = superblock.flags & SB_FLAG_ENCRYPTED != 0;
+        if encrypted != encryption_key.is_some() {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, if encrypted {
+                "archive is encrypted; appending to it needs its key"
+            } else {
+                "cannot append encrypted blocks to an unencrypted archive"
+            }));
+        }
+
+        let (idx_header, idx_payload) = read_block(&mut existing, superblock.index_offset)?;
+        if idx_header.block_type != BlockType::Index {
+            return Err(io::Error::new(io::ErrorKind::InvalidData, format!(
+                "Expected INDEX block at offset {}, found {:?}", superblock.index_offset, idx_header.block_type)));
+        }
+        let idx_raw = decode_block(&idx_header, &idx_payload, None)
+            .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+        let index = FileIndex::from_bytes(&idx_raw)
+            .map_err(|e| io::Error::new(io::ErrorKind::InvalidData, e))?;
+
+        // Every block but the superseded INDEX goes into the new table.
+        let table = read_table(&mut existing, superblock.block_table_offset)?;
+        let view  = table.as_deref().and_then(|bytes| BlockTableView::parse(bytes).ok());
+        let (entries, recovery_map) = match view {
+            Some(view) => (
+                view.iter().collect::<Result<Vec<_>, _>>()
+                    .map_err(|e| io::Error::new(io::ErrorKind::InvalidData, e))?,
+                read_recovery_map(&mut existing, view.recovery_map_offset()).unwrap_or_default(),
+            ),
+            None => (entries_from_index(&mut existing, &index)?, RecoveryMap::default()),
+        };
+        let entries: Vec<BlockTableEntry> =
+            entries.into_iter().filter(|e| e.block_type != BlockType::Index).collect();
+        if let Some(key) = &encryption_key {
+            check_key(&mut existing, &entries, key)?;
+        }
+
+        let mut block_dedup = DedupTable::new(dedup_memory);
+        for e in entries.iter().filter(|e| e.block_type == BlockType::Data) {
+            block_dedup.insert(e.content_hash, (e.archive_offset, e.comp_size as u64))?;
+        }
+
+        let dictionary = match index.dict_offset {
+            Some(offset) => {
+                let (header, payload) = read_block(&mut existing, offset)?;
+                let bytes = decode_block(&header, &payload, encryption_key.as_ref())
+                    .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+                Some(Dictionary::new(bytes))
+            }
+            None => None,
+        };
+
+        writer.seek(SeekFrom::End(0))?;
+        let mut w = Self::with_state(writer, superblock, chunk_size, compression_level, encryption_key);
+        w.mixed_levels = w.superblock.pack_level != Some(compression_level);
+        w.index        = index;
+        w.recovery_map = recovery_map;
+        w.block_dedup  = block_dedup;
+        w.dictionary   = dictionary;
+        w.block_table  = BlockTable { entries };
+        Ok(w)
+    }
+}
+
+/// Fail with `InvalidInput` unless `key` opens the first encrypted block.
+///
+/// The INDEX is never encrypted, so nothing else would notice a wrong key:
+/// new blocks would be sealed under it while CAS refs still point at blocks
+/// sealed under the archive's own key.
+fn check_key<R: Read + Seek>(r: &mut R, entries: &[BlockTableEntry], key: &[u8; 32]) -> io::Result<()> {
+    let Some(entry) = entries.iter().find(|e| e.flags & FLAG_ENCRYPTED != 0) else { return Ok(()) };
+    let (_, payload) = read_block(r, entry.archive_offset)?;
+    crypto::decrypt(key, &payload).map(drop).map_err(|_| io::Error::new(io::ErrorKind::InvalidInput,
+        "wrong password: the key does not open this archive's blocks"))
+}
+
+/// Header and payload of the block at `offset`.
+fn read_block<R: Read + Seek>(r: &mut R, offset: u64) -> io::Result<(BlockHeader, Vec<u8>)> {
+    r.seek(SeekFrom::Start(offset))?;
+    let header = BlockHeader::read(&mut *r)?;
+    let mut payload = vec![0u8; header.comp_size as usize];
+    r.read_exact(&mut payload)?;
+    Ok((header, payload))
+}
+
+/// The recovery map at `offset`; one that does not parse starts a new map.
+fn read_recovery_map<R: Read + Seek>(r: &mut R, offset: u64) -> io::Result<RecoveryMap> {
+    r.seek(SeekFrom::Start(offset))?;
+    let mut len = [0u8; 8];
+    r.read_exact(&mut len)?;
+    let mut bytes = Vec::new();
+    r.by_ref().take(u64::from_le_bytes(len)).read_to_end(&mut bytes)?;
+    Ok(RecoveryMap::from_bytes(&bytes).unwrap_or_default())
+}
+
+/// Table entries for the DICT block and every block the INDEX references,
+/// from their headers, for archives written before the BLOCK TABLE.
+fn entries_from_index<R: Read + Seek>(r: &mut R, index: &FileIndex) -> io::Result<Vec<BlockTableEntry>> {
+    let offsets = index.dict_offset.into_iter()
+        .chain(index.records.iter().flat_map(|rec| rec.block_refs.iter().map(|br| br.archive_offset)));
+    let mut entries = HashMap::new();
+    for offset in offsets {
+        if let Entry::Vacant(slot) = entries.entry(offset) {
+            r.seek(SeekFrom::Start(offset))?;
+            slot.insert(BlockTableEntry::new(offset, &BlockHeader::read(&mut *r)?));
+        }
+    }
+    let mut entries: Vec<BlockTableEntry> = entries.into_values().collect();
+    entries.sort_by_key(|e| e.archive_offset);
+    Ok(entries)
+}
@@ -0,0 +1,228 @@
+//! Decoded-block cache shared by every [`SixCyReader`](super::SixCyReader)
+//! read path.
+//!
+//! # Policy
+//! Entries are whole decoded blocks keyed by `(archive_offset, content_hash)`
+//! from the block header, so a key can never alias another block's bytes.
+//! The cache is split into [`CACHE_SHARDS`] independently locked LRU shards
+//! (a key's shard is picked from its content hash).  The byte budget is
+//! global: after an insert pushes the total over it, shards are trimmed
+//! round-robin, oldest entry first, until it fits again.  A block larger
+//! than the whole budget is never cached.
+//!
+//! Readers populate the cache when they need only part of a block — solid
+//! slices and `read_at` ranges — and consult it before any decode.  Whole
+//! blocks decoded straight into an output buffer are not inserted: that
+//! would cost a copy, and most such reads never revisit the block.
+
+use std::collections::{BTreeMap, HashMap};
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+
+use serde::Serialize;
+
+/// Number of independently locked shards.
+pub const CACHE_SHARDS: usize = 16;
+
+/// A decoded block held by the cache; cheap to clone, immutable.
+pub type CachedBlock = Arc<Vec<u8>>;
+
+type Key = (u64, [u8; 32]);
+
+/// Snapshot of [`BlockCache`] counters.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize)]
+pub struct CacheStats {
+    pub hits:    u64,
+    pub misses:  u64,
+    /// Decoded bytes currently held.
+    pub bytes:   u64,
+    pub entries: u64,
+    pub budget:  u64,
+}
+
+#[derive(Default)]
+struct Shard {
+    map:   HashMap<Key, (CachedBlock, u64)>,
+    /// Recency stamp → key; the first entry is the least recently used.
+    order: BTreeMap<u64, Key>,
+    stamp: u64,
+}
+
+impl Shard {
+    fn touch(&mut self, key: &Key) -> Option<CachedBlock> {
+        self.stamp += 1;
+        let stamp = self.stamp;
+        let (block, old) = self.map.get_mut(key)?;
+        self.order.remove(old);
+        *old = stamp;
+        self.order.insert(stamp, *key);
+        Some(block.clone())
+    }
+
+    /// Drop the least recently used entry, returning its size.
+    fn evict_one(&mut self) -> Option<usize> {
+        let (_, key) = self.order.pop_first()?;
+        self.map.remove(&key).map(|(block, _)| block.len())
+    }
+}
+
+/// Sharded, byte-budgeted LRU of decoded blocks.
+pub struct BlockCache {
+    shards: Box<[Mutex<Shard>]>,
+    budget: usize,
+    bytes:  AtomicUsize,
+    hits:   AtomicU64,
+    misses: AtomicU64,
+}
+
+impl BlockCache {
+    /// A cache holding at most `budget` decoded bytes; `0` disables it.
+    pub fn new(budget: usize) -> Self {
+        Self {
+            shards: (0..CACHE_SHARDS).map(|_| Mutex::default()).collect(),
+            budget,
+            bytes:  AtomicUsize::new(0),
+            hits:   AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+        }
+    }
+
+    pub fn budget(&self) -> usize { self.budget }
+
+    fn shard(&self, hash: &[u8; 32]) -> usize {
+        hash[0] as usize % CACHE_SHARDS
+    }
+
+    /// Look up a block, counting a hit or a miss.
+    pub fn get(&self, offset: u64, hash: &[u8; 32]) -> Option<CachedBlock> {
+        if self.budget == 0 {
+            return None;
+        }
+        let found = self.shards[self.shard(hash)].lock().unwrap().touch(&(offset, *hash));
+        let counter = if found.is_some() { &self.hits } else { &self.misses };
+        counter.fetch_add(1, Ordering::Relaxed);
+        found
+    }
+
+    /// Insert a decoded block, evicting old entries to stay within budget.
+    pub fn insert(&self, offset: u64, hash: &[u8; 32], block: CachedBlock) {
+        let len = block.len();
+        if len == 0 || len > self.budget {
+            return;
+        }
+        let home = self.shard(hash);
+        {
+            let mut shard = self.shards[home].lock().unwrap();
+            let key = (offset, *hash);
+            if shard.touch(&key).is_some() {
+                return; // a racing reader cached it first
+            }
+            let stamp = shard.stamp;
+            shard.map.insert(key, (block, stamp));
+            shard.order.insert(stamp, key);
+            // Counted under the shard lock that any eviction of this entry
+            // must take, so the total can never be decremented first.
+            self.bytes.fetch_add(len, Ordering::Relaxed);
+        }
+        self.trim(home);
+    }
+
+    /// Evict round-robin from the shard after `home` onward until within budget.
+    fn trim(&self, home: usize) {
+        let mut idle = 0;
+        let mut i    = home;
+        while self.bytes.load(Ordering::Relaxed) > self.budget && idle < CACHE_SHARDS {
+            i = (i + 1) % CACHE_SHARDS;
+            let mut shard = self.shards[i].lock().unwrap();
+            match shard.evict_one() {
+                Some(n) => { self.bytes.fetch_sub(n, Ordering::Relaxed); idle = 0; }
+                None    => idle += 1,
+            }
+        }
+    }
+
+    /// Drop every entry; counters are kept.
+    pub fn clear(&self) {
+        for shard in self.shards.iter() {
+            let mut s = shard.lock().unwrap();
+            let freed: usize = s.map.values().map(|(b, _)| b.len()).sum();
+            s.map.clear();
+            s.order.clear();
+            self.bytes.fetch_sub(freed, Ordering::Relaxed);
+        }
+    }
+
+    pub fn stats(&self) -> CacheStats {
+        let entries = self.shards.iter().map(|s| s.lock().unwrap().map.len() as u64).sum();
+        CacheStats {
+            hits:    self.hits.load(Ordering::Relaxed),
+            misses:  self.misses.load(Ordering::Relaxed),
+            bytes:   self.bytes.load(Ordering::Relaxed) as u64,
+            entries,
+            budget:  self.budget as u64,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn hash(n: u8) -> [u8; 32] { [n; 32] }
+
+    #[test]
+    fn hit_miss_counters() {
+        let c = BlockCache::new(1024);
+        assert!(c.get(0, &hash(1)).is_none());
+        c.insert(0, &hash(1), Arc::new(vec![7; 100]));
+        assert_eq!(c.get(0, &hash(1)).unwrap()[0], 7);
+        assert!(c.get(8, &hash(1)).is_none(), "offset is part of the key");
+        let s = c.stats();
+        assert_eq!((s.hits, s.misses, s.bytes, s.entries), (1, 2, 100, 1));
+    }
+
+    #[test]
+    fn evicts_least_recent_within_budget() {
+        let c = BlockCache::new(300);
+        c.insert(0, &hash(0), Arc::new(vec![0; 100]));
+        c.insert(1, &hash(0), Arc::new(vec![1; 100]));
+        c.insert(2, &hash(0), Arc::new(vec![2; 100]));
+        c.get(0, &hash(0));                          // 1 is now the oldest
+        c.insert(3, &hash(0), Arc::new(vec![3; 100]));
+        assert!(c.stats().bytes <= 300);
+        assert!(c.get(1, &hash(0)).is_none());
+        assert!(c.get(0, &hash(0)).is_some());
+        assert!(c.get(3, &hash(0)).is_some());
+    }
+
+    #[test]
+    fn bytes_match_entries_under_concurrent_clear() {
+        let c = BlockCache::new(64 * 100);
+        std::thread::scope(|s| {
+            for t in 0..4u8 {
+                let c = &c;
+                s.spawn(move || for i in 0..2000u64 {
+                    c.insert(i, &hash(t.wrapping_mul(17).wrapping_add(i as u8)), Arc::new(vec![t; 100]));
+                    if i % 97 == 0 { c.clear(); }
+                });
+            }
+        });
+        let held: usize = c.shards.iter()
+            .map(|s| s.lock().unwrap().map.values().map(|(b, _)| b.len()).sum::<usize>())
+            .sum();
+        assert_eq!(c.stats().bytes, held as u64);
+        assert!(held <= c.budget());
+    }
+
+    #[test]
+    fn oversized_and_disabled() {
+        let c = BlockCache::new(50);
+        c.insert(0, &hash(2), Arc::new(vec![0; 51]));
+        assert_eq!(c.stats().entries, 0);
+
+        let off = BlockCache::new(0);
+        off.insert(0, &hash(2), Arc::new(vec![0; 1]));
+        assert!(off.get(0, &hash(2)).is_none());
+        assert_eq!(off.stats(), CacheStats::default());
+    }
+}
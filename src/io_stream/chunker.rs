@@ -0,0 +1,201 @@
+//! Chunk boundaries for [`SixCyWriter`](super::SixCyWriter).
+//!
+//! [`Chunking::Fixed`] cuts every `chunk_size` bytes.  One byte inserted
+//! near the start of a file shifts every later chunk, so none of them
+//! deduplicate against the previous version.
+//!
+//! [`Chunking::ContentDefined`] cuts where the content says to (FastCDC):
+//! a Gear rolling hash is updated one byte at a time, and a boundary falls
+//! after the first byte where its top bits are all zero.  Because the hash
+//! only depends on the last 64 bytes, an edit moves the boundaries near it
+//! and leaves the rest where they were.
+//!
+//! FastCDC's two refinements are kept.  No boundary is considered before
+//! `min_size`, so those bytes are never hashed.  Normalized chunking uses a
+//! stricter mask (one more bit) before `avg_size` and a looser one (one
+//! bit fewer) after it, which pulls chunk sizes towards the average.
+//! `max_size` is a hard cut.
+//!
+//! Boundaries are a writer decision only: readers locate blocks through
+//! `BlockRef::file_offset`, so any chunking reads back the same way.
+
+use std::ops::Range;
+
+/// Gear table: 256 pseudo-random words (splitmix64 from a fixed seed).
+/// Changing it moves every content-defined boundary, which costs dedup
+/// against older archives but never readability.
+const GEAR: [u64; 256] = {
+    let mut t = [0u64; 256];
+    let mut s = 0x6C79_6365_6463_6463u64;
+    let mut i = 0;
+    while i < 256 {
+        s = s.wrapping_add(0x9E37_79B9_7F4A_7C15);
+        let mut z = s;
+        z = (z ^ (z >> 30)).wrapping_mul(0xBF58_476D_1CE4_E5B9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94D0_49BB_1331_11EB);
+        t[i] = z ^ (z >> 31);
+        i += 1;
+    }
+    t
+};
+
+/// Default average chunk size for content-defined chunking: 1 MiB.
+pub const DEFAULT_CDC_AVG_SIZE: usize = 1024 * 1024;
+
+/// Size bounds for content-defined chunking.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct CdcParams {
+    min_size: usize,
+    avg_size: usize,
+    max_size: usize,
+}
+
+impl CdcParams {
+    /// Bounds are clamped so that `1 <= min <= avg <= max`.
+    pub fn new(min_size: usize, avg_size: usize, max_size: usize) -> Self {
+        let min_size = min_size.max(1);
+        let max_size = max_size.max(min_size);
+        Self { min_size, avg_size: avg_size.clamp(min_size, max_size), max_size }
+    }
+
+    /// FastCDC's usual spread: `avg / 4 ..= avg * 4`.
+    pub fn with_avg(avg_size: usize) -> Self {
+        Self::new(avg_size / 4, avg_size, avg_size.saturating_mul(4))
+    }
+
+    pub fn min_size(&self) -> usize { self.min_size }
+    pub fn avg_size(&self) -> usize { self.avg_size }
+    pub fn max_size(&self) -> usize { self.max_size }
+
+    /// (mask before `avg_size`, mask after it), on the hash's top bits.
+    fn masks(&self) -> (u64, u64) {
+        let bits = self.avg_size.ilog2();
+        let top  = |n: u32| if n == 0 { 0 } else { u64::MAX << (64 - n.min(64)) };
+        (top(bits + 1), top(bits.saturating_sub(1)))
+    }
+
+    /// Length of the first chunk of `data`.
+    pub fn cut(&self, data: &[u8]) -> usize {
+        if data.len() <= self.min_size {
+            return data.len();
+        }
+        let end    = data.len().min(self.max_size);
+        let normal = self.avg_size.min(end);
+        let (strict, loose) = self.masks();
+
+        let mut h = 0u64;
+        let mut i = self.min_size;
+        while i < normal {
+            h = (h << 1).wrapping_add(GEAR[data[i] as usize]);
+            if h & strict == 0 { return i + 1; }
+            i += 1;
+        }
+        while i < end {
+            h = (h << 1).wrapping_add(GEAR[data[i] as usize]);
+            if h & loose == 0 { return i + 1; }
+            i += 1;
+        }
+        end
+    }
+}
+
+impl Default for CdcParams {
+    fn default() -> Self { Self::with_avg(DEFAULT_CDC_AVG_SIZE) }
+}
+
+/// How the writer splits a file into chunks.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum Chunking {
+    /// Every chunk is `chunk_size` bytes except the last.
+    #[default]
+    Fixed,
+    /// Boundaries chosen by content; see the module docs.
+    ContentDefined(CdcParams),
+}
+
+impl Chunking {
+    /// Length of the first chunk of `data` (`chunk_size` is used by
+    /// [`Fixed`](Chunking::Fixed) only).
+    pub fn cut(&self, data: &[u8], chunk_size: usize) -> usize {
+        match self {
+            Chunking::Fixed              => data.len().min(chunk_size.max(1)),
+            Chunking::ContentDefined(p)  => p.cut(data),
+        }
+    }
+
+    /// No chunk is shorter than this, except a file's last.
+    pub fn min_len(&self, chunk_size: usize) -> usize {
+        match self {
+            Chunking::Fixed              => chunk_size.max(1),
+            Chunking::ContentDefined(p)  => p.min_size,
+        }
+    }
+
+    /// No chunk is longer than this.
+    pub fn max_len(&self, chunk_size: usize) -> usize {
+        match self {
+            Chunking::Fixed              => chunk_size.max(1),
+            Chunking::ContentDefined(p)  => p.max_size,
+        }
+    }
+
+    /// The chunks of `data`, as consecutive ranges covering all of it.
+    pub fn split<'a>(self, data: &'a [u8], chunk_size: usize) -> impl Iterator<Item = Range<usize>> + 'a {
+        let mut pos = 0;
+        std::iter::from_fn(move || {
+            if pos == data.len() {
+                return None;
+            }
+            let start = pos;
+            pos += self.cut(&data[pos..], chunk_size);
+            Some(start..pos)
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn noise(n: usize, seed: u64) -> Vec<u8> {
+        let mut x = seed | 1;
+        (0..n).map(|_| { x ^= x << 13; x ^= x >> 7; x ^= x << 17; x as u8 }).collect()
+    }
+
+    #[test]
+    fn chunks_cover_input_within_bounds() {
+        let data = noise(1 << 20, 7);
+        let p    = CdcParams::with_avg(16 * 1024);
+        let ranges: Vec<_> = Chunking::ContentDefined(p).split(&data, 0).collect();
+        assert_eq!(ranges.first().unwrap().start, 0);
+        assert_eq!(ranges.last().unwrap().end, data.len());
+        for w in ranges.windows(2) {
+            assert_eq!(w[0].end, w[1].start);
+        }
+        for r in &ranges[..ranges.len() - 1] {
+            assert!((p.min_size()..=p.max_size()).contains(&r.len()), "{r:?}");
+        }
+        // Normalized chunking keeps the mean near the target.
+        let mean = data.len() / ranges.len();
+        assert!((8 * 1024..32 * 1024).contains(&mean), "mean chunk {mean} B");
+    }
+
+    #[test]
+    fn boundaries_survive_an_insertion() {
+        let data = noise(1 << 20, 11);
+        let mut edited = data[..1000].to_vec();
+        edited.extend_from_slice(b"inserted");
+        edited.extend_from_slice(&data[1000..]);
+
+        let cdc = Chunking::ContentDefined(CdcParams::with_avg(16 * 1024));
+        let chunks = |d: &[u8]| -> std::collections::HashSet<Vec<u8>> {
+            cdc.split(d, 0).map(|r| d[r].to_vec()).collect()
+        };
+        let (a, b) = (chunks(&data), chunks(&edited));
+        assert!(b.intersection(&a).count() + 2 >= b.len(), "{} of {} chunks shared", b.intersection(&a).count(), b.len());
+
+        let fixed: Vec<_> = Chunking::Fixed.split(&data, 4096).map(|r| r.len()).collect();
+        assert_eq!(fixed.len(), 256);
+        assert!(fixed.iter().all(|&n| n == 4096));
+    }
+}
@@ -0,0 +1,184 @@
+//! Block-level copy between archives, for `merge` and `optimize`.
+//!
+//! A DATA block is self-describing: its header names the codec and its
+//! payload decodes on its own.  [`SixCyWriter::copy_files_from`] therefore
+//! moves a file's blocks from another archive as header plus payload,
+//! without decompressing them.  Only the header is rewritten (for the new
+//! `file_id`), and each block lands at a new `archive_offset`.  Copied
+//! blocks enter the writer's CAS table under their `content_hash`, so
+//! content shared between several source archives is stored once, and
+//! later chunks with that content become references to the copy.
+//!
+//! # What can be copied
+//! A file moves block by block only when every block it references can be
+//! used unchanged in the new archive: a whole DATA block (not a solid
+//! slice), neither encrypted (the key is derived per archive) nor
+//! compressed against the source's DICT block, and accepted by the caller's
+//! filter.  Any other file is decoded and re-encoded through the normal
+//! ingestion path.  Re-encoded files are batched so that with `threads > 1`
+//! the pipeline compresses them in parallel.
+//!
+//! Copied payloads are not decoded, so they are not BLAKE3-verified on the
+//! way through: a damaged block in the source is still damaged in the
+//! copy, and will fail when it is read.
+
+use std::io::{self, Read, Seek, Write};
+
+use super::{new_record, ReadAt, SixCyReader, SixCyWriter};
+use crate::block::{BlockHeader, BlockType, BLOCK_HEADER_SIZE};
+use crate::codec::CodecId;
+use crate::index::{BlockRef, FileIndexRecord};
+use crate::stats::Stage;
+
+/// Decoded bytes of re-encoded files held before they go into the
+/// pipeline together: 256 MiB.
+pub const REENCODE_BATCH_BYTES: usize = 256 * 1024 * 1024;
+
+/// What [`SixCyWriter::copy_files_from`] did.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct CopyStats {
+    /// Files whose blocks were all copied without decoding.
+    pub files_copied:    usize,
+    /// Files that were decoded and re-encoded.
+    pub files_reencoded: usize,
+    /// Blocks written by copying; CAS hits are not counted.
+    pub blocks_copied:   usize,
+    /// Payload bytes of those blocks.
+    pub bytes_copied:    u64,
+}
+
+impl<W: Write + Seek> SixCyWriter<W> {
+    /// Append the files `(file_id, name)` of `src`, in order, as new records
+    /// named `name`.
+    ///
+    /// Blocks that can move unchanged and that `keep` accepts are copied
+    /// without decoding (see the module docs); files with any other block
+    /// are decoded and re-encoded with `codec`.  Metadata is carried over
+    /// for copied files.  Not available in solid mode.
+    pub fn copy_files_from<R: Read + Seek + ReadAt + Sync>(
+        &mut self,
+        src:   &SixCyReader<R>,
+        files: &[(u32, String)],
+        codec: CodecId,
+        keep:  impl Fn(&BlockHeader) -> bool,
+    ) -> io::Result<CopyStats> {
+        let _stats = crate::stats::install(self.stats.as_ref());
+        if self.solid_codec.is_some() {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput,
+                "cannot copy blocks into an open solid session"));
+        }
+
+        let mut stats = CopyStats::default();
+        let mut batch: Vec<(String, Vec<u8>)> = Vec::new();
+        let mut batch_bytes = 0usize;
+        for (file_id, name) in files {
+            let record  = src.record(*file_id)?;
+            let headers = record.block_refs()
+                .map(|br| src.header_at(br.archive_offset))
+                .collect::<io::Result<Vec<_>>>()?;
+            let copyable = record.block_refs().zip(&headers)
+                .all(|(br, h)| self.can_copy(&br, h) && keep(h));
+
+            if !copyable {
+                let data = src.unpack_file_parallel(*file_id)?;
+                batch_bytes += data.len();
+                batch.push((name.clone(), data));
+                stats.files_reencoded += 1;
+                if batch_bytes >= REENCODE_BATCH_BYTES {
+                    self.reencode(&mut batch, codec)?;
+                    batch_bytes = 0;
+                }
+                continue;
+            }
+
+            // Earlier re-encoded files take their IDs first.
+            self.reencode(&mut batch, codec)?;
+            batch_bytes = 0;
+
+            let mut out = new_record(self.index.records.len() as u32, name.clone());
+            out.original_size = record.original_size();
+            out.metadata      = record.metadata();
+            for (br, header) in record.block_refs().zip(headers) {
+                self.copy_block(src, &mut out, &br, header, &mut stats)?;
+            }
+            self.push_record(out)?;
+            stats.files_copied += 1;
+        }
+        self.reencode(&mut batch, codec)?;
+        Ok(stats)
+    }
+
+    /// Whether the block `br` names can be written into this archive as is.
+    fn can_copy(&self, br: &BlockRef, header: &BlockHeader) -> bool {
+        header.block_type == BlockType::Data
+            && !br.is_solid_slice()
+            && br.content_hash == header.content_hash
+            && !header.uses_dict()
+            && !header.is_encrypted()
+            && self.encryption_key.is_none()
+    }
+
+    /// Copy one block of `src` for `record`, or reference the stored block
+    /// with the same content.
+    fn copy_block<R: Read + Seek + ReadAt + Sync>(
+        &mut self,
+        src:    &SixCyReader<R>,
+        record: &mut FileIndexRecord,
+        br:     &BlockRef,
+        header: BlockHeader,
+        stats:  &mut CopyStats,
+    ) -> io::Result<()> {
+        let content_hash = header.content_hash;
+        let stored = self.block_dedup.get(&content_hash)?;
+        crate::stats::dedup(stored.is_some());
+        let (archive_offset, comp_len) = match stored {
+            Some(hit) => hit,
+            None => {
+                let payload = src.payload_at(br.archive_offset, &header)?;
+                let header  = BlockHeader { file_id: record.id, ..header };
+
+                let archive_offset = self.writer.stream_position()?;
+                crate::stats::timed(Stage::Write, BLOCK_HEADER_SIZE + payload.len(), || {
+                    header.write(&mut self.writer)?;
+                    self.writer.write_all(&payload)
+                })?;
+                self.block_table.push(archive_offset, &header);
+                self.superblock.add_block_codec(&header);
+                // A fill block is the same at every level.
+                if header.codec_uuid != CodecId::Fill.uuid()
+                    && src.superblock.pack_level != Some(self.compression_level)
+                {
+                    self.mixed_levels = true;
+                }
+
+                let hit = (archive_offset, payload.len() as u64);
+                self.block_dedup.insert(content_hash, hit)?;
+                stats.blocks_copied += 1;
+                stats.bytes_copied  += hit.1;
+                hit
+            }
+        };
+
+        record.compressed_size += comp_len;
+        record.block_refs.push(BlockRef {
+            content_hash,
+            archive_offset,
+            intra_offset: 0,
+            intra_length: 0,
+            file_offset:  br.file_offset,
+        });
+        Ok(())
+    }
+
+    /// Encode and clear the pending re-encode batch.
+    fn reencode(&mut self, batch: &mut Vec<(String, Vec<u8>)>, codec: CodecId) -> io::Result<()> {
+        if batch.is_empty() {
+            return Ok(());
+        }
+        let files: Vec<(String, &[u8])> =
+            batch.iter().map(|(name, data)| (name.clone(), data.as_slice())).collect();
+        self.add_files(&files, codec)?;
+        batch.clear();
+        Ok(())
+    }
+}
@@ -0,0 +1,320 @@
+//! Bounded-memory CAS table for the writer.
+//!
+//! Every chunk the writer stores is looked up by its BLAKE3 hash, to find an
+//! identical block that is already in the archive.  A `HashMap<[u8; 32],
+//! (u64, u64)>` costs about 100 bytes per unique chunk, so a multi-TB
+//! archive of small CDC chunks needs tens of GiB for the table alone.
+//! [`DedupTable`] keeps the same mapping in three parts:
+//!
+//! - **slots**: an open-addressing table with linear probing, at most 3/4
+//!   full.  Each 24-byte slot holds the first 8 bytes of a hash, the
+//!   block's offset and compressed length, and the entry's number.
+//! - **filter**: a blocked Bloom filter over the same prefixes, one byte per
+//!   slot.  A lookup tests three bits of one 64-bit word.  Most chunks of
+//!   new data are not stored yet, and the filter turns those away without
+//!   touching the slot array, which is 24 times larger.
+//! - **hashes**: the full 32-byte hash of every entry, by entry number.  A
+//!   prefix match only counts as a hit once the full hashes are equal, so
+//!   two chunks that share a prefix are never confused.
+//!
+//! The full hashes are the largest part.  Once the table is over its
+//! budget, the resident hashes are written to a spill file in
+//! `std::env::temp_dir()` and dropped from memory.  A prefix match on a
+//! spilled entry then costs one 32-byte read.  Slots and filter always stay
+//! in memory: about 33 to 67 bytes per entry, depending on how full the
+//! table is since it last doubled.  The spill file is deleted when the table is
+//! dropped, or by the OS if the process dies first.
+
+use std::fs::{File, OpenOptions};
+use std::io;
+use std::sync::atomic::{AtomicU64, Ordering};
+
+use super::parallel::{ReadAt, WriteAt};
+
+/// Default memory budget of a writer's CAS table: 1 GiB, about 16 million
+/// chunks before the first spill.
+pub const DEFAULT_DEDUP_MEMORY: usize = 1024 * 1024 * 1024;
+
+/// Slots allocated by the first insert.
+const MIN_SLOTS: usize = 1024;
+
+/// Fewest resident hashes that are spilled together (2 MiB), so a table
+/// whose slots alone exceed the budget still writes in large runs.
+const SPILL_RUN: usize = 64 * 1024;
+
+const HASH_BYTES: usize = 32;
+
+#[derive(Clone, Copy, Default)]
+struct Slot {
+    /// First 8 bytes of the hash, little-endian.
+    prefix:   u64,
+    /// Archive offset of the block.  No block starts at 0 (the superblock
+    /// does), so 0 marks an empty slot.
+    offset:   u64,
+    comp_len: u32,
+    /// Position of the full hash in the entry sequence.
+    entry:    u32,
+}
+
+/// BLAKE3 chunk hash → (archive offset, compressed length) of the block
+/// that stores it, in bounded memory; see the module docs.
+pub struct DedupTable {
+    slots:   Vec<Slot>,
+    filter:  Vec<u64>,
+    len:     usize,
+    /// Full hashes of entries `spilled..len`; earlier ones are in `spill`.
+    hashes:  Vec<[u8; 32]>,
+    spill:   Option<File>,
+    spilled: usize,
+    budget:  usize,
+}
+
+impl Default for DedupTable {
+    fn default() -> Self { Self::new(DEFAULT_DEDUP_MEMORY) }
+}
+
+impl DedupTable {
+    /// An empty table that spills once it holds more than `budget` bytes.
+    pub fn new(budget: usize) -> Self {
+        Self {
+            slots:   Vec::new(),
+            filter:  Vec::new(),
+            len:     0,
+            hashes:  Vec::new(),
+            spill:   None,
+            spilled: 0,
+            budget,
+        }
+    }
+
+    pub fn len(&self) -> usize { self.len }
+
+    pub fn is_empty(&self) -> bool { self.len == 0 }
+
+    /// Bytes held in memory.
+    pub fn memory(&self) -> usize {
+        self.slots.capacity() * std::mem::size_of::<Slot>()
+            + self.filter.capacity() * 8
+            + self.hashes.capacity() * HASH_BYTES
+    }
+
+    /// Entries whose full hash has been moved to the spill file.
+    pub fn spilled(&self) -> usize { self.spilled }
+
+    /// Change the memory budget, spilling now if the table is over it.
+    pub fn set_budget(&mut self, budget: usize) -> io::Result<()> {
+        self.budget = budget;
+        self.enforce_budget(1)
+    }
+
+    /// The block stored for `hash`, if any.  Fails only if a spilled hash
+    /// cannot be read back.
+    pub fn get(&self, hash: &[u8; 32]) -> io::Result<Option<(u64, u64)>> {
+        if self.len == 0 {
+            return Ok(None);
+        }
+        let prefix = prefix(hash);
+        let (word, bits) = filter_bits(prefix, self.filter.len());
+        if self.filter[word] & bits != bits {
+            return Ok(None);
+        }
+        let mask = self.slots.len() - 1;
+        let mut i = prefix as usize & mask;
+        loop {
+            let slot = self.slots[i];
+            if slot.offset == 0 {
+                return Ok(None);
+            }
+            if slot.prefix == prefix && self.hash_of(slot.entry)? == *hash {
+                return Ok(Some((slot.offset, slot.comp_len as u64)));
+            }
+            i = (i + 1) & mask;
+        }
+    }
+
+    pub fn contains(&self, hash: &[u8; 32]) -> io::Result<bool> {
+        Ok(self.get(hash)?.is_some())
+    }
+
+    /// Record that the block at `offset`, `comp_len` bytes on disk, stores
+    /// the chunk `hash`.  The first block recorded for a hash is kept.
+    pub fn insert(&mut self, hash: [u8; 32], (offset, comp_len): (u64, u64)) -> io::Result<()> {
+        if self.contains(&hash)? {
+            return Ok(());
+        }
+        if offset == 0 {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "CAS table: no block starts at offset 0"));
+        }
+        let comp_len = u32::try_from(comp_len).map_err(|_| io::Error::new(io::ErrorKind::InvalidInput,
+            format!("CAS table: block length {comp_len} does not fit a block header")))?;
+        let entry = u32::try_from(self.len).map_err(|_| io::Error::new(io::ErrorKind::Other,
+            "CAS table: more than 2^32 unique chunks"))?;
+
+        if (self.len + 1) * 4 > self.slots.len() * 3 {
+            self.grow();
+        }
+        self.place(Slot { prefix: prefix(&hash), offset, comp_len, entry });
+        self.hashes.push(hash);
+        self.len += 1;
+        self.enforce_budget(SPILL_RUN)
+    }
+
+    /// Put `slot` in the first free position of its probe sequence.
+    fn place(&mut self, slot: Slot) {
+        let mask = self.slots.len() - 1;
+        let mut i = slot.prefix as usize & mask;
+        while self.slots[i].offset != 0 {
+            i = (i + 1) & mask;
+        }
+        self.slots[i] = slot;
+        let (word, bits) = filter_bits(slot.prefix, self.filter.len());
+        self.filter[word] |= bits;
+    }
+
+    /// Double the slots (and the filter) and re-place every entry.  The
+    /// prefixes in the slots are all that is needed, so spilled hashes are
+    /// not read.
+    fn grow(&mut self) {
+        let size = (self.slots.len() * 2).max(MIN_SLOTS);
+        let old  = std::mem::replace(&mut self.slots, vec![Slot::default(); size]);
+        self.filter = vec![0; size / 8];
+        for slot in old.into_iter().filter(|s| s.offset != 0) {
+            self.place(slot);
+        }
+    }
+
+    fn hash_of(&self, entry: u32) -> io::Result<[u8; 32]> {
+        let entry = entry as usize;
+        if entry >= self.spilled {
+            return Ok(self.hashes[entry - self.spilled]);
+        }
+        let mut hash = [0u8; 32];
+        self.spill.as_ref()
+            .expect("spilled entries have a spill file")
+            .read_exact_at(&mut hash, (entry * HASH_BYTES) as u64)?;
+        Ok(hash)
+    }
+
+    /// Move the resident hashes to the spill file if the table is over
+    /// budget and there are at least `min_run` of them.
+    fn enforce_budget(&mut self, min_run: usize) -> io::Result<()> {
+        if self.memory() <= self.budget || self.hashes.len() < min_run.max(1) {
+            return Ok(());
+        }
+        if self.spill.is_none() {
+            self.spill = Some(spill_file()?);
+        }
+        let file = self.spill.as_ref().unwrap();
+        let mut at = (self.spilled * HASH_BYTES) as u64;
+        for run in self.hashes.chunks(SPILL_RUN) {
+            let bytes = run.concat();
+            file.write_all_at(&bytes, at)?;
+            at += bytes.len() as u64;
+        }
+        self.spilled += self.hashes.len();
+        self.hashes = Vec::new();
+        Ok(())
+    }
+}
+
+fn prefix(hash: &[u8; 32]) -> u64 {
+    u64::from_le_bytes(hash[..8].try_into().unwrap())
+}
+
+/// The filter word for `prefix` and the three bits it sets there.  The
+/// prefix is remixed so the filter does not follow the slot index bits.
+fn filter_bits(prefix: u64, words: usize) -> (usize, u64) {
+    let h    = prefix.wrapping_mul(0x9e37_79b9_7f4a_7c15);
+    let word = (h >> 32) as usize & (words - 1);
+    let bits = 1u64 << (h >> 26 & 63) | 1u64 << (h >> 20 & 63) | 1u64 << (h >> 14 & 63);
+    (word, bits)
+}
+
+/// A new, already-unlinked file for spilled hashes.
+fn spill_file() -> io::Result<File> {
+    static NEXT: AtomicU64 = AtomicU64::new(0);
+    let path = std::env::temp_dir().join(format!(
+        "6cy-dedup-{}-{}", std::process::id(), NEXT.fetch_add(1, Ordering::Relaxed)));
+    let mut opts = OpenOptions::new();
+    opts.read(true).write(true).create_new(true);
+    #[cfg(windows)]
+    {
+        use std::os::windows::fs::OpenOptionsExt;
+        const FILE_FLAG_DELETE_ON_CLOSE: u32 = 0x0400_0000;
+        opts.custom_flags(FILE_FLAG_DELETE_ON_CLOSE);
+    }
+    let file = opts.open(&path)?;
+    #[cfg(unix)]
+    std::fs::remove_file(&path)?;
+    Ok(file)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn hash(i: u64) -> [u8; 32] {
+        *blake3::hash(&i.to_le_bytes()).as_bytes()
+    }
+
+    #[test]
+    fn insert_get_and_grow() {
+        let mut t = DedupTable::default();
+        assert_eq!(t.get(&hash(0)).unwrap(), None);
+        for i in 0..10_000 {
+            t.insert(hash(i), (256 + i * 100, i)).unwrap();
+        }
+        assert_eq!(t.len(), 10_000);
+        for i in 0..10_000 {
+            assert_eq!(t.get(&hash(i)).unwrap(), Some((256 + i * 100, i)));
+        }
+        assert!((10_000..20_000).all(|i| !t.contains(&hash(i)).unwrap()));
+
+        // The first block recorded for a hash is kept.
+        t.insert(hash(7), (999_999, 1)).unwrap();
+        assert_eq!(t.get(&hash(7)).unwrap(), Some((256 + 700, 7)));
+        assert_eq!(t.len(), 10_000);
+        assert!(t.insert(hash(20_000), (0, 1)).is_err());
+    }
+
+    #[test]
+    fn shared_prefix_is_not_a_hit() {
+        let mut t = DedupTable::default();
+        let a = hash(1);
+        let mut b = a;
+        b[31] ^= 1;
+        t.insert(a, (256, 10)).unwrap();
+        assert_eq!(t.get(&b).unwrap(), None);
+        t.insert(b, (512, 20)).unwrap();
+        assert_eq!(t.get(&a).unwrap(), Some((256, 10)));
+        assert_eq!(t.get(&b).unwrap(), Some((512, 20)));
+    }
+
+    #[test]
+    fn spills_over_budget_and_still_confirms() {
+        let mut t = DedupTable::new(0);
+        let n = 3 * SPILL_RUN as u64 + 5;
+        for i in 0..n {
+            t.insert(hash(i), (256 + i, 1)).unwrap();
+        }
+        assert_eq!(t.spilled(), 3 * SPILL_RUN);
+        assert_eq!(t.hashes.len(), 5);
+        assert!(t.hashes.capacity() < SPILL_RUN);
+        for i in (0..n).step_by(97).chain([0, SPILL_RUN as u64, n - 1]) {
+            assert_eq!(t.get(&hash(i)).unwrap(), Some((256 + i, 1)));
+        }
+        // A spilled entry with a matching prefix but another full hash.
+        let mut other = hash(3);
+        other[20] ^= 0xff;
+        assert_eq!(t.get(&other).unwrap(), None);
+
+        // Lowering the budget later spills the resident rest.
+        let mut t = DedupTable::default();
+        for i in 0..100 {
+            t.insert(hash(i), (256 + i, 1)).unwrap();
+        }
+        t.set_budget(0).unwrap();
+        assert_eq!(t.spilled(), 100);
+        assert!((0..100).all(|i| t.get(&hash(i)).unwrap() == Some((256 + i, 1))));
+    }
+}
@@ -0,0 +1,35 @@
+//! Memory-mapped, read-only archive source.
+//!
+//! [`MmapSource`] is an `io::Cursor` over the whole mapped file, so it is
+//! `Read + Seek` for the streaming reader paths and [`ReadAt`] for the
+//! shared ones.  Its [`ReadAt::slice_at`] borrows straight from the mapping:
+//! block headers are parsed in place and payloads reach the decompressor
+//! (or the AEAD) without a read syscall or a per-block allocation.
+//!
+//! [`ReadAt`]: super::ReadAt
+//! [`ReadAt::slice_at`]: super::ReadAt::slice_at
+
+use std::fs::File;
+use std::io;
+
+/// A read-only mapping of an archive file.
+pub type MmapSource = io::Cursor<memmap2::Mmap>;
+
+/// Map `file` read-only.
+///
+/// The archive must not be truncated or rewritten while the mapping is
+/// alive: the pages are shared with the file, and shrinking it underneath
+/// a reader faults the process (`SIGBUS` on Unix).  Nothing in this crate
+/// shrinks an archive.  [`SixCyWriter::append`] only grows it, and the
+/// mapping's length is fixed when it is made, so bytes written past the
+/// old end are never mapped.  Append does rewrite the superblock in place,
+/// though, so it must not run while a mapping of the same file that it does
+/// not own is alive, whether in this process or another.
+///
+/// [`SixCyWriter::append`]: super::SixCyWriter::append
+pub fn map_file(file: &File) -> io::Result<MmapSource> {
+    // Safety: the mapping is never written through, and the mapped bytes
+    // are not changed while it is alive, given the rule above.
+    let map = unsafe { memmap2::Mmap::map(file)? };
+    Ok(io::Cursor::new(map))
+}
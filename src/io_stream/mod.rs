@@ -8,10 +8,32 @@
 //! A full INDEX block is written at the end; the superblock is patched in
 //! place at offset 0 on `finalize()`.
 //!
+//! The CAS table is a [`DedupTable`] with a memory budget, beyond which
+//! its full hashes spill to a temporary file (see `dedup.rs`).
+//!
+//! Chunk boundaries are fixed-size by default; [`Chunking::ContentDefined`]
+//! cuts by content instead, so dedup survives insertions (see `chunker.rs`).
+//!
+//! With `threads > 1`, chunks are compressed by a worker pool while the
+//! caller's thread writes finished blocks in order (see `pipeline.rs`).
+//! [`SixCyWriter::add_files`] pipelines across files as well as chunks, and
+//! [`SixCyWriter::add_reader`] streams one file from any `Read` source.
+//! [`SixCyWriter::copy_files_from`] moves files from another archive block
+//! by block, without decoding them (see `copy.rs`), and
+//! [`SixCyWriter::append`] continues a finished archive, reusing its CAS
+//! table (see `append.rs`).  Wrapping the output in a [`WriteBehind`]
+//! takes the block writes off the compressing thread (see
+//! `write_behind.rs`).  [`SixCyWriter::enable_stats`] times each stage of
+//! all of this (see [`crate::stats`]).
+//!
 //! # Reader (normal path)
 //! [`SixCyReader`] reads the superblock, performs an upfront codec
 //! availability check (fail hard if any required codec is missing — no
-//! negotiation), then seeks to the INDEX block to build the file list.
+//! negotiation), then reads the INDEX block.  The binary index is kept as
+//! an `IndexView`: opening validates it but decodes no records.
+//! Sources that also implement [`ReadAt`] get `&self` read paths that many
+//! threads can share (see `parallel.rs`); a memory-mapped [`MmapSource`]
+//! additionally hands block payloads to the decoder as borrowed slices.
 //!
 //! # Reader (reconstruction path)
 //! If the INDEX block is absent or corrupt, `SixCyReader::scan_blocks()`
@@ -27,17 +49,53 @@
 
 use std::io::{self, Read, Write, Seek, SeekFrom};
 use std::collections::HashMap;
+use std::ops::Range;
+use std::sync::{Arc, OnceLock};
 use crate::superblock::{Superblock, SUPERBLOCK_SIZE};
-use crate::block::{encode_block, decode_block, BlockHeader, BlockType, FILE_ID_SHARED};
-use crate::index::{FileIndex, FileIndexRecord, BlockRef};
-use crate::codec::CodecId;
+use crate::block::{content_hash, encode_block, encode_block_into, decode_block, decode_block_in_place,
+                   decode_block_in_place_owned,
+                   BlockHeader, BlockType, BLOCK_HEADER_SIZE, FILE_ID_SHARED};
+use crate::index::{FileIndex, FileIndexRecord, BlockRef, IndexView, RecordView, BlockTable, BlockTableView};
+use crate::buffer;
+use crate::codec::{adaptive, CodecId, Dictionary};
 use crate::recovery::{RecoveryMap, RecoveryCheckpoint};
+use crate::stats::{self, Stage, Stats, StatsReport};
 use chrono::Utc;
+use zeroize::Zeroize;
+
+mod append;
+mod cache;
+mod chunker;
+mod copy;
+mod dedup;
+mod mmap;
+mod parallel;
+mod pipeline;
+mod write_behind;
+
+use pipeline::{ChunkSource, ReaderSource};
+
+pub use cache::{BlockCache, CacheStats, CachedBlock, CACHE_SHARDS};
+pub use chunker::{CdcParams, Chunking, DEFAULT_CDC_AVG_SIZE};
+pub use copy::{CopyStats, REENCODE_BATCH_BYTES};
+pub use dedup::{DedupTable, DEFAULT_DEDUP_MEMORY};
+pub use mmap::{map_file, MmapSource};
+pub use parallel::{ReadAt, WriteAt, PARALLEL_READ_MIN_BYTES};
+pub use write_behind::{WriteBehind, DEFAULT_WRITE_DEPTH, WRITE_BEHIND_BUFFER};
 
 /// Default chunk size: 4 MiB.
 pub const DEFAULT_CHUNK_SIZE:        usize = 4 * 1024 * 1024;
+/// Default decoded size of each SOLID block in a solid session: 16 MiB.
+pub const DEFAULT_SOLID_BLOCK_SIZE: usize = 16 * 1024 * 1024;
 /// Default Zstd compression level.
 pub const DEFAULT_COMPRESSION_LEVEL: i32   = 3;
+/// Default [`BlockCache`] budget per reader: 64 MiB of decoded blocks.
+pub const DEFAULT_BLOCK_CACHE_BYTES: usize = 64 * 1024 * 1024;
+
+/// Worker count used when none is configured: one per available core.
+pub fn default_threads() -> usize {
+    std::thread::available_parallelism().map_or(1, |n| n.get())
+}
 
 // ── Writer ───────────────────────────────────────────────────────────────────
 
@@ -47,18 +105,51 @@ pub struct SixCyWriter<W: Write + Seek> {
     pub index:         FileIndex,
     pub recovery_map:  RecoveryMap,
 
-    // Solid-mode accumulation
+    // Solid-mode accumulation; never more than `solid_block_size` bytes.
     solid_buffer:      Vec<u8>,
     solid_codec:       Option<CodecId>,
-    /// (file_id, intra_offset, intra_length, content_hash)
-    solid_file_ranges: Vec<(u32, u64, u64, [u8; 32])>,
+    /// (record position in `index.records`, intra_offset, intra_length,
+    /// content_hash, file_offset) of each member slice in `solid_buffer`
+    solid_file_ranges: Vec<(usize, u64, u64, [u8; 32], u64)>,
 
     // CAS: BLAKE3(uncompressed chunk) → (archive_offset, compressed_payload_len)
-    block_dedup:       HashMap<[u8; 32], (u64, u64)>,
+    block_dedup:       DedupTable,
+
+    /// Shared dictionary, written once as a DICT block by `set_dictionary`.
+    dictionary:        Option<Dictionary>,
+
+    /// On-disk payload of the block being written, reused for every block.
+    payload:           Vec<u8>,
+
+    /// Every block written so far, for the BLOCK TABLE footer.
+    block_table:       BlockTable,
+
+    /// Set once a block compressed at another (or an unrecorded) level is
+    /// copied in; `superblock.pack_level` is then left unset.
+    mixed_levels:      bool,
+
+    /// Per-stage counters, once `enable_stats` is called.
+    stats:             Option<Arc<Stats>>,
 
     pub chunk_size:        usize,
+    /// Decoded size at which a solid session cuts a SOLID block and starts
+    /// the next; members that cross the cut are split between the two.
+    pub solid_block_size:  usize,
+    /// Where chunks are cut; `chunk_size` applies to [`Chunking::Fixed`].
+    pub chunking:          Chunking,
     pub compression_level: i32,
     pub encryption_key:    Option<[u8; 32]>,
+    /// Compressor worker threads; `1` (the default) compresses on the
+    /// caller's thread.  [`default_threads`] gives one per core.
+    pub threads:           usize,
+    /// Threads each block may use inside its codec (Zstd workers, `lzma-mt`
+    /// streams); `1` keeps every block on one thread.  Multiplies with
+    /// `threads` when the pipeline is running, so it pays off mostly for
+    /// solid sessions and a few large files.
+    pub block_threads:     usize,
+    /// Store blocks that sample as incompressible with `CodecId::None`
+    /// instead of the requested codec; see [`codec::adaptive`](crate::codec::adaptive).
+    pub adaptive:          bool,
 }
 
 impl<W: Write + Seek> SixCyWriter<W> {
@@ -72,41 +163,133 @@ impl<W: Write + Seek> SixCyWriter<W> {
         compression_level: i32,
         encryption_key:    Option<[u8; 32]>,
     ) -> io::Result<Self> {
-        let sb = Superblock::new();
         writer.seek(SeekFrom::Start(0))?;
         writer.write_all(&[0u8; SUPERBLOCK_SIZE])?; // reserved; overwritten on finalize
-        Ok(Self {
+        Ok(Self::with_state(writer, Superblock::new(), chunk_size, compression_level, encryption_key))
+    }
+
+    /// A writer that continues from `writer`'s position with `superblock`,
+    /// and no files or blocks yet; [`append`](Self::append) fills in the
+    /// rest.
+    fn with_state(
+        writer:            W,
+        superblock:        Superblock,
+        chunk_size:        usize,
+        compression_level: i32,
+        encryption_key:    Option<[u8; 32]>,
+    ) -> Self {
+        Self {
             writer,
-            superblock:        sb,
+            superblock,
             index:             FileIndex::default(),
             recovery_map:      RecoveryMap::default(),
             solid_buffer:      Vec::new(),
             solid_codec:       None,
             solid_file_ranges: Vec::new(),
-            block_dedup:       HashMap::new(),
+            block_dedup:       DedupTable::default(),
+            dictionary:        None,
+            payload:           Vec::new(),
+            block_table:       BlockTable::default(),
+            mixed_levels:      false,
+            stats:             None,
             chunk_size:        chunk_size.max(1),
+            solid_block_size:  DEFAULT_SOLID_BLOCK_SIZE,
+            chunking:          Chunking::Fixed,
             compression_level,
             encryption_key,
-        })
+            threads:           1,
+            block_threads:     1,
+            adaptive:          false,
+        }
+    }
+
+    // ── Dictionary ──────────────────────────────────────────────────────────
+
+    /// Write `dict` as the archive's DICT block and compress every following
+    /// block against it (for codecs that support dictionaries).
+    ///
+    /// May be called once per archive, before the files that should use it.
+    /// The DICT block is encrypted along with the data when a key is set.
+    pub fn set_dictionary(&mut self, dict: Dictionary) -> io::Result<()> {
+        if self.dictionary.is_some() {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput,
+                "archive already has a dictionary"));
+        }
+        let (header, payload) = encode_block(
+            BlockType::Dict,
+            FILE_ID_SHARED,
+            0,
+            dict.as_bytes(),
+            CodecId::None,            // trained dictionaries do not compress
+            0,
+            self.encryption_key.as_ref(),
+        ).map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+
+        let archive_offset = self.writer.stream_position()?;
+        header.write(&mut self.writer)?;
+        self.writer.write_all(&payload)?;
+        self.block_table.push(archive_offset, &header);
+
+        self.index.dict_offset = Some(archive_offset);
+        self.dictionary = Some(dict);
+        Ok(())
+    }
+
+    // ── CAS table ───────────────────────────────────────────────────────────
+
+    /// Bound the CAS table to `budget` bytes of memory (default
+    /// [`DEFAULT_DEDUP_MEMORY`]).  Past it, full chunk hashes spill to a
+    /// temporary file; see [`DedupTable`].
+    pub fn set_dedup_memory(&mut self, budget: usize) -> io::Result<()> {
+        self.block_dedup.set_budget(budget)
+    }
+
+    /// The CAS table: one entry per unique chunk stored so far.
+    pub fn dedup_table(&self) -> &DedupTable { &self.block_dedup }
+
+    // ── Statistics ──────────────────────────────────────────────────────────
+
+    /// Count calls, bytes and time per stage for everything this writer
+    /// does from now on, on every thread it uses; see [`crate::stats`].
+    pub fn enable_stats(&mut self) {
+        self.stats.get_or_insert_with(Default::default);
+    }
+
+    /// The counters so far, if [`enable_stats`](Self::enable_stats) was called.
+    pub fn stats(&self) -> Option<StatsReport> {
+        self.stats.as_ref().map(|s| s.report(None))
     }
 
     // ── Solid mode ──────────────────────────────────────────────────────────
 
-    /// Begin accumulating files into a single compressed solid block.
-    /// Flushes any open solid session first.
+    /// Begin accumulating files into compressed solid blocks.  Flushes any
+    /// open solid session first.
+    ///
+    /// Members are packed back to back into SOLID blocks of
+    /// `solid_block_size` decoded bytes each, so memory stays at one block
+    /// and reading a member decodes only the blocks it spans.
+    /// A `solid_block_size` of 0 is rejected with `InvalidInput`.
     pub fn start_solid_session(&mut self, codec: CodecId) -> io::Result<()> {
+        if self.solid_block_size == 0 {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "solid block size must not be 0"));
+        }
         self.flush_solid_session()?;
         self.solid_codec = Some(codec);
         Ok(())
     }
 
-    /// Compress the accumulated solid buffer as one SOLID block and update
-    /// every pending file's block_refs with correct intra-block ranges.
+    /// Write the open session's last SOLID block and end the session.
     pub fn flush_solid_session(&mut self) -> io::Result<()> {
-        let codec = match self.solid_codec.take() {
-            Some(c) => c,
-            None    => return Ok(()),
-        };
+        let Some(codec) = self.solid_codec else { return Ok(()) };
+        let _stats = stats::install(self.stats.as_ref());
+        self.write_solid_block(codec)?;
+        self.solid_codec = None;
+        Ok(())
+    }
+
+    /// Compress the accumulated solid buffer as one SOLID block and give
+    /// every member slice in it a block ref with its intra-block range.
+    fn write_solid_block(&mut self, codec: CodecId) -> io::Result<()> {
         if self.solid_buffer.is_empty() {
             self.solid_file_ranges.clear();
             return Ok(());
@@ -114,146 +297,283 @@ impl<W: Write + Seek> SixCyWriter<W> {
 
         self.superblock.add_required_codec(codec);
 
-        let (header, payload) = encode_block(
+        let codec = block_codec(self.adaptive, &self.solid_buffer, codec);
+        let header = encode_block_into(
             BlockType::Solid,
             FILE_ID_SHARED,
             0,
             &self.solid_buffer,
+            content_hash(&self.solid_buffer),
             codec,
             self.compression_level,
+            self.block_threads,
             self.encryption_key.as_ref(),
+            self.dictionary.as_ref(),
+            &mut self.payload,
         ).map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
 
         let archive_offset = self.writer.stream_position()?;
-        let payload_len    = payload.len() as u64;
-        header.write(&mut self.writer)?;
-        self.writer.write_all(&payload)?;
+        let payload_len    = self.payload.len() as u64;
+        self.write_block(&header)?;
+        self.block_table.push(archive_offset, &header);
+        self.superblock.add_block_codec(&header);
 
-        for (file_id, intra_offset, intra_length, content_hash) in
+        for (pos, intra_offset, intra_length, content_hash, file_offset) in
             self.solid_file_ranges.drain(..)
         {
-            if let Some(rec) = self.index.records.iter_mut().find(|r| r.id == file_id) {
-                rec.block_refs.push(BlockRef {
-                    content_hash,
-                    archive_offset,
-                    intra_offset,
-                    intra_length,
-                });
-                rec.compressed_size = payload_len;
-            }
+            let rec = &mut self.index.records[pos];
+            rec.block_refs.push(BlockRef {
+                content_hash,
+                archive_offset,
+                intra_offset,
+                intra_length,
+                file_offset,
+            });
+            // Each solid block a member spans counts toward its size.
+            rec.compressed_size += payload_len;
         }
         self.solid_buffer.clear();
         Ok(())
     }
 
+    /// Room left in the solid buffer before the next cut.
+    fn solid_room(&self) -> usize {
+        self.solid_block_size.max(1).saturating_sub(self.solid_buffer.len())
+    }
+
+    /// Note the member slice just appended to `solid_buffer` at
+    /// `intra_offset`, then cut a block if the buffer is full.
+    fn push_solid_slice(&mut self, pos: usize, intra_offset: usize, file_offset: u64) -> io::Result<()> {
+        let slice = &self.solid_buffer[intra_offset..];
+        let len   = slice.len() as u64;
+        if len > 0 {
+            self.solid_file_ranges.push((pos, intra_offset as u64, len, content_hash(slice), file_offset));
+            self.index.records[pos].original_size += len;
+        }
+        if self.solid_room() == 0 {
+            if let Some(codec) = self.solid_codec {
+                self.write_solid_block(codec)?;
+            }
+        }
+        Ok(())
+    }
+
     // ── File ingestion ───────────────────────────────────────────────────────
 
     /// Add a file to the archive.
     ///
-    /// **Solid mode**: data accumulates in the buffer; block_refs are filled
-    /// by the next `flush_solid_session`.
+    /// **Solid mode**: data joins the solid buffer, which is written as a
+    /// SOLID block each time it reaches `solid_block_size`; block_refs are
+    /// filled as those blocks are written.
     ///
-    /// **Normal mode**: data is split into `chunk_size` chunks.  Each unique
-    /// chunk is written once (CAS deduplication); subsequent identical chunks
-    /// receive a BlockRef pointing at the existing block.
+    /// **Normal mode**: data is split into chunks as `chunking` directs
+    /// (`chunk_size` each by default).  Each unique chunk is written once
+    /// (CAS deduplication); subsequent identical chunks receive a BlockRef
+    /// pointing at the existing block.
     pub fn add_file(
         &mut self,
         name:  String,
         data:  &[u8],
         codec: CodecId,
     ) -> io::Result<()> {
-        let file_id = self.index.records.len() as u32;
-
+        let _stats = stats::install(self.stats.as_ref());
         if self.solid_codec.is_some() {
-            // ── Solid mode ──────────────────────────────────────────────────
-            let intra_offset = self.solid_buffer.len() as u64;
-            let intra_length = data.len() as u64;
-            let content_hash: [u8; 32] = blake3::hash(data).into();
-
-            self.solid_file_ranges.push((file_id, intra_offset, intra_length, content_hash));
-            self.solid_buffer.extend_from_slice(data);
-
-            self.index.records.push(FileIndexRecord {
-                id:              file_id,
-                parent_id:       0,
-                name,
-                block_refs:      Vec::new(),
-                original_size:   data.len() as u64,
-                compressed_size: 0,
-                metadata:        HashMap::new(),
-            });
+            let pos = self.push_solid_member(name);
+            let mut rest = data;
+            while !rest.is_empty() {
+                let (piece, tail) = rest.split_at(self.solid_room().min(rest.len()));
+                let intra_offset = self.solid_buffer.len();
+                self.solid_buffer.extend_from_slice(piece);
+                self.push_solid_slice(pos, intra_offset, (data.len() - rest.len()) as u64)?;
+                rest = tail;
+            }
             return Ok(());
         }
+        if self.threads > 1 && data.len() > self.chunking.min_len(self.chunk_size) {
+            return self.add_files_pipelined(&[(name, data)], codec);
+        }
 
         // ── Normal (chunked CAS) mode ────────────────────────────────────────
         self.superblock.add_required_codec(codec);
 
-        let mut record = FileIndexRecord {
-            id:              file_id,
-            parent_id:       0,
-            name,
-            block_refs:      Vec::new(),
-            original_size:   data.len() as u64,
-            compressed_size: 0,
-            metadata:        HashMap::new(),
-        };
+        let mut record = new_record(self.index.records.len() as u32, name);
+        record.original_size = data.len() as u64;
+        for range in self.chunking.split(data, self.chunk_size) {
+            self.write_chunk(&mut record, range.start as u64, &data[range], codec)?;
+        }
+        self.push_record(record)
+    }
+
+    /// Add a file read from `reader`, which is consumed to EOF.
+    ///
+    /// Stores the same blocks as [`add_file`](Self::add_file) with the whole
+    /// contents, but pulls one chunk at a time into a small pool of reused
+    /// buffers, so memory stays at a few chunks (`2 × threads` in flight)
+    /// however long the input is.  `original_size` is counted as it goes.
+    ///
+    /// In solid mode the contents join the solid buffer like any other
+    /// member, read at most up to the next block cut at a time.
+    pub fn add_reader<R: Read>(
+        &mut self,
+        name:       String,
+        mut reader: R,
+        codec:      CodecId,
+    ) -> io::Result<()> {
+        let _stats = stats::install(self.stats.as_ref());
+        if self.solid_codec.is_some() {
+            let pos = self.push_solid_member(name);
+            loop {
+                let intra_offset = self.solid_buffer.len();
+                let file_offset  = self.index.records[pos].original_size;
+                let room = self.solid_room() as u64;
+                if let Err(e) = (&mut reader).take(room).read_to_end(&mut self.solid_buffer) {
+                    self.solid_buffer.truncate(intra_offset);
+                    return Err(e);
+                }
+                let read = self.solid_buffer.len() - intra_offset;
+                self.push_solid_slice(pos, intra_offset, file_offset)?;
+                if (read as u64) < room {
+                    return Ok(());
+                }
+            }
+        }
+        let mut source = ReaderSource::new(reader, self.chunking, self.chunk_size);
+        if self.threads > 1 {
+            return self.add_source_pipelined(source, vec![name], codec);
+        }
 
-        for (chunk_idx, chunk) in data.chunks(self.chunk_size).enumerate() {
-            let file_offset:  u64       = (chunk_idx * self.chunk_size) as u64;
-            let content_hash: [u8; 32]  = blake3::hash(chunk).into();
+        self.superblock.add_required_codec(codec);
 
-            if let Some(&(existing_offset, comp_len)) = self.block_dedup.get(&content_hash) {
-                // CAS hit — reuse existing block, no new I/O.
-                record.block_refs.push(BlockRef {
-                    content_hash,
-                    archive_offset: existing_offset,
-                    intra_offset:   0,
-                    intra_length:   0,
-                });
-                record.compressed_size += comp_len;
-            } else {
+        let mut record = new_record(self.index.records.len() as u32, name);
+        let mut spare  = Vec::new();
+        while let Some(job) = source.next_chunk(&mut spare)? {
+            record.original_size += job.chunk.len() as u64;
+            self.write_chunk(&mut record, job.file_offset, &job.chunk, codec)?;
+            job.chunk.recycle(&mut spare);
+        }
+        self.push_record(record)
+    }
+
+    /// Append an empty record for a solid member; its slices are added by
+    /// `push_solid_slice`.  Returns the record's position.
+    fn push_solid_member(&mut self, name: String) -> usize {
+        let pos = self.index.records.len();
+        self.index.records.push(new_record(pos as u32, name));
+        pos
+    }
+
+    /// Store one chunk of `record`'s file: a CAS reference when identical
+    /// content is already stored, otherwise a new DATA block.
+    fn write_chunk(
+        &mut self,
+        record:      &mut FileIndexRecord,
+        file_offset: u64,
+        chunk:       &[u8],
+        codec:       CodecId,
+    ) -> io::Result<()> {
+        // Hashed once: the same value is the dedup key and the block's
+        // `content_hash`.
+        let content_hash = content_hash(chunk);
+
+        let stored = self.block_dedup.get(&content_hash)?;
+        stats::dedup(stored.is_some());
+        let (archive_offset, comp_len) = match stored {
+            // CAS hit — reuse existing block, no new I/O.
+            Some(hit) => hit,
+            None => {
                 // New chunk — compress, (optionally) encrypt, write.
-                let (header, payload) = encode_block(
+                let header = encode_block_into(
                     BlockType::Data,
-                    file_id,
+                    record.id,
                     file_offset,
                     chunk,
-                    codec,
+                    content_hash,
+                    block_codec(self.adaptive, chunk, codec),
                     self.compression_level,
+                    self.block_threads,
                     self.encryption_key.as_ref(),
+                    self.dictionary.as_ref(),
+                    &mut self.payload,
                 ).map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
 
                 let archive_offset = self.writer.stream_position()?;
-                let comp_len       = payload.len() as u64;
-                header.write(&mut self.writer)?;
-                self.writer.write_all(&payload)?;
-
-                record.compressed_size += comp_len;
-                self.block_dedup.insert(content_hash, (archive_offset, comp_len));
-                record.block_refs.push(BlockRef {
-                    content_hash,
-                    archive_offset,
-                    intra_offset: 0,
-                    intra_length: 0,
-                });
+                let comp_len       = self.payload.len() as u64;
+                self.write_block(&header)?;
+                self.block_table.push(archive_offset, &header);
+                self.superblock.add_block_codec(&header);
+                self.block_dedup.insert(content_hash, (archive_offset, comp_len))?;
+                (archive_offset, comp_len)
             }
-        }
+        };
 
+        record.compressed_size += comp_len;
+        record.block_refs.push(BlockRef {
+            content_hash,
+            archive_offset,
+            intra_offset: 0,
+            intra_length: 0,
+            file_offset,
+        });
+        Ok(())
+    }
+
+    /// Write `header` and, after it, the payload in `self.payload`.
+    fn write_block(&mut self, header: &BlockHeader) -> io::Result<()> {
+        stats::timed(Stage::Write, BLOCK_HEADER_SIZE + self.payload.len(), || {
+            header.write(&mut self.writer)?;
+            self.writer.write_all(&self.payload)
+        })
+    }
+
+    /// Checkpoint after a chunked file's last block and append its record.
+    fn push_record(&mut self, record: FileIndexRecord) -> io::Result<()> {
         self.recovery_map.checkpoints.push(RecoveryCheckpoint {
             archive_offset: self.writer.stream_position()?,
-            last_file_id:   file_id,
+            last_file_id:   record.id,
             timestamp:      Utc::now().timestamp(),
         });
-
         self.index.records.push(record);
         Ok(())
     }
 
+    /// Add several files at once.
+    ///
+    /// Equivalent to calling [`add_file`](Self::add_file) for each entry in
+    /// order, but with `threads > 1` all of their chunks share one pipeline,
+    /// so batches of small files keep every worker busy too.
+    pub fn add_files(&mut self, files: &[(String, &[u8])], codec: CodecId) -> io::Result<()> {
+        let _stats = stats::install(self.stats.as_ref());
+        if self.solid_codec.is_some() || self.threads <= 1 {
+            for (name, data) in files {
+                self.add_file(name.clone(), data, codec)?;
+            }
+            return Ok(());
+        }
+        self.add_files_pipelined(files, codec)
+    }
+
     // ── Finalization ─────────────────────────────────────────────────────────
 
-    /// Flush any open solid session, write the INDEX block, then patch the
-    /// superblock at offset 0.  Must be called exactly once.
+    /// Flush any open solid session, write the INDEX block, the RecoveryMap
+    /// and the BLOCK TABLE, then patch the superblock at offset 0.  Must be
+    /// called exactly once.
     pub fn finalize(&mut self) -> io::Result<()> {
+        self.finalize_with(|_| Ok(()))
+    }
+
+    /// [`finalize`](Self::finalize), calling `barrier` on the flushed
+    /// writer once the footers are written and again after the superblock
+    /// is patched.
+    ///
+    /// `W` need not be a file, so the writer cannot make its bytes durable
+    /// itself; a `barrier` that syncs the file (e.g. `File::sync_data`)
+    /// does.  The first call orders the footers on disk before the
+    /// superblock that names them, so a crash during an append leaves
+    /// either the old archive or the new one, never a superblock pointing
+    /// at footers that were not written.  The second makes the finished
+    /// archive durable.
+    pub fn finalize_with(&mut self, mut barrier: impl FnMut(&mut W) -> io::Result<()>) -> io::Result<()> {
+        let _stats = stats::install(self.stats.as_ref());
         self.flush_solid_session()?;
 
         // Merkle root over all content hashes.
@@ -275,8 +595,11 @@ impl<W: Write + Seek> SixCyWriter<W> {
         ).map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
 
         let index_offset = self.writer.stream_position()?;
-        idx_header.write(&mut self.writer)?;
-        self.writer.write_all(&idx_on_disk)?;
+        stats::timed(Stage::Write, BLOCK_HEADER_SIZE + idx_on_disk.len(), || {
+            idx_header.write(&mut self.writer)?;
+            self.writer.write_all(&idx_on_disk)
+        })?;
+        self.block_table.push(index_offset, &idx_header);
 
         // Write the RecoveryMap (JSON blob, no block wrapper needed).
         let recovery_bytes = self.recovery_map.to_bytes()
@@ -286,20 +609,54 @@ impl<W: Write + Seek> SixCyWriter<W> {
         self.writer.write_all(&(recovery_bytes.len() as u64).to_le_bytes())?;
         self.writer.write_all(&recovery_bytes)?;
 
+        // The BLOCK TABLE footer, uncompressed so it can be read in place.
+        let table_offset = self.writer.stream_position()?;
+        self.writer.write_all(&self.block_table.encode(recovery_offset))?;
+        self.writer.flush()?;
+        barrier(&mut self.writer)?;
+
         // Patch the superblock.
         self.superblock.index_offset = index_offset;
         self.superblock.index_size   = idx_on_disk.len() as u64;
         if self.encryption_key.is_some() {
             self.superblock.flags |= crate::superblock::SB_FLAG_ENCRYPTED;
         }
-        // recovery_map_offset stored in superblock for diagnostics
-        // (superblock doesn't have the field in v3; stored in RecoveryCheckpoint)
-        let _ = recovery_offset; // acknowledged
+        self.superblock.block_table_offset = table_offset;
+        self.superblock.pack_level = (!self.mixed_levels).then_some(self.compression_level);
 
         self.writer.seek(SeekFrom::Start(0))?;
         self.superblock.write(&mut self.writer)?;
+        self.writer.flush()?;
+        barrier(&mut self.writer)
+    }
+}
 
-        Ok(())
+impl<W: Write + Seek> Drop for SixCyWriter<W> {
+    /// Clear the key and this thread's cipher built from it.
+    fn drop(&mut self) {
+        if let Some(key) = &mut self.encryption_key {
+            crate::crypto::forget_key(key);
+            key.zeroize();
+        }
+    }
+}
+
+/// The codec a new block of `data` is stored with: `codec`, unless
+/// `adaptive` mode finds it not worth compressing.
+fn block_codec(adaptive: bool, data: &[u8], codec: CodecId) -> CodecId {
+    if adaptive { adaptive::select(data, codec) } else { codec }
+}
+
+/// A record with no blocks yet, as the writer starts every file.
+fn new_record(id: u32, name: String) -> FileIndexRecord {
+    FileIndexRecord {
+        id,
+        parent_id:       0,
+        name,
+        block_refs:      Vec::new(),
+        original_size:   0,
+        compressed_size: 0,
+        metadata:        HashMap::new(),
     }
 }
 
@@ -308,8 +665,22 @@ impl<W: Write + Seek> SixCyWriter<W> {
 pub struct SixCyReader<R: Read + Seek> {
     reader:             R,
     pub superblock:     Superblock,
-    pub index:          FileIndex,
+    /// The FILE INDEX, read in place; records decode on demand.
+    pub index:          IndexView,
     pub decryption_key: Option<[u8; 32]>,
+    /// Loaded from the DICT block on first use; set at most once, so
+    /// `&self` readers can load it too.
+    dictionary:         OnceLock<Dictionary>,
+    /// Decode workers for the `*_parallel` / `unpack_files_to` paths.
+    pub threads:        usize,
+    /// Block payloads read ahead of those workers by separate I/O threads;
+    /// `0` (the default) lets each worker read its own.  Raise it where
+    /// per-read latency, not bandwidth, is the limit (network filesystems).
+    pub io_depth:       usize,
+    /// Decoded blocks shared by every read path; see `cache.rs`.
+    cache:              BlockCache,
+    /// Per-stage counters, once `enable_stats` is called.
+    stats:              Option<Arc<Stats>>,
 }
 
 impl<R: Read + Seek> SixCyReader<R> {
@@ -320,10 +691,22 @@ impl<R: Read + Seek> SixCyReader<R> {
     /// Open an archive.  Performs an upfront codec availability check —
     /// fails immediately if the superblock lists a codec UUID not available
     /// in this build.  No partial opening, no negotiation.
-    pub fn with_key(mut reader: R, decryption_key: Option<[u8; 32]>) -> io::Result<Self> {
+    pub fn with_key(reader: R, decryption_key: Option<[u8; 32]>) -> io::Result<Self> {
+        Self::with_key_from(reader, |_| Ok(decryption_key))
+    }
+
+    /// [`with_key`](Self::with_key) with the key worked out from the
+    /// superblock, e.g. derived from a password with its `archive_uuid` as
+    /// the salt.  The superblock is read once, from `reader` itself, and
+    /// `key_for` runs only after it has passed its CRC and codec checks.
+    pub fn with_key_from(
+        mut reader: R,
+        key_for:    impl FnOnce(&Superblock) -> io::Result<Option<[u8; 32]>>,
+    ) -> io::Result<Self> {
         // Superblock::read already calls check_codecs() internally.
         let sb = Superblock::read(&mut reader)
             .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+        let decryption_key = key_for(&sb)?;
 
         // Read and decompress the INDEX block.
         reader.seek(SeekFrom::Start(sb.index_offset))?;
@@ -334,131 +717,216 @@ impl<R: Read + Seek> SixCyReader<R> {
         let idx_raw = decode_block(&idx_header, &idx_payload, None)
             .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
 
-        let index = FileIndex::from_bytes(&idx_raw)
-            .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+        let index = FileIndex::view_payload(idx_raw)
+            .map_err(|e| io::Error::new(io::ErrorKind::InvalidData, e))?;
 
-        Ok(Self { reader, superblock: sb, index, decryption_key })
+        Ok(Self {
+            reader, superblock: sb, index, decryption_key,
+            dictionary: OnceLock::new(),
+            threads:    default_threads(),
+            io_depth:   0,
+            cache:      BlockCache::new(DEFAULT_BLOCK_CACHE_BYTES),
+            stats:      None,
+        })
     }
 
     // ── Block reconstruction (no INDEX) ──────────────────────────────────────
 
+    /// The serialized BLOCK TABLE named by the superblock, if a table header
+    /// is there; parse it with [`BlockTableView::parse`].
+    pub fn block_table(&mut self) -> io::Result<Option<Vec<u8>>> {
+        crate::index::table::read_table(&mut self.reader, self.superblock.block_table_offset)
+    }
+
     /// Reconstruct the file list by scanning every block header sequentially
     /// from `SUPERBLOCK_SIZE` onward.
     ///
     /// Used when the INDEX block is missing or corrupt.  File names are
     /// synthesised as `"file_{file_id:08x}"`.  Solid-block contents cannot
     /// be recovered without the INDEX; solid blocks are noted but their
-    /// intra-file ranges are not reconstructed.
+    /// intra-file ranges are not reconstructed.  Corrupt headers are skipped
+    /// by resyncing on the next valid one, as [`crate::recovery::scan`] does;
+    /// only healthy DATA blocks are listed.
+    ///
+    /// When the archive has a BLOCK TABLE that passes its CRCs, the list is
+    /// rebuilt from the table and no block header is read.
     ///
     /// Returns the reconstructed [`FileIndex`] without modifying `self.index`.
     pub fn scan_blocks(&mut self) -> io::Result<FileIndex> {
-        self.reader.seek(SeekFrom::Start(SUPERBLOCK_SIZE as u64))?;
-
-        // file_id → Vec<(file_offset, BlockRef)>
-        let mut chunks: HashMap<u32, Vec<(u64, BlockRef)>> = HashMap::new();
-        let mut orig_sizes: HashMap<u32, u64> = HashMap::new();
+        if let Some(bytes) = self.block_table()? {
+            if let Ok(index) = BlockTableView::parse(&bytes).and_then(|t| t.to_index()) {
+                return Ok(index);
+            }
+        }
+        let report = crate::recovery::scan::<_, fn(u64, u64)>(&mut self.reader, 0, None)?;
+        Ok(report.index)
+    }
 
-        loop {
-            let pos = match self.reader.stream_position() {
-                Ok(p) => p,
-                Err(_) => break,
-            };
+    // ── Internal helpers ─────────────────────────────────────────────────────
 
-            let header = match BlockHeader::read(&mut self.reader) {
-                Ok(h)  => h,
-                Err(_) => break,   // EOF or corruption — stop scan here
-            };
+    fn read_block_at(&mut self, offset: u64) -> io::Result<(BlockHeader, Vec<u8>)> {
+        let header  = self.read_header_at(offset)?;
+        let payload = self.read_payload(&header)?;
+        Ok((header, payload))
+    }
 
-            // Skip the payload bytes to reach the next block.
-            let skip = header.comp_size as u64;
-            match self.reader.seek(SeekFrom::Current(skip as i64)) {
-                Ok(_)  => {},
-                Err(_) => break,
-            }
+    /// Read and decode the DICT block named by the index.
+    fn load_dictionary(&mut self) -> io::Result<()> {
+        let offset = self.index.dict_offset.ok_or_else(|| io::Error::new(
+            io::ErrorKind::InvalidData,
+            "Block requires a dictionary but the archive has no DICT block"))?;
+        let (header, payload) = self.read_block_at(offset)?;
+        if header.block_type != BlockType::Dict {
+            return Err(io::Error::new(io::ErrorKind::InvalidData,
+                format!("Expected DICT block at offset {offset}, found {:?}", header.block_type)));
+        }
+        let bytes = decode_block(&header, &payload, self.decryption_key.as_ref())
+            .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+        let _ = self.dictionary.set(Dictionary::new(bytes));
+        Ok(())
+    }
 
-            match header.block_type {
-                BlockType::Index => break, // reached the end sentinel
-                BlockType::Solid => {
-                    // Solid block — we know its position but not which files
-                    // it contains (intra-offsets are in the INDEX).
-                    // Record it under the sentinel file_id for diagnostics.
-                }
-                BlockType::Data => {
-                    let fid = header.file_id;
-                    // Track the maximum observed file extent.
-                    let end = header.file_offset + header.orig_size as u64;
-                    let cur = orig_sizes.entry(fid).or_insert(0);
-                    if end > *cur { *cur = end; }
-
-                    let block_ref = BlockRef {
-                        content_hash:   header.content_hash,
-                        archive_offset: pos,
-                        intra_offset:   0,
-                        intra_length:   0,
-                    };
-                    chunks.entry(fid)
-                        .or_default()
-                        .push((header.file_offset, block_ref));
-                }
-            }
+    /// Load the archive dictionary the first time a FLAG_DICT block is seen.
+    fn ensure_dictionary(&mut self, header: &BlockHeader) -> io::Result<()> {
+        if header.uses_dict() && self.dictionary.get().is_none() {
+            self.load_dictionary()?;
         }
+        Ok(())
+    }
 
-        // Sort each file's chunks by file_offset and build FileIndexRecords.
-        let mut records: Vec<FileIndexRecord> = chunks.into_iter().map(|(fid, mut v)| {
-            v.sort_by_key(|(off, _)| *off);
-            let refs: Vec<BlockRef> = v.into_iter().map(|(_, r)| r).collect();
-            let size = *orig_sizes.get(&fid).unwrap_or(&0);
-            FileIndexRecord::from_scan(fid, size, refs)
-        }).collect();
-        records.sort_by_key(|r| r.id);
+    /// Header of the block at `offset`, leaving the cursor at its payload.
+    fn read_header_at(&mut self, offset: u64) -> io::Result<BlockHeader> {
+        self.reader.seek(SeekFrom::Start(offset))?;
+        BlockHeader::read(&mut self.reader)
+    }
 
-        let mut idx = FileIndex { records, root_hash: [0u8; 32] };
-        idx.compute_root_hash();
-        Ok(idx)
+    /// Payload following a header just read by `read_header_at`.
+    fn read_payload(&mut self, header: &BlockHeader) -> io::Result<Vec<u8>> {
+        let mut payload = vec![0u8; header.comp_size as usize];
+        stats::timed(Stage::Read, payload.len(), || self.reader.read_exact(&mut payload))?;
+        Ok(payload)
     }
 
-    // ── Internal helpers ─────────────────────────────────────────────────────
+    /// [`read_payload`](Self::read_payload) into this thread's scratch
+    /// buffer, lent to `f`; the block paths use this to skip the per-block
+    /// allocation, and decrypt in it.
+    fn with_payload<T>(
+        &mut self,
+        header: &BlockHeader,
+        f:      impl FnOnce(&mut Self, &mut [u8]) -> io::Result<T>,
+    ) -> io::Result<T> {
+        buffer::with_scratch(header.comp_size as usize, |payload| {
+            stats::timed(Stage::Read, payload.len(), || self.reader.read_exact(payload))?;
+            f(self, payload)
+        })
+    }
 
-    fn read_block_at(&mut self, offset: u64) -> io::Result<(BlockHeader, Vec<u8>)> {
-        self.reader.seek(SeekFrom::Start(offset))?;
-        let header = BlockHeader::read(&mut self.reader)?;
-        let mut payload = vec![0u8; header.comp_size as usize];
-        self.reader.read_exact(&mut payload)?;
-        Ok((header, payload))
+    /// The whole decoded block at `offset`, from the cache or decoded and
+    /// cached.
+    fn cached_block(&mut self, offset: u64) -> io::Result<CachedBlock> {
+        let header = self.read_header_at(offset)?;
+        if let Some(block) = self.cache.get(offset, &header.content_hash) {
+            return Ok(block);
+        }
+        let block = self.with_payload(&header, |this, payload| {
+            this.ensure_dictionary(&header)?;
+            decode_block_in_place_owned(&header, payload, this.decryption_key.as_ref(), this.dictionary.get(), 0)
+                .map_err(|e| io::Error::new(io::ErrorKind::Other, e))
+        })?;
+        let block = Arc::new(block);
+        self.cache.insert(offset, &header.content_hash, block.clone());
+        Ok(block)
     }
 
-    fn decompress_ref(&mut self, br: &BlockRef) -> io::Result<Vec<u8>> {
-        let (header, payload) = self.read_block_at(br.archive_offset)?;
-        let decompressed = decode_block(&header, &payload, self.decryption_key.as_ref())
-            .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+    /// The decoded block `br` points into and the range of it `br` covers.
+    fn decompress_ref(&mut self, br: &BlockRef) -> io::Result<(CachedBlock, Range<usize>)> {
+        let block = self.cached_block(br.archive_offset)?;
+        let range = if br.is_solid_slice() {
+            solid_slice_range(block.len(), br)?
+        } else {
+            0..block.len()
+        };
+        Ok((block, range))
+    }
 
+    /// Decode the bytes `br` refers to into the front of `dst`, returning how
+    /// many were written.  Non-solid blocks not already cached decompress in
+    /// place with no intermediate buffer.
+    fn decompress_ref_into(&mut self, br: &BlockRef, dst: &mut [u8]) -> io::Result<usize> {
+        let overrun = || io::Error::new(io::ErrorKind::InvalidData,
+            format!("Block at offset {} overruns the file's recorded size", br.archive_offset));
         if br.is_solid_slice() {
-            let start = br.intra_offset as usize;
-            let end   = start + br.intra_length as usize;
-            if end > decompressed.len() {
-                return Err(io::Error::new(io::ErrorKind::InvalidData, format!(
-                    "Solid intra range {start}..{end} exceeds decompressed size {}",
-                    decompressed.len()
-                )));
-            }
-            Ok(decompressed[start..end].to_vec())
-        } else {
-            Ok(decompressed)
+            let (block, range) = self.decompress_ref(br)?;
+            let out = dst.get_mut(..range.len()).ok_or_else(overrun)?;
+            out.copy_from_slice(&block[range]);
+            return Ok(out.len());
+        }
+
+        let header = self.read_header_at(br.archive_offset)?;
+        let out    = dst.get_mut(..header.orig_size as usize).ok_or_else(overrun)?;
+        if let Some(block) = self.cache.get(br.archive_offset, &header.content_hash) {
+            out.copy_from_slice(&block);
+            return Ok(out.len());
         }
+        let n = out.len();
+        self.with_payload(&header, |this, payload| {
+            this.ensure_dictionary(&header)?;
+            decode_block_in_place(&header, payload, this.decryption_key.as_ref(), this.dictionary.get(), 0, out)
+                .map_err(|e| io::Error::new(io::ErrorKind::Other, e))
+        })?;
+        Ok(n)
     }
 
     // ── Public API ───────────────────────────────────────────────────────────
 
+    /// The decoded-block cache, for its [`stats`](BlockCache::stats).
+    pub fn cache(&self) -> &BlockCache { &self.cache }
+
+    /// Replace the block cache with an empty one of `bytes`; `0` disables it.
+    pub fn set_cache_budget(&mut self, bytes: usize) {
+        self.cache = BlockCache::new(bytes);
+    }
+
+    /// Count calls, bytes and time per stage for every read from now on,
+    /// on every thread the reader uses; see [`crate::stats`].
+    pub fn enable_stats(&mut self) {
+        self.stats.get_or_insert_with(Default::default);
+    }
+
+    /// The counters so far, with the block cache's, if
+    /// [`enable_stats`](Self::enable_stats) was called.
+    pub fn stats(&self) -> Option<StatsReport> {
+        self.stats.as_ref().map(|s| s.report(Some(self.cache.stats())))
+    }
+
+    /// Index record for `file_id`, read in place.
+    fn record(&self, file_id: u32) -> io::Result<RecordView<'_>> {
+        self.index.find_id(file_id)
+            .ok_or_else(|| io::Error::new(io::ErrorKind::NotFound, "File not found"))
+    }
+
+    /// Ref `i` of the record at index position `pos`.  Looked up afresh
+    /// for each block, because decoding needs `&mut self`, which a held
+    /// [`RecordView`] would keep borrowed.
+    fn block_ref_at(&self, pos: usize, i: usize) -> BlockRef {
+        self.index.get(pos).expect("record position is in range").block_ref(i)
+    }
+
     /// Return the complete contents of a file by record ID.
     pub fn unpack_file(&mut self, file_id: u32) -> io::Result<Vec<u8>> {
-        let record = self.index.records.iter()
-            .find(|r| r.id == file_id)
-            .ok_or_else(|| io::Error::new(io::ErrorKind::NotFound, "File not found"))?;
-
-        let refs = record.block_refs.clone();
-        let mut out = Vec::with_capacity(record.original_size as usize);
-        for br in &refs {
-            out.extend(self.decompress_ref(br)?);
+        let _stats = stats::install(self.stats.as_ref());
+        let record = self.record(file_id)?;
+        let (at, count) = (record.position(), record.block_count());
+
+        let mut out = vec![0u8; record.original_size() as usize];
+        let mut pos = 0usize;
+        for i in 0..count {
+            let br = self.block_ref_at(at, i);
+            pos += self.decompress_ref_into(&br, &mut out[pos..])?;
+        }
+        if pos != out.len() {
+            return Err(io::Error::new(io::ErrorKind::InvalidData, format!(
+                "File decoded to {pos} B, index records {} B", out.len())));
         }
         Ok(out)
     }
@@ -468,25 +936,30 @@ impl<R: Read + Seek> SixCyReader<R> {
     /// Fills `buf` with bytes starting at `offset` within the file identified
     /// by `file_id`.  Reads continue across block boundaries until `buf` is
     /// full or EOF is reached.  Returns bytes copied.
+    ///
+    /// The first block needed is found by binary search on the refs'
+    /// `file_offset` in the index itself; earlier blocks are not touched,
+    /// and no ref is copied out but the ones read.
     pub fn read_at(&mut self, file_id: u32, offset: u64, buf: &mut [u8]) -> io::Result<usize> {
-        let record = self.index.records.iter()
-            .find(|r| r.id == file_id)
-            .ok_or_else(|| io::Error::new(io::ErrorKind::NotFound, "File not found"))?;
+        let _stats = stats::install(self.stats.as_ref());
+        let record = self.record(file_id)?;
 
-        if offset >= record.original_size || buf.is_empty() {
+        if offset >= record.original_size() || buf.is_empty() {
             return Ok(0);
         }
 
-        let refs = record.block_refs.clone();
-        let mut file_pos    = 0u64;
+        let (first, start)  = record.locate(offset);
+        let (pos, count)    = (record.position(), record.block_count());
+        let mut file_pos    = start;
         let mut buf_written = 0usize;
 
-        for br in &refs {
+        for i in first..count {
             if buf_written == buf.len() { break; }
 
-            let block = self.decompress_ref(br)?;
-            let block_len = block.len() as u64;
-            let block_end = file_pos + block_len;
+            let br = self.block_ref_at(pos, i);
+            let (block, range) = self.decompress_ref(&br)?;
+            let block     = &block[range];
+            let block_end = file_pos + block.len() as u64;
 
             // Skip blocks entirely before the requested offset.
             if block_end <= offset {
@@ -511,3 +984,25 @@ impl<R: Read + Seek> SixCyReader<R> {
         Ok(buf_written)
     }
 }
+
+impl<R: Read + Seek> Drop for SixCyReader<R> {
+    /// Clear the key and this thread's cipher built from it.
+    fn drop(&mut self) {
+        if let Some(key) = &mut self.decryption_key {
+            crate::crypto::forget_key(key);
+            key.zeroize();
+        }
+    }
+}
+
+/// The `intra_offset..intra_offset+intra_length` range of a decoded solid
+/// block, checked against the block's decoded size.
+fn solid_slice_range(block_len: usize, br: &BlockRef) -> io::Result<Range<usize>> {
+    let start = br.intra_offset as usize;
+    let end   = start + br.intra_length as usize;
+    if end > block_len {
+        return Err(io::Error::new(io::ErrorKind::InvalidData, format!(
+            "Solid intra range {start}..{end} exceeds decompressed size {block_len}")));
+    }
+    Ok(start..end)
+}
@@ -0,0 +1,646 @@
+//! Parallel multi-block extraction and `&self` reads for [`SixCyReader`].
+//!
+//! # Positional I/O
+//! Workers read blocks with [`ReadAt`] rather than through the reader's
+//! seek cursor, so many blocks can be in flight on one handle.  Extraction
+//! to disk writes through [`WriteAt`] at each piece's offset within its
+//! destination file, so files are assembled in place, in any order.
+//!
+//! # Work units
+//! The refs being extracted are grouped by `archive_offset`: each block is
+//! read, decrypted, decompressed and BLAKE3-verified exactly once, then
+//! delivered to every place it appears.  That covers CAS duplicates and the
+//! many files sharing one solid block.  A block with a single whole-block
+//! destination in memory decodes straight into it.  Otherwise it is taken
+//! from (or decoded into) the reader's block cache and copied out, so a
+//! solid block shared across batches or calls is still decoded once.
+//!
+//! Block headers are read up front on the caller's thread (84 bytes each)
+//! to size every destination before any worker starts.
+//!
+//! # Shared readers
+//! Nothing here moves the reader's cursor or mutates it: the dictionary is
+//! loaded into a `OnceLock` on first use.  A `SixCyReader` over a `Sync`
+//! source is therefore `Sync`, and any number of threads may call
+//! [`SixCyReader::read_at_shared`] or [`SixCyReader::unpack_file_parallel`]
+//! on one reader.  When the source lends its bytes ([`ReadAt::slice_at`]),
+//! blocks are decoded from the borrowed slice without being copied.
+//!
+//! # Read-ahead
+//! Jobs run in archive order.  Normally each worker reads the payload of
+//! the block it is about to decode, so at most `threads` reads are in
+//! flight, and only while no decoding happens.  With `io_depth > 0`,
+//! `io_depth` I/O threads fetch payloads ahead of the workers into a
+//! bounded queue, and the two stages overlap.  Reads from a plain file
+//! land in pooled buffers.  For a memory-mapped source, the I/O threads
+//! fault the payload's pages in, so on a network filesystem the round
+//! trips happen on them rather than on the decoders.  A
+//! [`SixCyReader::read_at_shared`] that decodes at least
+//! [`PARALLEL_READ_MIN_BYTES`] goes through the same path, so its blocks
+//! are fetched and decoded together; smaller reads decode on the caller's
+//! thread.
+
+use std::borrow::Cow;
+use std::collections::HashMap;
+use std::fs::File;
+use std::io::{self, Read, Seek};
+use std::ops::Range;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::mpsc::sync_channel;
+use std::sync::{Arc, Mutex};
+
+use super::{solid_slice_range, CachedBlock, SixCyReader};
+use crate::block::{decode_block, decode_block_in_place, decode_block_in_place_owned, decode_block_into,
+                   decode_block_owned, BlockHeader, BlockType, BLOCK_HEADER_SIZE};
+use crate::buffer::{self, BufferPool};
+use crate::codec::{CodecError, Dictionary};
+use crate::index::table::TABLE_HEADER_SIZE;
+use crate::index::{BlockRef, BlockTableView, RecordView};
+use crate::stats::{self, Stage};
+
+/// Bytes a [`SixCyReader::read_at_shared`] must decode before its blocks
+/// are handed to worker threads.  Below this, spawning the workers costs
+/// more than decoding the few blocks they would share.
+pub const PARALLEL_READ_MIN_BYTES: usize = 4 * 1024 * 1024;
+
+// ── Positional I/O traits ────────────────────────────────────────────────────
+
+/// Read at an absolute offset without moving any shared cursor.
+pub trait ReadAt {
+    fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> io::Result<()>;
+
+    /// Borrow `len` bytes at `offset` if the source is memory-resident.
+    /// `None` (the default) makes callers fall back to `read_exact_at`.
+    fn slice_at(&self, offset: u64, len: usize) -> Option<&[u8]> {
+        let _ = (offset, len);
+        None
+    }
+}
+
+/// Write at an absolute offset without moving any shared cursor.
+pub trait WriteAt {
+    fn write_all_at(&self, buf: &[u8], offset: u64) -> io::Result<()>;
+}
+
+#[cfg(unix)]
+impl ReadAt for File {
+    fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> io::Result<()> {
+        std::os::unix::fs::FileExt::read_exact_at(self, buf, offset)
+    }
+}
+
+#[cfg(unix)]
+impl WriteAt for File {
+    fn write_all_at(&self, buf: &[u8], offset: u64) -> io::Result<()> {
+        std::os::unix::fs::FileExt::write_all_at(self, buf, offset)
+    }
+}
+
+#[cfg(windows)]
+impl ReadAt for File {
+    fn read_exact_at(&self, mut buf: &mut [u8], mut offset: u64) -> io::Result<()> {
+        use std::os::windows::fs::FileExt;
+        while !buf.is_empty() {
+            match self.seek_read(buf, offset)? {
+                0 => return Err(io::ErrorKind::UnexpectedEof.into()),
+                n => { buf = &mut buf[n..]; offset += n as u64; }
+            }
+        }
+        Ok(())
+    }
+}
+
+#[cfg(windows)]
+impl WriteAt for File {
+    fn write_all_at(&self, mut buf: &[u8], mut offset: u64) -> io::Result<()> {
+        use std::os::windows::fs::FileExt;
+        while !buf.is_empty() {
+            match self.seek_write(buf, offset)? {
+                0 => return Err(io::ErrorKind::WriteZero.into()),
+                n => { buf = &buf[n..]; offset += n as u64; }
+            }
+        }
+        Ok(())
+    }
+}
+
+/// In-memory and memory-mapped archives ([`MmapSource`](super::MmapSource)).
+impl<T: AsRef<[u8]>> ReadAt for io::Cursor<T> {
+    fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> io::Result<()> {
+        let src = self.slice_at(offset, buf.len())
+            .ok_or_else(|| io::Error::from(io::ErrorKind::UnexpectedEof))?;
+        buf.copy_from_slice(src);
+        Ok(())
+    }
+
+    fn slice_at(&self, offset: u64, len: usize) -> Option<&[u8]> {
+        let start = usize::try_from(offset).ok()?;
+        self.get_ref().as_ref().get(start..start.checked_add(len)?)
+    }
+}
+
+// ── Work units ───────────────────────────────────────────────────────────────
+
+/// Where one piece of a decoded block goes.
+enum Dest<'a> {
+    /// A slice of a preallocated output buffer.
+    Buf(&'a mut [u8]),
+    /// `targets[sink]` at byte `pos`.
+    At { sink: usize, pos: u64 },
+}
+
+struct Piece<'a> {
+    dest:  Dest<'a>,
+    /// Range within the decoded block.
+    range: Range<usize>,
+}
+
+/// A block payload as [`SixCyReader::with_payload_at`] hands it over.
+enum Payload<'a> {
+    /// Read into a buffer the decoder may decrypt in place.
+    Owned(&'a mut [u8]),
+    /// Lent by the source, which must not be written.
+    Borrowed(&'a [u8]),
+}
+
+/// One block to decode, and everywhere its bytes are needed.
+struct BlockJob<'a> {
+    offset: u64,
+    header: BlockHeader,
+    pieces: Vec<Piece<'a>>,
+}
+
+impl<R: Read + Seek + ReadAt + Sync> SixCyReader<R> {
+    /// The BLOCK TABLE, validated and borrowed from a memory-resident
+    /// source.  `None` if the archive has no valid table or the source does
+    /// not lend its bytes; [`block_table`](Self::block_table) reads it then.
+    pub fn block_table_in_place(&self) -> Option<BlockTableView<'_>> {
+        let offset = self.superblock.block_table_offset;
+        if offset == 0 {
+            return None;
+        }
+        let header = self.reader.slice_at(offset, TABLE_HEADER_SIZE)?;
+        let len    = usize::try_from(BlockTableView::encoded_len(header)?).ok()?;
+        BlockTableView::parse(self.reader.slice_at(offset, len)?).ok()
+    }
+
+    /// [`unpack_file`](Self::unpack_file) with up to `self.threads` blocks
+    /// decoded concurrently, each straight into its slice of the result.
+    pub fn unpack_file_parallel(&self, file_id: u32) -> io::Result<Vec<u8>> {
+        let record = self.record(file_id)?;
+        let mut out = vec![0u8; record.original_size() as usize];
+
+        let mut headers = HashMap::new();
+        let sizes = self.piece_sizes(record, &mut headers)?;
+        check_total(&sizes, out.len(), file_id)?;
+
+        let mut jobs: Vec<BlockJob> = Vec::new();
+        let mut slot: HashMap<u64, usize> = HashMap::new();
+        let mut rest = out.as_mut_slice();
+        for (br, range) in record.block_refs().zip(sizes) {
+            let (dst, tail) = std::mem::take(&mut rest).split_at_mut(range.len());
+            rest = tail;
+            push_piece(&mut jobs, &mut slot, &headers, &br, Piece { dest: Dest::Buf(dst), range });
+        }
+        self.run_jobs::<File>(jobs, &[])?;
+        Ok(out)
+    }
+
+    /// Extract several files concurrently, writing each into its sink.
+    ///
+    /// `targets` pairs a record ID with a destination that must accept
+    /// writes anywhere in `0..original_size` (e.g. a `File` already
+    /// `set_len` to that size).  Blocks shared between the files are decoded
+    /// once.  Memory use is one decoded block per worker.
+    pub fn unpack_files_to<S: WriteAt + Sync>(&self, targets: &[(u32, S)]) -> io::Result<()> {
+        let mut headers = HashMap::new();
+        let mut jobs: Vec<BlockJob> = Vec::new();
+        let mut slot: HashMap<u64, usize> = HashMap::new();
+
+        for (sink, (file_id, _)) in targets.iter().enumerate() {
+            let record = self.record(*file_id)?;
+            let sizes = self.piece_sizes(record, &mut headers)?;
+            check_total(&sizes, record.original_size() as usize, *file_id)?;
+
+            let mut pos = 0u64;
+            for (br, range) in record.block_refs().zip(sizes) {
+                let len = range.len() as u64;
+                push_piece(&mut jobs, &mut slot, &headers, &br,
+                           Piece { dest: Dest::At { sink, pos }, range });
+                pos += len;
+            }
+        }
+        let sinks: Vec<&S> = targets.iter().map(|(_, s)| s).collect();
+        self.run_jobs(jobs, &sinks)
+    }
+
+    /// [`read_at`](Self::read_at) through `&self`, for readers shared
+    /// between threads.  Like `read_at` it binary-searches to the first
+    /// block needed; for records without file offsets, earlier blocks are
+    /// skipped on their header alone.  Only overlapping blocks are decoded;
+    /// when they add up to [`PARALLEL_READ_MIN_BYTES`] or more, they are
+    /// decoded concurrently.
+    pub fn read_at_shared(&self, file_id: u32, offset: u64, buf: &mut [u8]) -> io::Result<usize> {
+        let _stats = stats::install(self.stats.as_ref());
+        let record = self.record(file_id)?;
+        if offset >= record.original_size() || buf.is_empty() {
+            return Ok(0);
+        }
+
+        let (first, start)  = record.locate(offset);
+        let mut file_pos    = start;
+        let mut buf_written = 0usize;
+        let mut headers = HashMap::new();
+        let mut jobs: Vec<BlockJob> = Vec::new();
+        let mut slot: HashMap<u64, usize> = HashMap::new();
+        let mut rest = buf;
+        for i in first..record.block_count() {
+            if rest.is_empty() { break; }
+
+            let br = &record.block_ref(i);
+            let header = self.header_at(br.archive_offset)?;
+            let orig   = header.orig_size as usize;
+            let range  = if br.is_solid_slice() { solid_slice_range(orig, br)? } else { 0..orig };
+            let block_end = file_pos + range.len() as u64;
+            if block_end <= offset {
+                file_pos = block_end;
+                continue;
+            }
+
+            let skip    = offset.saturating_sub(file_pos) as usize;
+            let to_copy = rest.len().min(range.len() - skip);
+            let (dst, tail) = std::mem::take(&mut rest).split_at_mut(to_copy);
+            rest = tail;
+            let from = range.start + skip;
+            headers.insert(br.archive_offset, header);
+            push_piece(&mut jobs, &mut slot, &headers, br,
+                       Piece { dest: Dest::Buf(dst), range: from..from + to_copy });
+            buf_written += to_copy;
+            file_pos     = block_end;
+        }
+        let decoded: usize = jobs.iter().map(|job| job.header.orig_size as usize).sum();
+        if decoded < PARALLEL_READ_MIN_BYTES {
+            jobs.sort_unstable_by_key(|job| job.offset);
+            jobs.into_iter().try_for_each(|job| self.run_job::<File>(job, None, 0, &[]))?;
+        } else {
+            self.run_jobs::<File>(jobs, &[])?;
+        }
+        Ok(buf_written)
+    }
+
+    // ── Internals ────────────────────────────────────────────────────────────
+
+    /// Header and payload of the block at `offset`, borrowed from the
+    /// source when it lends its bytes.
+    fn block_at(&self, offset: u64) -> io::Result<(BlockHeader, Cow<'_, [u8]>)> {
+        let header  = self.header_at(offset)?;
+        let payload = self.payload_at(offset, &header)?;
+        Ok((header, payload))
+    }
+
+    /// Payload of the block at `offset` whose header is `header`.
+    pub(super) fn payload_at(&self, offset: u64, header: &BlockHeader) -> io::Result<Cow<'_, [u8]>> {
+        let start = offset + BLOCK_HEADER_SIZE as u64;
+        let len   = header.comp_size as usize;
+        if let Some(bytes) = self.reader.slice_at(start, len) {
+            return Ok(Cow::Borrowed(bytes));
+        }
+        let mut buf = vec![0u8; len];
+        stats::timed(Stage::Read, len, || self.reader.read_exact_at(&mut buf, start))?;
+        Ok(Cow::Owned(buf))
+    }
+
+    /// Decode the block at `offset` into `dst`, which must be exactly
+    /// `orig_size` long.  `threads` is the codec's budget for the block; see
+    /// [`decode_block_into`].
+    fn decode_at(
+        &self,
+        offset:  u64,
+        header:  &BlockHeader,
+        fetched: Option<&mut [u8]>,
+        threads: usize,
+        dst:     &mut [u8],
+    ) -> io::Result<()> {
+        self.with_payload_at(offset, header, fetched, |payload, key, dict| match payload {
+            Payload::Owned(p)    => decode_block_in_place(header, p, key, dict, threads, dst),
+            Payload::Borrowed(p) => decode_block_into(header, p, key, dict, threads, dst),
+        })
+    }
+
+    /// [`decode_at`](Self::decode_at) into a new buffer, which is sized from
+    /// `orig_size` only as far as [`decode_block_owned`] trusts it.
+    fn decode_owned_at(
+        &self,
+        offset:  u64,
+        header:  &BlockHeader,
+        fetched: Option<&mut [u8]>,
+        threads: usize,
+    ) -> io::Result<Vec<u8>> {
+        self.with_payload_at(offset, header, fetched, |payload, key, dict| match payload {
+            Payload::Owned(p)    => decode_block_in_place_owned(header, p, key, dict, threads),
+            Payload::Borrowed(p) => decode_block_owned(header, p, key, dict, threads),
+        })
+    }
+
+    /// Run `decode` on the payload of the block at `offset`: `fetched` when
+    /// read ahead, else borrowed from the source when it lends its bytes,
+    /// else read into this thread's scratch buffer (and decrypted there)
+    /// rather than a fresh allocation.
+    fn with_payload_at<T>(
+        &self,
+        offset:  u64,
+        header:  &BlockHeader,
+        fetched: Option<&mut [u8]>,
+        decode:  impl FnOnce(Payload<'_>, Option<&[u8; 32]>, Option<&Dictionary>) -> Result<T, CodecError>,
+    ) -> io::Result<T> {
+        let dict  = if header.uses_dict() { self.shared_dictionary()? } else { None };
+        let key   = self.decryption_key.as_ref();
+        let start = offset + BLOCK_HEADER_SIZE as u64;
+        let len   = header.comp_size as usize;
+        let decoded = match (fetched, self.reader.slice_at(start, len)) {
+            (Some(payload), _) => decode(Payload::Owned(payload), key, dict),
+            (None, Some(payload)) => decode(Payload::Borrowed(payload), key, dict),
+            (None, None) => buffer::with_scratch(len, |buf| {
+                stats::timed(Stage::Read, len, || self.reader.read_exact_at(buf, start))?;
+                Ok(decode(Payload::Owned(buf), key, dict))
+            })?,
+        };
+        decoded.map_err(|e| io::Error::new(io::ErrorKind::Other, e))
+    }
+
+    /// Bring the payload of `job` in ahead of its decode: read into a
+    /// buffer from `pool`, or, when the source lends its bytes, faulted in
+    /// and left in place (`None`).
+    fn fetch(&self, job: &BlockJob, pool: &BufferPool) -> io::Result<Option<Vec<u8>>> {
+        let start = job.offset + BLOCK_HEADER_SIZE as u64;
+        let len   = job.header.comp_size as usize;
+        if let Some(bytes) = self.reader.slice_at(start, len) {
+            touch_pages(bytes);
+            return Ok(None);
+        }
+        let mut buf = pool.take();
+        buf.resize(len, 0);
+        stats::timed(Stage::Read, len, || self.reader.read_exact_at(&mut buf, start))?;
+        Ok(Some(buf))
+    }
+
+    pub(super) fn header_at(&self, offset: u64) -> io::Result<BlockHeader> {
+        match self.reader.slice_at(offset, BLOCK_HEADER_SIZE) {
+            Some(bytes) => BlockHeader::read(bytes),
+            None => {
+                let mut buf = [0u8; BLOCK_HEADER_SIZE];
+                stats::timed(Stage::Read, BLOCK_HEADER_SIZE, || self.reader.read_exact_at(&mut buf, offset))?;
+                BlockHeader::read(&buf[..])
+            }
+        }
+    }
+
+    /// The whole decoded block at `offset`, from the cache or decoded and
+    /// cached.
+    fn cached_block_at(
+        &self,
+        offset:  u64,
+        header:  &BlockHeader,
+        fetched: Option<&mut [u8]>,
+        threads: usize,
+    ) -> io::Result<CachedBlock> {
+        if let Some(block) = self.cache.get(offset, &header.content_hash) {
+            return Ok(block);
+        }
+        let block = Arc::new(self.decode_owned_at(offset, header, fetched, threads)?);
+        self.cache.insert(offset, &header.content_hash, block.clone());
+        Ok(block)
+    }
+
+    /// Fill `dst` (exactly `orig_size`) with the block at `offset`: copied
+    /// from the cache on a hit, else decoded in place without caching.
+    fn decode_whole(
+        &self,
+        offset:  u64,
+        header:  &BlockHeader,
+        fetched: Option<&mut [u8]>,
+        threads: usize,
+        dst:     &mut [u8],
+    ) -> io::Result<()> {
+        if let Some(block) = self.cache.get(offset, &header.content_hash) {
+            dst.copy_from_slice(&block);
+            return Ok(());
+        }
+        self.decode_at(offset, header, fetched, threads, dst)
+    }
+
+    /// The archive dictionary, loaded through `&self` on first use.  Racing
+    /// loaders decode the same bytes; whichever is stored first wins.
+    fn shared_dictionary(&self) -> io::Result<Option<&Dictionary>> {
+        if let Some(d) = self.dictionary.get() {
+            return Ok(Some(d));
+        }
+        let Some(offset) = self.index.dict_offset else { return Ok(None) };
+        let (header, payload) = self.block_at(offset)?;
+        if header.block_type != BlockType::Dict {
+            return Err(io::Error::new(io::ErrorKind::InvalidData,
+                format!("Expected DICT block at offset {offset}, found {:?}", header.block_type)));
+        }
+        let bytes = decode_block(&header, &payload, self.decryption_key.as_ref())
+            .map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+        let _ = self.dictionary.set(Dictionary::new(bytes));
+        Ok(self.dictionary.get())
+    }
+
+    /// Range of each of `record`'s refs within its decoded block, reading
+    /// every distinct block header once.
+    fn piece_sizes(
+        &self,
+        record:  RecordView<'_>,
+        headers: &mut HashMap<u64, BlockHeader>,
+    ) -> io::Result<Vec<Range<usize>>> {
+        record.block_refs().map(|br| {
+            if !headers.contains_key(&br.archive_offset) {
+                headers.insert(br.archive_offset, self.header_at(br.archive_offset)?);
+            }
+            let orig = headers[&br.archive_offset].orig_size as usize;
+            if br.is_solid_slice() {
+                solid_slice_range(orig, &br)
+            } else {
+                Ok(0..orig)
+            }
+        }).collect()
+    }
+
+    /// Decode `jobs` on `self.threads` workers and deliver every piece,
+    /// reading ahead on `self.io_depth` I/O threads if it is set.  A single
+    /// job without read-ahead runs on the caller's thread, where its codec
+    /// may use every core; on a worker pool each block decodes on its
+    /// worker alone, so the pool does not multiply into `threads × cores`.
+    fn run_jobs<S: WriteAt + Sync>(&self, mut jobs: Vec<BlockJob>, sinks: &[&S]) -> io::Result<()> {
+        let _stats = stats::install(self.stats.as_ref());
+        jobs.sort_unstable_by_key(|job| job.offset);
+        let threads = self.threads.max(1).min(jobs.len().max(1));
+        if self.io_depth > 0 {
+            return self.run_jobs_read_ahead(jobs, sinks, threads);
+        }
+        if threads == 1 {
+            return jobs.into_iter().try_for_each(|job| self.run_job(job, None, 0, sinks));
+        }
+
+        let queue   = Mutex::new(jobs.into_iter());
+        let failed  = AtomicBool::new(false);
+        let error   = Mutex::new(None::<io::Error>);
+
+        std::thread::scope(|s| {
+            for _ in 0..threads {
+                s.spawn(|| {
+                    let _stats = stats::install(self.stats.as_ref());
+                    while !failed.load(Ordering::Relaxed) {
+                        let Some(job) = queue.lock().unwrap().next() else { break };
+                        if let Err(e) = self.run_job(job, None, 1, sinks) {
+                            failed.store(true, Ordering::Relaxed);
+                            error.lock().unwrap().get_or_insert(e);
+                        }
+                    }
+                });
+            }
+        });
+        error.into_inner().unwrap().map_or(Ok(()), Err)
+    }
+
+    /// [`run_jobs`](Self::run_jobs) as two stages: `io_depth` I/O threads
+    /// fetch payloads in archive order into a queue of `io_depth`, and
+    /// `threads` workers decode from it.  Fetched buffers are pooled.
+    fn run_jobs_read_ahead<S: WriteAt + Sync>(
+        &self,
+        jobs:    Vec<BlockJob>,
+        sinks:   &[&S],
+        threads: usize,
+    ) -> io::Result<()> {
+        let fetchers = self.io_depth.min(jobs.len().max(1));
+        let block_threads = if threads == 1 { 0 } else { 1 };
+        let queue    = Mutex::new(jobs.into_iter());
+        let pool     = BufferPool::new();
+        let failed   = AtomicBool::new(false);
+        let error    = Mutex::new(None::<io::Error>);
+        let fail = |e: io::Error| {
+            failed.store(true, Ordering::Relaxed);
+            error.lock().unwrap().get_or_insert(e);
+        };
+        let (ready_tx, ready_rx) = sync_channel::<(BlockJob, Option<Vec<u8>>)>(self.io_depth);
+        let ready_rx = Mutex::new(ready_rx);
+
+        std::thread::scope(|s| {
+            for _ in 0..fetchers {
+                let ready = ready_tx.clone();
+                let (queue, pool, failed, fail) = (&queue, &pool, &failed, &fail);
+                s.spawn(move || {
+                    let _stats = stats::install(self.stats.as_ref());
+                    while !failed.load(Ordering::Relaxed) {
+                        let Some(job) = queue.lock().unwrap().next() else { break };
+                        match self.fetch(&job, pool) {
+                            Ok(fetched) => if ready.send((job, fetched)).is_err() { break },
+                            Err(e)      => fail(e),
+                        }
+                    }
+                });
+            }
+            // The queue closes when the last fetcher is done.
+            drop(ready_tx);
+
+            for _ in 0..threads {
+                s.spawn(|| {
+                    let _stats = stats::install(self.stats.as_ref());
+                    loop {
+                        let next = stats::timed(Stage::Stall, 0, || ready_rx.lock().unwrap().recv());
+                        let Ok((job, mut fetched)) = next else { break };
+                        // After a failure, keep draining so no fetcher blocks.
+                        if failed.load(Ordering::Relaxed) { continue; }
+                        if let Err(e) = self.run_job(job, fetched.as_deref_mut(), block_threads, sinks) {
+                            fail(e);
+                        }
+                        if let Some(buf) = fetched {
+                            pool.give(buf);
+                        }
+                    }
+                });
+            }
+        });
+        error.into_inner().unwrap().map_or(Ok(()), Err)
+    }
+
+    fn run_job<S: WriteAt + Sync>(
+        &self,
+        mut job: BlockJob,
+        fetched: Option<&mut [u8]>,
+        threads: usize,
+        sinks:   &[&S],
+    ) -> io::Result<()> {
+        // One whole-block destination in memory: decode straight into it.
+        if let [Piece { dest: Dest::Buf(dst), range }] = job.pieces.as_mut_slice() {
+            if *range == (0..job.header.orig_size as usize) {
+                return self.decode_whole(job.offset, &job.header, fetched, threads, dst);
+            }
+        }
+
+        // Only whole-block pieces (files extracted to sinks): decode into this
+        // thread's scratch buffer and leave the cache alone, as above.
+        let whole = 0..job.header.orig_size as usize;
+        if job.pieces.iter().all(|piece| piece.range == whole) {
+            return buffer::with_scratch(whole.len(), |block| {
+                self.decode_whole(job.offset, &job.header, fetched, threads, block)?;
+                deliver(job.pieces, block, sinks)
+            });
+        }
+
+        let block = self.cached_block_at(job.offset, &job.header, fetched, threads)?;
+        deliver(job.pieces, &block, sinks)
+    }
+}
+
+/// Copy or write each of `pieces` out of the decoded `block`.
+fn deliver<S: WriteAt>(pieces: Vec<Piece>, block: &[u8], sinks: &[&S]) -> io::Result<()> {
+    for piece in pieces {
+        let bytes = &block[piece.range];
+        match piece.dest {
+            Dest::Buf(dst)          => dst.copy_from_slice(bytes),
+            Dest::At { sink, pos }  => {
+                stats::timed(Stage::Write, bytes.len(), || sinks[sink].write_all_at(bytes, pos))?
+            }
+        }
+    }
+    Ok(())
+}
+
+fn push_piece<'a>(
+    jobs:    &mut Vec<BlockJob<'a>>,
+    slot:    &mut HashMap<u64, usize>,
+    headers: &HashMap<u64, BlockHeader>,
+    br:      &BlockRef,
+    piece:   Piece<'a>,
+) {
+    let i = *slot.entry(br.archive_offset).or_insert_with(|| {
+        jobs.push(BlockJob {
+            offset: br.archive_offset,
+            header: headers[&br.archive_offset].clone(),
+            pieces: Vec::new(),
+        });
+        jobs.len() - 1
+    });
+    jobs[i].pieces.push(piece);
+}
+
+/// Fault in every page of `bytes` from this thread, one read per page.
+fn touch_pages(bytes: &[u8]) {
+    const PAGE: usize = 4096;
+    let mut acc = bytes.last().copied().unwrap_or(0);
+    for i in (0..bytes.len()).step_by(PAGE) {
+        acc ^= bytes[i];
+    }
+    std::hint::black_box(acc);
+}
+
+fn check_total(sizes: &[Range<usize>], expected: usize, file_id: u32) -> io::Result<()> {
+    let total: usize = sizes.iter().map(|r| r.len()).sum();
+    if total != expected {
+        return Err(io::Error::new(io::ErrorKind::InvalidData, format!(
+            "File {file_id} decodes to {total} B, index records {expected} B")));
+    }
+    Ok(())
+}
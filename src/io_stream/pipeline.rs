@@ -0,0 +1,381 @@
+//! Pipelined chunk ingestion for [`SixCyWriter`].
+//!
+//! # Stages
+//! 1. **Feed** (caller thread) — pulls chunks from a [`ChunkSource`] and
+//!    hands them to the pool, keeping at most `2 × threads` chunks in flight
+//!    so memory stays bounded.
+//! 2. **Compress** (`threads` workers) — BLAKE3-hash the chunk, claim its
+//!    hash, and compress + encrypt it if this chunk owns the claim.
+//! 3. **Write** (caller thread) — consumes results strictly in sequence
+//!    order, assigns `archive_offset`, and fills in each file's `BlockRef`s.
+//!
+//! In-memory files are fed as borrowed slices.  A [`ReaderSource`] reads
+//! each chunk into a buffer that the write stage returns to a spare pool,
+//! so streaming a file allocates only as many buffers as the window holds.
+//! Compressed payloads travel the same way: workers encode into buffers
+//! from a [`BufferPool`] that the write stage refills once each block is
+//! on disk.
+//!
+//! # Exact deduplication
+//! Every hash is owned by the lowest sequence number that carries it.  A
+//! worker that hashes chunk `i` records `min(i, current)` in the claim map
+//! and compresses only when it ends up the owner.  When chunk `i` reaches
+//! the write stage, every chunk before it has already been hashed, so the
+//! owner is final: either `i` itself (its block is written) or an earlier
+//! chunk whose block is already on disk (`i` becomes a CAS reference).  A
+//! worker that lost its claim after compressing merely wastes that work; it
+//! never produces a second block.  The archive is byte-for-byte what the
+//! sequential writer would produce.
+//!
+//! The write stage records each new block straight in the writer's CAS
+//! table, which the workers read behind an `RwLock`, and drops the hash's
+//! claim.  The claim map therefore holds only the hashes in flight, and a
+//! call that stores millions of new chunks adds nothing outside the
+//! bounded [`DedupTable`](super::DedupTable).
+
+use std::collections::{BTreeMap, HashMap};
+use std::io::{self, Read, Seek, Write};
+use std::ops::Deref;
+use std::panic::{self, AssertUnwindSafe};
+use std::sync::{mpsc, Mutex, RwLock};
+
+use chrono::Utc;
+
+use super::{block_codec, new_record, Chunking, SixCyWriter};
+use crate::block::{content_hash, encode_block_into, BlockHeader, BlockType, BLOCK_HEADER_SIZE};
+use crate::buffer::BufferPool;
+use crate::codec::{CodecError, CodecId};
+use crate::index::{BlockRef, FileIndexRecord};
+use crate::recovery::RecoveryCheckpoint;
+use crate::stats::{self, Stage};
+
+/// Chunk bytes: borrowed from an in-memory file, or read into a buffer
+/// that goes back to the spare pool once written.
+pub(super) enum Chunk<'a> {
+    Slice(&'a [u8]),
+    Owned(Vec<u8>),
+}
+
+impl Chunk<'_> {
+    /// Return an owned buffer to `spare` for the next read.
+    pub(super) fn recycle(self, spare: &mut Vec<Vec<u8>>) {
+        if let Chunk::Owned(buf) = self {
+            spare.push(buf);
+        }
+    }
+}
+
+impl Deref for Chunk<'_> {
+    type Target = [u8];
+    fn deref(&self) -> &[u8] {
+        match self {
+            Chunk::Slice(s) => s,
+            Chunk::Owned(v) => v,
+        }
+    }
+}
+
+/// One chunk of one file of the current call.
+pub(super) struct Job<'a> {
+    /// Position of the file among the call's files.
+    pub(super) file:        usize,
+    pub(super) file_offset: u64,
+    pub(super) chunk:       Chunk<'a>,
+}
+
+/// The chunks of one ingestion call, in file order.
+pub(super) trait ChunkSource<'a> {
+    /// The next chunk, or `None` when every file is exhausted.  Sources that
+    /// read take their buffer from `spare` when one is available.
+    fn next_chunk(&mut self, spare: &mut Vec<Vec<u8>>) -> io::Result<Option<Job<'a>>>;
+}
+
+/// Files already in memory, chunked in place.
+struct SliceSource<'a> {
+    files:      &'a [(String, &'a [u8])],
+    chunking:   Chunking,
+    chunk_size: usize,
+    file:       usize,
+    pos:        usize,
+}
+
+impl<'a> ChunkSource<'a> for SliceSource<'a> {
+    fn next_chunk(&mut self, _: &mut Vec<Vec<u8>>) -> io::Result<Option<Job<'a>>> {
+        let files = self.files;
+        while let Some(&(_, data)) = files.get(self.file) {
+            if self.pos < data.len() {
+                let start = self.pos;
+                self.pos += self.chunking.cut(&data[start..], self.chunk_size);
+                return Ok(Some(Job {
+                    file:        self.file,
+                    file_offset: start as u64,
+                    chunk:       Chunk::Slice(&data[start..self.pos]),
+                }));
+            }
+            self.file += 1;
+            self.pos = 0;
+        }
+        Ok(None)
+    }
+}
+
+/// One file streamed from a reader.
+///
+/// Each chunk is read into a spare buffer holding up to the longest chunk
+/// `chunking` allows.  Bytes past the cut (content-defined chunking only)
+/// are carried into the next chunk.
+pub(super) struct ReaderSource<R> {
+    reader:      R,
+    chunking:    Chunking,
+    chunk_size:  usize,
+    carry:       Vec<u8>,
+    file_offset: u64,
+}
+
+impl<R: Read> ReaderSource<R> {
+    pub(super) fn new(reader: R, chunking: Chunking, chunk_size: usize) -> Self {
+        Self { reader, chunking, chunk_size, carry: Vec::new(), file_offset: 0 }
+    }
+}
+
+impl<'a, R: Read> ChunkSource<'a> for ReaderSource<R> {
+    fn next_chunk(&mut self, spare: &mut Vec<Vec<u8>>) -> io::Result<Option<Job<'a>>> {
+        let max = self.chunking.max_len(self.chunk_size);
+        let mut buf = spare.pop().unwrap_or_default();
+        buf.clear();
+        buf.append(&mut self.carry);
+        let want = (max - buf.len()) as u64;
+        stats::timed_counted(Stage::Read, || {
+            let read = (&mut self.reader).take(want).read_to_end(&mut buf);
+            let n = *read.as_ref().unwrap_or(&0);
+            (read, n)
+        })?;
+        if buf.is_empty() {
+            spare.push(buf);
+            return Ok(None);
+        }
+
+        let cut = self.chunking.cut(&buf, self.chunk_size);
+        self.carry.extend_from_slice(&buf[cut..]);
+        buf.truncate(cut);
+        let file_offset = self.file_offset;
+        self.file_offset += cut as u64;
+        Ok(Some(Job { file: 0, file_offset, chunk: Chunk::Owned(buf) }))
+    }
+}
+
+/// Output of the compress stage for one chunk.
+enum ChunkOut {
+    /// This chunk owns its hash: an encoded block ready to write, its
+    /// payload in a buffer from the call's [`BufferPool`].
+    Block { hash: [u8; 32], header: BlockHeader, payload: Vec<u8> },
+    /// The content is stored by an earlier chunk or a previous call.
+    Dup { hash: [u8; 32] },
+}
+
+impl<W: Write + Seek> SixCyWriter<W> {
+    /// Chunk in-memory `files` and push them through the worker pool.
+    pub(super) fn add_files_pipelined(
+        &mut self,
+        files: &[(String, &[u8])],
+        codec: CodecId,
+    ) -> io::Result<()> {
+        let source = SliceSource {
+            files,
+            chunking:   self.chunking,
+            chunk_size: self.chunk_size,
+            file:       0,
+            pos:        0,
+        };
+        let names = files.iter().map(|(name, _)| name.clone()).collect();
+        self.add_source_pipelined(source, names, codec)
+    }
+
+    /// Push every chunk of `source` through the worker pool; see the module
+    /// docs.  One record per entry of `names` is appended, in order and
+    /// with consecutive IDs; sizes are counted from the chunks.
+    pub(super) fn add_source_pipelined<'a>(
+        &mut self,
+        mut source: impl ChunkSource<'a>,
+        names:      Vec<String>,
+        codec:      CodecId,
+    ) -> io::Result<()> {
+        self.superblock.add_required_codec(codec);
+
+        let threads = self.threads.max(1);
+        let window  = threads * 2;
+        let base_id = self.index.records.len() as u32;
+
+        let mut records: Vec<FileIndexRecord> = names.into_iter().enumerate()
+            .map(|(f, name)| new_record(base_id + f as u32, name))
+            .collect();
+
+        let Self {
+            writer, superblock, block_dedup, recovery_map, dictionary, block_table,
+            encryption_key, compression_level, block_threads, adaptive, stats: run_stats, ..
+        } = self;
+        let known  = RwLock::new(block_dedup);
+        let dict   = dictionary.as_ref();
+        let key    = encryption_key.as_ref();
+        let level  = *compression_level;
+        let block_threads = *block_threads;
+        let adaptive = *adaptive;
+        let claims = Mutex::new(HashMap::<[u8; 32], usize>::new());
+        let payloads = BufferPool::new();
+
+        type Done<'a> = (usize, Job<'a>, Result<ChunkOut, CodecError>);
+        let (job_tx, job_rx) = mpsc::channel::<(usize, Job<'a>)>();
+        let (res_tx, res_rx) = mpsc::channel::<Done<'a>>();
+        let job_rx = Mutex::new(job_rx);
+
+        std::thread::scope(|s| -> io::Result<()> {
+            // Owned by the closure: dropping them on return (including early
+            // error returns) releases the workers before the scope joins.
+            let (job_tx, res_rx) = (job_tx, res_rx);
+
+            for _ in 0..threads {
+                let (job_rx, res_tx, known, claims, payloads) = (&job_rx, res_tx.clone(), &known, &claims, &payloads);
+                let run_stats = run_stats.clone();
+                s.spawn(move || {
+                    let _stats = stats::install(run_stats.as_ref());
+                    loop {
+                        let (seq, job) = match job_rx.lock().unwrap().recv() {
+                            Ok(job) => job,
+                            Err(_)  => break,
+                        };
+                        // The workers already hash in parallel, so this is the
+                        // single-threaded hash; it doubles as `content_hash`.
+                        let hash = content_hash(&job.chunk);
+
+                        // A failed lookup makes this worker an owner; the write
+                        // stage repeats the lookup and reports the error.
+                        let stored = known.read().unwrap().contains(&hash).unwrap_or(false);
+                        let owner = !stored && {
+                            let mut m = claims.lock().unwrap();
+                            let e = m.entry(hash).or_insert(seq);
+                            *e = (*e).min(seq);
+                            *e == seq
+                        };
+                        let out = if owner {
+                            let mut payload = payloads.take();
+                            let codec = block_codec(adaptive, &job.chunk, codec);
+                            // A panicking codec must still answer for `seq`, or
+                            // the write stage would wait on it forever.
+                            panic::catch_unwind(AssertUnwindSafe(|| encode_block_into(
+                                BlockType::Data, base_id + job.file as u32, job.file_offset, &job.chunk,
+                                hash, codec, level, block_threads, key, dict, &mut payload,
+                            )))
+                            .unwrap_or_else(|_| Err(CodecError::Compression("codec panicked".into())))
+                            .map(|header| ChunkOut::Block { hash, header, payload })
+                        } else {
+                            Ok(ChunkOut::Dup { hash })
+                        };
+                        if res_tx.send((seq, job, out)).is_err() {
+                            break;
+                        }
+                    }
+                });
+            }
+            drop(res_tx);
+
+            let mut pending    = BTreeMap::new();
+            let mut spare      = Vec::new();
+            let mut exhausted  = false;
+            let mut next_send  = 0usize;
+            let mut next_write = 0usize;
+            let mut next_file  = 0usize;
+
+            // Checkpoint every file before `until` (including empty ones).
+            let mut finish_files = |until: usize, writer: &mut W| -> io::Result<()> {
+                while next_file < until {
+                    recovery_map.checkpoints.push(RecoveryCheckpoint {
+                        archive_offset: writer.stream_position()?,
+                        last_file_id:   base_id + next_file as u32,
+                        timestamp:      Utc::now().timestamp(),
+                    });
+                    next_file += 1;
+                }
+                Ok(())
+            };
+
+            loop {
+                while !exhausted && next_send - next_write < window {
+                    match source.next_chunk(&mut spare)? {
+                        Some(job) => {
+                            job_tx.send((next_send, job)).map_err(|_| worker_gone())?;
+                            next_send += 1;
+                        }
+                        None => exhausted = true,
+                    }
+                }
+                if next_write == next_send {
+                    break;
+                }
+
+                let (job, out) = match pending.remove(&next_write) {
+                    Some(done) => done,
+                    None => {
+                        let (seq, job, out) = stats::timed(Stage::Stall, 0, || res_rx.recv()).map_err(|_| worker_gone())?;
+                        pending.insert(seq, (job, out));
+                        continue;
+                    }
+                };
+                let out = out.map_err(|e| io::Error::new(io::ErrorKind::Other, e))?;
+                finish_files(job.file, &mut *writer)?;
+
+                let hash = match &out { ChunkOut::Block { hash, .. } | ChunkOut::Dup { hash } => *hash };
+                let stored = known.read().unwrap().get(&hash)?;
+                stats::dedup(stored.is_some());
+                let (archive_offset, comp_len) = match stored {
+                    // Stored already; a losing claimant's payload is unused.
+                    Some(hit) => {
+                        if let ChunkOut::Block { payload, .. } = out {
+                            payloads.give(payload);
+                        }
+                        hit
+                    }
+                    None => match out {
+                        ChunkOut::Block { header, payload, .. } => {
+                            let archive_offset = writer.stream_position()?;
+                            stats::timed(Stage::Write, BLOCK_HEADER_SIZE + payload.len(), || {
+                                header.write(&mut *writer)?;
+                                writer.write_all(&payload)
+                            })?;
+                            block_table.push(archive_offset, &header);
+                            superblock.add_block_codec(&header);
+                            let hit = (archive_offset, payload.len() as u64);
+                            known.write().unwrap().insert(hash, hit)?;
+                            payloads.give(payload);
+                            hit
+                        }
+                        ChunkOut::Dup { .. } => return Err(io::Error::new(io::ErrorKind::Other,
+                            "pipelined writer: duplicate chunk has no stored owner")),
+                    },
+                };
+                // Later chunks with this hash now find it in the table.
+                claims.lock().unwrap().remove(&hash);
+
+                let rec = &mut records[job.file];
+                rec.original_size   += job.chunk.len() as u64;
+                rec.compressed_size += comp_len;
+                rec.block_refs.push(BlockRef {
+                    content_hash: hash,
+                    archive_offset,
+                    intra_offset: 0,
+                    intra_length: 0,
+                    file_offset:  job.file_offset,
+                });
+                job.chunk.recycle(&mut spare);
+                next_write += 1;
+            }
+            finish_files(records.len(), &mut *writer)
+        })?;
+
+        self.index.records.extend(records);
+        Ok(())
+    }
+}
+
+fn worker_gone() -> io::Error {
+    io::Error::new(io::ErrorKind::Other, "pipelined writer: compressor worker exited")
+}
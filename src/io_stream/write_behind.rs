@@ -0,0 +1,251 @@
+//! Write-behind output for the archive writer.
+//!
+//! [`SixCyWriter`](super::SixCyWriter) writes each block as an 84-byte
+//! header followed by its payload.  On a plain `File`, every one of those
+//! writes is a blocking syscall on the thread that also compresses (or, in
+//! the pipeline, collects) the next block.  On network filesystems, each
+//! one is a round trip.  [`WriteBehind`] moves all of that onto
+//! a dedicated I/O thread:
+//!
+//! - writes are gathered into buffers of [`WRITE_BEHIND_BUFFER`] bytes, and
+//!   each full buffer is handed to the I/O thread;
+//! - at most `depth` buffers are queued, so a slow device backs up into the
+//!   writer instead of into memory.  Written buffers come back through a
+//!   [`BufferPool`] and are refilled, so the same `depth + 2` buffers carry
+//!   the whole archive;
+//! - the position is tracked locally, so `stream_position` (called for
+//!   every block) is not a syscall.  Seeks are queued in order with the writes.
+//!
+//! An I/O error stops the thread.  It is returned by the next `write`,
+//! `seek` or `flush`, or by [`into_inner`](WriteBehind::into_inner); until
+//! then the data written is not known to be on disk.  Dropping without
+//! flushing still writes everything queued but discards any error.
+
+use std::io::{self, Seek, SeekFrom, Write};
+use std::sync::mpsc::{sync_channel, SyncSender, TrySendError};
+use std::sync::Arc;
+use std::thread::JoinHandle;
+
+use crate::buffer::BufferPool;
+use crate::stats::{self, Stage};
+
+/// Bytes gathered before a buffer is handed to the I/O thread: 1 MiB.
+pub const WRITE_BEHIND_BUFFER: usize = 1024 * 1024;
+
+/// Default number of full buffers queued behind the writer.
+pub const DEFAULT_WRITE_DEPTH: usize = 4;
+
+enum Op {
+    Write(Vec<u8>),
+    Seek(u64),
+    /// Flush the inner writer, then signal.
+    Flush(SyncSender<()>),
+}
+
+/// A `Write + Seek` adapter that performs the writes on its own thread;
+/// see the module docs.
+pub struct WriteBehind<W: Write + Seek + Send + 'static> {
+    ops:    Option<SyncSender<Op>>,
+    thread: Option<JoinHandle<io::Result<W>>>,
+    pool:   Arc<BufferPool>,
+    buf:    Vec<u8>,
+    /// Logical position and end, as they will be once the queue drains.
+    pos:    u64,
+    end:    u64,
+}
+
+impl<W: Write + Seek + Send + 'static> WriteBehind<W> {
+    /// Write `inner` from a background thread, with up to `depth` full
+    /// buffers queued (at least one).  Writing starts at `inner`'s current
+    /// position.
+    pub fn new(mut inner: W, depth: usize) -> io::Result<Self> {
+        let pos  = inner.stream_position()?;
+        let end  = inner.seek(SeekFrom::End(0))?;
+        inner.seek(SeekFrom::Start(pos))?;
+
+        let (ops, queue) = sync_channel::<Op>(depth.max(1));
+        let pool = Arc::new(BufferPool::new());
+        let recycle = pool.clone();
+        let thread = std::thread::Builder::new()
+            .name("6cy-write-behind".into())
+            .spawn(move || {
+                for op in queue {
+                    match op {
+                        Op::Write(buf) => {
+                            inner.write_all(&buf)?;
+                            recycle.give(buf);
+                        }
+                        Op::Seek(to)    => { inner.seek(SeekFrom::Start(to))?; }
+                        Op::Flush(done) => {
+                            inner.flush()?;
+                            let _ = done.send(());
+                        }
+                    }
+                }
+                inner.flush()?;
+                Ok(inner)
+            })?;
+
+        Ok(Self {
+            ops: Some(ops),
+            thread: Some(thread),
+            buf: Vec::with_capacity(WRITE_BEHIND_BUFFER),
+            pool, pos, end,
+        })
+    }
+
+    /// Write out everything queued and return the inner writer, or the
+    /// first error the I/O thread hit.
+    pub fn into_inner(mut self) -> io::Result<W> {
+        self.finish()
+    }
+
+    /// Queue the gathered bytes, taking an empty buffer in their place.
+    fn submit(&mut self) -> io::Result<()> {
+        if self.buf.is_empty() {
+            return Ok(());
+        }
+        let mut next = self.pool.take();
+        next.reserve(WRITE_BEHIND_BUFFER);
+        let full = std::mem::replace(&mut self.buf, next);
+        self.send(Op::Write(full))
+    }
+
+    fn send(&mut self, op: Op) -> io::Result<()> {
+        // A full queue means the disk is behind: the wait is a stall.
+        let sent = self.ops.as_ref().is_some_and(|ops| match ops.try_send(op) {
+            Ok(())                      => true,
+            Err(TrySendError::Full(op)) => stats::timed(Stage::Stall, 0, || ops.send(op).is_ok()),
+            Err(TrySendError::Disconnected(_)) => false,
+        });
+        if sent { Ok(()) } else { Err(self.fail()) }
+    }
+
+    /// The I/O thread has stopped: collect the error it stopped on.  Later
+    /// calls get a generic error.
+    fn fail(&mut self) -> io::Error {
+        self.ops = None;
+        match self.thread.take().map(JoinHandle::join) {
+            Some(Ok(Err(e))) => e,
+            Some(Err(_))     => io::Error::new(io::ErrorKind::Other, "write-behind thread panicked"),
+            _ => io::Error::new(io::ErrorKind::Other, "write-behind writer failed earlier"),
+        }
+    }
+
+    fn finish(&mut self) -> io::Result<W> {
+        self.submit()?;
+        self.ops = None;
+        match self.thread.take().map(JoinHandle::join) {
+            Some(Ok(result)) => result,
+            Some(Err(_)) => Err(io::Error::new(io::ErrorKind::Other, "write-behind thread panicked")),
+            None => Err(io::Error::new(io::ErrorKind::Other, "write-behind writer failed earlier")),
+        }
+    }
+}
+
+impl<W: Write + Seek + Send + 'static> Write for WriteBehind<W> {
+    fn write(&mut self, data: &[u8]) -> io::Result<usize> {
+        let n = data.len().min(WRITE_BEHIND_BUFFER - self.buf.len());
+        self.buf.extend_from_slice(&data[..n]);
+        self.pos += n as u64;
+        self.end  = self.end.max(self.pos);
+        if self.buf.len() == WRITE_BEHIND_BUFFER {
+            self.submit()?;
+        }
+        Ok(n)
+    }
+
+    /// Wait until everything written so far has reached the inner writer
+    /// and it has been flushed.
+    fn flush(&mut self) -> io::Result<()> {
+        self.submit()?;
+        let (done, flushed) = sync_channel(1);
+        self.send(Op::Flush(done))?;
+        flushed.recv().map_err(|_| self.fail())
+    }
+}
+
+impl<W: Write + Seek + Send + 'static> Seek for WriteBehind<W> {
+    fn seek(&mut self, from: SeekFrom) -> io::Result<u64> {
+        let to = match from {
+            SeekFrom::Start(n)   => Some(n),
+            SeekFrom::Current(d) => self.pos.checked_add_signed(d),
+            SeekFrom::End(d)     => self.end.checked_add_signed(d),
+        }.ok_or_else(|| io::Error::new(io::ErrorKind::InvalidInput,
+            "seek to a negative or overflowing position"))?;
+        if to != self.pos {
+            self.submit()?;
+            self.send(Op::Seek(to))?;
+            self.pos = to;
+        }
+        Ok(to)
+    }
+
+    fn stream_position(&mut self) -> io::Result<u64> {
+        Ok(self.pos)
+    }
+}
+
+impl<W: Write + Seek + Send + 'static> Drop for WriteBehind<W> {
+    fn drop(&mut self) {
+        if self.thread.is_some() {
+            let _ = self.finish();
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::Cursor;
+
+    #[test]
+    fn matches_direct_writes_across_buffers_and_seeks() {
+        let mut direct = Cursor::new(Vec::new());
+        let mut behind = WriteBehind::new(Cursor::new(Vec::new()), 2).unwrap();
+        let big: Vec<u8> = (0..3 * WRITE_BEHIND_BUFFER + 17).map(|i| i as u8).collect();
+        let targets: [&mut dyn WriteSeek; 2] = [&mut direct, &mut behind];
+        for w in targets {
+            w.write_all(&[0u8; 64]).unwrap();
+            w.write_all(&big).unwrap();
+            assert_eq!(w.stream_position().unwrap(), 64 + big.len() as u64);
+            w.seek(SeekFrom::Start(8)).unwrap();
+            w.write_all(b"patched").unwrap();
+            w.seek(SeekFrom::End(0)).unwrap();
+            w.write_all(b"tail").unwrap();
+        }
+        behind.flush().unwrap();
+        assert_eq!(behind.into_inner().unwrap().into_inner(), direct.into_inner());
+    }
+
+    trait WriteSeek: Write + Seek {}
+    impl<T: Write + Seek> WriteSeek for T {}
+
+    /// Fails every write once `limit` bytes have gone through.
+    struct Full { written: usize, limit: usize }
+
+    impl Write for Full {
+        fn write(&mut self, data: &[u8]) -> io::Result<usize> {
+            if self.written + data.len() > self.limit {
+                return Err(io::Error::new(io::ErrorKind::Other, "device full"));
+            }
+            self.written += data.len();
+            Ok(data.len())
+        }
+        fn flush(&mut self) -> io::Result<()> { Ok(()) }
+    }
+
+    impl Seek for Full {
+        fn seek(&mut self, _: SeekFrom) -> io::Result<u64> { Ok(self.written as u64) }
+    }
+
+    #[test]
+    fn io_errors_surface_on_flush() {
+        let mut w = WriteBehind::new(Full { written: 0, limit: 100 }, 1).unwrap();
+        // Queued, so this succeeds; the device fails behind it.
+        w.write_all(&[1u8; 4096]).unwrap();
+        let err = w.flush().unwrap_err();
+        assert_eq!(err.to_string(), "device full");
+        assert!(w.write_all(&[0u8; WRITE_BEHIND_BUFFER]).is_err());
+    }
+}
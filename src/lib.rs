@@ -9,12 +9,16 @@
 //!   immediately if any UUID is unavailable — no partial decode, no fallback
 //! - The INDEX block is at the end; the full block list is reconstructible by
 //!   scanning forward from `SUPERBLOCK_SIZE` without the INDEX
-//! - The plugin C ABI (`plugin.rs`) is stable at `SIXCY_PLUGIN_ABI_VERSION=1`
+//! - The plugin C ABI (`plugin.rs`) is stable at `SIXCY_PLUGIN_ABI_VERSION=3`
+//!   (v1 and v2 plugins remain loadable); plugins are loaded from
+//!   `SIXCY_PLUGIN_PATH` into `codec::registry`
 
 pub mod superblock;
 pub mod codec;
 pub mod crypto;
 pub mod block;
+pub mod buffer;
+pub mod stats;
 pub mod index;
 pub mod recovery;
 pub mod io_stream;
@@ -24,11 +28,13 @@ pub mod perf;
 
 // Flat re-exports for the most common types.
 pub use superblock::Superblock;
-pub use codec::{CodecId, get_codec, get_codec_by_uuid, CodecError};
+pub use codec::{CodecId, Dictionary, get_codec, get_codec_by_uuid, CodecError};
 pub use block::{BlockHeader, BlockType, encode_block, decode_block,
+                encode_block_with_dict, encode_block_into, decode_block_with_dict, decode_block_into,
+                decode_block_in_place, decode_block_owned, decode_block_in_place_owned,
                 BLOCK_HEADER_SIZE, BLOCK_MAGIC};
-pub use index::{FileIndex, FileIndexRecord, BlockRef};
-pub use crypto::{derive_key, CryptoError};
+pub use index::{FileIndex, FileIndexRecord, BlockRef, IndexView, RecordView, IndexError};
+pub use crypto::{derive_key, CryptoError, KeyCache};
 pub use archive::{Archive, PackOptions, FileInfo};
 pub use plugin::{SixcyCodecPlugin, PluginCodec, SIXCY_PLUGIN_ABI_VERSION};
 pub use recovery::{RecoveryReport, RecoveryQuality, BlockHealth, scan_file};
@@ -1,8 +1,9 @@
 use clap::{Parser, Subcommand};
 use sixcy::archive::{Archive, PackOptions};
-use sixcy::codec::{CodecId, uuid_to_string};
-use sixcy::io_stream::DEFAULT_CHUNK_SIZE;
+use sixcy::codec::{CodecId, Dictionary, registry, uuid_to_string};
+use sixcy::io_stream::{default_threads, CdcParams, Chunking};
 use sixcy::perf;
+use std::io::Read;
 use std::path::PathBuf;
 
 #[derive(Parser)]
@@ -18,7 +19,7 @@ enum Commands {
     Pack {
         #[arg(short, long)]
         output: PathBuf,
-        /// Codec: zstd (default), lz4, brotli, lzma, none
+        /// Codec: zstd (default), lz4, brotli, lzma, lzma-mt, none, or a plugin codec UUID
         #[arg(short, long, default_value = "zstd")]
         codec: String,
         #[arg(short, long, default_value = "3")]
@@ -26,12 +27,48 @@ enum Commands {
         /// Maximum chunk size in KiB (default 4096 = 4 MiB)
         #[arg(long, default_value = "4096")]
         chunk_size: usize,
-        /// Combine all inputs into a single solid block
+        /// Content-defined chunking with this average chunk size in KiB
+        /// (chunks range from a quarter to four times it)
+        #[arg(long)]
+        cdc: Option<usize>,
+        /// Compress all inputs together in solid blocks
         #[arg(short, long)]
         solid: bool,
+        /// Decoded size of each solid block in KiB (default 16384 = 16 MiB)
+        #[arg(long, default_value = "16384")]
+        solid_block: usize,
+        /// Train a shared Zstd dictionary of this many KiB from the inputs
+        #[arg(long)]
+        dict_size: Option<usize>,
+        /// Compressor threads (0 = one per core, 1 = single-threaded)
+        #[arg(short = 'j', long, default_value = "0")]
+        threads: usize,
+        /// Threads each block may use inside its codec (zstd workers,
+        /// lzma-mt streams; 0 = one per core, 1 = off)
+        #[arg(long, default_value = "1")]
+        block_threads: usize,
+        /// Store chunks that sample as incompressible without compressing them
+        #[arg(long)]
+        adaptive: bool,
+        /// 1 MiB write buffers queued behind the compressor for the
+        /// archive's I/O thread
+        #[arg(long, default_value = "4")]
+        io_depth: usize,
+        /// Memory for the dedup table in MiB; past it, chunk hashes spill
+        /// to a temporary file
+        #[arg(long, default_value = "1024")]
+        dedup_memory: usize,
+        /// Add the inputs to an existing archive; chunks it already holds
+        /// are referenced instead of stored again
+        #[arg(long)]
+        append: bool,
         /// Encrypt with AES-256-GCM
         #[arg(short, long)]
         password: Option<String>,
+        /// Print time and throughput per pipeline stage, codec and dedup
+        /// counts after packing, as a table or JSON
+        #[arg(long, num_args = 0..=1, default_missing_value = "text", value_parser = ["text", "json"])]
+        stats: Option<String>,
         #[arg(short, long, required = true, num_args = 1..)]
         input: Vec<PathBuf>,
     },
@@ -42,6 +79,14 @@ enum Commands {
         output_dir: PathBuf,
         #[arg(short, long)]
         password: Option<String>,
+        /// I/O threads reading blocks ahead of the decoders (0 = off);
+        /// helps on high-latency storage such as NFS
+        #[arg(long, default_value = "0")]
+        io_depth: usize,
+        /// Print time and throughput per stage, codec and block cache
+        /// counts after unpacking, as a table or JSON
+        #[arg(long, num_args = 0..=1, default_missing_value = "text", value_parser = ["text", "json"])]
+        stats: Option<String>,
     },
     /// List archive contents
     List {
@@ -66,7 +111,7 @@ enum Commands {
         #[arg(long)]
         verbose: bool,
     },
-    /// Re-compress at maximum Zstd ratio
+    /// Re-compress at maximum Zstd ratio; blocks already there are copied
     Optimize {
         input:  PathBuf,
         #[arg(short, long)]
@@ -75,52 +120,113 @@ enum Commands {
         password: Option<String>,
         #[arg(short, long, default_value = "19")]
         level: i32,
+        /// Compressor threads for re-encoded files (0 = one per core)
+        #[arg(short = 'j', long, default_value = "0")]
+        threads: usize,
     },
-    /// Merge two or more archives into one (deduplication applied)
+    /// Merge two or more archives into one (deduplication applied).
+    /// DATA blocks are copied without recompression.
     Merge {
         #[arg(num_args = 2..)]
         inputs: Vec<PathBuf>,
         #[arg(short, long)]
         output: PathBuf,
+        /// Codec for files that must be re-encoded (solid, encrypted or
+        /// dictionary-compressed in their source)
         #[arg(short, long, default_value = "zstd")]
         codec: String,
+        /// Compressor threads for re-encoded files (0 = one per core)
+        #[arg(short = 'j', long, default_value = "0")]
+        threads: usize,
     },
     /// Run RLE pre-filter benchmark on a file and report savings
     Bench {
         input: PathBuf,
     },
+    /// List available codecs, including plugins loaded from SIXCY_PLUGIN_PATH
+    Plugins,
 }
 
 fn main() -> Result<(), Box<dyn std::error::Error>> {
     match Cli::parse().command {
 
         // ── Pack ─────────────────────────────────────────────────────────────
-        Commands::Pack { output, input, codec, level, chunk_size, solid, password } => {
+        Commands::Pack {
+            output, input, codec, level, chunk_size, cdc, solid, solid_block, dict_size, threads,
+            block_threads, adaptive, io_depth, dedup_memory, append, password, stats,
+        } => {
             let codec_id = parse_codec(&codec);
+            if solid && solid_block < chunk_size {
+                return Err(format!(
+                    "--solid-block {solid_block} KiB is smaller than the {chunk_size} KiB chunk size").into());
+            }
+            let dictionary = match dict_size {
+                Some(kib) => Some(train_dictionary(&input, kib * 1024)?),
+                None      => None,
+            };
             let opts = PackOptions {
                 default_codec: codec_id,
                 level,
                 chunk_size: chunk_size * 1024,
+                chunking: match cdc {
+                    Some(kib) => Chunking::ContentDefined(CdcParams::with_avg(kib * 1024)),
+                    None      => Chunking::Fixed,
+                },
+                solid_block_size: solid_block * 1024,
                 password,
+                dictionary,
+                threads: if threads == 0 { default_threads() } else { threads },
+                block_threads: if block_threads == 0 { default_threads() } else { block_threads },
+                adaptive,
+                io_depth,
+                dedup_memory: dedup_memory * 1024 * 1024,
             };
-            let mut ar = Archive::create(&output, opts)?;
+            let before = if append { std::fs::metadata(&output)?.len() } else { 0 };
+            let mut ar = if append { Archive::append(&output, opts)? } else { Archive::create(&output, opts)? };
+            if stats.is_some() { ar.enable_stats(); }
             if solid { ar.begin_solid(codec_id)?; }
+            // Read small inputs in batches so they share the compressor pool;
+            // stream large ones so they are never resident whole.
+            let mut batch: Vec<(&PathBuf, String, Vec<u8>)> = Vec::new();
+            let mut batch_bytes = 0usize;
             for path in &input {
+                let name = path.file_name().unwrap().to_string_lossy().into_owned();
+                let size = std::fs::metadata(path)?.len();
+                if size >= PACK_STREAM_BYTES {
+                    pack_batch(&mut ar, &mut batch)?;
+                    batch_bytes = 0;
+                    ar.add_reader(&name, std::io::BufReader::new(std::fs::File::open(path)?))?;
+                    println!("  packed  {} ({} B, streamed)", path.display(), size);
+                    continue;
+                }
                 let data = std::fs::read(path)?;
-                ar.add_file(path.file_name().unwrap().to_string_lossy().as_ref(), &data)?;
-                println!("  packed  {} ({} B)", path.display(), data.len());
+                batch_bytes += data.len();
+                batch.push((path, name, data));
+                if batch_bytes >= PACK_BATCH_BYTES {
+                    pack_batch(&mut ar, &mut batch)?;
+                    batch_bytes = 0;
+                }
             }
+            pack_batch(&mut ar, &mut batch)?;
             if solid { ar.end_solid()?; }
             ar.finalize()?;
             let size = std::fs::metadata(&output)?.len();
-            println!("Created: {}  ({} B on disk)", output.display(), size);
+            if append {
+                println!("Appended: {}  ({} B on disk, {} B written)", output.display(), size, size - before);
+            } else {
+                println!("Created: {}  ({} B on disk)", output.display(), size);
+            }
+            print_stats(&ar, stats.as_deref());
         }
 
         // ── Unpack ───────────────────────────────────────────────────────────
-        Commands::Unpack { input, output_dir, password } => {
+        Commands::Unpack { input, output_dir, password, io_depth, stats } => {
             let mut ar = open_archive(&input, &password)?;
+            ar.set_io_depth(io_depth)?;
+            if stats.is_some() { ar.enable_stats(); }
             ar.extract_all(&output_dir)?;
             println!("Unpacked to: {}", output_dir.display());
+            print_stats(&ar, stats.as_deref());
         }
 
         // ── List ─────────────────────────────────────────────────────────────
@@ -155,9 +261,17 @@ fn main() -> Result<(), Box<dyn std::error::Error>> {
             println!("  Format version {}", sb.format_version);
             println!("  UUID           {}", sb.archive_uuid);
             println!("  Encrypted      {}", sb.flags & sixcy::superblock::SB_FLAG_ENCRYPTED != 0);
+            match sb.pack_level {
+                Some(l) => println!("  Pack level     {l}"),
+                None    => println!("  Pack level     mixed or unrecorded"),
+            }
             println!("  Index offset   {} B", sb.index_offset);
             println!("  Index size     {} B", sb.index_size);
             println!("  Files          {}", files.len());
+            match ar.block_table() {
+                Some(t) => println!("  Blocks         {} (block table at {} B)", t.len(), sb.block_table_offset),
+                None    => println!("  Blocks         no block table"),
+            }
             println!("  Root hash      {}", ar.root_hash_hex());
             println!("  Required codecs ({}):", sb.required_codec_uuids.len());
             for uuid_bytes in &sb.required_codec_uuids {
@@ -170,9 +284,7 @@ fn main() -> Result<(), Box<dyn std::error::Error>> {
 
         // ── Scan ─────────────────────────────────────────────────────────────
         Commands::Scan { input } => {
-            use sixcy::io_stream::SixCyReader;
-            let mut reader = SixCyReader::new(std::fs::File::open(&input)?)?;
-            let idx = reader.scan_blocks()?;
+            let idx = sixcy::recovery::scan_file(&input)?.index;
             println!("Scan recovered {} file(s) from block headers:", idx.records.len());
             for r in &idx.records {
                 println!("  id={:08x}  chunks={}  size={}  name={}",
@@ -242,51 +354,49 @@ fn main() -> Result<(), Box<dyn std::error::Error>> {
         }
 
         // ── Optimize ─────────────────────────────────────────────────────────
-        Commands::Optimize { input, output, password, level } => {
-            let mut src = open_archive(&input, &password)?;
-            let files: Vec<(String, Vec<u8>)> = src.list()
-                .into_iter()
-                .map(|info| (info.name.clone(), src.read_file_by_id(info.id).unwrap_or_default()))
-                .collect();
-
+        Commands::Optimize { input, output, password, level, threads } => {
+            let src = open_archive(&input, &password)?;
             let opts = PackOptions {
                 default_codec: CodecId::Zstd,
                 level,
-                chunk_size: DEFAULT_CHUNK_SIZE,
-                password: None,
+                threads: if threads == 0 { default_threads() } else { threads },
+                ..PackOptions::default()
             };
             let mut dst = Archive::create(&output, opts)?;
-            for (name, data) in &files {
-                dst.add_file(name, data)?;
-            }
+            // Block headers do not record a level; the source's pack level
+            // stands in for it.  Fill blocks need no level.  Everything else
+            // is recompressed in parallel.
+            let at_target = src.pack_level() == Some(level);
+            let stats = dst.copy_from(&src, str::to_owned, |h| match h.codec_id() {
+                Some(CodecId::Fill) => true,
+                Some(CodecId::Zstd) => at_target,
+                _                   => false,
+            })?;
             dst.finalize()?;
-            println!("Optimized ({} files) → {}", files.len(), output.display());
+            println!("Optimized ({} files, {} already at zstd-{level}) → {}",
+                stats.files_copied + stats.files_reencoded, stats.files_copied, output.display());
         }
 
         // ── Merge ─────────────────────────────────────────────────────────────
-        Commands::Merge { inputs, output, codec } => {
+        Commands::Merge { inputs, output, codec, threads } => {
             let codec_id = parse_codec(&codec);
             let opts = PackOptions {
                 default_codec: codec_id,
+                threads: if threads == 0 { default_threads() } else { threads },
                 ..PackOptions::default()
             };
             let mut dst = Archive::create(&output, opts)?;
 
             let mut total_files = 0usize;
             for path in &inputs {
-                let mut src = open_archive(path, &None)?;
-                for info in src.list() {
-                    let data = src.read_file_by_id(info.id)?;
-                    // Prefix with source archive name to avoid name collisions.
-                    let merged_name = format!(
-                        "{}/{}",
-                        path.file_stem().unwrap_or_default().to_string_lossy(),
-                        info.name,
-                    );
-                    dst.add_file(&merged_name, &data)?;
-                    total_files += 1;
-                }
-                println!("  merged  {} ({} files)", path.display(), src.list().len());
+                let src = open_archive(path, &None)?;
+                // Prefix with source archive name to avoid name collisions.
+                let stem  = path.file_stem().unwrap_or_default().to_string_lossy().into_owned();
+                let stats = dst.copy_from(&src, |name| format!("{stem}/{name}"), |_| true)?;
+                let files = stats.files_copied + stats.files_reencoded;
+                total_files += files;
+                println!("  merged  {} ({} files, {} blocks copied, {} re-encoded)",
+                    path.display(), files, stats.blocks_copied, stats.files_reencoded);
             }
             dst.finalize()?;
             println!("Merged {} file(s) → {}", total_files, output.display());
@@ -312,6 +422,25 @@ fn main() -> Result<(), Box<dyn std::error::Error>> {
             println!("  Decode time:  {} ms", dec_ms);
             println!("  Round-trip:   {}", if correct { "✓ correct" } else { "✗ MISMATCH" });
         }
+
+        // ── Plugins ───────────────────────────────────────────────────────────
+        Commands::Plugins => {
+            println!("── Codecs ───────────────────────────────────────────────");
+            for info in registry::codecs() {
+                let slot = match (info.short_id.0, &info.source) {
+                    (0, src) if *src != registry::CodecSource::BuiltIn => "-".to_string(),
+                    (n, _) => n.to_string(),
+                };
+                println!("  [{:>3}] {}", slot, registry::describe(&info));
+            }
+            let errors = registry::load_errors();
+            if !errors.is_empty() {
+                println!("── Failed to load ───────────────────────────────────────");
+                for (_, err) in errors {
+                    println!("  {err}");
+                }
+            }
+        }
     }
 
     Ok(())
@@ -319,6 +448,25 @@ fn main() -> Result<(), Box<dyn std::error::Error>> {
 
 // ── helpers ──────────────────────────────────────────────────────────────────
 
+/// Input bytes read before handing a batch to the writer.
+const PACK_BATCH_BYTES: usize = 256 * 1024 * 1024;
+/// Inputs at least this large are streamed with `add_reader` instead.
+const PACK_STREAM_BYTES: u64 = 64 * 1024 * 1024;
+
+/// Add and empty a batch of files read by `6cy pack`.
+fn pack_batch(ar: &mut Archive, batch: &mut Vec<(&PathBuf, String, Vec<u8>)>) -> std::io::Result<()> {
+    if batch.is_empty() {
+        return Ok(());
+    }
+    let files: Vec<(&str, &[u8])> = batch.iter().map(|(_, n, d)| (n.as_str(), d.as_slice())).collect();
+    ar.add_files(&files)?;
+    for (path, _, data) in batch.iter() {
+        println!("  packed  {} ({} B)", path.display(), data.len());
+    }
+    batch.clear();
+    Ok(())
+}
+
 fn open_archive(path: &PathBuf, password: &Option<String>) -> Result<Archive, Box<dyn std::error::Error>> {
     Ok(match password {
         Some(pwd) => Archive::open_encrypted(path, pwd)?,
@@ -326,6 +474,36 @@ fn open_archive(path: &PathBuf, password: &Option<String>) -> Result<Archive, Bo
     })
 }
 
+/// Print `--stats` in `format` ("text" or "json"), if it was given.
+fn print_stats(ar: &Archive, format: Option<&str>) {
+    let Some(report) = format.and(ar.stats()) else { return };
+    match format {
+        Some("json") => println!("{}", report.to_json()),
+        _            => print!("{report}"),
+    }
+}
+
+/// Train a dictionary from the pack inputs, split into 16 KiB samples.
+fn train_dictionary(inputs: &[PathBuf], max_size: usize) -> Result<Dictionary, Box<dyn std::error::Error>> {
+    const SAMPLE_SIZE: usize = 16 * 1024;
+    // zstd recommends ~100× the dictionary size of training input.
+    let budget = max_size.saturating_mul(100);
+    let mut samples: Vec<Vec<u8>> = Vec::new();
+    let mut total = 0usize;
+    'files: for path in inputs {
+        let mut data = Vec::new();
+        std::fs::File::open(path)?.take(budget.saturating_sub(total) as u64).read_to_end(&mut data)?;
+        for s in data.chunks(SAMPLE_SIZE) {
+            if total >= budget { break 'files; }
+            total += s.len();
+            samples.push(s.to_vec());
+        }
+    }
+    let dict = Dictionary::train(&samples, max_size)?;
+    println!("  trained {} B dictionary from {} sample(s)", dict.as_bytes().len(), samples.len());
+    Ok(dict)
+}
+
 fn parse_codec(s: &str) -> CodecId {
     CodecId::from_name(s).unwrap_or_else(|| {
         eprintln!("Unknown codec '{}', defaulting to zstd", s);
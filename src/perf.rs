@@ -52,6 +52,9 @@ pub fn compress_chunks_parallel(
     codec:   CodecId,
     level:   i32,
 ) -> Result<Vec<CompressedChunk>, CodecError> {
+    // Resolved once: the handle is `&'static` and shared by every task.
+    let c = get_codec(codec)?;
+
     // Rayon is an optional dependency; fall back to sequential if unavailable.
     #[cfg(feature = "parallel")]
     {
@@ -62,7 +65,6 @@ pub fn compress_chunks_parallel(
             .enumerate()
             .map(|(i, chunk)| {
                 let hash: [u8; 32] = blake3::hash(chunk).into();
-                let c = get_codec(codec)?;
                 let payload = c.compress(chunk, level)?;
                 Ok(CompressedChunk {
                     chunk_index:  i,
@@ -88,7 +90,6 @@ pub fn compress_chunks_parallel(
             .enumerate()
             .map(|(i, chunk)| {
                 let hash: [u8; 32] = blake3::hash(chunk).into();
-                let c = get_codec(codec)?;
                 let payload = c.compress(chunk, level)?;
                 Ok(CompressedChunk {
                     chunk_index:  i,
@@ -166,24 +167,18 @@ impl<W: Write> Write for WriteBuffer<W> {
 // ── Streaming decompression ───────────────────────────────────────────────────
 
 /// Decompress a block payload into a caller-supplied buffer, avoiding the
-/// intermediate `Vec<u8>` allocation in the common case where the caller
-/// knows the output size from `block_header.orig_size`.
-///
-/// Returns the number of bytes written to `out`.
+/// intermediate `Vec<u8>` when the caller knows the output size from
+/// `block_header.orig_size`.
 ///
-/// This is a thin wrapper that picks the right codec and calls its
-/// `decompress` method, then copies into `out` rather than returning a
-/// fresh Vec.  For large blocks this saves one allocation and one copy.
+/// Returns the number of bytes written to `out`.  The codec writes straight
+/// into `out` via [`Codec::decompress_into`](crate::codec::Codec::decompress_into);
+/// output larger than `out` is an error rather than being truncated.
 pub fn decompress_into(
     codec:   CodecId,
     payload: &[u8],
     out:     &mut [u8],
 ) -> Result<usize, CodecError> {
-    let codec_impl = get_codec(codec)?;
-    let decompressed = codec_impl.decompress(payload)?;
-    let n = decompressed.len().min(out.len());
-    out[..n].copy_from_slice(&decompressed[..n]);
-    Ok(n)
+    get_codec(codec)?.decompress_into(payload, out)
 }
 
 // ── Delta / run-length pre-filter ─────────────────────────────────────────────
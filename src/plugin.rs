@@ -8,6 +8,13 @@
 //!
 //! The returned pointer is **static** — the host never frees it.
 //!
+//! # Loading
+//! [`crate::codec::registry`] opens the libraries listed in
+//! `SIXCY_PLUGIN_PATH`, or passed to `registry::load_plugin`, resolves this
+//! symbol, and registers the descriptor under its UUID.  Registered plugin
+//! codecs are selected with [`CodecId::Plugin`] and decoded automatically
+//! whenever a block header names their UUID.
+//!
 //! # Stability contract
 //! - `SIXCY_PLUGIN_ABI_VERSION` is **monotonically increasing and never
 //!   decremented**.
@@ -18,18 +25,40 @@
 //!
 //! # Thread safety
 //! Both `compress` and `decompress` MUST be safe to call concurrently from
-//! multiple threads on different buffer pairs.  The plugin MUST NOT use any
-//! global mutable state.  No allocator is shared with the host; all memory is
-//! owned by the caller and passed via explicit length-annotated buffers.
+//! multiple threads on different buffer pairs, as must the `*_ctx` variants
+//! on distinct contexts.  The plugin MUST NOT use any global mutable state.
+//! No allocator is shared with the host; all memory is owned by the caller
+//! and passed via explicit length-annotated buffers.
 //!
 //! # Memory model
 //! The plugin never allocates or frees memory on behalf of the host.
 //! The host pre-allocates output buffers using the upper bound returned by
 //! `compress_bound`.  A plugin that needs scratch space must manage its own
 //! memory independently.
+//!
+//! # Codec contexts (ABI v2)
+//! A v2 plugin may export `ctx_create` / `ctx_destroy` / `compress_ctx` /
+//! `decompress_ctx`.  [`PluginCodec`] then keeps one [`SixcyCodecCtx`] per
+//! plugin per thread, created lazily on first use and destroyed when the
+//! thread exits, so encoder state survives across chunks.  A context is
+//! confined to its thread and is never used by two calls at once.
+//!
+//! # Dictionaries (ABI v3)
+//! A v3 plugin may export `dict_compress` / `dict_decompress`, which take the
+//! plaintext of the archive's DICT block alongside the usual buffers.
+
+use std::cell::RefCell;
+
+use crate::codec::{Codec, CodecError, CodecId, Dictionary};
 
 /// ABI version of this header.  Written into `SixcyCodecPlugin::abi_version`.
-pub const SIXCY_PLUGIN_ABI_VERSION: u32 = 1;
+pub const SIXCY_PLUGIN_ABI_VERSION: u32 = 3;
+
+/// First ABI version whose descriptor carries the codec-context fields.
+pub const SIXCY_PLUGIN_ABI_CTX: u32 = 2;
+
+/// First ABI version whose descriptor carries the dictionary fields.
+pub const SIXCY_PLUGIN_ABI_DICT: u32 = 3;
 
 /// Return codes from plugin compress/decompress functions.
 pub mod rc {
@@ -43,6 +72,15 @@ pub mod rc {
     pub const INTERNAL:     i32 = -3;
 }
 
+/// Opaque per-thread codec state owned by the plugin (ABI v2+).
+///
+/// The host never dereferences it; it only hands the pointer back to the
+/// plugin's `*_ctx` entry points and finally to `ctx_destroy`.
+#[repr(C)]
+pub struct SixcyCodecCtx {
+    _private: [u8; 0],
+}
+
 /// Frozen C ABI descriptor for a codec plugin.
 ///
 /// # Safety
@@ -109,16 +147,101 @@ pub struct SixcyCodecPlugin {
     /// MUST be a pure function: deterministic, no side effects, no I/O,
     /// no global state reads.  Safe to call from any thread at any time.
     pub compress_bound: Option<unsafe extern "C" fn(in_len: u32) -> u32>,
+
+    // ── ABI v2 ──────────────────────────────────────────────────────────────
+    // Read only when `abi_version >= SIXCY_PLUGIN_ABI_CTX`; a v1 descriptor
+    // ends before these fields.
+
+    /// Allocate a codec context for the calling thread.  Returns null if no
+    /// context can be created, in which case the stateless path is used.
+    pub ctx_create: Option<unsafe extern "C" fn() -> *mut SixcyCodecCtx>,
+
+    /// Release a context.  Called once, on the creating thread.
+    pub ctx_destroy: Option<unsafe extern "C" fn(ctx: *mut SixcyCodecCtx)>,
+
+    /// `compress` with reusable state.  Same buffer contract as `compress`.
+    pub compress_ctx: Option<unsafe extern "C" fn(
+        ctx:     *mut SixcyCodecCtx,
+        in_buf:  *const u8, in_len:  u32,
+        out_buf: *mut   u8, out_len: *mut u32,
+        level:   i32,
+    ) -> i32>,
+
+    /// `decompress` with reusable state.  Same buffer contract as `decompress`.
+    pub decompress_ctx: Option<unsafe extern "C" fn(
+        ctx:     *mut SixcyCodecCtx,
+        in_buf:  *const u8, in_len:  u32,
+        out_buf: *mut   u8, out_len: *mut u32,
+    ) -> i32>,
+
+    // ── ABI v3 ──────────────────────────────────────────────────────────────
+    // Read only when `abi_version >= SIXCY_PLUGIN_ABI_DICT`.
+
+    /// `compress` against a shared dictionary.
+    pub dict_compress: Option<unsafe extern "C" fn(
+        dict:    *const u8, dict_len: u32,
+        in_buf:  *const u8, in_len:   u32,
+        out_buf: *mut   u8, out_len:  *mut u32,
+        level:   i32,
+    ) -> i32>,
+
+    /// `decompress` of a payload produced by `dict_compress`.
+    pub dict_decompress: Option<unsafe extern "C" fn(
+        dict:    *const u8, dict_len: u32,
+        in_buf:  *const u8, in_len:   u32,
+        out_buf: *mut   u8, out_len:  *mut u32,
+    ) -> i32>,
 }
 
+/// Signature of the exported `sixcy_codec_register` entry point.
+pub type SixcyCodecRegisterFn = unsafe extern "C" fn() -> *const SixcyCodecPlugin;
+
 // Safety: the ABI contract declares all fn pointers reentrant.
 unsafe impl Send for SixcyCodecPlugin {}
 unsafe impl Sync for SixcyCodecPlugin {}
 
+/// The ABI v2 context entry points, present only when all four are set.
+#[derive(Clone, Copy)]
+struct CtxFns {
+    create:     unsafe extern "C" fn() -> *mut SixcyCodecCtx,
+    destroy:    unsafe extern "C" fn(*mut SixcyCodecCtx),
+    compress:   unsafe extern "C" fn(*mut SixcyCodecCtx, *const u8, u32, *mut u8, *mut u32, i32) -> i32,
+    decompress: unsafe extern "C" fn(*mut SixcyCodecCtx, *const u8, u32, *mut u8, *mut u32) -> i32,
+}
+
+/// The ABI v3 dictionary entry points, present only when both are set.
+#[derive(Clone, Copy)]
+struct DictFns {
+    compress:   unsafe extern "C" fn(*const u8, u32, *const u8, u32, *mut u8, *mut u32, i32) -> i32,
+    decompress: unsafe extern "C" fn(*const u8, u32, *const u8, u32, *mut u8, *mut u32) -> i32,
+}
+
+/// Contexts owned by the current thread: (descriptor address, ctx, destroy).
+/// A null ctx records that `ctx_create` failed, so it is not retried.
+struct ThreadCtxs(Vec<(usize, *mut SixcyCodecCtx, unsafe extern "C" fn(*mut SixcyCodecCtx))>);
+
+impl Drop for ThreadCtxs {
+    fn drop(&mut self) {
+        for (_, ctx, destroy) in self.0.drain(..) {
+            if !ctx.is_null() {
+                unsafe { destroy(ctx) };
+            }
+        }
+    }
+}
+
+thread_local! {
+    static THREAD_CTXS: RefCell<ThreadCtxs> = RefCell::new(ThreadCtxs(Vec::new()));
+}
+
 /// Safe Rust wrapper around a loaded [`SixcyCodecPlugin`].
 pub struct PluginCodec {
     /// Raw descriptor — lifetime must outlive this wrapper.
     desc: &'static SixcyCodecPlugin,
+    /// ABI v2 context functions, if the plugin provides them.
+    ctx_fns: Option<CtxFns>,
+    /// ABI v3 dictionary functions, if the plugin provides them.
+    dict_fns: Option<DictFns>,
 }
 
 impl PluginCodec {
@@ -134,41 +257,350 @@ impl PluginCodec {
                 desc.abi_version, SIXCY_PLUGIN_ABI_VERSION,
             ));
         }
-        Ok(Self { desc })
+        // v1 descriptors end at `compress_bound`; never read past it.
+        let ctx_fns = if desc.abi_version >= SIXCY_PLUGIN_ABI_CTX {
+            match (desc.ctx_create, desc.ctx_destroy, desc.compress_ctx, desc.decompress_ctx) {
+                (Some(create), Some(destroy), Some(compress), Some(decompress)) =>
+                    Some(CtxFns { create, destroy, compress, decompress }),
+                _ => None,
+            }
+        } else {
+            None
+        };
+        let dict_fns = if desc.abi_version >= SIXCY_PLUGIN_ABI_DICT {
+            match (desc.dict_compress, desc.dict_decompress) {
+                (Some(compress), Some(decompress)) => Some(DictFns { compress, decompress }),
+                _ => None,
+            }
+        } else {
+            None
+        };
+        Ok(Self { desc, ctx_fns, dict_fns })
     }
 
     pub fn uuid(&self) -> &[u8; 16] { &self.desc.uuid }
 
+    /// True if this plugin reuses per-thread codec contexts (ABI v2).
+    pub fn has_contexts(&self) -> bool { self.ctx_fns.is_some() }
+
+    /// True if this plugin can compress against a dictionary (ABI v3).
+    pub fn has_dict(&self) -> bool { self.dict_fns.is_some() }
+
+    /// Return the calling thread's context for this plugin, creating it on
+    /// first use.  `None` if the plugin has no context support or
+    /// `ctx_create` returned null.
+    fn thread_ctx(&self, fns: &CtxFns) -> Option<*mut SixcyCodecCtx> {
+        let key = self.desc as *const SixcyCodecPlugin as usize;
+        let ctx = THREAD_CTXS.with(|cell| {
+            let mut ctxs = cell.borrow_mut();
+            if let Some(&(_, ctx, _)) = ctxs.0.iter().find(|(k, _, _)| *k == key) {
+                return ctx;
+            }
+            let ctx = unsafe { (fns.create)() };
+            ctxs.0.push((key, ctx, fns.destroy));
+            ctx
+        });
+        if ctx.is_null() { None } else { Some(ctx) }
+    }
+
     pub fn compress(&self, data: &[u8], level: i32) -> Result<Vec<u8>, String> {
+        let mut out = Vec::new();
+        self.compress_into(data, level, &mut out)?;
+        Ok(out)
+    }
+
+    /// [`compress`](Self::compress), appending to `dst`.
+    pub fn compress_into(&self, data: &[u8], level: i32, dst: &mut Vec<u8>) -> Result<(), String> {
         let f = self.desc.compress.ok_or("Plugin missing compress fn")?;
+        let ctx = self.ctx_fns.as_ref().and_then(|fns| Some((fns, self.thread_ctx(fns)?)));
+        self.append_bounded(data, dst, "compress", |out, out_len| match ctx {
+            Some((fns, ctx)) => unsafe {
+                (fns.compress)(ctx,
+                               data.as_ptr(), data.len() as u32,
+                               out, out_len,
+                               level)
+            },
+            None => unsafe {
+                f(data.as_ptr(), data.len() as u32,
+                  out, out_len,
+                  level)
+            },
+        })
+    }
+
+    /// Reserve `compress_bound(data.len())` bytes after `dst`'s contents and
+    /// let `call` fill them.  The plugin writes into spare capacity, so the
+    /// buffer is never zero-filled first.
+    fn append_bounded(
+        &self,
+        data: &[u8],
+        dst:  &mut Vec<u8>,
+        what: &str,
+        call: impl FnOnce(*mut u8, &mut u32) -> i32,
+    ) -> Result<(), String> {
         let bound_fn = self.desc.compress_bound.ok_or("Plugin missing compress_bound fn")?;
         let cap = unsafe { bound_fn(data.len() as u32) } as usize;
-        let mut out = vec![0u8; cap];
+        dst.reserve(cap);
         let mut out_len = cap as u32;
-        let rc = unsafe {
-            f(data.as_ptr(), data.len() as u32,
-              out.as_mut_ptr(), &mut out_len,
-              level)
-        };
+        let rc = call(dst.spare_capacity_mut().as_mut_ptr().cast(), &mut out_len);
         if rc != rc::OK {
-            return Err(format!("Plugin compress returned error code {rc}"));
+            return Err(format!("Plugin {what} returned error code {rc}"));
         }
-        out.truncate(out_len as usize);
-        Ok(out)
+        if out_len as usize > cap {
+            return Err(format!("Plugin {what} reported {out_len} B written to a {cap} B buffer"));
+        }
+        // SAFETY: the plugin initialised `out_len <= cap` bytes of the
+        // capacity reserved above.
+        unsafe { dst.set_len(dst.len() + out_len as usize) };
+        Ok(())
     }
 
     pub fn decompress(&self, data: &[u8], orig_size: usize) -> Result<Vec<u8>, String> {
+        let mut out = vec![0u8; orig_size];
+        let n = self.decompress_rc(data, &mut out)?
+            .map_err(|rc| format!("Plugin decompress returned error code {rc}"))?;
+        out.truncate(n);
+        Ok(out)
+    }
+
+    /// Decompress into `out`, returning the bytes written.  The inner error
+    /// is the plugin's return code, so callers can react to `rc::OVERFLOW`.
+    fn decompress_rc(&self, data: &[u8], out: &mut [u8]) -> Result<Result<usize, i32>, String> {
         let f = self.desc.decompress.ok_or("Plugin missing decompress fn")?;
+        let mut out_len = out.len() as u32;
+        let rc = match self.ctx_fns.as_ref().and_then(|fns| Some((fns, self.thread_ctx(fns)?))) {
+            Some((fns, ctx)) => unsafe {
+                (fns.decompress)(ctx,
+                                 data.as_ptr(), data.len() as u32,
+                                 out.as_mut_ptr(), &mut out_len)
+            },
+            None => unsafe {
+                f(data.as_ptr(), data.len() as u32,
+                  out.as_mut_ptr(), &mut out_len)
+            },
+        };
+        if rc != rc::OK {
+            return Ok(Err(rc));
+        }
+        Ok(Ok(out_len as usize))
+    }
+
+    pub fn compress_with_dict(&self, data: &[u8], level: i32, dict: &[u8]) -> Result<Vec<u8>, String> {
+        let mut out = Vec::new();
+        self.compress_with_dict_into(data, level, dict, &mut out)?;
+        Ok(out)
+    }
+
+    /// [`compress_with_dict`](Self::compress_with_dict), appending to `dst`.
+    pub fn compress_with_dict_into(&self, data: &[u8], level: i32, dict: &[u8], dst: &mut Vec<u8>)
+        -> Result<(), String>
+    {
+        let f = self.dict_fns.ok_or("Plugin missing dict_compress fn")?.compress;
+        self.append_bounded(data, dst, "dict_compress", |out, out_len| unsafe {
+            f(dict.as_ptr(), dict.len() as u32,
+              data.as_ptr(), data.len() as u32,
+              out, out_len,
+              level)
+        })
+    }
+
+    pub fn decompress_with_dict(&self, data: &[u8], dict: &[u8], orig_size: usize) -> Result<Vec<u8>, String> {
         let mut out = vec![0u8; orig_size];
-        let mut out_len = orig_size as u32;
+        let n = self.decompress_with_dict_into(data, dict, &mut out)?;
+        out.truncate(n);
+        Ok(out)
+    }
+
+    pub fn decompress_with_dict_into(&self, data: &[u8], dict: &[u8], out: &mut [u8]) -> Result<usize, String> {
+        let f = self.dict_fns.ok_or("Plugin missing dict_decompress fn")?.decompress;
+        let mut out_len = out.len() as u32;
         let rc = unsafe {
-            f(data.as_ptr(), data.len() as u32,
+            f(dict.as_ptr(), dict.len() as u32,
+              data.as_ptr(), data.len() as u32,
               out.as_mut_ptr(), &mut out_len)
         };
         if rc != rc::OK {
-            return Err(format!("Plugin decompress returned error code {rc}"));
+            return Err(format!("Plugin dict_decompress returned error code {rc}"));
         }
-        out.truncate(out_len as usize);
-        Ok(out)
+        Ok(out_len as usize)
+    }
+}
+
+/// Largest output tried when a block's decompressed size is unknown.
+const MAX_UNSIZED_OUTPUT: usize = 1 << 30;
+
+impl Codec for PluginCodec {
+    fn codec_id(&self) -> CodecId {
+        CodecId::builtin_from_uuid(&self.desc.uuid).unwrap_or(CodecId::Plugin(self.desc.uuid))
+    }
+
+    fn compress(&self, data: &[u8], level: i32) -> Result<Vec<u8>, CodecError> {
+        PluginCodec::compress(self, data, level).map_err(CodecError::Compression)
+    }
+
+    fn compress_into(&self, data: &[u8], level: i32, dst: &mut Vec<u8>) -> Result<(), CodecError> {
+        PluginCodec::compress_into(self, data, level, dst).map_err(CodecError::Compression)
+    }
+
+    /// Without a size hint, retry with a doubling buffer while the plugin
+    /// reports `OVERFLOW`.  Block decoding always goes through
+    /// `decompress_sized` instead.
+    fn decompress(&self, data: &[u8]) -> Result<Vec<u8>, CodecError> {
+        let mut cap = data.len().saturating_mul(4).max(4096);
+        loop {
+            let mut out = vec![0u8; cap];
+            match self.decompress_rc(data, &mut out).map_err(CodecError::Decompression)? {
+                Ok(n) => {
+                    out.truncate(n);
+                    return Ok(out);
+                }
+                Err(rc::OVERFLOW) if cap < MAX_UNSIZED_OUTPUT =>
+                    cap = cap.saturating_mul(2).min(MAX_UNSIZED_OUTPUT),
+                Err(rc) => return Err(CodecError::Decompression(
+                    format!("Plugin decompress returned error code {rc}"))),
+            }
+        }
+    }
+
+    fn decompress_sized(&self, data: &[u8], orig_size: usize) -> Result<Vec<u8>, CodecError> {
+        PluginCodec::decompress(self, data, orig_size).map_err(CodecError::Decompression)
+    }
+
+    fn decompress_into(&self, src: &[u8], dst: &mut [u8]) -> Result<usize, CodecError> {
+        self.decompress_rc(src, dst).map_err(CodecError::Decompression)?
+            .map_err(|rc| CodecError::Decompression(
+                format!("Plugin decompress returned error code {rc}")))
+    }
+
+    fn supports_dict(&self) -> bool { self.has_dict() }
+
+    fn compress_with_dict(&self, data: &[u8], level: i32, dict: &Dictionary)
+        -> Result<Vec<u8>, CodecError>
+    {
+        PluginCodec::compress_with_dict(self, data, level, dict.as_bytes())
+            .map_err(CodecError::Compression)
+    }
+
+    fn compress_with_dict_into(&self, data: &[u8], level: i32, dict: &Dictionary, dst: &mut Vec<u8>)
+        -> Result<(), CodecError>
+    {
+        PluginCodec::compress_with_dict_into(self, data, level, dict.as_bytes(), dst)
+            .map_err(CodecError::Compression)
+    }
+
+    fn decompress_with_dict(&self, data: &[u8], dict: &Dictionary, orig_size: usize)
+        -> Result<Vec<u8>, CodecError>
+    {
+        PluginCodec::decompress_with_dict(self, data, dict.as_bytes(), orig_size)
+            .map_err(CodecError::Decompression)
+    }
+
+    fn decompress_with_dict_into(&self, src: &[u8], dict: &Dictionary, dst: &mut [u8])
+        -> Result<usize, CodecError>
+    {
+        PluginCodec::decompress_with_dict_into(self, src, dict.as_bytes(), dst)
+            .map_err(CodecError::Decompression)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+
+    static CREATED:   AtomicUsize = AtomicUsize::new(0);
+    static DESTROYED: AtomicUsize = AtomicUsize::new(0);
+    static CTX_CALLS: AtomicUsize = AtomicUsize::new(0);
+
+    unsafe extern "C" fn copy(i: *const u8, n: u32, o: *mut u8, on: *mut u32) -> i32 {
+        if *on < n { return rc::OVERFLOW; }
+        std::ptr::copy_nonoverlapping(i, o, n as usize);
+        *on = n;
+        rc::OK
+    }
+    unsafe extern "C" fn compress(i: *const u8, n: u32, o: *mut u8, on: *mut u32, _: i32) -> i32 {
+        copy(i, n, o, on)
+    }
+    unsafe extern "C" fn bound(n: u32) -> u32 { n }
+    unsafe extern "C" fn ctx_create() -> *mut SixcyCodecCtx {
+        CREATED.fetch_add(1, Ordering::SeqCst);
+        Box::into_raw(Box::new(0u64)) as *mut SixcyCodecCtx
+    }
+    unsafe extern "C" fn ctx_destroy(ctx: *mut SixcyCodecCtx) {
+        DESTROYED.fetch_add(1, Ordering::SeqCst);
+        drop(Box::from_raw(ctx as *mut u64));
+    }
+    unsafe extern "C" fn compress_ctx(
+        ctx: *mut SixcyCodecCtx, i: *const u8, n: u32, o: *mut u8, on: *mut u32, l: i32,
+    ) -> i32 {
+        *(ctx as *mut u64) += 1;
+        CTX_CALLS.fetch_add(1, Ordering::SeqCst);
+        compress(i, n, o, on, l)
+    }
+    unsafe extern "C" fn decompress_ctx(
+        ctx: *mut SixcyCodecCtx, i: *const u8, n: u32, o: *mut u8, on: *mut u32,
+    ) -> i32 {
+        *(ctx as *mut u64) += 1;
+        CTX_CALLS.fetch_add(1, Ordering::SeqCst);
+        copy(i, n, o, on)
+    }
+
+    static MOCK_V2: SixcyCodecPlugin = SixcyCodecPlugin {
+        uuid:           [0xAB; 16],
+        short_id:       0,
+        abi_version:    3,
+        compress:       Some(compress),
+        decompress:     Some(copy),
+        compress_bound: Some(bound),
+        ctx_create:     Some(ctx_create),
+        ctx_destroy:    Some(ctx_destroy),
+        compress_ctx:   Some(compress_ctx),
+        decompress_ctx: Some(decompress_ctx),
+        dict_compress:   None,
+        dict_decompress: None,
+    };
+
+    #[test]
+    fn context_reused_per_thread() {
+        let codec = PluginCodec::new(&MOCK_V2).unwrap();
+        assert!(codec.has_contexts());
+
+        for _ in 0..8 {
+            let c = codec.compress(b"chunk", 0).unwrap();
+            assert_eq!(codec.decompress(&c, 5).unwrap(), b"chunk");
+        }
+        assert_eq!(CREATED.load(Ordering::SeqCst), 1);
+        assert_eq!(CTX_CALLS.load(Ordering::SeqCst), 16);
+
+        // A second thread gets its own context, destroyed when it exits.
+        std::thread::spawn(|| {
+            PluginCodec::new(&MOCK_V2).unwrap().compress(b"other", 0).unwrap();
+        }).join().unwrap();
+        assert_eq!(CREATED.load(Ordering::SeqCst), 2);
+        assert_eq!(DESTROYED.load(Ordering::SeqCst), 1);
+    }
+
+    #[test]
+    fn compress_into_appends() {
+        // No contexts, so the counters above are left alone.
+        static MOCK_PLAIN: SixcyCodecPlugin = SixcyCodecPlugin {
+            uuid:           [0xAC; 16],
+            short_id:       0,
+            abi_version:    3,
+            compress:       Some(compress),
+            decompress:     Some(copy),
+            compress_bound: Some(bound),
+            ctx_create:     None,
+            ctx_destroy:    None,
+            compress_ctx:   None,
+            decompress_ctx: None,
+            dict_compress:   None,
+            dict_decompress: None,
+        };
+        let codec = PluginCodec::new(&MOCK_PLAIN).unwrap();
+        let mut out = b"head".to_vec();
+        codec.compress_into(b"chunk", 0, &mut out).unwrap();
+        codec.compress_into(b"!", 0, &mut out).unwrap();
+        assert_eq!(out, b"headchunk!");
     }
 }
@@ -1,7 +1,7 @@
 pub mod scanner;
 
 pub use scanner::{
-    scan, scan_file, extract_recoverable,
+    scan, scan_at, scan_file, extract_recoverable,
     RecoveryReport, RecoveryQuality, BlockHealth, ScannedBlock,
 };
 
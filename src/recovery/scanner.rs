@@ -24,17 +24,44 @@
 //! - `TruncatedPayload` — header valid but fewer bytes follow than `comp_size` declares
 //! - `UnknownCodec` — header valid but `codec_uuid` is not in registry
 //!
+//! ## Resynchronisation
+//!
+//! A corrupt header is logged once.  The scanner then searches forward for
+//! the `BLCK` magic a window at a time ([`SCAN_WINDOW`], SIMD-accelerated
+//! by `memchr::memmem`), and resumes at the first match whose header CRC32
+//! holds.  A damaged region costs one read per window, not one per byte.
+//!
+//! The INDEX block normally ends the scan.  In an archive that was appended
+//! to (`SixCyWriter::append`), the superseded INDEX, RecoveryMap and BLOCK
+//! TABLE sit between the old blocks and the new ones.  After an INDEX the
+//! scanner therefore looks for one more valid header.  If it finds one, it
+//! carries on from there, without logging the footer bytes as corrupt.
+//!
+//! ## Parallel scan
+//!
+//! [`scan_at`] cuts large archives into [`SCAN_RANGE_SIZE`] ranges.  Each
+//! worker resyncs to the first valid header in its range and walks from
+//! there; the walks are stitched where the chain from the previous range
+//! lands on a block of the next.  Only headers are read, never payloads.
+//!
 //! ## Progress
 //!
 //! `scan()` accepts an optional `ProgressFn` callback called after every block.
 //! The callback receives `(bytes_scanned, total_bytes_estimate)`.
 //! Pass `None` to disable progress reporting.
 
+use std::cell::RefCell;
 use std::io::{self, Read, Seek, SeekFrom};
 use std::collections::HashMap;
+use std::ops::Range;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
 
-use crate::block::{BlockHeader, BlockType, BLOCK_HEADER_SIZE};
+use memchr::memmem;
+
+use crate::block::{BlockHeader, BlockType, BLOCK_HEADER_SIZE, BLOCK_MAGIC};
 use crate::codec::CodecId;
+use crate::io_stream::{default_threads, ReadAt};
 use crate::index::{FileIndex, FileIndexRecord, BlockRef};
 use crate::superblock::SUPERBLOCK_SIZE;
 
@@ -143,6 +170,16 @@ pub type ProgressFn<'a> = dyn FnMut(u64 /*scanned*/, u64 /*total_estimate*/) + '
 
 // ── Scanner ───────────────────────────────────────────────────────────────────
 
+/// Bytes searched per read while looking for the next `BLCK` magic.
+pub const SCAN_WINDOW: usize = 1024 * 1024;
+
+/// Archives are cut into ranges of this size for [`scan_at`], one range per
+/// task.  Smaller archives are scanned on the calling thread.
+pub const SCAN_RANGE_SIZE: u64 = 256 * 1024 * 1024;
+
+/// [`BLOCK_MAGIC`] as it appears on disk.
+static MAGIC_BYTES: [u8; 4] = BLOCK_MAGIC.to_le_bytes();
+
 /// Scan an archive stream for recoverable blocks without using the INDEX block.
 ///
 /// # Arguments
@@ -155,6 +192,11 @@ pub type ProgressFn<'a> = dyn FnMut(u64 /*scanned*/, u64 /*total_estimate*/) + '
 /// function does not return `Err` due to corrupt data — all errors are encoded
 /// as `BlockHealth` variants in the report.  Only genuine I/O errors (e.g.,
 /// permission denied) propagate as `io::Error`.
+///
+/// A corrupt header is recorded once; the scan then resumes at the next
+/// offset holding a valid header, found by searching [`SCAN_WINDOW`]-sized
+/// reads for the magic.  Use [`scan_at`] for sources that can be read from
+/// several threads.
 pub fn scan<R, F>(
     reader:         &mut R,
     file_size_hint: u64,
@@ -164,135 +206,427 @@ where
     R: Read + Seek,
     F: FnMut(u64, u64),
 {
-    reader.seek(SeekFrom::Start(SUPERBLOCK_SIZE as u64))?;
+    let len      = reader.seek(SeekFrom::End(0))?;
+    let estimate = if file_size_hint > 0 { file_size_hint } else { len };
+    let src      = Seeking(RefCell::new(reader));
+
+    let (blocks, end) = scan_serial(&src, len, &mut |n| {
+        if let Some(ref mut cb) = progress { cb(n, estimate); }
+    })?;
+    Ok(build_report(blocks, end))
+}
 
-    // Per-file chunk accumulation: file_id → Vec<(file_offset, ScannedBlock)>
-    let mut chunks: HashMap<u32, Vec<(u64, ScannedBlock)>> = HashMap::new();
-    let mut orig_sizes: HashMap<u32, u64> = HashMap::new();
-    let mut block_log: Vec<ScannedBlock> = Vec::new();
+/// [`scan`] over a positional source, splitting archives larger than
+/// [`SCAN_RANGE_SIZE`] into ranges scanned by one thread per core.
+///
+/// Each range is walked from the first valid header at or after its start;
+/// the walks are then stitched at the block that straddles each boundary,
+/// so the report is identical to a single forward scan.  `progress` runs on
+/// the calling thread, once per block for small archives and once per
+/// finished range otherwise.
+pub fn scan_at<S, F>(
+    src:          &S,
+    len:          u64,
+    mut progress: Option<&mut F>,
+) -> io::Result<RecoveryReport>
+where
+    S: ReadAt + Sync + ?Sized,
+    F: FnMut(u64, u64),
+{
+    let (blocks, end) = scan_ranges(src, len, SCAN_RANGE_SIZE, &mut |n| {
+        if let Some(ref mut cb) = progress { cb(n, len); }
+    })?;
+    Ok(build_report(blocks, end))
+}
 
-    let mut total_scanned        = 0usize;
-    let mut healthy_blocks       = 0usize;
-    let mut corrupt_blocks       = 0usize;
-    let mut truncated_blocks     = 0usize;
-    let mut unknown_codec_blocks = 0usize;
-    let mut recoverable_bytes    = 0u64;
-    let mut bytes_scanned        = SUPERBLOCK_SIZE as u64;
+/// Convenience: scan a file at `path` and return the report.
+///
+/// The file is read with positional reads rather than mapped, so an I/O
+/// error on a failing disk surfaces as `Err` instead of a fault.
+pub fn scan_file(path: &std::path::Path) -> io::Result<RecoveryReport> {
+    let f    = std::fs::File::open(path)?;
+    let size = f.metadata()?.len();
+    scan_at::<_, fn(u64, u64)>(&f, size, None)
+}
 
-    loop {
-        let pos = reader.stream_position()?;
+/// Walk every block from `SUPERBLOCK_SIZE` on the calling thread.
+fn scan_serial<S: ReadAt + ?Sized>(
+    src:      &S,
+    len:      u64,
+    progress: &mut dyn FnMut(u64),
+) -> io::Result<(Vec<ScannedBlock>, u64)> {
+    let mut walker = Walker::new(src, len);
+    let mut blocks = Vec::new();
+    let next = walker.walk(SUPERBLOCK_SIZE as u64, len, &mut blocks, progress)?;
+    Ok((blocks, next.end(len)))
+}
 
-        // Try to read a full 84-byte header.
-        let mut hdr_buf = [0u8; BLOCK_HEADER_SIZE];
-        match reader.read_exact(&mut hdr_buf) {
-            Ok(_) => {}
-            Err(e) if e.kind() == io::ErrorKind::UnexpectedEof => break,
-            Err(e) => return Err(e),
-        }
-        bytes_scanned += BLOCK_HEADER_SIZE as u64;
-        total_scanned += 1;
-
-        // Attempt to parse.  BlockHeader::read re-reads from a cursor; we
-        // already have the bytes, so parse from the buffer directly.
-        let parse_result = BlockHeader::read(std::io::Cursor::new(&hdr_buf));
-
-        match parse_result {
-            Err(_) => {
-                // Header CRC32 or magic failed.
-                corrupt_blocks += 1;
-                let sb = ScannedBlock {
-                    archive_offset: pos,
-                    header: None,
-                    health: BlockHealth::HeaderCorrupt,
-                };
-                block_log.push(sb);
+/// Scan `[SUPERBLOCK_SIZE, len)` in ranges of `range_size` bytes on
+/// [`default_threads`] workers, then stitch the ranges together.
+fn scan_ranges<S: ReadAt + Sync + ?Sized>(
+    src:        &S,
+    len:        u64,
+    range_size: u64,
+    progress:   &mut dyn FnMut(u64),
+) -> io::Result<(Vec<ScannedBlock>, u64)> {
+    let start = SUPERBLOCK_SIZE as u64;
+    if len <= start.saturating_add(range_size) {
+        return scan_serial(src, len, progress);
+    }
 
-                // Skip one byte and retry — allows finding the next valid
-                // header after a run of corruption.
-                reader.seek(SeekFrom::Start(pos + 1))?;
-                bytes_scanned = pos + 1 + BLOCK_HEADER_SIZE as u64; // approx
+    let bounds: Vec<Range<u64>> = (start..len)
+        .step_by(range_size as usize)
+        .map(|lo| lo..lo.saturating_add(range_size).min(len))
+        .collect();
+    let threads = default_threads().min(bounds.len());
+    let queue   = Mutex::new(bounds.into_iter().enumerate());
+    let done    = Mutex::new(Vec::new());
+    let scanned = AtomicU64::new(0);
+    let failed  = AtomicBool::new(false);
+    let error   = Mutex::new(None::<io::Error>);
+
+    let work = |report: &mut dyn FnMut(u64)| {
+        while !failed.load(Ordering::Relaxed) {
+            let Some((i, range)) = queue.lock().unwrap().next() else { break };
+            let size = range.end - range.start;
+            // Only the first range is known to start on a block boundary.
+            match scan_range(src, len, range, i == 0) {
+                Ok(r)  => done.lock().unwrap().push((i, r)),
+                Err(e) => {
+                    failed.store(true, Ordering::Relaxed);
+                    error.lock().unwrap().get_or_insert(e);
+                }
             }
-            Ok(header) => {
-                // Header parsed.  Now assess codec and payload availability.
-                let comp_size  = header.comp_size as u64;
-                let block_type = header.block_type;
-
-                // Check codec availability.
-                let health = if CodecId::from_uuid(&header.codec_uuid).is_none()
-                    && header.codec_uuid != crate::codec::UUID_NONE
-                {
-                    unknown_codec_blocks += 1;
-                    BlockHealth::UnknownCodec {
-                        uuid_hex: hex::encode(&header.codec_uuid),
-                    }
-                } else {
-                    // Check payload truncation.
-                    let stream_pos = reader.stream_position()?;
-                    let remaining  = if file_size_hint > stream_pos {
-                        file_size_hint - stream_pos
-                    } else {
-                        // Seek to end to get remaining bytes.
-                        let end = reader.seek(SeekFrom::End(0))?;
-                        let _ = reader.seek(SeekFrom::Start(stream_pos))?;
-                        if end > stream_pos { end - stream_pos } else { 0 }
-                    };
+            report(start + scanned.fetch_add(size, Ordering::Relaxed) + size);
+        }
+    };
+    std::thread::scope(|s| {
+        for _ in 1..threads {
+            s.spawn(|| work(&mut |_| {}));
+        }
+        work(&mut *progress);
+    });
+    if let Some(e) = error.into_inner().unwrap() {
+        return Err(e);
+    }
 
-                    if remaining < comp_size {
-                        truncated_blocks += 1;
-                        BlockHealth::TruncatedPayload {
-                            declared:  header.comp_size,
-                            available: remaining,
-                        }
-                    } else {
-                        healthy_blocks   += 1;
-                        recoverable_bytes += header.orig_size as u64;
-                        BlockHealth::Healthy
-                    }
-                };
+    let mut ranges = done.into_inner().unwrap();
+    ranges.sort_unstable_by_key(|(i, _)| *i);
+    stitch(&mut Walker::new(src, len), ranges.into_iter().map(|(_, r)| r))
+}
 
-                let usable = health.is_usable() && block_type == BlockType::Data;
+/// Where a walk stopped.
+#[derive(Debug, Clone, Copy)]
+enum Next {
+    /// The next header is expected at this offset.
+    At(u64),
+    /// A corrupt header was seen and no valid one follows it before the end
+    /// of the range being walked.
+    Resync,
+    /// INDEX block or end of input; the scan ends at this offset.
+    Stop(u64),
+}
 
-                // Record in per-file accumulator if usable DATA block.
-                if usable {
-                    let fid = header.file_id;
-                    let end = header.file_offset + header.orig_size as u64;
-                    let sz  = orig_sizes.entry(fid).or_insert(0);
-                    if end > *sz { *sz = end; }
+impl Next {
+    fn end(self, len: u64) -> u64 {
+        match self {
+            Next::At(p) | Next::Stop(p) => p.min(len),
+            Next::Resync => len,
+        }
+    }
+}
+
+/// One range's walk, started at its first valid header.
+struct RangeScan {
+    range:  Range<u64>,
+    first:  Option<u64>,
+    blocks: Vec<ScannedBlock>,
+    next:   Next,
+}
 
-                    let sb = ScannedBlock {
-                        archive_offset: pos,
-                        header: Some(header.clone()),
-                        health: health.clone(),
+fn scan_range<S: ReadAt + ?Sized>(
+    src:     &S,
+    len:     u64,
+    range:   Range<u64>,
+    aligned: bool,
+) -> io::Result<RangeScan> {
+    let mut walker = Walker::new(src, len);
+    let first = if aligned {
+        Some(range.start)
+    } else {
+        walker.find_header(range.start, range.end)?
+    };
+    let mut blocks = Vec::new();
+    let next = match first {
+        Some(p) => walker.walk(p, range.end, &mut blocks, &mut |_| {})?,
+        None    => Next::Resync,
+    };
+    Ok(RangeScan { range, first, blocks, next })
+}
+
+/// Join range walks into the block sequence a single forward scan produces.
+///
+/// A range's walk is adopted from the first of its blocks that the chain
+/// so far lands on.  Where the chain skips a range's first header (a stray
+/// magic inside a payload, such as an archive stored in an archive), the
+/// chain is followed block by block until the two agree.
+fn stitch<S: ReadAt + ?Sized>(
+    walker: &mut Walker<'_, S>,
+    ranges: impl Iterator<Item = RangeScan>,
+) -> io::Result<(Vec<ScannedBlock>, u64)> {
+    let mut out  = Vec::new();
+    let mut next = Next::At(SUPERBLOCK_SIZE as u64);
+
+    for mut r in ranges {
+        if let Next::Resync = next {
+            // Nothing parses between the last corrupt header and this range.
+            match r.first {
+                Some(p) => next = Next::At(p),
+                None    => continue,
+            }
+        }
+        while let Next::At(pos) = next {
+            if pos >= r.range.end { break; }
+            match r.blocks.binary_search_by_key(&pos, |b| b.archive_offset) {
+                Ok(k) => {
+                    out.extend(r.blocks.drain(k..));
+                    next = r.next;
+                }
+                Err(_) => {
+                    next = match walker.step(pos, r.range.end)? {
+                        Some((block, n)) => { out.push(block); n }
+                        None             => Next::Stop(walker.len),
                     };
-                    chunks.entry(fid).or_default().push((header.file_offset, sb));
                 }
+            }
+        }
+        if let Next::Stop(_) = next { break; }
+    }
+    Ok((out, next.end(walker.len)))
+}
 
-                let sb = ScannedBlock {
-                    archive_offset: pos,
-                    header: Some(header.clone()),
-                    health,
-                };
-                block_log.push(sb);
+/// [`ReadAt`] over a seeking stream, for [`scan`].
+struct Seeking<'a, R>(RefCell<&'a mut R>);
 
-                // Seek past payload.
-                if reader.seek(SeekFrom::Current(comp_size as i64)).is_err() {
-                    break;
-                }
-                bytes_scanned += comp_size;
+impl<R: Read + Seek> ReadAt for Seeking<'_, R> {
+    fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> io::Result<()> {
+        let mut r = self.0.borrow_mut();
+        r.seek(SeekFrom::Start(offset))?;
+        r.read_exact(buf)
+    }
+}
+
+/// Bytes read ahead of the scan position.  Unused when the source lends
+/// its bytes through [`ReadAt::slice_at`].
+struct Window {
+    buf:   Vec<u8>,
+    start: u64,
+}
+
+impl Window {
+    /// `len` bytes at `offset`; on a miss, reads `max(len, ahead)` bytes
+    /// (clamped to `end`).
+    fn get<'a, S: ReadAt + ?Sized>(
+        &'a mut self,
+        src:    &'a S,
+        offset: u64,
+        len:    usize,
+        ahead:  usize,
+        end:    u64,
+    ) -> io::Result<&'a [u8]> {
+        if let Some(bytes) = src.slice_at(offset, len) {
+            return Ok(bytes);
+        }
+        let have = offset >= self.start
+            && offset + len as u64 <= self.start + self.buf.len() as u64;
+        if !have {
+            let n = end.saturating_sub(offset).min(len.max(ahead) as u64) as usize;
+            if n < len {
+                return Err(io::ErrorKind::UnexpectedEof.into());
+            }
+            self.buf.resize(n, 0);
+            src.read_exact_at(&mut self.buf, offset)?;
+            self.start = offset;
+        }
+        let at = (offset - self.start) as usize;
+        Ok(&self.buf[at..at + len])
+    }
+}
+
+enum Probe {
+    Eof,
+    Corrupt,
+    Header(BlockHeader),
+}
+
+/// Header-at-a-time walker over `[0, len)` of one source.
+struct Walker<'s, S: ?Sized> {
+    src:    &'s S,
+    len:    u64,
+    window: Window,
+    magic:  memmem::Finder<'static>,
+}
+
+impl<'s, S: ReadAt + ?Sized> Walker<'s, S> {
+    fn new(src: &'s S, len: u64) -> Self {
+        Self {
+            src,
+            len,
+            window: Window { buf: Vec::new(), start: 0 },
+            magic:  memmem::Finder::new(&MAGIC_BYTES),
+        }
+    }
 
-                // Stop at INDEX block — it marks the end of data blocks.
-                if block_type == BlockType::Index {
+    fn probe(&mut self, pos: u64) -> io::Result<Probe> {
+        if self.len.saturating_sub(pos) < BLOCK_HEADER_SIZE as u64 {
+            return Ok(Probe::Eof);
+        }
+        let bytes = self.window.get(self.src, pos, BLOCK_HEADER_SIZE, 0, self.len)?;
+        Ok(match BlockHeader::read(bytes) {
+            Ok(h)  => Probe::Header(h),
+            Err(_) => Probe::Corrupt,
+        })
+    }
+
+    /// Offset of the first valid header in `[from, limit)`.
+    fn find_header(&mut self, mut from: u64, limit: u64) -> io::Result<Option<u64>> {
+        while from < limit && self.len.saturating_sub(from) >= BLOCK_HEADER_SIZE as u64 {
+            let n   = (self.len - from).min(SCAN_WINDOW as u64) as usize;
+            let hay = self.window.get(self.src, from, n, n, self.len)?;
+            // Overlap windows by three bytes so a straddling magic is seen.
+            let mut resume = from + (n - (MAGIC_BYTES.len() - 1)) as u64;
+            for i in self.magic.find_iter(hay) {
+                let cand = from + i as u64;
+                if cand >= limit {
+                    return Ok(None);
+                }
+                if i + BLOCK_HEADER_SIZE > n {
+                    // Header runs past the window: read the next one from it.
+                    resume = cand;
                     break;
                 }
+                if BlockHeader::read(&hay[i..i + BLOCK_HEADER_SIZE]).is_ok() {
+                    return Ok(Some(cand));
+                }
             }
+            from = resume;
         }
+        Ok(None)
+    }
+
+    /// Examine the block at `pos`.  After a corrupt header, the next valid
+    /// header is searched for up to `limit`.  `None` at end of input.
+    fn step(&mut self, pos: u64, limit: u64) -> io::Result<Option<(ScannedBlock, Next)>> {
+        let header = match self.probe(pos)? {
+            Probe::Eof     => return Ok(None),
+            Probe::Corrupt => {
+                let next = match self.find_header(pos + 1, limit)? {
+                    Some(p) => Next::At(p),
+                    None    => Next::Resync,
+                };
+                let block = ScannedBlock {
+                    archive_offset: pos,
+                    header: None,
+                    health: BlockHealth::HeaderCorrupt,
+                };
+                return Ok(Some((block, next)));
+            }
+            Probe::Header(h) => h,
+        };
+
+        let health = assess(&header, pos, self.len);
+        let end    = pos + BLOCK_HEADER_SIZE as u64 + header.comp_size as u64;
+        // An INDEX block ends the data blocks, unless the archive was
+        // appended to: then a footer it superseded is followed by more
+        // blocks, found as after a corrupt header (to the end of input, not
+        // of the range, as the footer may cross ranges).
+        let next = if end > self.len {
+            Next::Stop(self.len)
+        } else if header.block_type == BlockType::Index {
+            match self.find_header(end, self.len)? {
+                Some(p) => Next::At(p),
+                None    => Next::Stop(end),
+            }
+        } else {
+            Next::At(end)
+        };
+        Ok(Some((ScannedBlock { archive_offset: pos, header: Some(header), health }, next)))
+    }
 
-        // Progress callback.
-        if let Some(ref mut cb) = progress {
-            let estimate = if file_size_hint > 0 { file_size_hint } else { bytes_scanned * 2 };
-            cb(bytes_scanned, estimate);
+    /// Step from `pos` until a block starts at or beyond `hi`.
+    fn walk(
+        &mut self,
+        mut pos:  u64,
+        hi:       u64,
+        out:      &mut Vec<ScannedBlock>,
+        progress: &mut dyn FnMut(u64),
+    ) -> io::Result<Next> {
+        while pos < hi {
+            let Some((block, next)) = self.step(pos, hi)? else {
+                return Ok(Next::Stop(self.len));
+            };
+            out.push(block);
+            match next {
+                Next::At(p) => { pos = p; progress(p); }
+                other       => return Ok(other),
+            }
         }
+        Ok(Next::At(pos))
     }
+}
+
+/// Codec and payload availability of a block whose header parsed.
+fn assess(header: &BlockHeader, pos: u64, len: u64) -> BlockHealth {
+    if CodecId::from_uuid(&header.codec_uuid).is_none()
+        && header.codec_uuid != crate::codec::UUID_NONE
+    {
+        return BlockHealth::UnknownCodec { uuid_hex: hex::encode(header.codec_uuid) };
+    }
+    let available = len.saturating_sub(pos + BLOCK_HEADER_SIZE as u64);
+    if available < header.comp_size as u64 {
+        BlockHealth::TruncatedPayload { declared: header.comp_size, available }
+    } else {
+        BlockHealth::Healthy
+    }
+}
+
+/// Tally `block_log` and rebuild the file index from its usable DATA blocks.
+fn build_report(block_log: Vec<ScannedBlock>, bytes_scanned: u64) -> RecoveryReport {
+    // Per-file chunk accumulation: file_id → Vec<(file_offset, ScannedBlock)>
+    let mut chunks: HashMap<u32, Vec<(u64, ScannedBlock)>> = HashMap::new();
+    let mut orig_sizes: HashMap<u32, u64> = HashMap::new();
+
+    let mut healthy_blocks       = 0usize;
+    let mut corrupt_blocks       = 0usize;
+    let mut truncated_blocks     = 0usize;
+    let mut unknown_codec_blocks = 0usize;
+    let mut recoverable_bytes    = 0u64;
+    let mut dict_offset: Option<u64> = None;
+
+    for sb in &block_log {
+        match sb.health {
+            BlockHealth::Healthy                 => healthy_blocks += 1,
+            BlockHealth::HeaderCorrupt           => corrupt_blocks += 1,
+            BlockHealth::TruncatedPayload { .. } => truncated_blocks += 1,
+            BlockHealth::UnknownCodec { .. }     => unknown_codec_blocks += 1,
+        }
+        let Some(header) = sb.header.as_ref().filter(|_| sb.health.is_usable()) else { continue };
+        recoverable_bytes += header.orig_size as u64;
+
+        match header.block_type {
+            BlockType::Dict => dict_offset = Some(sb.archive_offset),
+            // Record in per-file accumulator if usable DATA block.
+            BlockType::Data => {
+                let fid = header.file_id;
+                let end = header.file_offset + header.orig_size as u64;
+                let sz  = orig_sizes.entry(fid).or_insert(0);
+                if end > *sz { *sz = end; }
+                chunks.entry(fid).or_default().push((header.file_offset, sb.clone()));
+            }
+            _ => {}
+        }
+    }
+    let total_scanned = block_log.len();
 
     // Build FileIndexRecords from accumulated chunks.
     let mut records: Vec<FileIndexRecord> = chunks
@@ -301,11 +635,12 @@ where
             v.sort_by_key(|(off, _)| *off);
             let refs: Vec<BlockRef> = v
                 .into_iter()
-                .map(|(_, sb)| BlockRef {
+                .map(|(file_offset, sb)| BlockRef {
                     content_hash:   sb.header.as_ref().map(|h| h.content_hash).unwrap_or([0u8; 32]),
                     archive_offset: sb.archive_offset,
                     intra_offset:   0,
                     intra_length:   0,
+                    file_offset,
                 })
                 .collect();
             let size = *orig_sizes.get(&fid).unwrap_or(&0);
@@ -314,7 +649,7 @@ where
         .collect();
     records.sort_by_key(|r| r.id);
 
-    let mut index = FileIndex { records, root_hash: [0u8; 32] };
+    let mut index = FileIndex { records, root_hash: [0u8; 32], dict_offset };
     index.compute_root_hash();
 
     // Determine quality.
@@ -330,7 +665,7 @@ where
         }
     };
 
-    Ok(RecoveryReport {
+    RecoveryReport {
         total_scanned,
         healthy_blocks,
         corrupt_blocks,
@@ -341,14 +676,7 @@ where
         index,
         recoverable_bytes,
         quality,
-    })
-}
-
-/// Convenience: scan a file at `path` and return the report.
-pub fn scan_file(path: &std::path::Path) -> io::Result<RecoveryReport> {
-    let mut f    = std::fs::File::open(path)?;
-    let size     = f.metadata()?.len();
-    scan::<_, fn(u64, u64)>(&mut f, size, None)
+    }
 }
 
 /// Extract all recoverable DATA blocks from `src` into new archive `dst`.
@@ -367,8 +695,8 @@ where
     W: std::io::Write + Seek,
 {
     use crate::io_stream::{SixCyWriter, DEFAULT_COMPRESSION_LEVEL};
-    use crate::codec::CodecId;
-    use crate::block::decode_block;
+    use crate::codec::{CodecId, Dictionary};
+    use crate::block::{decode_block, decode_block_with_dict};
 
     let size   = src.seek(SeekFrom::End(0))?;
     let report = scan::<_, fn(u64, u64)>(src, size, None)?;
@@ -380,6 +708,19 @@ where
         None,
     )?;
 
+    // Load the shared dictionary, if one survived.  Blocks that need it are
+    // skipped below when it did not.
+    let dict = match report.index.dict_offset {
+        Some(off) => {
+            src.seek(SeekFrom::Start(off))?;
+            let h = BlockHeader::read(&mut *src)?;
+            let mut payload = vec![0u8; h.comp_size as usize];
+            src.read_exact(&mut payload)?;
+            decode_block(&h, &payload, decryption_key).ok().map(Dictionary::new)
+        }
+        None => None,
+    };
+
     // Group healthy blocks by file_id and sort by file_offset.
     let mut by_file: HashMap<u32, Vec<&ScannedBlock>> = HashMap::new();
     for sb in report.block_log.iter().filter(|sb| sb.is_usable()) {
@@ -406,7 +747,7 @@ where
             let mut payload = vec![0u8; h.comp_size as usize];
             src.read_exact(&mut payload)?;
 
-            match decode_block(h, &payload, decryption_key) {
+            match decode_block_with_dict(h, &payload, decryption_key, dict.as_ref()) {
                 Ok(chunk) => data.extend(chunk),
                 Err(_)    => {
                     // Decompression failed despite header being valid — skip.
@@ -423,3 +764,83 @@ where
     writer.finalize()?;
     Ok(report)
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::io_stream::SixCyWriter;
+
+    fn noise(n: usize, seed: u64) -> Vec<u8> {
+        let mut x = seed | 1;
+        (0..n).map(|_| { x ^= x << 13; x ^= x >> 7; x ^= x << 17; x as u8 }).collect()
+    }
+
+    fn archive(files: &[(&str, &[u8], CodecId)]) -> Vec<u8> {
+        let mut out = io::Cursor::new(Vec::new());
+        {
+            let mut w = SixCyWriter::with_options(&mut out, 4096, 3, None).unwrap();
+            for (name, data, codec) in files {
+                w.add_file(name.to_string(), data, *codec).unwrap();
+            }
+            w.finalize().unwrap();
+        }
+        out.into_inner()
+    }
+
+    /// A source that never lends its bytes, so reads go through `Window`.
+    struct Copying(Vec<u8>);
+    impl ReadAt for Copying {
+        fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> io::Result<()> {
+            io::Cursor::new(&self.0).read_exact_at(buf, offset)
+        }
+    }
+
+    fn log(blocks: &[ScannedBlock]) -> Vec<(u64, BlockHealth)> {
+        blocks.iter().map(|b| (b.archive_offset, b.health.clone())).collect()
+    }
+
+    #[test]
+    fn resyncs_after_corrupt_header() {
+        let bytes = archive(&[("a", &noise(20_000, 1), CodecId::Zstd)]);
+        let clean = scan::<_, fn(u64, u64)>(&mut io::Cursor::new(&bytes), 0, None).unwrap();
+        assert_eq!(clean.corrupt_blocks, 0);
+        assert_eq!(clean.quality, RecoveryQuality::Full);
+
+        // Damage the second block's header.
+        let mut bad = bytes.clone();
+        let second = clean.block_log[1].archive_offset as usize;
+        bad[second + 20] ^= 0xFF;
+        let report = scan::<_, fn(u64, u64)>(&mut io::Cursor::new(&bad), 0, None).unwrap();
+        assert_eq!(report.corrupt_blocks, 1);
+        assert_eq!(report.block_log[1].health, BlockHealth::HeaderCorrupt);
+        assert_eq!(report.block_log[2].archive_offset, clean.block_log[2].archive_offset);
+        assert_eq!(report.total_scanned, clean.total_scanned);
+    }
+
+    #[test]
+    fn ranges_stitch_to_the_serial_scan() {
+        // An uncompressed archive inside the archive puts valid headers in
+        // a payload, which a range starting there will sync on.
+        let inner = archive(&[("x", &noise(30_000, 2), CodecId::Lz4)]);
+        let mut bytes = archive(&[
+            ("a", &noise(50_000, 3), CodecId::Zstd),
+            ("inner.6cy", &inner, CodecId::None),
+            ("b", &noise(30_000, 4), CodecId::Lz4),
+        ]);
+        let clean = scan::<_, fn(u64, u64)>(&mut io::Cursor::new(&bytes), 0, None).unwrap();
+        let offset = clean.block_log[4].archive_offset as usize;
+        bytes[offset + 5] ^= 0x01;
+        let len = bytes.len() as u64;
+
+        let (serial, serial_end) = scan_serial(&io::Cursor::new(&bytes), len, &mut |_| {}).unwrap();
+        assert!(serial.iter().any(|b| b.health == BlockHealth::HeaderCorrupt));
+        let copying = Copying(bytes.clone());
+        for range_size in [97, 1000, 4096, 50_000] {
+            let (blocks, end) = scan_ranges(&io::Cursor::new(&bytes), len, range_size, &mut |_| {}).unwrap();
+            assert_eq!(log(&blocks), log(&serial), "range {range_size}");
+            assert_eq!(end, serial_end);
+            let (blocks, _) = scan_ranges(&copying, len, range_size, &mut |_| {}).unwrap();
+            assert_eq!(log(&blocks), log(&serial), "range {range_size}, copying");
+        }
+    }
+}
@@ -0,0 +1,319 @@
+//! Hot-path instrumentation: call counts, bytes and time per pipeline stage.
+//!
+//! A [`Stats`] collects, from every thread working for one writer or
+//! reader:
+//!
+//! - per [`Stage`]: file reads, BLAKE3 hashing, AES-GCM sealing and opening,
+//!   archive writes, and time spent blocked on a queue (compressor results,
+//!   read-ahead payloads, a full write-behind queue);
+//! - per codec: compression and decompression, by [`CodecId`];
+//! - CAS lookups that found a stored block, and those that did not.
+//!
+//! The code that does the work records into whichever `Stats` is installed
+//! on its thread, so block encode and decode need no extra parameters.
+//! [`SixCyWriter`](crate::io_stream::SixCyWriter) and
+//! [`SixCyReader`](crate::io_stream::SixCyReader) install theirs (when
+//! enabled) at each entry point and in each worker they start.  When
+//! nothing is installed, a probe is one thread-local read; the clock is
+//! only read when a `Stats` is installed.
+//!
+//! Decoding verifies the output inside the codec call, so on the read side
+//! the BLAKE3 stage's time is also part of the codec's decompress time.
+//! [`StatsReport`] is a snapshot.  It prints as a per-stage table and
+//! serializes to JSON.
+
+use std::cell::RefCell;
+use std::fmt;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+use serde::Serialize;
+
+use crate::codec::CodecId;
+use crate::io_stream::CacheStats;
+
+/// A timed step of packing or extraction.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Stage {
+    /// Reading block payloads (or file contents) from storage.
+    Read,
+    /// BLAKE3 content hashing of chunks being stored.
+    Hash,
+    /// AES-256-GCM sealing of compressed payloads.
+    Encrypt,
+    /// AES-256-GCM opening of stored payloads.
+    Decrypt,
+    /// Writing block headers and payloads to the archive, or extracted
+    /// data to its destination files.
+    Write,
+    /// Blocked on a queue: waiting for compressors, for read-ahead, or for
+    /// room behind the write-behind thread.
+    Stall,
+}
+
+impl Stage {
+    pub const ALL: [Stage; 6] = [Stage::Read, Stage::Hash, Stage::Encrypt, Stage::Decrypt, Stage::Write, Stage::Stall];
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Stage::Read    => "read",
+            Stage::Hash    => "blake3",
+            Stage::Encrypt => "aes-gcm seal",
+            Stage::Decrypt => "aes-gcm open",
+            Stage::Write   => "write",
+            Stage::Stall   => "queue stall",
+        }
+    }
+}
+
+/// Codec slots: the built-in codecs, then one for every plugin codec.
+const CODECS: [CodecId; 7] = [
+    CodecId::None, CodecId::Zstd, CodecId::Lz4, CodecId::Brotli, CodecId::Lzma, CodecId::LzmaMt, CodecId::Fill,
+];
+const CODEC_SLOTS: usize = CODECS.len() + 1;
+
+fn codec_slot(codec: CodecId) -> usize {
+    CODECS.iter().position(|&c| c == codec).unwrap_or(CODECS.len())
+}
+
+#[derive(Default)]
+struct Counter {
+    calls: AtomicU64,
+    bytes: AtomicU64,
+    nanos: AtomicU64,
+}
+
+impl Counter {
+    fn add(&self, bytes: usize, elapsed: Duration) {
+        self.calls.fetch_add(1, Ordering::Relaxed);
+        self.bytes.fetch_add(bytes as u64, Ordering::Relaxed);
+        self.nanos.fetch_add(elapsed.as_nanos() as u64, Ordering::Relaxed);
+    }
+
+    fn snapshot(&self) -> (u64, u64, u64) {
+        (self.calls.load(Ordering::Relaxed), self.bytes.load(Ordering::Relaxed), self.nanos.load(Ordering::Relaxed))
+    }
+}
+
+/// Counters shared by every thread working for one writer or reader.
+#[derive(Default)]
+pub struct Stats {
+    stages:       [Counter; Stage::ALL.len()],
+    /// `[compress, decompress]` per codec slot.
+    codecs:       [[Counter; 2]; CODEC_SLOTS],
+    dedup_hits:   AtomicU64,
+    dedup_misses: AtomicU64,
+}
+
+impl Stats {
+    pub fn new() -> Self { Self::default() }
+
+    pub fn add(&self, stage: Stage, bytes: usize, elapsed: Duration) {
+        self.stages[stage as usize].add(bytes, elapsed);
+    }
+
+    pub fn add_codec(&self, codec: CodecId, decompress: bool, bytes: usize, elapsed: Duration) {
+        self.codecs[codec_slot(codec)][decompress as usize].add(bytes, elapsed);
+    }
+
+    pub fn add_dedup(&self, hit: bool) {
+        let n = if hit { &self.dedup_hits } else { &self.dedup_misses };
+        n.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// The counters so far; `cache` is the reader's block cache, if any.
+    pub fn report(&self, cache: Option<CacheStats>) -> StatsReport {
+        let stages = Stage::ALL.iter()
+            .map(|&s| (s.name(), self.stages[s as usize].snapshot()))
+            .filter(|(_, (calls, ..))| *calls > 0)
+            .map(|(stage, (calls, bytes, nanos))| StageStats { stage: stage.into(), calls, bytes, nanos })
+            .collect();
+        let names = CODECS.iter().map(|c| c.name()).chain(["plugin"]);
+        let codecs = names.zip(&self.codecs)
+            .flat_map(|(codec, ops)| ["compress", "decompress"].into_iter().zip(ops)
+                .map(move |(op, counter)| (codec, op, counter.snapshot())))
+            .filter(|(_, _, (calls, ..))| *calls > 0)
+            .map(|(codec, op, (calls, bytes, nanos))| CodecStats { codec: codec.into(), op: op.into(), calls, bytes, nanos })
+            .collect();
+        StatsReport {
+            stages,
+            codecs,
+            dedup_hits:   self.dedup_hits.load(Ordering::Relaxed),
+            dedup_misses: self.dedup_misses.load(Ordering::Relaxed),
+            cache,
+        }
+    }
+}
+
+// ── Recording ────────────────────────────────────────────────────────────────
+
+thread_local! {
+    static CURRENT: RefCell<Option<Arc<Stats>>> = const { RefCell::new(None) };
+}
+
+/// Restores the thread's previous `Stats` when dropped; see [`install`].
+pub struct Installed {
+    prev: Option<Option<Arc<Stats>>>,
+}
+
+impl Drop for Installed {
+    fn drop(&mut self) {
+        if let Some(prev) = self.prev.take() {
+            CURRENT.with(|c| *c.borrow_mut() = prev);
+        }
+    }
+}
+
+/// Record this thread's work into `stats` until the guard is dropped.
+/// `None` leaves whatever is installed in place.
+pub fn install(stats: Option<&Arc<Stats>>) -> Installed {
+    Installed {
+        prev: stats.map(|s| CURRENT.with(|c| c.borrow_mut().replace(s.clone()))),
+    }
+}
+
+fn current() -> Option<Arc<Stats>> {
+    CURRENT.with(|c| c.borrow().clone())
+}
+
+/// Run `f`, recording it as one `stage` call over `bytes` bytes.
+#[inline]
+pub fn timed<T>(stage: Stage, bytes: usize, f: impl FnOnce() -> T) -> T {
+    let Some(stats) = current() else { return f() };
+    let start = Instant::now();
+    let out = f();
+    stats.add(stage, bytes, start.elapsed());
+    out
+}
+
+/// [`timed`] for a step whose byte count is known only once it is done:
+/// `f` returns its result and the count.
+#[inline]
+pub fn timed_counted<T>(stage: Stage, f: impl FnOnce() -> (T, usize)) -> T {
+    let Some(stats) = current() else { return f().0 };
+    let start = Instant::now();
+    let (out, bytes) = f();
+    stats.add(stage, bytes, start.elapsed());
+    out
+}
+
+/// Run `f`, recording it as compressing (or decompressing) `bytes`
+/// uncompressed bytes with `codec`.
+#[inline]
+pub fn timed_codec<T>(codec: CodecId, decompress: bool, bytes: usize, f: impl FnOnce() -> T) -> T {
+    let Some(stats) = current() else { return f() };
+    let start = Instant::now();
+    let out = f();
+    stats.add_codec(codec, decompress, bytes, start.elapsed());
+    out
+}
+
+/// Count one CAS lookup.
+#[inline]
+pub fn dedup(hit: bool) {
+    if let Some(stats) = current() {
+        stats.add_dedup(hit);
+    }
+}
+
+// ── Report ───────────────────────────────────────────────────────────────────
+
+#[derive(Debug, Clone, PartialEq, Eq, Serialize)]
+pub struct StageStats {
+    pub stage: String,
+    pub calls: u64,
+    pub bytes: u64,
+    /// Summed over threads, so it can exceed the wall-clock time.
+    pub nanos: u64,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq, Serialize)]
+pub struct CodecStats {
+    pub codec: String,
+    /// `"compress"` or `"decompress"`.
+    pub op:    String,
+    pub calls: u64,
+    /// Uncompressed bytes in or out.
+    pub bytes: u64,
+    pub nanos: u64,
+}
+
+/// Snapshot of a [`Stats`]; stages and codecs that never ran are left out.
+#[derive(Debug, Clone, Default, PartialEq, Eq, Serialize)]
+pub struct StatsReport {
+    pub stages:       Vec<StageStats>,
+    pub codecs:       Vec<CodecStats>,
+    pub dedup_hits:   u64,
+    pub dedup_misses: u64,
+    pub cache:        Option<CacheStats>,
+}
+
+impl StatsReport {
+    pub fn to_json(&self) -> String {
+        serde_json::to_string_pretty(self).expect("stats serialize")
+    }
+}
+
+impl fmt::Display for StatsReport {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fn row(f: &mut fmt::Formatter<'_>, name: &str, calls: u64, bytes: u64, nanos: u64) -> fmt::Result {
+            let secs = nanos as f64 / 1e9;
+            let rate = if nanos > 0 && bytes > 0 { format!("{:.1}", bytes as f64 / secs / 1e6) } else { "-".into() };
+            writeln!(f, "  {name:<22} {calls:>10} {:>12.1} {:>10.3} {rate:>10}", bytes as f64 / 1e6, secs)
+        }
+        writeln!(f, "  {:<22} {:>10} {:>12} {:>10} {:>10}", "stage", "calls", "MB", "thread-s", "MB/s")?;
+        for s in &self.stages {
+            row(f, &s.stage, s.calls, s.bytes, s.nanos)?;
+        }
+        for c in &self.codecs {
+            row(f, &format!("{} {}", c.codec, c.op), c.calls, c.bytes, c.nanos)?;
+        }
+        let lookups = self.dedup_hits + self.dedup_misses;
+        if lookups > 0 {
+            writeln!(f, "  dedup: {} of {} chunks already stored ({:.1}%)",
+                self.dedup_hits, lookups, 100.0 * self.dedup_hits as f64 / lookups as f64)?;
+        }
+        if let Some(c) = &self.cache {
+            let lookups = c.hits + c.misses;
+            if lookups > 0 {
+                writeln!(f, "  block cache: {} hits, {} misses ({:.1}% hit rate)",
+                    c.hits, c.misses, 100.0 * c.hits as f64 / lookups as f64)?;
+            }
+        }
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn records_only_while_installed() {
+        timed(Stage::Read, 10, || ());
+        let stats = Arc::new(Stats::new());
+        {
+            let _g = install(Some(&stats));
+            timed(Stage::Read, 100, || ());
+            timed_codec(CodecId::Zstd, false, 4096, || ());
+            timed_codec(CodecId::Plugin([7; 16]), true, 1, || ());
+            dedup(true);
+            dedup(false);
+            dedup(false);
+            // `None` keeps the installed stats.
+            let _inner = install(None);
+            timed(Stage::Read, 100, || ());
+        }
+        timed(Stage::Write, 1, || ());
+
+        let r = stats.report(None);
+        assert_eq!(r.stages.len(), 1);
+        assert_eq!((r.stages[0].stage.as_str(), r.stages[0].calls, r.stages[0].bytes), ("read", 2, 200));
+        let codecs: Vec<_> = r.codecs.iter().map(|c| (c.codec.as_str(), c.op.as_str(), c.bytes)).collect();
+        assert_eq!(codecs, [("zstd", "compress", 4096), ("plugin", "decompress", 1)]);
+        assert_eq!((r.dedup_hits, r.dedup_misses), (1, 2));
+        assert!(r.to_string().contains("1 of 3 chunks"));
+        assert!(r.to_json().contains("\"dedup_hits\": 1"));
+    }
+}
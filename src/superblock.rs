@@ -13,9 +13,23 @@
 //!   44      2   required_codec_count (LE u16)
 //!   46   N×16   required_codec_uuids (N × 16 raw bytes, LE field order)
 //!  46+N×16  4   header_crc32       CRC32 of all preceding bytes (LE u32)
+//!  50+N×16  8   block_table_offset byte offset of the BLOCK TABLE; 0 = none (LE u64)
+//!  58+N×16  4   pack_level         compression level of every block (LE i32)
 //!   ...    ...  zero padding to exactly 256 bytes
 //! ```
 //!
+//! `block_table_offset` sits after the CRC so that readers which predate it
+//! still accept the superblock.  So does `pack_level`, which is only
+//! meaningful when [`SB_FLAG_PACK_LEVEL`] (`0x02`) is set: archives whose
+//! blocks were copied in from archives packed at other (or unrecorded)
+//! levels leave it clear.
+//!
+//! Neither field is covered by `header_crc32`.  The BLOCK TABLE that
+//! `block_table_offset` points at validates itself (see
+//! [`crate::index::table`]), and a reader that finds no valid table there
+//! treats it as absent.  `pack_level` is advisory: it only decides whether
+//! copied blocks are re-encoded and whether an append keeps the level.
+//!
 //! # Codec declaration
 //! `required_codec_uuids` lists every codec UUID that appears in DATA or
 //! SOLID blocks.  A decoder MUST fail immediately if it cannot supply every
@@ -30,7 +44,8 @@ use std::io::{self, Read, Write};
 use uuid::Uuid;
 use crc32fast::Hasher;
 use thiserror::Error;
-use crate::codec::{CodecId, uuid_to_string};
+use crate::block::BlockHeader;
+use crate::codec::{CodecId, registry, uuid_to_string};
 
 pub const MAGIC:              &[u8; 4] = b".6cy";
 pub const FORMAT_VERSION:     u32      = 3;
@@ -39,6 +54,8 @@ pub const SUPERBLOCK_SIZE:    usize    = 256;
 
 /// Archive-level flag: at least one block is AES-256-GCM encrypted.
 pub const SB_FLAG_ENCRYPTED: u32 = 0x0001;
+/// Archive-level flag: `pack_level` is recorded and holds for every block.
+pub const SB_FLAG_PACK_LEVEL: u32 = 0x0002;
 
 #[derive(Error, Debug)]
 pub enum SuperblockError {
@@ -67,6 +84,11 @@ pub struct Superblock {
     /// Each entry is the raw 16-byte UUID (LE field order) of a required codec.
     /// Written during `finalize()`; empty while packing is in progress.
     pub required_codec_uuids:  Vec<[u8; 16]>,
+    /// Offset of the BLOCK TABLE footer, or 0.  Written during `finalize()`.
+    pub block_table_offset:    u64,
+    /// Level every DATA and SOLID block was compressed at, when known.
+    /// Written during `finalize()`; stored only with `SB_FLAG_PACK_LEVEL`.
+    pub pack_level:            Option<i32>,
 }
 
 impl Superblock {
@@ -79,6 +101,8 @@ impl Superblock {
             index_offset:         0,
             index_size:           0,
             required_codec_uuids: Vec::new(),
+            block_table_offset:   0,
+            pack_level:           None,
         }
     }
 
@@ -89,11 +113,15 @@ impl Superblock {
     pub fn write<W: Write>(&self, mut w: W) -> io::Result<()> {
         // Build the variable-length portion in a buffer first so we can CRC it.
         let mut body = Vec::with_capacity(SUPERBLOCK_SIZE);
+        let flags = match self.pack_level {
+            Some(_) => self.flags | SB_FLAG_PACK_LEVEL,
+            None    => self.flags & !SB_FLAG_PACK_LEVEL,
+        };
 
         body.extend_from_slice(&self.magic);                                       // 4
         body.extend_from_slice(&self.format_version.to_le_bytes());                // 4
         body.extend_from_slice(self.archive_uuid.as_bytes());                      // 16
-        body.extend_from_slice(&self.flags.to_le_bytes());                         // 4
+        body.extend_from_slice(&flags.to_le_bytes());                              // 4
         body.extend_from_slice(&self.index_offset.to_le_bytes());                  // 8
         body.extend_from_slice(&self.index_size.to_le_bytes());                    // 8
         body.extend_from_slice(&(self.required_codec_uuids.len() as u16).to_le_bytes()); // 2
@@ -106,6 +134,8 @@ impl Superblock {
         let mut h = Hasher::new();
         h.update(&body);
         body.extend_from_slice(&h.finalize().to_le_bytes()); // 4
+        body.extend_from_slice(&self.block_table_offset.to_le_bytes());            // 8
+        body.extend_from_slice(&self.pack_level.unwrap_or(0).to_le_bytes());       // 4
 
         // Pad to exactly SUPERBLOCK_SIZE with zeros.
         assert!(body.len() <= SUPERBLOCK_SIZE,
@@ -162,6 +192,13 @@ impl Superblock {
             return Err(SuperblockError::Crc32Mismatch);
         }
 
+        // Absent (zero) in archives from writers that predate the table.
+        let block_table_offset = buf.get(uuid_end + 4..uuid_end + 12)
+            .map_or(0, |b| u64::from_le_bytes(b.try_into().unwrap()));
+        let pack_level = buf.get(uuid_end + 12..uuid_end + 16)
+            .filter(|_| flags & SB_FLAG_PACK_LEVEL != 0)
+            .map(|b| i32::from_le_bytes(b.try_into().unwrap()));
+
         let sb = Self {
             magic: *MAGIC,
             format_version,
@@ -170,6 +207,8 @@ impl Superblock {
             index_offset,
             index_size,
             required_codec_uuids,
+            block_table_offset,
+            pack_level,
         };
 
         // Codec availability check — fail now, not at block decode time.
@@ -178,11 +217,12 @@ impl Superblock {
         Ok(sb)
     }
 
-    /// Verify that every required codec UUID is available in this build.
+    /// Verify that every required codec UUID is available in this process,
+    /// either built in or provided by a loaded plugin.
     /// Returns the first unavailable UUID if any are missing.
     pub fn check_codecs(&self) -> Result<(), SuperblockError> {
         for uuid_bytes in &self.required_codec_uuids {
-            if CodecId::from_uuid(uuid_bytes).is_none() {
+            if !registry::contains(uuid_bytes) {
                 return Err(SuperblockError::UnavailableCodec {
                     uuid: uuid_to_string(uuid_bytes),
                 });
@@ -202,4 +242,11 @@ impl Superblock {
             self.required_codec_uuids.push(uuid);
         }
     }
+
+    /// Register the codec a written block names.  It can differ from the
+    /// one the writer asked for: uniform blocks are stored as `Fill`.
+    pub fn add_block_codec(&mut self, header: &BlockHeader) {
+        self.add_required_codec(CodecId::builtin_from_uuid(&header.codec_uuid)
+            .unwrap_or(CodecId::Plugin(header.codec_uuid)));
+    }
 }
@@ -24,12 +24,1031 @@ fn test_pack_and_list() {
         let sb = sixcy::superblock::Superblock::read(&mut file).unwrap();
         
         file.seek(SeekFrom::Start(sb.index_offset)).unwrap();
-        let mut index_bytes = Vec::new();
-        file.read_to_end(&mut index_bytes).unwrap();
-        
+        let header = sixcy::BlockHeader::read(&mut file).unwrap();
+        let mut payload = vec![0u8; header.comp_size as usize];
+        file.read_exact(&mut payload).unwrap();
+        let index_bytes = sixcy::decode_block(&header, &payload, None).unwrap();
+
         let index = sixcy::index::FileIndex::from_bytes(&index_bytes).unwrap();
         assert_eq!(index.records.len(), 1);
         assert_eq!(index.records[0].name, file_name);
         assert_eq!(index.records[0].original_size, test_data.len() as u64);
     }
 }
+
+#[test]
+fn test_shared_dictionary_roundtrip() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::Dictionary;
+
+    let files: Vec<(String, Vec<u8>)> = (0..400)
+        .map(|i| (
+            format!("event_{i}.json"),
+            format!(r#"{{"id":{i},"service":"billing","level":"info","msg":"request {} handled","latency_ms":{}}}"#,
+                    i * 7, i % 13).into_bytes(),
+        ))
+        .collect();
+    let samples: Vec<&[u8]> = files.iter().map(|(_, d)| d.as_slice()).collect();
+    let dict = Dictionary::train(&samples, 4 * 1024).unwrap();
+
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let opts = PackOptions { dictionary: Some(dict), ..PackOptions::default() };
+        let mut ar = Archive::create(temp_file.path(), opts).unwrap();
+        for (name, data) in &files {
+            ar.add_file(name, data).unwrap();
+        }
+        ar.finalize().unwrap();
+    }
+
+    let ar = Archive::open(temp_file.path()).unwrap();
+    for (name, data) in files.iter().step_by(37) {
+        assert_eq!(&ar.read_file(name).unwrap(), data);
+    }
+}
+
+#[test]
+fn test_plugin_codec_roundtrip() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::codec::registry;
+    use sixcy::plugin::{rc, SixcyCodecPlugin};
+
+    // v1 plugin: XOR every byte with 0x5A.
+    unsafe extern "C" fn xor(i: *const u8, n: u32, o: *mut u8, on: *mut u32) -> i32 {
+        if *on < n { return rc::OVERFLOW; }
+        for k in 0..n as usize { *o.add(k) = *i.add(k) ^ 0x5A; }
+        *on = n;
+        rc::OK
+    }
+    unsafe extern "C" fn xor_c(i: *const u8, n: u32, o: *mut u8, on: *mut u32, _: i32) -> i32 {
+        xor(i, n, o, on)
+    }
+    unsafe extern "C" fn bound(n: u32) -> u32 { n }
+    static XOR_PLUGIN: SixcyCodecPlugin = SixcyCodecPlugin {
+        uuid:           [0xC0, 0xDE, 0, 0, 0, 0, 0, 0x40, 0x80, 0, 0, 0, 0, 0, 0, 0x01],
+        short_id:       77,
+        abi_version:    1,
+        compress:       Some(xor_c),
+        decompress:     Some(xor),
+        compress_bound: Some(bound),
+        ctx_create:     None,
+        ctx_destroy:    None,
+        compress_ctx:   None,
+        decompress_ctx: None,
+        dict_compress:   None,
+        dict_decompress: None,
+    };
+
+    let uuid = registry::register_plugin(&XOR_PLUGIN).unwrap();
+    let codec = CodecId::from_name(&sixcy::codec::uuid_to_string(&uuid)).unwrap();
+    assert_eq!(codec, CodecId::Plugin(uuid));
+    assert_eq!(codec.short_id().0, 77);
+
+    let data: Vec<u8> = (0..200_000u32).map(|i| (i % 251) as u8).collect();
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let opts = PackOptions { default_codec: codec, ..PackOptions::default() };
+        let mut ar = Archive::create(temp_file.path(), opts).unwrap();
+        ar.add_file("data.bin", &data).unwrap();
+        ar.finalize().unwrap();
+    }
+
+    let sb = sixcy::Superblock::read(&mut File::open(temp_file.path()).unwrap()).unwrap();
+    assert!(sb.required_codec_uuids.contains(&uuid));
+    let ar = Archive::open(temp_file.path()).unwrap();
+    assert_eq!(ar.read_file("data.bin").unwrap(), data);
+}
+
+#[test]
+fn test_decompress_into_builtin_codecs() {
+    use sixcy::get_codec;
+
+    let data: Vec<u8> = (0..300_000u32).map(|i| (i / 7 % 256) as u8).collect();
+    for id in [CodecId::None, CodecId::Zstd, CodecId::Lz4, CodecId::Brotli, CodecId::Lzma, CodecId::LzmaMt] {
+        let codec = get_codec(id).unwrap();
+        let comp  = codec.compress(&data, 3).unwrap();
+        let mut out = vec![0u8; data.len()];
+        assert_eq!(codec.decompress_into(&comp, &mut out).unwrap(), data.len(), "{}", id.name());
+        assert_eq!(out, data, "{}", id.name());
+
+        out.fill(0);
+        let (n, hash) = codec.decompress_into_hashed(&comp, &mut out).unwrap();
+        assert_eq!((n, out.as_slice()), (data.len(), data.as_slice()), "{}", id.name());
+        assert_eq!(hash, *blake3::hash(&data).as_bytes(), "{}", id.name());
+    }
+    for id in [CodecId::None, CodecId::Zstd] {
+        let codec = get_codec(id).unwrap();
+        let comp  = codec.compress(&data, 3).unwrap();
+        let mut short = vec![0u8; data.len() - 1];
+        assert!(codec.decompress_into(&comp, &mut short).is_err(), "{}", id.name());
+        assert!(codec.decompress_into_hashed(&comp, &mut short).is_err(), "{}", id.name());
+    }
+    // A Zstd frame cut short fails to decode before anything is hashed.
+    let zstd = get_codec(CodecId::Zstd).unwrap();
+    let comp = zstd.compress(&data, 3).unwrap();
+    assert!(zstd.decompress_into_hashed(&comp[..comp.len() / 2], &mut vec![0u8; data.len()]).is_err());
+}
+
+#[test]
+fn test_encode_block_into_reuses_payload() {
+    use sixcy::{decode_block, encode_block_into, BlockType};
+
+    let big:   Vec<u8> = (0..300_000u32).map(|i| (i / 7 % 256) as u8).collect();
+    let small: Vec<u8> = b"second block, smaller than the first".repeat(4);
+    let key = [7u8; 32];
+    for id in [CodecId::None, CodecId::Zstd, CodecId::Lz4, CodecId::Brotli, CodecId::Lzma, CodecId::LzmaMt] {
+        for key in [None, Some(&key)] {
+            // One buffer for both blocks: the second must not see the first.
+            let mut payload = Vec::new();
+            for data in [&big, &small] {
+                let hash   = sixcy::block::content_hash(data);
+                let header = encode_block_into(BlockType::Data, 1, 0, data, hash, id, 3, 1, key, None, &mut payload)
+                    .unwrap();
+                assert_eq!(header.comp_size as usize, payload.len(), "{}", id.name());
+                assert_eq!(&decode_block(&header, &payload, key).unwrap(), data, "{}", id.name());
+            }
+        }
+    }
+}
+
+#[test]
+fn test_decode_block_does_not_trust_orig_size_for_allocation() {
+    use sixcy::block::{encode_block, MAX_PREALLOC_RATIO};
+    use sixcy::{decode_block, BlockType};
+
+    // Repetitive but not uniform, so it stays Zstd at a ratio past the cap.
+    let data: Vec<u8> = b"0123456789abcdef".repeat(512 * 1024);
+    let key = [9u8; 32];
+    for key in [None, Some(&key)] {
+        let (header, payload) = encode_block(BlockType::Data, 0, 0, &data, CodecId::Zstd, 3, key).unwrap();
+        assert!(payload.len() * MAX_PREALLOC_RATIO < data.len(), "{} B payload", payload.len());
+        assert_eq!(decode_block(&header, &payload, key).unwrap(), data);
+
+        // A header claiming 4 GiB bounds the output instead of sizing it.
+        let mut lying = header.clone();
+        lying.orig_size = u32::MAX;
+        assert!(decode_block(&lying, &payload, key).is_err());
+
+        // Past the cap, output beyond `orig_size` stops the decode.
+        lying.orig_size = data.len() as u32 - 1;
+        assert!(decode_block(&lying, &payload, key).is_err());
+    }
+
+    // A Fill run's payload must state the length its header claims.
+    let zeros = vec![0u8; 64 * 1024];
+    let (header, payload) = encode_block(BlockType::Data, 0, 0, &zeros, CodecId::Zstd, 3, None).unwrap();
+    assert_eq!(header.codec_uuid, CodecId::Fill.uuid());
+    let mut lying = header.clone();
+    lying.orig_size = u32::MAX;
+    assert!(decode_block(&lying, &payload, None).is_err());
+}
+
+#[test]
+fn test_pipelined_writer_matches_sequential() {
+    use sixcy::io_stream::SixCyReader;
+
+    // Three distinct 4 KiB chunks repeated across files: heavy CAS traffic.
+    let pattern = |k: u8| -> Vec<u8> { (0..4096u32).map(|i| (i as u8).wrapping_mul(k) ^ k).collect() };
+    let chunks = [pattern(3), pattern(5), pattern(7)];
+    let files: Vec<(String, Vec<u8>)> = (0..6)
+        .map(|f| {
+            let data: Vec<u8> = (0..20).flat_map(|i| chunks[(i * (f + 1)) % 3].clone()).collect();
+            (format!("f{f}.bin"), data)
+        })
+        .chain(std::iter::once(("empty".to_string(), Vec::new())))
+        .collect();
+    let batch: Vec<(String, &[u8])> = files.iter().map(|(n, d)| (n.clone(), d.as_slice())).collect();
+
+    let pack = |threads: usize| {
+        let temp = NamedTempFile::new().unwrap();
+        let mut w = SixCyWriter::with_options(File::create(temp.path()).unwrap(), 4096, 3, None).unwrap();
+        w.threads = threads;
+        w.add_files(&batch, CodecId::Zstd).unwrap();
+        w.finalize().unwrap();
+        temp
+    };
+    let seq = pack(1);
+    let par = pack(8);
+
+    let r_seq = SixCyReader::new(File::open(seq.path()).unwrap()).unwrap();
+    let mut r_par = SixCyReader::new(File::open(par.path()).unwrap()).unwrap();
+    assert_eq!(r_seq.index.root_hash, r_par.index.root_hash);
+    let (idx_seq, idx_par) = (r_seq.index.to_index(), r_par.index.to_index());
+    for (a, b) in idx_seq.records.iter().zip(&idx_par.records) {
+        let offs = |r: &sixcy::FileIndexRecord| r.block_refs.iter().map(|b| b.archive_offset).collect::<Vec<_>>();
+        assert_eq!(offs(a), offs(b), "{}", a.name);
+    }
+    let mut stored: Vec<u64> = idx_par.records.iter()
+        .flat_map(|r| r.block_refs.iter().map(|b| b.archive_offset)).collect();
+    stored.sort();
+    stored.dedup();
+    assert_eq!(stored.len(), 3, "each distinct chunk must be stored exactly once");
+
+    for (i, (_, data)) in files.iter().enumerate() {
+        assert_eq!(&r_par.unpack_file(i as u32).unwrap(), data);
+    }
+}
+
+#[test]
+fn test_parallel_extract_matches_sequential() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::io_stream::SixCyReader;
+
+    let block: Vec<u8> = (0..5000u32).map(|i| (i * 31 % 253) as u8).collect();
+    let big: Vec<u8> = block.iter().cycle().take(block.len() * 9 + 123).copied().collect();
+    let files: Vec<(String, Vec<u8>)> = vec![
+        ("big.bin".into(),   big.clone()),
+        ("dup.bin".into(),   big),                       // every block a CAS hit
+        ("empty".into(),     Vec::new()),
+        ("solid_a".into(),   b"alpha ".repeat(300)),
+        ("solid_b".into(),   b"beta ".repeat(500)),
+    ];
+
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let opts = PackOptions { chunk_size: 4096, password: Some("pw".into()), ..PackOptions::default() };
+        let mut ar = Archive::create(temp_file.path(), opts).unwrap();
+        for (name, data) in &files[..3] {
+            ar.add_file(name, data).unwrap();
+        }
+        ar.begin_solid(CodecId::Lz4).unwrap();
+        for (name, data) in &files[3..] {
+            ar.add_file(name, data).unwrap();
+        }
+        ar.end_solid().unwrap();
+        ar.finalize().unwrap();
+    }
+
+    let out_dir = tempfile::tempdir().unwrap();
+    let ar = Archive::open_encrypted(temp_file.path(), "pw").unwrap();
+    ar.extract_all(out_dir.path()).unwrap();
+    for (name, data) in &files {
+        assert_eq!(&std::fs::read(out_dir.path().join(name)).unwrap(), data, "{name}");
+        assert_eq!(&ar.read_file(name).unwrap(), data, "{name}");
+    }
+
+    let key = sixcy::derive_key("pw", ar.uuid().as_bytes()).unwrap();
+    let mut r = SixCyReader::with_key(File::open(temp_file.path()).unwrap(), Some(key)).unwrap();
+    r.threads = 3;
+    for id in 0..files.len() as u32 {
+        assert_eq!(r.unpack_file_parallel(id).unwrap(), r.unpack_file(id).unwrap());
+    }
+}
+
+#[test]
+fn test_shared_archive_concurrent_read_at() {
+    use sixcy::archive::{Archive, PackOptions};
+
+    let big: Vec<u8> = (0..50_000u32).map(|i| (i.wrapping_mul(2654435761) >> 13) as u8).collect();
+    let small = b"solid member ".repeat(40);
+
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let opts = PackOptions { chunk_size: 4096, ..PackOptions::default() };
+        let mut ar = Archive::create(temp_file.path(), opts).unwrap();
+        ar.add_file("big", &big).unwrap();
+        ar.begin_solid(CodecId::Zstd).unwrap();
+        ar.add_file("pad", b"leading bytes").unwrap();
+        ar.add_file("small", &small).unwrap();
+        ar.end_solid().unwrap();
+        ar.finalize().unwrap();
+    }
+
+    let ar = Archive::open(temp_file.path()).unwrap();
+    std::thread::scope(|s| {
+        for t in 0..4u64 {
+            let (ar, big, small) = (&ar, &big, &small);
+            s.spawn(move || {
+                for i in 0..50u64 {
+                    // Unaligned ranges that start mid-block and cross blocks.
+                    let off = (t * 7919 + i * 1031) % big.len() as u64;
+                    let mut buf = vec![0u8; 5000];
+                    let n = ar.read_at("big", off, &mut buf).unwrap();
+                    let end = (off as usize + 5000).min(big.len());
+                    assert_eq!(&buf[..n], &big[off as usize..end]);
+
+                    let off = i % small.len() as u64;
+                    let mut buf = [0u8; 17];
+                    let n = ar.read_at("small", off, &mut buf).unwrap();
+                    let end = (off as usize + 17).min(small.len());
+                    assert_eq!(&buf[..n], &small[off as usize..end]);
+                }
+            });
+        }
+    });
+}
+
+#[test]
+fn test_block_cache_serves_solid_members() {
+    use sixcy::archive::{Archive, PackOptions};
+
+    let members: Vec<Vec<u8>> = (0..100u32).map(|i| format!("member {i} ").repeat(20).into_bytes()).collect();
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let mut ar = Archive::create(temp_file.path(), PackOptions::default()).unwrap();
+        ar.begin_solid(CodecId::Zstd).unwrap();
+        for (i, data) in members.iter().enumerate() {
+            ar.add_file(&format!("m{i}"), data).unwrap();
+        }
+        ar.end_solid().unwrap();
+        ar.finalize().unwrap();
+    }
+
+    let ar = Archive::open(temp_file.path()).unwrap();
+    for (i, data) in members.iter().enumerate() {
+        assert_eq!(&ar.read_file(&format!("m{i}")).unwrap(), data);
+    }
+    let mut buf = [0u8; 8];
+    ar.read_at("m42", 3, &mut buf).unwrap();
+    assert_eq!(&buf, &members[42][3..11]);
+
+    // One solid decode serves every member.
+    let stats = ar.cache_stats().unwrap();
+    assert_eq!((stats.misses, stats.hits, stats.entries), (1, 100, 1));
+}
+
+#[test]
+fn test_read_at_seeks_to_block() {
+    use sixcy::io_stream::SixCyReader;
+
+    let data: Vec<u8> = (0..64 * 1024u32).map(|i| (i % 251) as u8).collect();
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let mut w = SixCyWriter::with_options(File::create(temp_file.path()).unwrap(), 1024, 3, None).unwrap();
+        w.threads = 1;
+        w.add_file("f".into(), &data, CodecId::Lz4).unwrap();
+        w.finalize().unwrap();
+    }
+
+    let mut r = SixCyReader::new(File::open(temp_file.path()).unwrap()).unwrap();
+    let mut buf = [0u8; 100];
+    let off = data.len() as u64 - 1500;
+    assert_eq!(r.read_at(0, off, &mut buf).unwrap(), 100);
+    assert_eq!(&buf[..], &data[off as usize..off as usize + 100]);
+    // Only the one block covering the range was decoded.
+    assert_eq!(r.cache().stats().misses, 1);
+}
+
+#[test]
+fn test_content_defined_chunking_dedups_after_insertion() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::io_stream::{CdcParams, Chunking, SixCyReader};
+    use std::collections::HashSet;
+
+    let mut x = 0x2545_F491_4F6C_DD1Du64;
+    let v1: Vec<u8> = (0..256 * 1024).map(|_| { x ^= x << 13; x ^= x >> 7; x ^= x << 17; x as u8 }).collect();
+    let mut v2 = v1[..5000].to_vec();
+    v2.extend_from_slice(b"a few inserted bytes");
+    v2.extend_from_slice(&v1[5000..]);
+
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let opts = PackOptions {
+            chunking: Chunking::ContentDefined(CdcParams::with_avg(4096)),
+            threads:  3,
+            ..PackOptions::default()
+        };
+        let mut ar = Archive::create(temp_file.path(), opts).unwrap();
+        ar.add_files(&[("v1", &v1[..]), ("v2", &v2[..])]).unwrap();
+        ar.finalize().unwrap();
+    }
+
+    let r = SixCyReader::new(File::open(temp_file.path()).unwrap()).unwrap();
+    let offsets = |name: &str| -> Vec<u64> {
+        r.index.find_name(name).unwrap().block_refs().map(|br| br.archive_offset).collect()
+    };
+    let (a, b) = (offsets("v1"), offsets("v2"));
+    let stored: HashSet<u64> = a.iter().copied().collect();
+    let fresh = b.iter().filter(|o| !stored.contains(o)).count();
+    assert!(fresh <= 3, "{fresh} of {} chunks rewritten", b.len());
+
+    let ar = Archive::open(temp_file.path()).unwrap();
+    assert_eq!(ar.read_file("v2").unwrap(), v2);
+    let mut buf = vec![0u8; 10_000];
+    for off in [0u64, 4097, 123_456, v2.len() as u64 - 700] {
+        let n   = ar.read_at("v2", off, &mut buf).unwrap();
+        let end = (off as usize + buf.len()).min(v2.len());
+        assert_eq!(&buf[..n], &v2[off as usize..end]);
+    }
+}
+
+#[test]
+fn test_add_reader_matches_add_file() {
+    use sixcy::io_stream::{CdcParams, Chunking, SixCyReader};
+
+    /// Hands out at most 1000 bytes per `read`, like a pipe.
+    struct Trickle<'a>(&'a [u8]);
+    impl Read for Trickle<'_> {
+        fn read(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
+            let n = buf.len().min(self.0.len()).min(1000);
+            buf[..n].copy_from_slice(&self.0[..n]);
+            self.0 = &self.0[n..];
+            Ok(n)
+        }
+    }
+
+    let data: Vec<u8> = (0..100_000u32).map(|i| (i.wrapping_mul(2654435761) >> 11) as u8).collect();
+    for chunking in [Chunking::Fixed, Chunking::ContentDefined(CdcParams::with_avg(4096))] {
+        for threads in [1, 3] {
+            let temp_file = NamedTempFile::new().unwrap();
+            {
+                let mut w = SixCyWriter::with_options(File::create(temp_file.path()).unwrap(), 8192, 3, None).unwrap();
+                w.threads  = threads;
+                w.chunking = chunking;
+                w.add_file("mem".into(), &data, CodecId::Zstd).unwrap();
+                w.add_reader("stream".into(), Trickle(&data), CodecId::Zstd).unwrap();
+                w.add_reader("empty".into(), Trickle(&[]), CodecId::Zstd).unwrap();
+                w.finalize().unwrap();
+            }
+
+            let mut r = SixCyReader::new(File::open(temp_file.path()).unwrap()).unwrap();
+            let refs = |name: &str| -> Vec<(u64, u64)> {
+                r.index.find_name(name).unwrap().block_refs()
+                    .map(|br| (br.archive_offset, br.file_offset)).collect()
+            };
+            // Same boundaries, so every streamed chunk is a CAS hit.
+            assert_eq!(refs("stream"), refs("mem"), "{chunking:?}, {threads} threads");
+            assert_eq!(r.index.find_name("stream").unwrap().original_size(), data.len() as u64);
+            assert_eq!(r.unpack_file(1).unwrap(), data);
+            assert!(r.unpack_file(2).unwrap().is_empty());
+        }
+    }
+}
+
+#[test]
+fn test_block_table_footer() {
+    use sixcy::block::BlockHeader;
+    use sixcy::index::BlockTableView;
+    use sixcy::io_stream::SixCyReader;
+    use sixcy::recovery::RecoveryMap;
+    use std::io::Write;
+
+    let data: Vec<u8> = (0..60_000u32).map(|i| (i.wrapping_mul(2654435761) >> 13) as u8).collect();
+    for threads in [1, 3] {
+        let temp_file = NamedTempFile::new().unwrap();
+        {
+            let mut w = SixCyWriter::with_options(File::create(temp_file.path()).unwrap(), 8192, 3, None).unwrap();
+            w.threads = threads;
+            w.add_file("a".into(), &data, CodecId::Zstd).unwrap();
+            w.start_solid_session(CodecId::Lz4).unwrap();
+            w.add_file("s1".into(), b"solid one", CodecId::Lz4).unwrap();
+            w.add_file("s2".into(), b"solid two", CodecId::Lz4).unwrap();
+            w.flush_solid_session().unwrap();
+            w.add_file("b".into(), &data[..16_384], CodecId::Lz4).unwrap();
+            w.finalize().unwrap();
+        }
+        let bytes = std::fs::read(temp_file.path()).unwrap();
+
+        let ar = sixcy::Archive::open(temp_file.path()).unwrap();
+        let table = ar.block_table().expect("block table");
+        let entries: Vec<_> = table.iter().map(Result::unwrap).collect();
+        // Eight DATA blocks for "a" (CAS hits for "b"), one SOLID, the INDEX.
+        assert_eq!(entries.len(), 10, "{threads} threads");
+        for e in &entries {
+            let h = BlockHeader::read(&bytes[e.archive_offset as usize..]).unwrap();
+            assert_eq!((h.block_type, h.file_id, h.file_offset, h.comp_size, h.content_hash),
+                       (e.block_type, e.file_id, e.file_offset, e.comp_size, e.content_hash));
+        }
+        let sb = sixcy::Superblock::read(&bytes[..]).unwrap();
+        assert_eq!(entries.last().unwrap().archive_offset, sb.index_offset);
+
+        let rm   = table.recovery_map_offset() as usize;
+        let len  = u64::from_le_bytes(bytes[rm..rm + 8].try_into().unwrap()) as usize;
+        let map  = RecoveryMap::from_bytes(&bytes[rm + 8..rm + 8 + len]).unwrap();
+        assert_eq!(map.checkpoints.len(), 2);
+
+        // The table and a header scan reconstruct the same file list.
+        let refs = |idx: &sixcy::FileIndex| -> Vec<(u32, Vec<u64>)> {
+            idx.records.iter().map(|r| (r.id, r.block_refs.iter().map(|b| b.archive_offset).collect())).collect()
+        };
+        let mut r = SixCyReader::new(File::open(temp_file.path()).unwrap()).unwrap();
+        let from_table = r.scan_blocks().unwrap();
+        let scanned = sixcy::recovery::scan_file(temp_file.path()).unwrap().index;
+        assert_eq!(refs(&from_table), refs(&scanned));
+        assert!(BlockTableView::parse(&r.block_table().unwrap().unwrap()).is_ok());
+
+        drop(ar);
+
+        // A damaged table is ignored and the scan takes over.
+        let mut f = std::fs::OpenOptions::new().write(true).open(temp_file.path()).unwrap();
+        f.seek(SeekFrom::Start(sb.block_table_offset + 40)).unwrap();
+        f.write_all(&[0xAA]).unwrap();
+        drop(f);
+        let mut r = SixCyReader::new(File::open(temp_file.path()).unwrap()).unwrap();
+        assert!(BlockTableView::parse(&r.block_table().unwrap().unwrap()).is_err());
+        assert_eq!(refs(&r.scan_blocks().unwrap()), refs(&scanned));
+        assert!(sixcy::Archive::open(temp_file.path()).unwrap().block_table().is_none());
+    }
+}
+
+#[test]
+fn test_copy_from_merges_without_recompressing() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::BlockType;
+
+    let shared: Vec<u8> = (0..40_000u32).map(|i| (i.wrapping_mul(2654435761) >> 13) as u8).collect();
+    let opts = |level| PackOptions { chunk_size: 8192, level, threads: 2, ..PackOptions::default() };
+    let (a, b, out) = (NamedTempFile::new().unwrap(), NamedTempFile::new().unwrap(), NamedTempFile::new().unwrap());
+    {
+        let mut ar = Archive::create(a.path(), opts(3)).unwrap();
+        ar.add_file("shared", &shared).unwrap();
+        ar.add_file("only_a", b"alpha").unwrap();
+        ar.finalize().unwrap();
+        let mut ar = Archive::create(b.path(), opts(3)).unwrap();
+        ar.add_file("shared", &shared).unwrap();
+        ar.begin_solid(CodecId::Lz4).unwrap();
+        ar.add_file("solid", b"in a solid block").unwrap();
+        ar.end_solid().unwrap();
+        ar.finalize().unwrap();
+    }
+
+    let (src_a, src_b) = (Archive::open(a.path()).unwrap(), Archive::open(b.path()).unwrap());
+    assert_eq!(src_a.pack_level(), Some(3));
+    let mut dst = Archive::create(out.path(), opts(3)).unwrap();
+    let sa = dst.copy_from(&src_a, |n| format!("a/{n}"), |_| true).unwrap();
+    let sb = dst.copy_from(&src_b, |n| format!("b/{n}"), |_| true).unwrap();
+    dst.finalize().unwrap();
+    assert_eq!((sa.files_copied, sa.files_reencoded, sa.blocks_copied), (2, 0, 6));
+    // "b/shared" is all CAS hits on the blocks copied from `a`.
+    assert_eq!((sb.files_copied, sb.files_reencoded, sb.blocks_copied), (1, 1, 0));
+
+    let merged = Archive::open(out.path()).unwrap();
+    assert_eq!(merged.read_file("a/shared").unwrap(), shared);
+    assert_eq!(merged.read_file("b/shared").unwrap(), shared);
+    assert_eq!(merged.read_file("a/only_a").unwrap(), b"alpha");
+    assert_eq!(merged.read_file("b/solid").unwrap(), b"in a solid block");
+    assert_eq!(merged.pack_level(), Some(3));
+    let (x, y) = (merged.stat("a/shared").unwrap(), merged.stat("b/shared").unwrap());
+    assert_eq!(x.compressed_size, y.compressed_size);
+
+    // Copied payloads are byte-identical to the source's.
+    let (src_bytes, dst_bytes) = (std::fs::read(a.path()).unwrap(), std::fs::read(out.path()).unwrap());
+    let payloads = |bytes: &[u8], ar: &Archive| -> Vec<Vec<u8>> {
+        ar.block_table().unwrap().iter().map(Result::unwrap)
+            .filter(|e| e.block_type == BlockType::Data)
+            .map(|e| { let at = e.archive_offset as usize + sixcy::BLOCK_HEADER_SIZE; bytes[at..at + e.comp_size as usize].to_vec() })
+            .collect()
+    };
+    let copied = payloads(&dst_bytes, &merged);
+    for p in payloads(&src_bytes, &src_a) {
+        assert!(copied.contains(&p));
+    }
+
+    // A filter that rejects every block re-encodes, which keeps the level.
+    let out2 = NamedTempFile::new().unwrap();
+    let mut dst = Archive::create(out2.path(), opts(19)).unwrap();
+    let s = dst.copy_from(&src_a, str::to_owned, |_| false).unwrap();
+    assert_eq!((s.files_copied, s.files_reencoded), (0, 2));
+    dst.finalize().unwrap();
+    assert_eq!(Archive::open(out2.path()).unwrap().pack_level(), Some(19));
+
+    // Copying level-3 blocks into a level-19 archive leaves it unrecorded.
+    let out3 = NamedTempFile::new().unwrap();
+    let mut dst = Archive::create(out3.path(), opts(19)).unwrap();
+    let s = dst.copy_from(&src_b, str::to_owned, |h| h.codec_id() == Some(CodecId::Zstd)).unwrap();
+    assert_eq!((s.files_copied, s.files_reencoded, s.blocks_copied), (1, 1, 5));
+    dst.finalize().unwrap();
+    let ar = Archive::open(out3.path()).unwrap();
+    assert_eq!(ar.read_file("solid").unwrap(), b"in a solid block");
+    assert_eq!(ar.pack_level(), None);
+}
+
+#[test]
+fn test_solid_session_splits_into_bounded_blocks() {
+    use sixcy::io_stream::SixCyReader;
+    use sixcy::BlockType;
+
+    let big: Vec<u8> = (0..2500u32).map(|i| (i % 251) as u8).collect();
+    let temp_file = NamedTempFile::new().unwrap();
+
+    // A block size of 0, or under one chunk, is refused up front.
+    let mut w = SixCyWriter::new(std::io::Cursor::new(Vec::new())).unwrap();
+    w.solid_block_size = 0;
+    assert_eq!(w.start_solid_session(CodecId::Zstd).unwrap_err().kind(), std::io::ErrorKind::InvalidInput);
+    let opts = sixcy::PackOptions { chunk_size: 64 * 1024, solid_block_size: 4096, ..Default::default() };
+    let mut ar = sixcy::Archive::create(temp_file.path(), opts).unwrap();
+    assert_eq!(ar.begin_solid(CodecId::Zstd).unwrap_err().kind(), std::io::ErrorKind::InvalidInput);
+    drop(ar);
+
+    {
+        let mut w = SixCyWriter::new(File::create(temp_file.path()).unwrap()).unwrap();
+        w.solid_block_size = 1000;
+        w.start_solid_session(CodecId::Zstd).unwrap();
+        w.add_file("small".into(), b"first member", CodecId::Zstd).unwrap();
+        w.add_file("big".into(), &big, CodecId::Zstd).unwrap();
+        w.add_file("empty".into(), b"", CodecId::Zstd).unwrap();
+        w.add_reader("streamed".into(), &big[..1500], CodecId::Zstd).unwrap();
+        w.flush_solid_session().unwrap();
+        w.finalize().unwrap();
+    }
+
+    let ar = sixcy::Archive::open(temp_file.path()).unwrap();
+    let solid = ar.block_table().unwrap().iter().map(Result::unwrap)
+        .filter(|e| e.block_type == BlockType::Solid)
+        .count();
+    // 12 + 2500 + 1500 bytes in blocks of at most 1000.
+    assert_eq!(solid, 5);
+    assert_eq!(ar.stat("big").unwrap().block_count, 3);
+    assert_eq!(ar.stat("empty").unwrap().block_count, 0);
+
+    assert_eq!(ar.read_file("small").unwrap(), b"first member");
+    assert_eq!(ar.read_file("big").unwrap(), big);
+    assert_eq!(ar.read_file("empty").unwrap(), b"");
+    assert_eq!(ar.read_file("streamed").unwrap(), &big[..1500]);
+
+    // A read across a block cut touches only the two blocks around it.
+    let mut buf = [0u8; 200];
+    assert_eq!(ar.read_at("big", 900, &mut buf).unwrap(), 200);
+    assert_eq!(&buf[..], &big[900..1100]);
+    let mut r = SixCyReader::new(File::open(temp_file.path()).unwrap()).unwrap();
+    let id = ar.stat("big").unwrap().id;
+    assert_eq!(r.read_at(id, 2400, &mut buf).unwrap(), 100);
+    assert_eq!(&buf[..100], &big[2400..]);
+    assert_eq!(r.cache().stats().misses, 1);
+}
+
+#[test]
+fn test_block_threads_encode_one_block_in_parallel() {
+    use sixcy::codec::{get_codec, LZMA_MT_STREAM_SIZE};
+    use sixcy::{decode_block, encode_block_into, BlockType};
+
+    // Three lzma-mt streams, the last one short.
+    let data: Vec<u8> = (0..2 * LZMA_MT_STREAM_SIZE as u32 + 12_345).map(|i| (i / 5 % 251) as u8).collect();
+    let hash = sixcy::block::content_hash(&data);
+    for id in [CodecId::Zstd, CodecId::LzmaMt] {
+        let (mut serial, mut threaded) = (Vec::new(), Vec::new());
+        let h1 = encode_block_into(BlockType::Data, 1, 0, &data, hash, id, 3, 1, None, None, &mut serial).unwrap();
+        let h4 = encode_block_into(BlockType::Data, 1, 0, &data, hash, id, 3, 4, None, None, &mut threaded).unwrap();
+        assert_eq!(h4.codec_uuid, id.uuid());
+        assert_eq!(decode_block(&h1, &serial, None).unwrap(), data, "{}", id.name());
+        assert_eq!(decode_block(&h4, &threaded, None).unwrap(), data, "{}", id.name());
+        if id == CodecId::LzmaMt {
+            // Streams are cut by size, not by thread count.
+            assert_eq!(serial, threaded);
+            assert_eq!(u32::from_le_bytes(serial[..4].try_into().unwrap()), 3);
+        }
+    }
+
+    // Malformed lzma-mt payloads are rejected, not decoded short.
+    let codec = get_codec(CodecId::LzmaMt).unwrap();
+    let comp  = codec.compress(&data, 0).unwrap();
+    let mut out = vec![0u8; data.len()];
+    assert_eq!(codec.decompress_into(&comp, &mut out).unwrap(), data.len());
+    assert!(codec.decompress_into(&comp[..comp.len() - 1], &mut out).is_err());
+    let mut trailing = comp.clone();
+    trailing.push(0);
+    assert!(codec.decompress_into(&trailing, &mut out).is_err());
+    assert!(codec.decompress_into(&comp, &mut out[..data.len() - 1]).is_err());
+
+    // The writer hands its budget to SOLID blocks.
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let mut w = SixCyWriter::new(File::create(temp_file.path()).unwrap()).unwrap();
+        w.block_threads = 4;
+        w.start_solid_session(CodecId::LzmaMt).unwrap();
+        w.add_file("a".into(), &data[..LZMA_MT_STREAM_SIZE + 1], CodecId::LzmaMt).unwrap();
+        w.add_file("b".into(), &data, CodecId::LzmaMt).unwrap();
+        w.flush_solid_session().unwrap();
+        w.finalize().unwrap();
+    }
+    let ar = sixcy::Archive::open(temp_file.path()).unwrap();
+    assert_eq!(ar.read_file("a").unwrap(), &data[..LZMA_MT_STREAM_SIZE + 1]);
+    assert_eq!(ar.read_file("b").unwrap(), data);
+}
+
+#[test]
+fn test_uniform_chunks_are_stored_as_fill_blocks() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::block::{content_hash, uniform_byte};
+    use sixcy::codec::{get_codec, UUID_FILL};
+    use sixcy::{decode_block, encode_block, BlockType};
+
+    // A sparse image: zero pages, a run of 0xFF, real data, zeros again.
+    const PAGE: usize = 64 * 1024;
+    let mut image = vec![0u8; 3 * PAGE];
+    image.extend(std::iter::repeat(0xFF).take(PAGE));
+    image.extend((0..PAGE as u32).map(|i| (i.wrapping_mul(2_654_435_761) >> 11) as u8));
+    image.extend(vec![0u8; PAGE]);
+
+    let zeros = &image[..3 * PAGE];
+    assert_eq!(uniform_byte(zeros), Some(0));
+    assert_eq!(uniform_byte(&image[..3 * PAGE + 1]), None);
+    let mut dented = zeros.to_vec();
+    dented[PAGE + 17] = 1;
+    assert_eq!(uniform_byte(&dented), None);
+    assert_eq!(content_hash(zeros), *blake3::hash(zeros).as_bytes());
+    assert_eq!(content_hash(&dented), *blake3::hash(&dented).as_bytes());
+
+    let (header, payload) = encode_block(BlockType::Data, 0, 0, &image[3 * PAGE..4 * PAGE], CodecId::Zstd, 3, None)
+        .unwrap();
+    assert_eq!((header.codec_uuid, payload.len()), (UUID_FILL, 5));
+    assert_eq!(decode_block(&header, &payload, None).unwrap(), &image[3 * PAGE..4 * PAGE]);
+    assert!(get_codec(CodecId::Fill).unwrap().compress(&image[4 * PAGE..5 * PAGE], 0).is_err());
+
+    // Fill is never a user choice: not by name, UUID or option.
+    assert_eq!(CodecId::from_name("fill"), None);
+    assert_eq!(CodecId::from_name(&CodecId::Fill.uuid_str()), None);
+    let rejected = NamedTempFile::new().unwrap();
+    let opts = PackOptions { default_codec: CodecId::Fill, ..PackOptions::default() };
+    let err = Archive::create(rejected.path(), opts).err().unwrap();
+    assert_eq!(err.kind(), std::io::ErrorKind::InvalidInput);
+
+    for threads in [1, 2] {
+        let temp_file = NamedTempFile::new().unwrap();
+        {
+            let opts = PackOptions { chunk_size: PAGE, threads, ..PackOptions::default() };
+            let mut ar = Archive::create(temp_file.path(), opts).unwrap();
+            ar.add_file("disk.img", &image).unwrap();
+            ar.finalize().unwrap();
+        }
+        let sb = sixcy::Superblock::read(&mut File::open(temp_file.path()).unwrap()).unwrap();
+        assert!(sb.required_codec_uuids.contains(&UUID_FILL));
+
+        let ar = Archive::open(temp_file.path()).unwrap();
+        assert_eq!(ar.read_file("disk.img").unwrap(), image);
+        // Four zero chunks share one fill block; the 0xFF chunk has its own.
+        let blocks: Vec<_> = ar.block_table().unwrap().iter().map(Result::unwrap)
+            .filter(|e| e.block_type == BlockType::Data)
+            .collect();
+        assert_eq!(blocks.len(), 3);
+        assert_eq!(blocks.iter().filter(|e| e.comp_size == 5).count(), 2);
+    }
+}
+
+#[test]
+fn test_adaptive_mode_stores_incompressible_chunks() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::codec::UUID_ZSTD;
+    use sixcy::BlockType;
+
+    let mut x = 0x2545_f491_4f6c_dd1du64;
+    let noise: Vec<u8> = (0..256 * 1024).map(|_| { x ^= x << 13; x ^= x >> 7; x ^= x << 17; x as u8 }).collect();
+    let text = b"2026-10-14 12:00:00 INFO request served in 3 ms\n".repeat(5000);
+
+    for threads in [1, 2] {
+        let temp_file = NamedTempFile::new().unwrap();
+        {
+            let opts = PackOptions { chunk_size: 64 * 1024, threads, adaptive: true, ..PackOptions::default() };
+            let mut ar = Archive::create(temp_file.path(), opts).unwrap();
+            ar.add_file("photo.jpg", &noise).unwrap();
+            ar.add_file("server.log", &text).unwrap();
+            ar.finalize().unwrap();
+        }
+        let ar = Archive::open(temp_file.path()).unwrap();
+        assert_eq!(ar.read_file("photo.jpg").unwrap(), noise);
+        assert_eq!(ar.read_file("server.log").unwrap(), text);
+
+        // Noise is stored as is; the log still goes through Zstd.
+        let photo = ar.stat("photo.jpg").unwrap();
+        assert_eq!(photo.compressed_size, photo.original_size);
+        assert!(ar.stat("server.log").unwrap().compressed_size < text.len() as u64 / 10);
+        let bytes = std::fs::read(temp_file.path()).unwrap();
+        let codecs: Vec<[u8; 16]> = ar.block_table().unwrap().iter().map(Result::unwrap)
+            .filter(|e| e.block_type == BlockType::Data)
+            .map(|e| sixcy::BlockHeader::read(&bytes[e.archive_offset as usize..]).unwrap().codec_uuid)
+            .collect();
+        assert_eq!(codecs.iter().filter(|u| **u == CodecId::None.uuid()).count(), 4);
+        assert!(codecs.iter().any(|u| *u == UUID_ZSTD));
+    }
+}
+
+#[test]
+fn test_read_ahead_and_write_behind() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::io_stream::SixCyReader;
+
+    let text: Vec<u8> = (0..300_000u32).map(|i| b"read ahead, write behind "[(i % 25) as usize]).collect();
+    let files: Vec<(String, Vec<u8>)> = vec![
+        ("a".into(), text.clone()),
+        ("b".into(), text.iter().rev().copied().collect()),
+        ("c".into(), text[..10_000].to_vec()),
+    ];
+
+    // A write-behind queue of one buffer still produces the same archive.
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let opts = PackOptions { chunk_size: 16 * 1024, threads: 2, io_depth: 1, ..PackOptions::default() };
+        let mut ar = Archive::create(temp_file.path(), opts).unwrap();
+        for (name, data) in &files {
+            ar.add_file(name, data).unwrap();
+        }
+        ar.finalize().unwrap();
+    }
+
+    let mut ar = Archive::open(temp_file.path()).unwrap();
+    ar.set_io_depth(3).unwrap();
+    let out_dir = tempfile::tempdir().unwrap();
+    ar.extract_all(out_dir.path()).unwrap();
+    for (name, data) in &files {
+        assert_eq!(&std::fs::read(out_dir.path().join(name)).unwrap(), data, "{name}");
+    }
+
+    // Without a mapping the I/O threads read payloads into buffers.
+    let mut r = SixCyReader::new(File::open(temp_file.path()).unwrap()).unwrap();
+    r.threads = 2;
+    for io_depth in [0, 1, 4] {
+        r.io_depth = io_depth;
+        r.set_cache_budget(0);
+        for (id, (_, data)) in files.iter().enumerate() {
+            assert_eq!(&r.unpack_file_parallel(id as u32).unwrap(), data);
+        }
+        // Spans five blocks, under `PARALLEL_READ_MIN_BYTES`: decoded inline.
+        let mut buf = vec![0u8; 70_000];
+        assert_eq!(r.read_at_shared(0, 5_000, &mut buf).unwrap(), buf.len());
+        assert_eq!(&buf[..], &text[5_000..75_000]);
+    }
+}
+
+#[test]
+fn test_append_reuses_stored_chunks() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::BlockType;
+
+    const CHUNK: usize = 4096;
+    let mut x = 0x9e37_79b9_7f4a_7c15u64;
+    let base: Vec<u8> = (0..64 * CHUNK).map(|_| { x ^= x << 13; x ^= x >> 7; x ^= x << 17; x as u8 }).collect();
+    let mut edited = base.clone();
+    edited[10 * CHUNK + 7] ^= 0xff;                 // one chunk changes
+
+    let temp_file = NamedTempFile::new().unwrap();
+    let opts = || PackOptions { chunk_size: CHUNK, threads: 2, ..PackOptions::default() };
+    {
+        let mut ar = Archive::create(temp_file.path(), opts()).unwrap();
+        ar.add_file("disk.img", &base).unwrap();
+        ar.add_file("notes.txt", b"monday").unwrap();
+        ar.finalize().unwrap();
+    }
+    let before = std::fs::metadata(temp_file.path()).unwrap().len();
+    let uuid   = Archive::open(temp_file.path()).unwrap().uuid();
+
+    {
+        let mut ar = Archive::append(temp_file.path(), opts()).unwrap();
+        ar.add_file("disk.img", &edited).unwrap();
+        ar.add_file("tuesday.txt", b"tuesday").unwrap();
+        ar.finalize().unwrap();
+    }
+    // One new DATA block for the edit, plus the new file and footers.
+    let written = std::fs::metadata(temp_file.path()).unwrap().len() - before;
+    assert!(written < (base.len() / 8) as u64, "{written} B appended");
+
+    let ar = Archive::open(temp_file.path()).unwrap();
+    assert_eq!(ar.uuid(), uuid);
+    assert_eq!(ar.list().len(), 4);
+    assert_eq!(ar.read_file("disk.img").unwrap(), edited, "newest version wins");
+    assert_eq!(ar.read_file_by_id(0).unwrap(), base, "old version is kept");
+    assert_eq!(ar.read_file("notes.txt").unwrap(), b"monday");
+    assert_eq!(ar.read_file("tuesday.txt").unwrap(), b"tuesday");
+    let data_blocks = ar.block_table().unwrap().iter().map(Result::unwrap)
+        .filter(|e| e.block_type == BlockType::Data)
+        .count();
+    assert_eq!(data_blocks, 64 + 1 + 1 + 1);
+
+    // A header scan carries on past the superseded footer.
+    let report = sixcy::recovery::scan_file(temp_file.path()).unwrap();
+    assert_eq!(report.corrupt_blocks, 0);
+    let scanned = report.block_log.iter()
+        .filter(|b| b.header.as_ref().is_some_and(|h| h.block_type == BlockType::Data))
+        .count();
+    assert_eq!(scanned, data_blocks);
+
+    // The key has to match the archive's encryption.
+    let err = Archive::append(temp_file.path(), PackOptions { password: Some("pw".into()), ..opts() });
+    assert_eq!(err.err().unwrap().kind(), std::io::ErrorKind::InvalidInput);
+
+    // ...and be the archive's key: a wrong password is refused before any write.
+    let secret = NamedTempFile::new().unwrap();
+    let sealed = || PackOptions { password: Some("pw".into()), ..opts() };
+    {
+        let mut ar = Archive::create(secret.path(), sealed()).unwrap();
+        ar.add_file("disk.img", &base).unwrap();
+        ar.finalize().unwrap();
+    }
+    let len = std::fs::metadata(secret.path()).unwrap().len();
+    let err = Archive::append(secret.path(), PackOptions { password: Some("wrong".into()), ..opts() });
+    assert_eq!(err.err().unwrap().kind(), std::io::ErrorKind::InvalidInput);
+    assert_eq!(std::fs::metadata(secret.path()).unwrap().len(), len);
+
+    let mut ar = Archive::append(secret.path(), sealed()).unwrap();
+    ar.add_file("edited.img", &edited).unwrap();
+    ar.finalize().unwrap();
+    let ar = Archive::open_encrypted(secret.path(), "pw").unwrap();
+    assert_eq!(ar.read_file("edited.img").unwrap(), edited);
+}
+
+#[test]
+fn test_dedup_table_spills_and_still_dedups() {
+    use sixcy::io_stream::SixCyReader;
+
+    // 70,000 distinct 64-byte chunks: past one spill run of full hashes.
+    const CHUNK: usize = 64;
+    const CHUNKS: usize = 70_000;
+    let mut x = 0x2545_f491_4f6c_dd1du64;
+    let data: Vec<u8> = (0..CHUNKS * CHUNK).map(|_| { x ^= x << 13; x ^= x >> 7; x ^= x << 17; x as u8 }).collect();
+    let batch: Vec<(String, &[u8])> = vec![("a.bin".to_string(), data.as_slice()), ("b.bin".to_string(), data.as_slice())];
+
+    let temp = NamedTempFile::new().unwrap();
+    let mut w = SixCyWriter::with_options(File::create(temp.path()).unwrap(), CHUNK, 1, None).unwrap();
+    w.threads = 4;
+    w.set_dedup_memory(0).unwrap();
+    w.add_files(&batch, CodecId::Lz4).unwrap();
+    w.add_file("c.bin".into(), &data, CodecId::Lz4).unwrap();
+    assert_eq!(w.dedup_table().len(), CHUNKS);
+    assert!(w.dedup_table().spilled() >= 64 * 1024);
+    w.finalize().unwrap();
+
+    let mut r = SixCyReader::new(File::open(temp.path()).unwrap()).unwrap();
+    let index = r.index.to_index();
+    let offsets = |id: usize| index.records[id].block_refs.iter().map(|b| b.archive_offset).collect::<Vec<_>>();
+    assert_eq!(offsets(0).len(), CHUNKS);
+    assert_eq!(offsets(1), offsets(0), "second copy is all CAS references");
+    assert_eq!(offsets(2), offsets(0), "spilled hashes are found by the sequential writer too");
+    for id in 0..3 {
+        assert_eq!(r.unpack_file(id).unwrap(), data);
+    }
+    drop(r);
+
+    // Appending rebuilds the table under the budget it is given.
+    let existing = File::open(temp.path()).unwrap();
+    let out = std::fs::OpenOptions::new().write(true).open(temp.path()).unwrap();
+    let mut w = SixCyWriter::append(existing, out, CHUNK, 1, None, 0).unwrap();
+    assert_eq!(w.dedup_table().len(), CHUNKS);
+    assert!(w.dedup_table().spilled() >= 64 * 1024);
+    w.add_file("d.bin".into(), &data, CodecId::Lz4).unwrap();
+    w.finalize().unwrap();
+    let r = SixCyReader::new(File::open(temp.path()).unwrap()).unwrap();
+    let index = r.index.to_index();
+    let appended: Vec<u64> = index.records[3].block_refs.iter().map(|b| b.archive_offset).collect();
+    assert_eq!(appended, offsets(0), "appended copy is all CAS references");
+}
+
+#[test]
+fn test_stats_count_stages_codecs_and_dedup() {
+    use sixcy::io_stream::SixCyReader;
+
+    // 16 distinct 4 KiB chunks, stored once and then referenced twice.
+    const CHUNK: usize = 4096;
+    let data: Vec<u8> = (0..16 * CHUNK).map(|i| (i / CHUNK) as u8 ^ (i % 251) as u8).collect();
+    let batch: Vec<(String, &[u8])> = vec![("a.bin".to_string(), data.as_slice()), ("b.bin".to_string(), data.as_slice())];
+
+    let temp = NamedTempFile::new().unwrap();
+    let mut w = SixCyWriter::with_options(File::create(temp.path()).unwrap(), CHUNK, 3, None).unwrap();
+    assert!(w.stats().is_none());
+    w.enable_stats();
+    w.threads = 4;
+    w.add_files(&batch, CodecId::Zstd).unwrap();
+    w.add_file("c.bin".into(), &data, CodecId::Zstd).unwrap();
+    w.finalize().unwrap();
+
+    let report = w.stats().unwrap();
+    let stage = |name: &str| report.stages.iter().find(|s| s.stage == name).cloned();
+    assert_eq!((report.dedup_hits, report.dedup_misses), (32, 16));
+    assert!(stage("blake3").unwrap().bytes >= 3 * data.len() as u64, "every chunk is hashed");
+    assert!(stage("write").unwrap().calls >= 16);
+    assert!(stage("aes-gcm seal").is_none(), "nothing was encrypted");
+    let zstd = report.codecs.iter().find(|c| c.codec == "zstd" && c.op == "compress").unwrap();
+    assert!(zstd.calls >= 16 && zstd.bytes >= data.len() as u64);
+    assert!(report.cache.is_none());
+    assert!(report.to_json().contains("\"dedup_hits\": 32"));
+    assert!(report.to_string().contains("blake3"));
+
+    let mut r = SixCyReader::new(File::open(temp.path()).unwrap()).unwrap();
+    r.enable_stats();
+    for id in 0..3 {
+        assert_eq!(r.unpack_file(id).unwrap(), data);
+    }
+    let report = r.stats().unwrap();
+    assert!(report.stages.iter().any(|s| s.stage == "read" && s.calls > 0));
+    let zstd = report.codecs.iter().find(|c| c.codec == "zstd" && c.op == "decompress").unwrap();
+    assert!(zstd.bytes >= data.len() as u64);
+    assert!(report.cache.is_some());
+}
+
+#[test]
+fn test_key_cache_reopens_without_deriving_again() {
+    use sixcy::archive::{Archive, PackOptions};
+    use sixcy::KeyCache;
+
+    let temp_file = NamedTempFile::new().unwrap();
+    {
+        let opts = PackOptions { chunk_size: 4096, password: Some("pw".into()), ..PackOptions::default() };
+        let mut ar = Archive::create(temp_file.path(), opts).unwrap();
+        ar.add_file("secret.txt", &b"on a need-to-know basis ".repeat(500)).unwrap();
+        ar.finalize().unwrap();
+    }
+
+    let cache = KeyCache::new(8);
+    for _ in 0..3 {
+        let ar = Archive::open_encrypted_cached(temp_file.path(), "pw", &cache).unwrap();
+        assert_eq!(ar.read_file("secret.txt").unwrap(), b"on a need-to-know basis ".repeat(500));
+    }
+    assert_eq!(cache.len(), 1, "one derivation for three opens");
+
+    // A wrong password is derived on its own and fails at the first block.
+    let ar = Archive::open_encrypted_cached(temp_file.path(), "wrong", &cache).unwrap();
+    assert!(ar.read_file("secret.txt").is_err());
+    assert_eq!(cache.len(), 2);
+
+    let uuid = ar.uuid();
+    cache.forget(&uuid);
+    assert!(cache.is_empty());
+}